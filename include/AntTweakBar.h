@@ -133,8 +133,34 @@ TW_API int      TW_CALL TwAddVarRO(TwBar *bar, const char *name, TwType type, co
 TW_API int      TW_CALL TwAddVarCB(TwBar *bar, const char *name, TwType type, TwSetVarCallback setCallback, TwGetVarCallback getCallback, void *clientData, const char *def);
 TW_API int      TW_CALL TwAddButton(TwBar *bar, const char *name, TwButtonCallback callback, void *clientData, const char *def);
 TW_API int      TW_CALL TwAddSeparator(TwBar *bar, const char *name, const char *def);
+typedef struct CTwVarDesc
+{
+    const char *        Name;
+    TwType              Type;
+    void *              Var;            // pointer to the variable, or NULL if callbacks are used
+    int                 ReadOnly;
+    TwSetVarCallback    SetCallback;
+    TwGetVarCallback    GetCallback;
+    void *              ClientData;
+    const char *        DefString;
+    TwButtonCallback    ButtonCallback; // if not NULL, a button is added as with TwAddButton (Type, Var, ReadOnly, SetCallback and GetCallback are ignored)
+} TwVarDesc;
+TW_API int      TW_CALL TwAddVarsBatch(TwBar *bar, const TwVarDesc *vars, unsigned int nbVars);
 TW_API int      TW_CALL TwRemoveVar(TwBar *bar, const char *name);
 TW_API int      TW_CALL TwRemoveAllVars(TwBar *bar);
+TW_API int      TW_CALL TwNotifyVarChanged(TwBar *bar, const char *name); // name==NULL: all vars of the bar
+
+// A mailbox passes the values of a var from one worker thread to the render
+// thread. TwNewMailbox and TwDeleteMailbox must be called from the render
+// thread. TwPublishVarValue can be called from the worker thread at any time
+// between them; the latest value published is applied by the next TwDraw. A
+// mailbox is deleted by TwDeleteMailbox or TwTerminate, so the worker must
+// have stopped publishing before any of them is called. A mailbox whose var
+// or bar has been deleted stays valid but its values are ignored.
+typedef struct CTwMailbox TwMailbox; // structure CTwMailbox is not exposed.
+TW_API TwMailbox * TW_CALL TwNewMailbox(TwBar *bar, const char *name);
+TW_API int      TW_CALL TwPublishVarValue(TwMailbox *mailbox, const void *value);
+TW_API int      TW_CALL TwDeleteMailbox(TwMailbox *mailbox);
 
 typedef struct CTwEnumVal
 {
@@ -151,6 +177,10 @@ typedef struct CTwStructMember
 typedef void (TW_CALL * TwSummaryCallback)(char *summaryString, size_t summaryMaxLength, const void *value, void *clientData);
 
 TW_API int      TW_CALL TwDefine(const char *def);
+typedef struct CTwCompiledDefine TwCompiledDefine; // structure CTwCompiledDefine is not exposed.
+TW_API TwCompiledDefine * TW_CALL TwCompileDefine(const char *def); // parse def once, apply it with TwApplyCompiledDefine
+TW_API int      TW_CALL TwApplyCompiledDefine(TwCompiledDefine *compiledDef);
+TW_API int      TW_CALL TwDeleteCompiledDefine(TwCompiledDefine *compiledDef);
 TW_API TwType   TW_CALL TwDefineEnum(const char *name, const TwEnumVal *enumValues, unsigned int nbValues);
 TW_API TwType   TW_CALL TwDefineStruct(const char *name, const TwStructMember *structMembers, unsigned int nbMembers, size_t structSize, TwSummaryCallback summaryCallback, void *summaryClientData);
 
@@ -183,9 +213,19 @@ typedef enum ETwGraphAPI
     TW_OPENGL           = 1,
     TW_DIRECT3D9        = 2,
     TW_DIRECT3D10       = 3,
-    TW_DIRECT3D11       = 3
+    TW_DIRECT3D11       = 3,
+    TW_OPENGL_CORE      = 4,
+    TW_SOFTWARE         = 5     // device is a TwSoftwareBuffer
 } TwGraphAPI;
 
+typedef struct CTwSoftwareBuffer
+{
+    void *        Pixels;   // 8-bit RGBA pixels, first row is the top of the window
+    int           Width;
+    int           Height;
+    int           Pitch;    // bytes between two rows (0 means Width*4)
+} TwSoftwareBuffer;
+
 #ifdef ANT_TW_SUPPORT_DX11
 TW_API int      TW_CALL TwInit(TwGraphAPI graphAPI, void *device, void *context);
 #else
@@ -193,7 +233,18 @@ TW_API int      TW_CALL TwInit(TwGraphAPI graphAPI, void *device);
 #endif
 TW_API int      TW_CALL TwTerminate();
 
+// Threads: the render thread is the thread that called TwInit; TwDraw must
+// be called from it. TwMouseButton, TwMouseMotion, TwMouseWheel, TwKeyPressed,
+// TwWindowSize and TwNotifyVarChanged can be called from any thread: when
+// called from another thread (or while drawing) the event is queued and
+// processed by the next TwDraw. TwPublishVarValue can be called from the
+// worker thread of a mailbox (see TwNewMailbox). The other functions must be
+// called from the render thread; those that modify bars, vars, types or
+// mailboxes fail with an error otherwise. No thread may call the library
+// while TwInit or TwTerminate is running.
+
 TW_API int      TW_CALL TwDraw();
+TW_API int      TW_CALL TwNeedsRedraw();  // 1 if the next TwDraw would not draw the same image as the previous one
 TW_API int      TW_CALL TwWindowSize(int width, int height);
 
 typedef enum ETwKeyModifier
@@ -241,6 +292,10 @@ typedef enum EKeySpecial
     TW_KEY_LAST
 } TwKeySpecial;
 
+// Input functions return 1 if the event has been handled and 0 otherwise. An
+// event queued for the next TwDraw (see Threads above) returns 0 since it is
+// not known yet if it will be handled; TwEventsQueued returns 1 while queued
+// events are waiting for TwDraw.
 TW_API int      TW_CALL TwKeyPressed(int key, int modifiers);
 
 typedef enum ETwMouseAction
@@ -258,6 +313,14 @@ typedef enum ETwMouseButtonID
 TW_API int      TW_CALL TwMouseButton(TwMouseAction action, TwMouseButtonID button);
 TW_API int      TW_CALL TwMouseMotion(int mouseX, int mouseY);
 TW_API int      TW_CALL TwMouseWheel(int pos);
+TW_API int      TW_CALL TwEventsQueued();
+
+// Between TwBeginEvents and TwEndEvents, consecutive mouse motions are merged
+// and mouse wheel steps in the same direction are accumulated; TwMouseMotion
+// and TwMouseWheel return 0 since the events are processed later. TwEndEvents returns 1 if one of the
+// merged events has been handled.
+TW_API int      TW_CALL TwBeginEvents();
+TW_API int      TW_CALL TwEndEvents();
 
 TW_API const char * TW_CALL TwGetLastError();
 typedef void (TW_CALL * TwErrorHandler)(const char *errorMessage);
@@ -269,6 +332,10 @@ TW_API void     TW_CALL TwHandleErrors(TwErrorHandler errorHandler);
 //  frameworks to AntTweakBar.
 //  They call TwKeyPressed, TwMouse* and TwWindowSize for you (implemented in
 //  files TwEventWin.c TwEventSDL.c TwEventGLFW.c TwEventGLUT.c)
+//  They translate one event per call. To merge the mouse motions received
+//  during one poll of the application event loop (SDL_PollEvent loop,
+//  glfwPollEvents...), call TwBeginEvents before the poll and TwEndEvents
+//  after it.
 // ----------------------------------------------------------------------------
 
 //  For Windows message proc
@@ -15,6 +15,7 @@
 #include "TwMgr.h"
 #include "TwBar.h"
 #include "TwColors.h"
+#include "TwFormat.h"
   
 using namespace std;
 
@@ -76,6 +77,11 @@ CTwVarAtom::CTwVarAtom()
     m_KeyDecr[0] = 0;
     m_KeyDecr[1] = 0;
     memset(&m_Val, 0, sizeof(UVal));
+    m_Format = FORMAT_UNKNOWN;
+    m_FormatDigits = 0;
+    m_CacheValid = false;
+    m_CacheIsMin = false;
+    m_CacheIsMax = false;
 }
 
 CTwVarAtom::~CTwVarAtom()
@@ -120,11 +126,150 @@ CTwVarAtom::~CTwVarAtom()
 
 //  ---------------------------------------------------------------------------
 
+void CTwVarAtom::UpdateFormat() const
+{
+    m_CacheValid = false;   // the cached string may not use the new format
+    m_FormatDigits = 0;
+    switch( m_Type )
+    {
+    case TW_TYPE_BOOLCPP:
+    case TW_TYPE_BOOL8:
+    case TW_TYPE_BOOL16:
+    case TW_TYPE_BOOL32:
+        m_Format = FORMAT_BOOL;
+        break;
+    case TW_TYPE_CHAR:
+        m_Format = m_Val.m_Char.m_Hexa ? FORMAT_CHAR_HEXA : FORMAT_CHAR;
+        break;
+    case TW_TYPE_INT8:
+    case TW_TYPE_UINT8:
+    case TW_TYPE_INT16:
+    case TW_TYPE_UINT16:
+    case TW_TYPE_INT32:
+    case TW_TYPE_UINT32:
+        {
+            bool Hexa = (m_Type==TW_TYPE_INT8) ? m_Val.m_Int8.m_Hexa : (m_Type==TW_TYPE_UINT8) ? m_Val.m_UInt8.m_Hexa : (m_Type==TW_TYPE_INT16) ? m_Val.m_Int16.m_Hexa
+                      : (m_Type==TW_TYPE_UINT16) ? m_Val.m_UInt16.m_Hexa : (m_Type==TW_TYPE_INT32) ? m_Val.m_Int32.m_Hexa : m_Val.m_UInt32.m_Hexa;
+            if( Hexa )
+            {
+                m_Format = FORMAT_HEXA;
+                m_FormatDigits = (signed char)(2*GetDataSize(m_Type));
+            }
+            else if( m_Type==TW_TYPE_INT8 || m_Type==TW_TYPE_INT16 || m_Type==TW_TYPE_INT32 )
+                m_Format = FORMAT_INT;
+            else
+                m_Format = FORMAT_UINT;
+        }
+        break;
+    case TW_TYPE_FLOAT:
+    case TW_TYPE_DOUBLE:
+        m_FormatDigits = (m_Type==TW_TYPE_FLOAT) ? m_Val.m_Float32.m_Precision : m_Val.m_Float64.m_Precision;
+        m_Format = (m_FormatDigits<0) ? FORMAT_GENERAL : FORMAT_FIXED;
+        break;
+    default:
+        m_Format = FORMAT_NONE; // formatted by ValueToString itself
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwVarAtom::FormatValue(const void *_Value, string *_Str) const
+{
+    assert( m_Format!=FORMAT_UNKNOWN && m_Format!=FORMAT_NONE );
+    int IntVal = 0;             // signed value of integer types
+    unsigned int BitsVal = 0;   // bits of integer types
+    double RealVal = 0;
+    switch( m_Type )
+    {
+    case TW_TYPE_BOOLCPP:   IntVal = *(const bool *)_Value ? 1 : 0; break;
+    case TW_TYPE_CHAR:
+    case TW_TYPE_UINT8:     BitsVal = *(const unsigned char *)_Value; IntVal = (int)BitsVal; break;
+    case TW_TYPE_BOOL8:
+    case TW_TYPE_INT8:      IntVal = *(const signed char *)_Value; BitsVal = IntVal&0xff; break;
+    case TW_TYPE_UINT16:    BitsVal = *(const unsigned short *)_Value; IntVal = (int)BitsVal; break;
+    case TW_TYPE_BOOL16:
+    case TW_TYPE_INT16:     IntVal = *(const short *)_Value; BitsVal = IntVal&0xffff; break;
+    case TW_TYPE_FLOAT:     RealVal = *(const float *)_Value; break;
+    case TW_TYPE_DOUBLE:    RealVal = *(const double *)_Value; break;
+    default:                BitsVal = *(const unsigned int *)_Value; IntVal = (int)BitsVal; break;
+    }
+
+    char Buf[TW_FORMAT_BUFFER_SIZE];
+    int Len = 0;
+    switch( m_Format )
+    {
+    case FORMAT_BOOL:
+        if( IntVal!=0 )
+            _Str->assign((m_Val.m_Bool.m_TrueString!=NULL) ? m_Val.m_Bool.m_TrueString : "ON");
+        else
+            _Str->assign((m_Val.m_Bool.m_FalseString!=NULL) ? m_Val.m_Bool.m_FalseString : "OFF");
+        return;
+    case FORMAT_CHAR:
+    case FORMAT_CHAR_HEXA:
+        Buf[0] = (char)BitsVal;    // a null char is kept in _Str as is
+        Buf[1] = ' ';
+        Buf[2] = '(';
+        if( m_Format==FORMAT_CHAR_HEXA && BitsVal!=0 )
+            Len = 3 + TwFormatHex(Buf+3, BitsVal, 2);
+        else
+            Len = 3 + TwFormatUInt(Buf+3, BitsVal);
+        Buf[Len++] = ')';
+        break;
+    case FORMAT_INT:
+        Len = TwFormatInt(Buf, IntVal);
+        break;
+    case FORMAT_UINT:
+        Len = TwFormatUInt(Buf, BitsVal);
+        break;
+    case FORMAT_HEXA:
+        Len = TwFormatHex(Buf, BitsVal, m_FormatDigits);
+        break;
+    case FORMAT_GENERAL:
+        Len = TwFormatGeneral(Buf, RealVal);
+        break;
+    case FORMAT_FIXED:
+        Len = TwFormatFixed(Buf, RealVal, m_FormatDigits);
+        break;
+    default:
+        assert(0);
+    }
+    _Str->assign(Buf, Len);
+}
+
+//  ---------------------------------------------------------------------------
+
+const string *CTwVarAtom::CachedValueToString(bool *_Unchanged) const
+{
+    if( m_Format==FORMAT_UNKNOWN )
+        UpdateFormat();
+    if( m_Format==FORMAT_NONE || (m_Ptr==NULL && m_GetCallback==NULL) )
+        return NULL;
+
+    size_t Size = GetDataSize(m_Type);
+    assert( Size<=sizeof(m_CacheBytes) );
+    union { int m_Int; double m_Double; } Val;
+    memset(&Val, 0, sizeof(Val));
+    if( m_GetCallback!=NULL )
+        m_GetCallback(&Val, m_ClientData);
+    else
+        memcpy(&Val, m_Ptr, Size);
+
+    *_Unchanged = m_CacheValid && memcmp(&Val, m_CacheBytes, Size)==0;
+    if( !*_Unchanged )
+    {
+        memcpy(m_CacheBytes, &Val, Size);
+        FormatValue(&Val, &m_CacheString);
+        m_CacheValid = true;
+    }
+    return &m_CacheString;
+}
+
+//  ---------------------------------------------------------------------------
+
 void CTwVarAtom::ValueToString(string *_Str) const
 {
     assert(_Str!=NULL);
     static const char *ErrStr = "unreachable";
-    char Tmp[1024];
     if( m_Type==TW_TYPE_UNDEF || m_Type==TW_TYPE_HELP_ATOM || m_Type==TW_TYPE_HELP_GRP || m_Type==TW_TYPE_BUTTON )  // has no value
     {
         *_Str = "";
@@ -173,207 +318,24 @@ void CTwVarAtom::ValueToString(string *_Str) const
         return;
     }
     bool UseGet = (m_GetCallback!=NULL);
-    switch( m_Type )
+    if( m_Format==FORMAT_UNKNOWN )
+        UpdateFormat();
+    if( m_Format!=FORMAT_NONE )
     {
-    case TW_TYPE_BOOLCPP:
-        {
-            bool Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(bool *)m_Ptr;
-            if( Val )
-                *_Str = (m_Val.m_Bool.m_TrueString!=NULL) ? m_Val.m_Bool.m_TrueString : "ON";
-            else
-                *_Str = (m_Val.m_Bool.m_FalseString!=NULL) ? m_Val.m_Bool.m_FalseString : "OFF";
-        }
-        break;
-    case TW_TYPE_BOOL8:
-        {
-            char Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(char *)m_Ptr;
-            if( Val )
-                *_Str = (m_Val.m_Bool.m_TrueString!=NULL) ? m_Val.m_Bool.m_TrueString : "ON";
-            else
-                *_Str = (m_Val.m_Bool.m_FalseString!=NULL) ? m_Val.m_Bool.m_FalseString : "OFF";
-        }
-        break;
-    case TW_TYPE_BOOL16:
-        {
-            short Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(short *)m_Ptr;
-            if( Val )
-                *_Str = (m_Val.m_Bool.m_TrueString!=NULL) ? m_Val.m_Bool.m_TrueString : "ON";
-            else
-                *_Str = (m_Val.m_Bool.m_FalseString!=NULL) ? m_Val.m_Bool.m_FalseString : "OFF";
-        }
-        break;
-    case TW_TYPE_BOOL32:
-        {
-            int Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(int *)m_Ptr;
-            if( Val )
-                *_Str = (m_Val.m_Bool.m_TrueString!=NULL) ? m_Val.m_Bool.m_TrueString : "ON";
-            else
-                *_Str = (m_Val.m_Bool.m_FalseString!=NULL) ? m_Val.m_Bool.m_FalseString : "OFF";
-        }
-        break;
-    case TW_TYPE_CHAR:
+        union { int m_Int; double m_Double; } Val;    // receives the value from the get callback
+        const void *Ptr = m_Ptr;
+        if( UseGet )
         {
-            unsigned char Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(unsigned char *)m_Ptr;
-            if( Val!=0 )
-            {
-                int d = Val;
-                if( m_Val.m_Char.m_Hexa )
-                    sprintf(Tmp, "%c (0x%.2X)", Val, d);
-                else
-                    sprintf(Tmp, "%c (%d)", Val, d);
-                *_Str = Tmp;
-            }
-            else
-            {
-                *_Str = "  (0)";
-                const_cast<char *>(_Str->c_str())[0] = '\0';
-            }
+            memset(&Val, 0, sizeof(Val));
+            m_GetCallback(&Val, m_ClientData);
+            Ptr = &Val;
         }
-        break;
-    case TW_TYPE_INT8:
-        {
-            signed char Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(signed char *)m_Ptr;
-            int d = Val;
-            if( m_Val.m_Int8.m_Hexa )
-                sprintf(Tmp, "0x%.2X", d&0xff);
-            else
-                sprintf(Tmp, "%d", d);
-            *_Str = Tmp;
-        }
-        break;
-    case TW_TYPE_UINT8:
-        {
-            unsigned char Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(unsigned char *)m_Ptr;
-            unsigned int d = Val;
-            if( m_Val.m_UInt8.m_Hexa )
-                sprintf(Tmp, "0x%.2X", d);
-            else        
-                sprintf(Tmp, "%u", d);
-            *_Str = Tmp;
-        }
-        break;
-    case TW_TYPE_INT16:
-        {
-            short Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(short *)m_Ptr;
-            int d = Val;
-            if( m_Val.m_Int16.m_Hexa )
-                sprintf(Tmp, "0x%.4X", d&0xffff);
-            else
-                sprintf(Tmp, "%d", d);
-            *_Str = Tmp;
-        }
-        break;
-    case TW_TYPE_UINT16:
-        {
-            unsigned short Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(unsigned short *)m_Ptr;
-            unsigned int d = Val;
-            if( m_Val.m_UInt16.m_Hexa )
-                sprintf(Tmp, "0x%.4X", d);
-            else
-                sprintf(Tmp, "%u", d);
-            *_Str = Tmp;
-        }
-        break;
-    case TW_TYPE_INT32:
-        {
-            int Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(int *)m_Ptr;
-            if( m_Val.m_Int32.m_Hexa )
-                sprintf(Tmp, "0x%.8X", Val);
-            else
-                sprintf(Tmp, "%d", Val);
-            *_Str = Tmp;
-        }
-        break;
-    case TW_TYPE_UINT32:
-        {
-            unsigned int Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(unsigned int *)m_Ptr;
-            if( m_Val.m_UInt32.m_Hexa )
-                sprintf(Tmp, "0x%.8X", Val);
-            else
-                sprintf(Tmp, "%u", Val);
-            *_Str = Tmp;
-        }
-        break;
-    case TW_TYPE_FLOAT:
-        {
-            float Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(float *)m_Ptr;
-            if( m_Val.m_Float32.m_Precision<0 )
-                sprintf(Tmp, "%g", Val);
-            else
-            {
-                char Fmt[64];
-                sprintf(Fmt, "%%.%df", (int)m_Val.m_Float32.m_Precision);
-                sprintf(Tmp, Fmt, Val);
-            }
-            *_Str = Tmp;
-        }
-        break;  
-    case TW_TYPE_DOUBLE:
-        {
-            double Val = 0;
-            if( UseGet )
-                m_GetCallback(&Val, m_ClientData);
-            else
-                Val = *(double *)m_Ptr;
-            if( m_Val.m_Float64.m_Precision<0 )
-                sprintf(Tmp, "%g", Val);
-            else
-            {
-                char Fmt[128];
-                sprintf(Fmt, "%%.%dlf", (int)m_Val.m_Float64.m_Precision);
-                sprintf(Tmp, Fmt, Val);
-            }
-            *_Str = Tmp;
-        }
-        break;
+        FormatValue(Ptr, _Str);
+        return;
+    }
+
+    switch( m_Type )
+    {
     case TW_TYPE_STDSTRING:
         {
             if( UseGet )
@@ -443,14 +405,14 @@ void CTwVarAtom::ValueToString(string *_Str) const
             else
                 Val = *(unsigned int *)m_Ptr;
 
-            CTwMgr::CEnum& e = g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE];
-            CTwMgr::CEnum::CEntries::iterator It = e.m_Entries.find(Val);
-            if( It!=e.m_Entries.end() )
-                *_Str = It->second;
+            const CTwMgr::CEnum& e = g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE];
+            int Rank = e.Find(Val);
+            if( Rank>=0 )
+                _Str->assign(e.Label(Rank), e.LabelLength(Rank));
             else
             {
-                sprintf(Tmp, "%u", Val);
-                *_Str = Tmp;
+                char Buf[TW_FORMAT_BUFFER_SIZE];
+                _Str->assign(Buf, TwFormatUInt(Buf, Val));
             }
         }
         else if( m_Type>=TW_TYPE_CSSTRING_BASE && m_Type<=TW_TYPE_CSSTRING_MAX )
@@ -952,34 +914,25 @@ enum EVarAttribs
     V_ENDTAG
 };
 
-int CTwVar::HasAttrib(const char *_Attrib, bool *_HasValue) const
+static const CTwAttribName g_VarAttribNames[] =
 {
-    *_HasValue = true;
-    if( _stricmp(_Attrib, "label")==0 )
-        return V_LABEL;
-    else if( _stricmp(_Attrib, "help")==0 )
-        return V_HELP;
-    else if( _stricmp(_Attrib, "group")==0 )
-        return V_GROUP;
-    else if( _stricmp(_Attrib, "order")==0 )
-        return V_ORDER;
-    else if( _stricmp(_Attrib, "visible")==0 )
-        return V_VISIBLE;
-    else if( _stricmp(_Attrib, "readonly")==0 )
-        return V_READONLY;
-
+    { "label",          V_LABEL,        true },
+    { "help",           V_HELP,         true },
+    { "group",          V_GROUP,        true },
+    { "order",          V_ORDER,        true },
+    { "visible",        V_VISIBLE,      true },
+    { "readonly",       V_READONLY,     true },
     // for backward compatibility
+    { "show",           V_SHOW,         false },
+    { "hide",           V_HIDE,         false },
+    { "readwrite",      V_READWRITE,    false }
+};
+static const CTwAttribTable g_VarAttribs(g_VarAttribNames, sizeof(g_VarAttribNames)/sizeof(g_VarAttribNames[0]));
+
+int CTwVar::HasAttrib(const char *_Attrib, int _Len, bool *_HasValue) const
+{
     *_HasValue = false;
-    if( _stricmp(_Attrib, "show")==0 )
-        return V_SHOW;
-    else if( _stricmp(_Attrib, "hide")==0 )
-        return V_HIDE;
-    if( _stricmp(_Attrib, "readonly")==0 )
-        return V_READONLY;
-    else if( _stricmp(_Attrib, "readwrite")==0 )
-        return V_READWRITE;
-
-    return 0; // not found
+    return g_VarAttribs.Find(_Attrib, _Len, _HasValue);
 }
 
 int CTwVar::SetAttrib(int _AttribID, const char *_Value, TwBar *_Bar, struct CTwVarGroup *_VarParent, int _VarIndex)
@@ -1065,12 +1018,15 @@ int CTwVar::SetAttrib(int _AttribID, const char *_Value, TwBar *_Bar, struct CTw
                     Grp->m_StructValuePtr = NULL;
                     Grp->m_ColorPtr = &(_Bar->m_ColGrpText);
                     _Bar->m_VarRoot.m_Vars.push_back(Grp);
+                    _Bar->IndexVar(Grp, &(_Bar->m_VarRoot), (int)_Bar->m_VarRoot.m_Vars.size()-1);
                 }
             }
             Grp->m_Vars.push_back(this);
+            _Bar->IndexVar(this, Grp, (int)Grp->m_Vars.size()-1);
             if( _VarParent!=NULL && _VarIndex>=0 )
             {
                 _VarParent->m_Vars.erase(_VarParent->m_Vars.begin()+_VarIndex);
+                _Bar->ReindexVars(_VarParent, _VarIndex);
                 if( _VarParent!=&(_Bar->m_VarRoot) && _VarParent->m_Vars.size()<=0 )
                     TwRemoveVar(_Bar, _VarParent->m_Name.c_str());
             }
@@ -1230,43 +1186,38 @@ enum EVarAtomAttribs
     VA_VALUE
 };
 
-int CTwVarAtom::HasAttrib(const char *_Attrib, bool *_HasValue) const
+static const CTwAttribName g_VarAtomAttribNames[] =
 {
-    *_HasValue = true;
-    if( _stricmp(_Attrib, "keyincr")==0 || _stricmp(_Attrib, "key")==0 )
-        return VA_KEY_INCR;
-    else if( _stricmp(_Attrib, "keydecr")==0 )
-        return VA_KEY_DECR;
-    else if( _stricmp(_Attrib, "min")==0 )
-        return VA_MIN;
-    else if( _stricmp(_Attrib, "max")==0 )
-        return VA_MAX;
-    else if( _stricmp(_Attrib, "step")==0 )
-        return VA_STEP;
-    else if( _stricmp(_Attrib, "precision")==0 )
-        return VA_PRECISION;
-    else if( _stricmp(_Attrib, "hexa")==0 )
-        return VA_HEXA;
-    else if( _stricmp(_Attrib, "decimal")==0 ) // for backward compatibility
-    {
-        *_HasValue = false;
-        return VA_DECIMAL;
-    }
-    else if( _stricmp(_Attrib, "true")==0 )
-        return VA_TRUE;
-    else if( _stricmp(_Attrib, "false")==0 )
-        return VA_FALSE;
-    else if( _stricmp(_Attrib, "enum")==0 
-             || _stricmp(_Attrib, "val")==0 ) // for backward compatibility
-        return VA_ENUM;
-    else if( _stricmp(_Attrib, "value")==0 )
-        return VA_VALUE;
-
-    return CTwVar::HasAttrib(_Attrib, _HasValue);
+    { "keyincr",        VA_KEY_INCR,    true },
+    { "key",            VA_KEY_INCR,    true },
+    { "keydecr",        VA_KEY_DECR,    true },
+    { "min",            VA_MIN,         true },
+    { "max",            VA_MAX,         true },
+    { "step",           VA_STEP,        true },
+    { "precision",      VA_PRECISION,   true },
+    { "hexa",           VA_HEXA,        true },
+    { "decimal",        VA_DECIMAL,     false },    // for backward compatibility
+    { "true",           VA_TRUE,        true },
+    { "false",          VA_FALSE,       true },
+    { "enum",           VA_ENUM,        true },
+    { "val",            VA_ENUM,        true },     // for backward compatibility
+    { "value",          VA_VALUE,       true }
+};
+static const CTwAttribTable g_VarAtomAttribs(g_VarAtomAttribNames, sizeof(g_VarAtomAttribNames)/sizeof(g_VarAtomAttribNames[0]));
+
+int CTwVarAtom::HasAttrib(const char *_Attrib, int _Len, bool *_HasValue) const
+{
+    *_HasValue = false;
+    int ID = g_VarAtomAttribs.Find(_Attrib, _Len, _HasValue);
+    if( ID>0 )
+        return ID;
+
+    return CTwVar::HasAttrib(_Attrib, _Len, _HasValue);
 }
 
 int CTwVarAtom::SetAttrib(int _AttribID, const char *_Value, TwBar *_Bar, struct CTwVarGroup *_VarParent, int _VarIndex)
 {
+    m_Format = FORMAT_UNKNOWN;  // precision, hexa or bool strings may change
     switch( _AttribID )
     {
     case VA_KEY_INCR:
@@ -1498,6 +1449,8 @@ int CTwVarAtom::SetAttrib(int _AttribID, const char *_Value, TwBar *_Bar, struct
             int n = 0, i = 0;
             unsigned int u;
             bool Cont;
+            vector<CTwMgr::CEnum::CEntry> Entries;
+            CTwMgr::CEnum::CEntry Entry;
             do
             {
                 Cont = false;
@@ -1520,20 +1473,11 @@ int CTwVarAtom::SetAttrib(int _AttribID, const char *_Value, TwBar *_Bar, struct
                         ++i;
                     if( s[i]==Sep )
                     {
-                        //if( m_Val.m_Enum.m_Entries==NULL )
-                        //  m_Val.m_Enum.m_Entries = new UVal::CEnumVal::CEntries;
-                        //UVal::CEnumVal::CEntries::value_type v(u, "");
-                        CTwMgr::CEnum::CEntries::value_type v(u, "");
-                        if( i>0 )
-                            v.second.assign(s, i);
-                        //m_Val.m_Enum.m_Entries->insert(v);
-                        pair<CTwMgr::CEnum::CEntries::iterator, bool> ret;
-                        ret = g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE].m_Entries.insert(v);
-                        if( !ret.second ) // force overwrite if element already exists
-                        {
-                            g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE].m_Entries.erase(ret.first);
-                            g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE].m_Entries.insert(v);
-                        }
+                        // labels point into _Value; entries are inserted all at once below
+                        Entry.m_Value = u;
+                        Entry.m_Label = s;
+                        Entry.m_Length = i;
+                        Entries.push_back(Entry);
 
                         s += i+1;
                         i = 0;
@@ -1546,16 +1490,19 @@ int CTwVarAtom::SetAttrib(int _AttribID, const char *_Value, TwBar *_Bar, struct
                     }
                     else
                     {
+                        g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE].Insert(Entries);    // keep the entries parsed before the error
                         g_TwMgr->SetLastError(g_ErrBadValue);
                         return 0;
                     }
                 }
                 else
                 {
+                    g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE].Insert(Entries);
                     g_TwMgr->SetLastError(g_ErrBadValue);
                     return 0;
                 }
             } while( Cont );
+            g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE].Insert(Entries);
             return 1;
         }
         else
@@ -1756,22 +1703,23 @@ ERetType CTwVarAtom::GetAttrib(int _AttribID, TwBar *_Bar, CTwVarGroup *_VarPare
     case VA_ENUM:
         if( m_Type>=TW_TYPE_ENUM_BASE && m_Type<TW_TYPE_ENUM_BASE+(int)g_TwMgr->m_Enums.size() )
         {
-            CTwMgr::CEnum::CEntries::iterator it = g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE].m_Entries.begin();
-            for( ; it != g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE].m_Entries.end(); ++it )
+            const CTwMgr::CEnum& e = g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE];
+            for( int r=0; r<e.Size(); ++r )
             {
-                if( it != g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE].m_Entries.begin() )
+                if( r>0 )
                     outString << ',';
-                outString << it->first << ' ';
-                if( it->second.find_first_of("{}")==std::string::npos )
-                    outString << '{' << it->second << '}';
-                else if ( it->second.find_first_of("<>")==std::string::npos )
-                    outString << '<' << it->second << '>';
-                else if ( it->second.find_first_of("()")==std::string::npos )
-                    outString << '(' << it->second << ')';
-                else if ( it->second.find_first_of("[]")==std::string::npos )
-                    outString << '[' << it->second << ']';
+                outString << e.m_Values[r] << ' ';
+                const char *Label = e.Label(r);
+                if( strpbrk(Label, "{}")==NULL )
+                    outString << '{' << Label << '}';
+                else if ( strpbrk(Label, "<>")==NULL )
+                    outString << '<' << Label << '>';
+                else if ( strpbrk(Label, "()")==NULL )
+                    outString << '(' << Label << ')';
+                else if ( strpbrk(Label, "[]")==NULL )
+                    outString << '[' << Label << ']';
                 else
-                    outString << '{' << it->second << '}'; // should not occured (use braces)
+                    outString << '{' << Label << '}'; // should not occured (use braces)
             }
             return RET_STRING;
         }
@@ -2198,26 +2146,18 @@ void CTwVarAtom::Increment(int _Step)
                 v = *((unsigned int *)m_Ptr);
             else if( m_GetCallback!=NULL )
                 m_GetCallback(&v, m_ClientData);
-            CTwMgr::CEnum& e = g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE];
-            CTwMgr::CEnum::CEntries::iterator It = e.m_Entries.find(v);
-            if( It==e.m_Entries.end() )
-                It = e.m_Entries.begin();
+            const CTwMgr::CEnum& e = g_TwMgr->m_Enums[m_Type-TW_TYPE_ENUM_BASE];
+            int Rank = e.Find(v);
+            if( Rank<0 )
+                Rank = 0;
             else if( _Step==1 )
-            {
-                ++It;
-                if( It==e.m_Entries.end() )
-                    It = e.m_Entries.begin();
-            }
+                Rank = (Rank+1<e.Size()) ? Rank+1 : 0;
             else if( _Step==-1 )
+                Rank = (Rank>0) ? Rank-1 : e.Size()-1;
+            if( Rank<e.Size() )
             {
-                if( It==e.m_Entries.begin() )
-                    It = e.m_Entries.end();
-                if( It!=e.m_Entries.begin() )
-                    --It;
-            }
-            if( It!=e.m_Entries.end() )
-            {
-                v = (unsigned int)(It->first);
+                e.m_LastRank = Rank;    // next Find(v) is immediate
+                v = e.m_Values[Rank];
                 if( m_Ptr!=NULL )
                     *((unsigned int *)m_Ptr) = v;
                 else if( m_SetCallback!=NULL )
@@ -2233,6 +2173,7 @@ void CTwVarAtom::Increment(int _Step)
 
 void CTwVarAtom::SetDefaults()
 {
+    m_Format = FORMAT_UNKNOWN;
     switch( m_Type )
     {
     case TW_TYPE_BOOL8:
@@ -2376,83 +2317,37 @@ enum EVarGroupAttribs
     VG_SHOWVAL      // tw_type_quat* only
 };
 
-int CTwVarGroup::HasAttrib(const char *_Attrib, bool *_HasValue) const
+static const CTwAttribName g_VarGroupAttribNames[] =
+{
+    { "open",           VG_OPEN,        false },    // for backward compatibility
+    { "close",          VG_CLOSE,       false },    // for backward compatibility
+    { "opened",         VG_OPENED,      true },
+    { "typeid",         VG_TYPEID,      true },
+    { "valptr",         VG_VALPTR,      true },
+    { "alpha",          VG_ALPHA,       false },    // for backward compatibility
+    { "noalpha",        VG_NOALPHA,     false },    // for backward compatibility
+    { "coloralpha",     VG_COLORALPHA,  true },
+    { "hls",            VG_HLS,         false },    // for backward compatibility
+    { "rgb",            VG_RGB,         false },    // for backward compatibility
+    { "colormode",      VG_COLORMODE,   true },
+    { "colororder",     VG_COLORORDER,  true },
+    { "arrow",          VG_ARROW,       true },
+    { "arrowcolor",     VG_ARROWCOLOR,  true },
+    { "axisx",          VG_AXISX,       true },
+    { "axisy",          VG_AXISY,       true },
+    { "axisz",          VG_AXISZ,       true },
+    { "showval",        VG_SHOWVAL,     true }
+};
+static const CTwAttribTable g_VarGroupAttribs(g_VarGroupAttribNames, sizeof(g_VarGroupAttribNames)/sizeof(g_VarGroupAttribNames[0]));
+
+int CTwVarGroup::HasAttrib(const char *_Attrib, int _Len, bool *_HasValue) const
 {
     *_HasValue = false;
-    if( _stricmp(_Attrib, "open")==0 ) // for backward compatibility
-        return VG_OPEN;
-    else if( _stricmp(_Attrib, "close")==0 ) // for backward compatibility
-        return VG_CLOSE;
-    else if( _stricmp(_Attrib, "opened")==0 )
-    {
-        *_HasValue = true;
-        return VG_OPENED;
-    }
-    else if( _stricmp(_Attrib, "typeid")==0 )
-    {
-        *_HasValue = true;
-        return VG_TYPEID;
-    }
-    else if( _stricmp(_Attrib, "valptr")==0 )
-    {
-        *_HasValue = true;
-        return VG_VALPTR;
-    }
-    else if( _stricmp(_Attrib, "alpha")==0 ) // for backward compatibility
-        return VG_ALPHA;
-    else if( _stricmp(_Attrib, "noalpha")==0 ) // for backward compatibility
-        return VG_NOALPHA;
-    else if( _stricmp(_Attrib, "coloralpha")==0 )
-    {
-        *_HasValue = true;
-        return VG_COLORALPHA;
-    }
-    else if( _stricmp(_Attrib, "hls")==0 ) // for backward compatibility
-        return VG_HLS;
-    else if( _stricmp(_Attrib, "rgb")==0 ) // for backward compatibility
-        return VG_RGB;
-    else if( _stricmp(_Attrib, "colormode")==0 )
-    {
-        *_HasValue = true;
-        return VG_COLORMODE;
-    }
-    else if( _stricmp(_Attrib, "colororder")==0 )
-    {
-        *_HasValue = true;
-        return VG_COLORORDER;
-    }
-    else if( _stricmp(_Attrib, "arrow")==0 )
-    {
-        *_HasValue = true;
-        return VG_ARROW;
-    }
-    else if( _stricmp(_Attrib, "arrowcolor")==0 )
-    {
-        *_HasValue = true;
-        return VG_ARROWCOLOR;
-    }
-    else if( _stricmp(_Attrib, "axisx")==0 )
-    {
-        *_HasValue = true;
-        return VG_AXISX;
-    }
-    else if( _stricmp(_Attrib, "axisy")==0 )
-    {
-        *_HasValue = true;
-        return VG_AXISY;
-    }
-    else if( _stricmp(_Attrib, "axisz")==0 )
-    {
-        *_HasValue = true;
-        return VG_AXISZ;
-    }
-    else if( _stricmp(_Attrib, "showval")==0 )
-    {
-        *_HasValue = true;
-        return VG_SHOWVAL;
-    }
+    int ID = g_VarGroupAttribs.Find(_Attrib, _Len, _HasValue);
+    if( ID>0 )
+        return ID;
 
-    return CTwVar::HasAttrib(_Attrib, _HasValue);
+    return CTwVar::HasAttrib(_Attrib, _Len, _HasValue);
 }
 
 int CTwVarGroup::SetAttrib(int _AttribID, const char *_Value, TwBar *_Bar, struct CTwVarGroup *_VarParent, int _VarIndex)
@@ -2975,9 +2870,11 @@ CTwBar::CTwBar(const char *_Name)
     m_ValuesWidth = 10*(m_Font->m_CharHeight/2); // about 10 characters
     m_NbHierLines = 0;
     m_NbDisplayedLines = 0;
+    m_HierLinesUpToDate = false;
     m_FirstLine = 0;
     m_LastUpdateTime = 0;
     m_UpdatePeriod = 2;
+    m_AutoRefresh = true;
     m_ScrollYW = 0;
     m_ScrollYH = 0;
     m_ScrollY0 = 0;
@@ -3022,6 +2919,7 @@ CTwBar::CTwBar(const char *_Name)
 
     m_IsMinimized = false;
     m_MinNumber = 0;
+    m_RectIndex = -1;
     m_MinPosX = 0;
     m_MinPosY = 0;
     m_HighlightMaximize = false;
@@ -3029,6 +2927,8 @@ CTwBar::CTwBar(const char *_Name)
     m_IsPopupList = false;
     m_VarEnumLinkedToPopupList = NULL;
     m_BarLinkedToPopupList = NULL;
+    m_PopupEnum = -1;
+    m_PopupValue = 0;
 
     m_Resizable = true;
     m_Movable = true;
@@ -3040,12 +2940,20 @@ CTwBar::CTwBar(const char *_Name)
     m_ValuesTextObj = g_TwMgr->m_Graph->NewTextObj();
     m_ShortcutTextObj = g_TwMgr->m_Graph->NewTextObj();
     m_ShortcutLine = -1;
+    m_LabelsLines.m_Font = NULL;
+    m_ValuesLines.m_Font = NULL;
 
     m_RotoMinRadius = 24;
     m_RotoNbSubdiv = 256;   // number of steps for one turn
 
     m_CustomActiveStructProxy = NULL;
 
+    m_VarIndexValid = true;
+
+    m_DrawCache = NULL;
+    m_DrawCacheValid = false;
+    m_DrawKeyValid = false;
+
     UpdateColors();
     NotUpToDate();
 }
@@ -3064,13 +2972,32 @@ CTwBar::~CTwBar()
         g_TwMgr->m_Graph->DeleteTextObj(m_ValuesTextObj);
     if( m_ShortcutTextObj )
         g_TwMgr->m_Graph->DeleteTextObj(m_ShortcutTextObj);
+    if( m_DrawCache )
+        g_TwMgr->m_Graph->DeleteCacheObj(m_DrawCache);
 }
 
 //  ---------------------------------------------------------------------------
 
 const CTwVar *CTwBar::Find(const char *_Name, CTwVarGroup **_Parent, int *_Index) const
 {
-    return m_VarRoot.Find(_Name, _Parent, _Index);
+    if( strcmp(_Name, m_VarRoot.m_Name.c_str())==0 )
+        return m_VarRoot.Find(_Name, _Parent, _Index);
+
+    if( !m_VarIndexValid )
+    {
+        m_VarIndex.clear();
+        BuildVarIndex(&m_VarRoot);
+        m_VarIndexValid = true;
+    }
+
+    CVarIndex::const_iterator it = m_VarIndex.lower_bound(_Name);    // first var inserted with this name
+    if( it==m_VarIndex.end() || it->first!=_Name )
+        return NULL;
+    if( _Parent!=NULL )
+        *_Parent = it->second.m_Parent;
+    if( _Index!=NULL )
+        *_Index = it->second.m_Index;
+    return it->second.m_Var;
 }
 
 CTwVar *CTwBar::Find(const char *_Name, CTwVarGroup **_Parent, int *_Index)
@@ -3078,6 +3005,118 @@ CTwVar *CTwBar::Find(const char *_Name, CTwVarGroup **_Parent, int *_Index)
     return const_cast<CTwVar *>(const_cast<const CTwBar *>(this)->Find(_Name, _Parent, _Index));
 }
 
+void CTwBar::BuildVarIndex(const CTwVarGroup *_Grp) const
+{
+    for( size_t i=0; i<_Grp->m_Vars.size(); ++i )
+        if( _Grp->m_Vars[i]!=NULL )
+        {
+            // vars are inserted in hierarchy order, so Find returns the same
+            // var as CTwVarGroup::Find when names collide
+            CVarIndexEntry e;
+            e.m_Var = _Grp->m_Vars[i];
+            e.m_Parent = const_cast<CTwVarGroup *>(_Grp);
+            e.m_Index = (int)i;
+            m_VarIndex.insert(CVarIndex::value_type(_Grp->m_Vars[i]->m_Name, e));
+            if( _Grp->m_Vars[i]->IsGroup() )
+                BuildVarIndex(static_cast<const CTwVarGroup *>(_Grp->m_Vars[i]));
+        }
+}
+
+CTwBar::CVarIndex::iterator CTwBar::FindVarIndexEntry(const CTwVar *_Var)
+{
+    std::pair<CVarIndex::iterator, CVarIndex::iterator> r = m_VarIndex.equal_range(_Var->m_Name);
+    for( CVarIndex::iterator it=r.first; it!=r.second; ++it )
+        if( it->second.m_Var==_Var )
+            return it;
+    return m_VarIndex.end();
+}
+
+void CTwBar::IndexVar(CTwVar *_Var, CTwVarGroup *_Parent, int _Index)
+{
+    if( !m_VarIndexValid || _Var==NULL )
+        return; // the whole index will be rebuilt by the next Find
+
+    CVarIndexEntry e;
+    e.m_Var = _Var;
+    e.m_Parent = _Parent;
+    e.m_Index = _Index;
+    CVarIndex::iterator it = FindVarIndexEntry(_Var);
+    if( it!=m_VarIndex.end() )
+        it->second = e; // _Var has been moved to another group
+    else
+        m_VarIndex.insert(CVarIndex::value_type(_Var->m_Name, e));  // inserted after the vars with the same name
+    if( _Var->IsGroup() )
+    {
+        CTwVarGroup *Grp = static_cast<CTwVarGroup *>(_Var);
+        for( size_t i=0; i<Grp->m_Vars.size(); ++i )
+            IndexVar(Grp->m_Vars[i], Grp, (int)i);
+    }
+}
+
+void CTwBar::UnindexVar(const CTwVar *_Var)
+{
+    if( !m_VarIndexValid || _Var==NULL )
+        return;
+
+    CVarIndex::iterator it = FindVarIndexEntry(_Var);
+    if( it!=m_VarIndex.end() )
+        m_VarIndex.erase(it);
+    if( _Var->IsGroup() )
+    {
+        const CTwVarGroup *Grp = static_cast<const CTwVarGroup *>(_Var);
+        for( size_t i=0; i<Grp->m_Vars.size(); ++i )
+            UnindexVar(Grp->m_Vars[i]);
+    }
+}
+
+void CTwBar::ReindexVars(CTwVarGroup *_Parent, int _FirstIndex)
+{
+    if( !m_VarIndexValid || _Parent==NULL )
+        return;
+
+    for( int i=max(_FirstIndex, 0); i<(int)_Parent->m_Vars.size(); ++i )
+        if( _Parent->m_Vars[i]!=NULL )
+        {
+            CVarIndex::iterator it = FindVarIndexEntry(_Parent->m_Vars[i]);
+            if( it!=m_VarIndex.end() )
+            {
+                it->second.m_Parent = _Parent;
+                it->second.m_Index = i;
+            }
+        }
+}
+
+// Remove _Var from _Grp or from one of its sub-groups. The groups left empty
+// are removed too. Returns false if _Var is not found.
+static bool RemoveVarFromGroup(CTwBar *_Bar, CTwVarGroup *_Grp, const CTwVar *_Var)
+{
+    for( int i=0; i<(int)_Grp->m_Vars.size(); ++i )
+    {
+        CTwVar *Var = _Grp->m_Vars[i];
+        if( Var==NULL )
+            continue;
+        if( Var!=_Var && !(Var->IsGroup() && RemoveVarFromGroup(_Bar, static_cast<CTwVarGroup *>(Var), _Var)) )
+            continue;
+        if( Var==_Var || static_cast<CTwVarGroup *>(Var)->m_Vars.size()<=0 )
+        {
+            _Bar->UnindexVar(Var);
+            delete Var;
+            _Grp->m_Vars.erase(_Grp->m_Vars.begin()+i);
+            _Bar->ReindexVars(_Grp, i);
+        }
+        return true;
+    }
+    return false;
+}
+
+bool CTwBar::RemoveVar(const CTwVar *_Var)
+{
+    if( _Var==NULL || !RemoveVarFromGroup(this, &m_VarRoot, _Var) )
+        return false;
+    NotUpToDate();
+    return true;
+}
+
 //  ---------------------------------------------------------------------------
 
 enum EBarAttribs
@@ -3107,72 +3146,52 @@ enum EBarAttribs
     BAR_ALWAYS_TOP,
     BAR_ALWAYS_BOTTOM,
     BAR_COLOR_SCHEME,
-    BAR_CONTAINED
+    BAR_CONTAINED,
+    BAR_AUTO_REFRESH
 };
 
-int CTwBar::HasAttrib(const char *_Attrib, bool *_HasValue) const
+static const CTwAttribName g_BarAttribNames[] =
 {
-    *_HasValue = true;
-    if( _stricmp(_Attrib, "label")==0 )
-        return BAR_LABEL;
-    else if( _stricmp(_Attrib, "help")==0 )
-        return BAR_HELP;
-    else if( _stricmp(_Attrib, "color")==0 )
-        return BAR_COLOR;
-    else if( _stricmp(_Attrib, "alpha")==0 )
-        return BAR_ALPHA;
-    else if( _stricmp(_Attrib, "text")==0 )
-        return BAR_TEXT;
-    else if( _stricmp(_Attrib, "size")==0 )
-        return BAR_SIZE;
-    else if( _stricmp(_Attrib, "position")==0 )
-        return BAR_POSITION;
-    else if( _stricmp(_Attrib, "refresh")==0 )
-        return BAR_REFRESH;
-    else if( _stricmp(_Attrib, "fontsize")==0 )
-        return BAR_FONT_SIZE;
-    else if( _stricmp(_Attrib, "valueswidth")==0 )
-        return BAR_VALUES_WIDTH;
-    else if( _stricmp(_Attrib, "iconpos")==0 )
-        return BAR_ICON_POS;
-    else if( _stricmp(_Attrib, "iconalign")==0 )
-        return BAR_ICON_ALIGN;
-    else if( _stricmp(_Attrib, "iconmargin")==0 )
-        return BAR_ICON_MARGIN;
-    else if( _stricmp(_Attrib, "resizable")==0 )
-        return BAR_RESIZABLE;
-    else if( _stricmp(_Attrib, "movable")==0 )
-        return BAR_MOVABLE;
-    else if( _stricmp(_Attrib, "iconifiable")==0 )
-        return BAR_ICONIFIABLE;
-    else if( _stricmp(_Attrib, "fontresizable")==0 )
-        return BAR_FONT_RESIZABLE;
-    else if( _stricmp(_Attrib, "alwaystop")==0 )
-        return BAR_ALWAYS_TOP;
-    else if( _stricmp(_Attrib, "alwaysbottom")==0 )
-        return BAR_ALWAYS_BOTTOM;
-    else if( _stricmp(_Attrib, "visible")==0 )
-        return BAR_VISIBLE;
-    else if( _stricmp(_Attrib, "iconified")==0 )
-        return BAR_ICONIFIED;
-    else if( _stricmp(_Attrib, "colorscheme")==0 )
-        return BAR_COLOR_SCHEME;
-    else if( _stricmp(_Attrib, "contained")==0 )
-        return BAR_CONTAINED;
+    { "label",          BAR_LABEL,          true },
+    { "help",           BAR_HELP,           true },
+    { "color",          BAR_COLOR,          true },
+    { "alpha",          BAR_ALPHA,          true },
+    { "text",           BAR_TEXT,           true },
+    { "size",           BAR_SIZE,           true },
+    { "position",       BAR_POSITION,       true },
+    { "refresh",        BAR_REFRESH,        true },
+    { "fontsize",       BAR_FONT_SIZE,      true },
+    { "valueswidth",    BAR_VALUES_WIDTH,   true },
+    { "iconpos",        BAR_ICON_POS,       true },
+    { "iconalign",      BAR_ICON_ALIGN,     true },
+    { "iconmargin",     BAR_ICON_MARGIN,    true },
+    { "resizable",      BAR_RESIZABLE,      true },
+    { "movable",        BAR_MOVABLE,        true },
+    { "iconifiable",    BAR_ICONIFIABLE,    true },
+    { "fontresizable",  BAR_FONT_RESIZABLE, true },
+    { "alwaystop",      BAR_ALWAYS_TOP,     true },
+    { "alwaysbottom",   BAR_ALWAYS_BOTTOM,  true },
+    { "visible",        BAR_VISIBLE,        true },
+    { "iconified",      BAR_ICONIFIED,      true },
+    { "colorscheme",    BAR_COLOR_SCHEME,   true },
+    { "contained",      BAR_CONTAINED,      true },
+    { "autorefresh",    BAR_AUTO_REFRESH,   true },
+    // for backward compatibility
+    { "show",           BAR_SHOW,           false },
+    { "hide",           BAR_HIDE,           false },
+    { "iconify",        BAR_ICONIFY,        false }
+};
+static const CTwAttribTable g_BarAttribs(g_BarAttribNames, sizeof(g_BarAttribNames)/sizeof(g_BarAttribNames[0]));
 
+int CTwBar::HasAttrib(const char *_Attrib, int _Len, bool *_HasValue) const
+{
     *_HasValue = false;
-    if( _stricmp(_Attrib, "show")==0 ) // for backward compatibility
-        return BAR_SHOW;
-    else if( _stricmp(_Attrib, "hide")==0 ) // for backward compatibility
-        return BAR_HIDE;
-    else if( _stricmp(_Attrib, "iconify")==0 ) // for backward compatibility
-        return BAR_ICONIFY;
-
-    return 0; // not found
+    return g_BarAttribs.Find(_Attrib, _Len, _HasValue);
 }
 
 int CTwBar::SetAttrib(int _AttribID, const char *_Value)
 {
+    g_TwMgr->BarRectsNotUpToDate();    // position, size, visibility... may change
     switch( _AttribID )
     {
     case BAR_LABEL:
@@ -3574,6 +3593,30 @@ int CTwBar::SetAttrib(int _AttribID, const char *_Value)
             g_TwMgr->SetLastError(g_ErrNoValue);
             return 0;
         }
+    case BAR_AUTO_REFRESH:
+        if( _Value && strlen(_Value)>0 )
+        {
+            if( _stricmp(_Value, "1")==0 || _stricmp(_Value, "true")==0 )
+            {
+                m_AutoRefresh = true;
+                return 1;
+            }
+            else if( _stricmp(_Value, "0")==0 || _stricmp(_Value, "false")==0 )
+            {
+                m_AutoRefresh = false;
+                return 1;
+            }
+            else
+            {
+                g_TwMgr->SetLastError(g_ErrBadValue);
+                return 0;
+            }
+        }
+        else
+        {
+            g_TwMgr->SetLastError(g_ErrNoValue);
+            return 0;
+        }
     default:
         g_TwMgr->SetLastError(g_ErrUnknownAttrib);
         return 0;
@@ -3667,6 +3710,9 @@ ERetType CTwBar::GetAttrib(int _AttribID, std::vector<double>& outDoubles, std::
     case BAR_CONTAINED:
         outDoubles.push_back(m_Contained);
         return RET_DOUBLE;
+    case BAR_AUTO_REFRESH:
+        outDoubles.push_back(m_AutoRefresh);
+        return RET_DOUBLE;
     default:
         g_TwMgr->SetLastError(g_ErrUnknownAttrib);
         return RET_ERROR;
@@ -3677,7 +3723,74 @@ ERetType CTwBar::GetAttrib(int _AttribID, std::vector<double>& outDoubles, std::
 
 void CTwBar::NotUpToDate()
 {
+    if( m_UpToDate )
+        g_TwMgr->MouseStateSet(this);   // see HasMouseState
     m_UpToDate = false;
+    m_DrawCacheValid = false;
+    m_HierLinesUpToDate = false;
+}
+
+void CTwBar::ValuesNotUpToDate()
+{
+    if( m_UpToDate )
+        g_TwMgr->MouseStateSet(this);   // see HasMouseState
+    m_UpToDate = false;
+    m_DrawCacheValid = false;
+}
+
+//  ---------------------------------------------------------------------------
+
+bool CTwBar::GetDrawKey(int *_Key) const
+{
+    // Fills _Key with the state read by Draw that is not refreshed by Update.
+    // Returns false if Draw also depends on other state, in which case its 
+    // result cannot be cached.
+    const bool Flags[] = 
+    {
+        m_HighlightIncrBtn, m_HighlightDecrBtn, m_HighlightRotoBtn, m_HighlightListBtn, m_HighlightBoolBtn, 
+        m_HighlightClickBtn, m_HighlightTitle, m_HighlightScroll, m_HighlightUpScroll, m_HighlightDnScroll, 
+        m_HighlightMinimize, m_HighlightFont, m_HighlightValWidth, m_DrawHandles, m_DrawIncrDecrBtn, 
+        m_DrawRotoBtn, m_DrawClickBtn, m_DrawListBtn, m_DrawBoolBtn, m_MouseDrag, m_MouseDragTitle, 
+        m_MouseDragScroll, m_MouseDragValWidth, m_HighlightClickBtnAuto>0,
+        (g_TwMgr->m_PopupBar!=NULL && this!=g_TwMgr->m_PopupBar), m_IsMinimized, m_HighlightMaximize
+    };
+    int FlagBits = 0;
+    for( int i=0; i<(int)(sizeof(Flags)/sizeof(Flags[0])); ++i )
+        if( Flags[i] )
+            FlagBits |= (1<<i);
+
+    _Key[0] = m_PosX;
+    _Key[1] = m_PosY;
+    _Key[2] = m_Width;
+    _Key[3] = m_Height;
+    _Key[4] = m_FirstLine;
+    _Key[5] = m_HighlightedLine;
+    _Key[6] = m_ValuesWidth;
+    _Key[7] = g_TwMgr->m_WndWidth;
+    _Key[8] = g_TwMgr->m_WndHeight;
+    _Key[9] = FlagBits;
+    _Key[10] = m_Sep;
+    _Key[11] = m_MinNumber;
+
+    return !( m_IsMinimized || m_IsHelpBar || m_Roto.m_Active || m_EditInPlace.m_Active || m_HighlightClickBtnAuto>0 );
+}
+
+//  ---------------------------------------------------------------------------
+
+bool CTwBar::NeedsRedraw() const
+{
+    if( !m_UpToDate || !m_DrawKeyValid || m_HighlightedLine!=m_HighlightedLinePrev )
+        return true;
+    if( m_AutoRefresh && !m_IsMinimized && float(g_BarTimer.GetTime())>m_LastUpdateTime+m_UpdatePeriod )
+        return true;    // vars are polled
+    if( m_Roto.m_Active || m_EditInPlace.m_Active || m_HighlightClickBtnAuto>0 )
+        return true;    // animated
+    if( m_IsHelpBar && !m_IsMinimized && (g_TwMgr->m_HelpBarNotUpToDate || g_TwMgr->m_KeyPressedStr.size()>0 || g_TwMgr->m_InfoBuildText) )
+        return true;    // the help content and the info texts are not drawn while the help bar is minimized
+
+    int Key[DRAW_KEY_SIZE];
+    GetDrawKey(Key);
+    return memcmp(Key, m_DrawKey, sizeof(Key))!=0;
 }
 
 //  ---------------------------------------------------------------------------
@@ -3872,38 +3985,114 @@ static inline int IncrBtnWidth(int _CharHeight)
 
 //  ---------------------------------------------------------------------------
 
-void CTwBar::BrowseHierarchy(int *_CurrLine, int _CurrLevel, const CTwVar *_Var, int _First, int _Last)
+int CTwBar::CountHierLines(CTwVarGroup *_Grp)
 {
-    assert(_Var!=NULL);
-    if( !_Var->m_IsRoot )
+    assert(_Grp!=NULL && _Grp->m_Open);
+    int NbVars = (int)_Grp->m_Vars.size();
+    _Grp->m_LineOffsets.resize(NbVars+1);
+    int NbLines = 0;
+    for( int i=0; i<NbVars; ++i )
     {
-        if( (*_CurrLine)>=_First && (*_CurrLine)<=_Last )
+        _Grp->m_LineOffsets[i] = NbLines;
+        CTwVar *Var = _Grp->m_Vars[i];
+        if( Var->m_Visible )
         {
-            CHierTag Tag;
-            Tag.m_Level = _CurrLevel;
-            Tag.m_Var = const_cast<CTwVar *>(_Var);
-            Tag.m_Closing = false;
-            m_HierTags.push_back(Tag);
+            ++NbLines;
+            if( Var->IsGroup() && static_cast<CTwVarGroup *>(Var)->m_Open )
+                NbLines += CountHierLines(static_cast<CTwVarGroup *>(Var));
         }
-        *_CurrLine += 1;
     }
-    else
+    _Grp->m_LineOffsets[NbVars] = NbLines;
+    return NbLines;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwBar::BrowseHierarchy(int _First, int _Last)
+{
+    // Lists the lines _First to _Last of the var hierarchy in m_HierTags.
+    // The line counts stored by CountHierLines are used to go down directly
+    // to the var displayed at line _First, so the cost does not depend on
+    // the number of vars above or below the listed lines.
+    m_HierTags.resize(0);
+    m_HierStack.resize(0);
+    if( !m_VarRoot.m_Open )
+    {
+        m_NbHierLines = 0;
+        return;
+    }
+    if( !m_HierLinesUpToDate )
     {
-        *_CurrLine = 0;
-        _CurrLevel = -1;
-        m_HierTags.resize(0);
+        CountHierLines(&m_VarRoot);
+        m_HierLinesUpToDate = true;
     }
+    m_NbHierLines = m_VarRoot.m_LineOffsets.back();
+    if( _First<0 || _First>=m_NbHierLines || _Last<_First )
+        return;
 
-    if( _Var->IsGroup() )
+    const CTwVarGroup *Grp = &m_VarRoot;
+    int Line = _First;  // relative to the first line below Grp
+    for( ;; )
     {
-        const CTwVarGroup *Grp = static_cast<const CTwVarGroup *>(_Var);
-        if( Grp->m_Open )
-            for( vector<CTwVar*>::const_iterator it=Grp->m_Vars.begin(); it!=Grp->m_Vars.end(); ++it )
-                if( (*it)->m_Visible )
-                    BrowseHierarchy(_CurrLine, _CurrLevel+1, *it, _First, _Last);
-        if( m_HierTags.size()>0 )
-            m_HierTags[m_HierTags.size()-1].m_Closing = true;
+        const vector<int>& Offsets = Grp->m_LineOffsets;
+        int Index = (int)(upper_bound(Offsets.begin(), Offsets.end()-1, Line) - Offsets.begin()) - 1;
+        assert( Index>=0 && Index<(int)Grp->m_Vars.size() );
+        CHierFrame Frame;
+        Frame.m_Grp = Grp;
+        Frame.m_Index = Index;
+        m_HierStack.push_back(Frame);
+        Line -= Offsets[Index];
+        if( Line==0 )
+            break;
+        // line _First is inside the open group Grp->m_Vars[Index]
+        Grp = static_cast<const CTwVarGroup *>(Grp->m_Vars[Index]);
+        Line -= 1;
+    }
+
+    for( int l=_First; l<=_Last && !m_HierStack.empty(); )
+    {
+        CHierFrame& Top = m_HierStack.back();
+        if( Top.m_Index>=(int)Top.m_Grp->m_Vars.size() )
+        {
+            m_HierStack.pop_back();
+            if( !m_HierStack.empty() )
+                ++m_HierStack.back().m_Index;
+            continue;
+        }
+        CTwVar *Var = Top.m_Grp->m_Vars[Top.m_Index];
+        if( !Var->m_Visible )
+        {
+            ++Top.m_Index;
+            continue;
+        }
+        CHierTag Tag;
+        Tag.m_Level = (int)m_HierStack.size()-1;
+        Tag.m_Var = Var;
+        Tag.m_Closing = false;
+        m_HierTags.push_back(Tag);
+        ++l;
+        if( Var->IsGroup() && static_cast<CTwVarGroup *>(Var)->m_Open )
+        {
+            CHierFrame Frame;
+            Frame.m_Grp = static_cast<CTwVarGroup *>(Var);
+            Frame.m_Index = 0;
+            m_HierStack.push_back(Frame);
+        }
+        else
+            ++Top.m_Index;
     }
+
+    // A line is closing if it is the last line of a group content, or if it
+    // is a closed or empty group. The last listed line is closing as well.
+    int NbTags = (int)m_HierTags.size();
+    for( int t=0; t<NbTags-1; ++t )
+    {
+        int Level = m_HierTags[t].m_Level;
+        int NextLevel = m_HierTags[t+1].m_Level;
+        m_HierTags[t].m_Closing = ( NextLevel<Level || (NextLevel==Level && m_HierTags[t].m_Var->IsGroup()) );
+    }
+    if( NbTags>0 )
+        m_HierTags[NbTags-1].m_Closing = true;
 }
 
 //  ---------------------------------------------------------------------------
@@ -3992,6 +4181,8 @@ void CTwBar::ListValues(vector<string>& _Values, vector<color32>& _Colors, vecto
     const int NbEtc = 2;
     const CTwVarAtom *Atom = NULL;
     string ValStr;
+    const string *Str;
+    bool Unchanged;
     int Len, i, x, Etc;
     const unsigned char *Text;
     unsigned char ch;
@@ -4016,19 +4207,34 @@ void CTwBar::ListValues(vector<string>& _Values, vector<color32>& _Colors, vecto
             IsROText = false;
             HasBgColor = true;
             AcceptEdit = false;
+            Str = &ValStr;
+            Unchanged = false;
             if( !m_HierTags[h].m_Var->IsGroup() )
             {
                 Atom = static_cast<const CTwVarAtom *>(m_HierTags[h].m_Var);
-                Atom->ValueToString(&ValStr);
+                // numeric values are reformatted only if their bytes changed since the last refresh
+                Str = Atom->CachedValueToString(&Unchanged);
+                if( Str==NULL )
+                {
+                    Atom->ValueToString(&ValStr);
+                    Str = &ValStr;
+                }
                 if( !m_IsHelpBar || (Atom->m_Type==TW_TYPE_SHORTCUT && (Atom->m_Val.m_Shortcut.m_Incr[0]>0 || Atom->m_Val.m_Shortcut.m_Decr[0]>0)) )
                     ReadOnly = Atom->m_ReadOnly;
-                if( !Atom->m_NoSlider )
+                if( !Atom->m_NoSlider && Unchanged )
+                {
+                    IsMax = Atom->m_CacheIsMax;
+                    IsMin = Atom->m_CacheIsMin;
+                }
+                else if( !Atom->m_NoSlider )
                 {
                     double v, vmin, vmax;
                     v = Atom->ValueToDouble();
                     Atom->MinMaxStepToDouble(&vmin, &vmax, NULL);
                     IsMax = (v>=vmax);
                     IsMin = (v<=vmin);
+                    Atom->m_CacheIsMax = IsMax;
+                    Atom->m_CacheIsMin = IsMin;
                 }
                 if(    (Atom->m_Type==TW_TYPE_CDSTRING && Atom->m_SetCallback==NULL && g_TwMgr->m_CopyCDStringToClient==NULL)
                     || (Atom->m_Type==TW_TYPE_CDSTDSTRING && Atom->m_SetCallback==NULL)
@@ -4058,8 +4264,8 @@ void CTwBar::ListValues(vector<string>& _Values, vector<color32>& _Colors, vecto
                 ValStr = "";    // is a group in the help bar
                 HasBgColor = false;
             }
-            Len = (int)ValStr.length();
-            Text = (const unsigned char *)(ValStr.c_str());
+            Len = (int)Str->length();
+            Text = (const unsigned char *)(Str->c_str());
             x = 0;
             Etc = 0;
             _Values.push_back("");  // add a new text line
@@ -4152,6 +4358,7 @@ void CTwBar::Update()
     assert(m_UpToDate==false);
     assert(m_Font);
     ITwGraph *Gr = g_TwMgr->m_Graph;
+    CTwRefreshScope RefreshScope;   // struct vars are fetched once
 
     bool DoEndDraw = false;
     if( !Gr->IsDrawing() )
@@ -4254,7 +4461,7 @@ void CTwBar::Update()
     }
     else
     {
-        m_VarY0 = 4;
+        m_VarY0 = (m_PopupFilter.size()>0) ? m_Font->m_CharHeight+2+4 : 4; // the filter is displayed as a title
         m_VarY1 = m_Height-2-m_Sep;
         m_VarY2 = m_Height-1;
     }
@@ -4262,13 +4469,13 @@ void CTwBar::Update()
     int NbLines = (m_VarY1-m_VarY0+1)/(m_Font->m_CharHeight+m_Sep);
     if( NbLines<= 0 )
         NbLines = 1;
-    if( !m_IsMinimized )
+    if( !m_IsMinimized && m_IsPopupList )
+        UpdatePopupList(NbLines);
+    else if( !m_IsMinimized )
     {
-        int LineNum = 0;
-        BrowseHierarchy(&LineNum, 0, &m_VarRoot, m_FirstLine, m_FirstLine+NbLines); // add a dummy tag at the end to avoid wrong 'tag-closing' problems
+        BrowseHierarchy(m_FirstLine, m_FirstLine+NbLines); // add a dummy tag at the end to avoid wrong 'tag-closing' problems
         if( (int)m_HierTags.size()>NbLines )
             m_HierTags.resize(NbLines); // remove the last dummy tag
-        m_NbHierLines = LineNum;
         m_NbDisplayedLines = (int)m_HierTags.size();
     }
 
@@ -4304,7 +4511,13 @@ void CTwBar::Update()
 
     // Build title
     string Title;
-    if( m_Label.size()>0 )
+    if( m_IsPopupList && m_PopupFilter.size()>0 )
+    {
+        char Count[32];
+        sprintf(Count, "  (%d)", m_NbHierLines);
+        Title = m_PopupFilter + Count;
+    }
+    else if( m_Label.size()>0 )
         Title = m_Label;
     else
         Title = m_Name;
@@ -4320,10 +4533,7 @@ void CTwBar::Update()
         bool HasBgColors = false;
         ListLabels(Labels, Colors, BgColors, &HasBgColors, m_Font, m_VarX1-m_VarX0, m_VarX2-m_VarX0);
         assert( Labels.size()==Colors.size() && Labels.size()==BgColors.size() );
-        if( Labels.size()>0 )
-            Gr->BuildText(m_LabelsTextObj, &(Labels[0]), &(Colors[0]), &(BgColors[0]), (int)Labels.size(), m_Font, 1, HasBgColors ? m_VarX1-m_VarX0-m_Font->m_CharHeight+2 : 0);
-        else
-            Gr->BuildText(m_LabelsTextObj, NULL, NULL, NULL, 0, m_Font, 1, 0);
+        BuildTextLines(m_LabelsTextObj, &m_LabelsLines, Labels, Colors, BgColors, 1, (HasBgColors && Labels.size()>0) ? m_VarX1-m_VarX0-m_Font->m_CharHeight+2 : 0);
 
         // Should draw click button?
         m_DrawClickBtn    = ( m_VarX2-m_VarX1>4*IncrBtnWidth(m_Font->m_CharHeight)
@@ -4385,10 +4595,7 @@ void CTwBar::Update()
         BgColors.resize(0);
         ListValues(Values, Colors, BgColors, m_Font, m_VarX2-m_VarX1);
         assert( BgColors.size()==Values.size() && Colors.size()==Values.size() );
-        if( Values.size()>0 )
-            Gr->BuildText(m_ValuesTextObj, &(Values[0]), &(Colors[0]), &(BgColors[0]), (int)Values.size(), m_Font, 1, m_VarX2-m_VarX1);
-        else
-            Gr->BuildText(m_ValuesTextObj, NULL, NULL, NULL, 0, m_Font, 1, m_VarX2-m_VarX1);
+        BuildTextLines(m_ValuesTextObj, &m_ValuesLines, Values, Colors, BgColors, 1, m_VarX2-m_VarX1);
 
         // Build key shortcut text
         string Shortcut;
@@ -4427,6 +4634,36 @@ void CTwBar::Update()
 
 //  ---------------------------------------------------------------------------
 
+void CTwBar::BuildTextLines(void *_TextObj, CTextLines *_Prev, vector<string>& _Lines, vector<color32>& _Colors, vector<color32>& _BgColors, int _Sep, int _BgWidth)
+{
+    // Only the lines whose text or colors changed are rebuilt if the layout
+    // is the same as the one of the previous call (_Prev). The new lines are
+    // swapped into _Prev.
+    ITwGraph *Gr = g_TwMgr->m_Graph;
+    int NbLines = (int)_Lines.size();
+    bool Incremental = ( _Prev->m_Font==m_Font && _Prev->m_Sep==_Sep && _Prev->m_BgWidth==_BgWidth && (int)_Prev->m_Lines.size()==NbLines );
+    for( int l=0; l<NbLines && Incremental; ++l )
+        if( _Lines[l]!=_Prev->m_Lines[l] || _Colors[l]!=_Prev->m_Colors[l] || _BgColors[l]!=_Prev->m_BgColors[l] )
+            Incremental = Gr->UpdateTextLine(_TextObj, l, _Lines[l], _Colors[l], _BgColors[l], m_Font, _Sep);
+
+    if( !Incremental )
+    {
+        if( NbLines>0 )
+            Gr->BuildText(_TextObj, &(_Lines[0]), &(_Colors[0]), &(_BgColors[0]), NbLines, m_Font, _Sep, _BgWidth);
+        else
+            Gr->BuildText(_TextObj, NULL, NULL, NULL, 0, m_Font, _Sep, _BgWidth);
+    }
+
+    _Prev->m_Lines.swap(_Lines);
+    _Prev->m_Colors.swap(_Colors);
+    _Prev->m_BgColors.swap(_BgColors);
+    _Prev->m_Font = m_Font;
+    _Prev->m_Sep = _Sep;
+    _Prev->m_BgWidth = _BgWidth;
+}
+
+//  ---------------------------------------------------------------------------
+
 void CTwBar::DrawHierHandle()
 {
     assert(m_Font);
@@ -4651,16 +4888,20 @@ void CTwBar::Draw()
 
     assert(m_Font);
     ITwGraph *Gr = g_TwMgr->m_Graph;
+    CTwRefreshScope RefreshScope;   // custom widgets read the struct vars fetched by Update
 
     m_CustomRecords.clear();
 
-    if( float(g_BarTimer.GetTime())>m_LastUpdateTime+m_UpdatePeriod )
-        NotUpToDate();
+    if( m_AutoRefresh && float(g_BarTimer.GetTime())>m_LastUpdateTime+m_UpdatePeriod )
+        ValuesNotUpToDate();
+
+    if( m_HighlightClickBtnAuto>0 && g_TwMgr->m_Timer.GetTime()-m_HighlightClickBtnAuto>=0.1 )
+        m_HighlightClickBtnAuto = 0;    // the button pressed by a shortcut is drawn highlighted for 0.1s
 
     if( m_HighlightedLine!=m_HighlightedLinePrev )
     {
         m_HighlightedLinePrev = m_HighlightedLine;
-        NotUpToDate();
+        ValuesNotUpToDate();
     }
 
     if( m_IsHelpBar && g_TwMgr->m_HelpBarNotUpToDate )
@@ -4669,13 +4910,38 @@ void CTwBar::Draw()
     if( !m_UpToDate )
         Update();
 
+    int Key[DRAW_KEY_SIZE];
+    bool Cacheable = GetDrawKey(Key);
+    bool SameKey = m_DrawKeyValid && memcmp(Key, m_DrawKey, sizeof(Key))==0;
+    memcpy(m_DrawKey, Key, sizeof(Key));
+    m_DrawKeyValid = true;
+
+    // Replay the primitives recorded by a previous Draw if nothing changed since
+    bool RecordCache = false;
+    if( g_TwMgr->m_UseDrawCache )
+    {
+        if( Cacheable )
+        {
+            if( m_DrawCacheValid && SameKey && m_DrawCache!=NULL && Gr->DrawCache(m_DrawCache) )
+                return;
+            if( m_DrawCache==NULL )
+                m_DrawCache = Gr->NewCacheObj();
+            if( m_DrawCache!=NULL )
+            {
+                Gr->BeginCache(m_DrawCache);
+                RecordCache = true;
+            }
+        }
+        m_DrawCacheValid = false;
+    }
+
     if( !m_IsMinimized )
     {
         int y = m_PosY+1;
         int LevelSpace = max(m_Font->m_CharHeight-6, 4); // space used by DrawHierHandles
 
         // Draw title
-        if( !m_IsPopupList )
+        if( !m_IsPopupList || m_PopupFilter.size()>0 )
         {
             PERF( Timer.Reset(); )
             Gr->DrawRect(m_PosX, m_PosY, m_PosX+m_Width-1, m_PosY+m_Font->m_CharHeight+1, (m_HighlightTitle||m_MouseDragTitle) ? m_ColTitleHighBg : (m_DrawHandles ? m_ColTitleBg : m_ColTitleUnactiveBg));
@@ -4716,7 +4982,7 @@ void CTwBar::Draw()
         {
             int y0 = m_PosY + m_VarY0 + m_HighlightedLine*(m_Font->m_CharHeight+m_Sep);
             Gr->DrawRect(m_PosX+LevelSpace+6+LevelSpace*m_HierTags[m_HighlightedLine].m_Level, y0+1, m_PosX+m_VarX2, y0+m_Font->m_CharHeight-1, m_ColHighBg0, m_ColHighBg0, m_ColHighBg1, m_ColHighBg1);
-            int eps = (g_TwMgr->m_GraphAPI==TW_OPENGL) ? 1 : 0;
+            int eps = (g_TwMgr->m_GraphAPI==TW_OPENGL || g_TwMgr->m_GraphAPI==TW_OPENGL_CORE) ? 1 : 0;
             if( !m_EditInPlace.m_Active )
                 Gr->DrawLine(m_PosX+LevelSpace+6+LevelSpace*m_HierTags[m_HighlightedLine].m_Level, y0+m_Font->m_CharHeight+eps, m_PosX+m_VarX2, y0+m_Font->m_CharHeight+eps, m_ColUnderline);
         }
@@ -4777,7 +5043,7 @@ void CTwBar::Draw()
                     // draw color value
                     if( Grp->m_Vars.size()>0 && Grp->m_Vars[0]!=NULL && !Grp->m_Vars[0]->IsGroup() )
                         static_cast<CTwVarAtom *>(Grp->m_Vars[0])->ValueToDouble(); // force ext update
-                    int ydecal = (g_TwMgr->m_GraphAPI==TW_OPENGL) ? 1 : 0;
+                    int ydecal = (g_TwMgr->m_GraphAPI==TW_OPENGL || g_TwMgr->m_GraphAPI==TW_OPENGL_CORE) ? 1 : 0;
                     const int checker = 8;
                     for( int c=0; c<checker; ++c )
                         Gr->DrawRect(m_PosX+m_VarX1+(c*(m_VarX2-m_VarX1))/checker, yh+1+ydecal+((c%2)*(m_Font->m_CharHeight-2))/2, m_PosX+m_VarX1-1+((c+1)*(m_VarX2-m_VarX1))/checker, yh+ydecal+(((c%2)+1)*(m_Font->m_CharHeight-2))/2, 0xffffffff);
@@ -4803,8 +5069,7 @@ void CTwBar::Draw()
                 int cbx0 = m_PosX+m_VarX2-2*bw+bw/2, cby0 = yh+2, cbx1 = m_PosX+m_VarX2-2-bw/2, cby1 = yh+m_Font->m_CharHeight-4;
                 if( !static_cast<CTwVarAtom *>(m_HierTags[h].m_Var)->m_ReadOnly )
                 {
-                    double BtnAutoDelta = g_TwMgr->m_Timer.GetTime() - m_HighlightClickBtnAuto;
-                    if( (m_HighlightClickBtn || (BtnAutoDelta>=0 && BtnAutoDelta<0.1)) && h==m_HighlightedLine )
+                    if( (m_HighlightClickBtn || m_HighlightClickBtnAuto>0) && h==m_HighlightedLine )
                     {
                         cbx0--; cby0--; cbx1--; cby1--;
                         Gr->DrawRect(cbx0+2, cby0+2, cbx1+2, cby1+2, m_ColHighBtn);
@@ -5202,6 +5467,34 @@ void CTwBar::Draw()
             Gr->DrawLine(xm+wm/2, m_MinPosY+3+wm-wm/4+1, xm+wm/2, m_MinPosY+3+wm-wm/4+2, m_ColTitleText);
         }
     }
+
+    // custom widgets display live values: they are not cached
+    if( RecordCache )
+        m_DrawCacheValid = Gr->EndCache(m_DrawCache) && m_CustomRecords.empty();
+}
+
+//  ---------------------------------------------------------------------------
+
+// A bar without mouse state ignores the mouse events occurring outside its
+// rectangle (or outside its icon if minimized), so TwMouseEvent does not need
+// to pass them to it.
+bool CTwBar::HasMouseState() const
+{
+    if( m_MouseDrag || m_MouseDragVar || m_MouseDragTitle || m_MouseDragScroll || m_MouseDragValWidth
+        || m_MouseDragResizeUR || m_MouseDragResizeUL || m_MouseDragResizeLR || m_MouseDragResizeLL )
+        return true;
+    if( m_HighlightedLine>=0 || m_HighlightIncrBtn || m_HighlightDecrBtn || m_HighlightRotoBtn || m_HighlightListBtn || m_HighlightBoolBtn
+        || m_HighlightClickBtn || m_HighlightTitle || m_HighlightScroll || m_HighlightUpScroll || m_HighlightDnScroll || m_HighlightMinimize
+        || m_HighlightFont || m_HighlightValWidth || m_HighlightMaximize || m_DrawHandles )
+        return true;
+    if( m_EditInPlace.m_Active || m_CustomActiveStructProxy!=NULL )
+        return true;
+    if( !m_UpToDate )   // the handlers call Update, which may move the bar into the window
+        return true;
+    for( CustomMap::const_iterator it=m_CustomRecords.begin(); it!=m_CustomRecords.end(); ++it )
+        if( it->first!=NULL && it->first->m_CustomCaptureFocus )
+            return true;
+    return false;
 }
 
 //  ---------------------------------------------------------------------------
@@ -5456,7 +5749,7 @@ bool CTwBar::MouseMotion(int _X, int _Y)
                         m_FirstLine = m_NbHierLines-m_NbDisplayedLines;
                     else
                         m_FirstLine = m_FirstLine0+dl;
-                    NotUpToDate();
+                    ValuesNotUpToDate();
                 }
                 ANT_SET_CURSOR(NS);
                 Handled = true;
@@ -5709,7 +6002,7 @@ static void ANT_CALL PopupCallback(void *_ClientData)
 
     if( g_TwMgr!=NULL && g_TwMgr->m_PopupBar!=NULL )
     {
-        unsigned int Enum = *(unsigned int *)&_ClientData;
+        unsigned int Enum = (unsigned int)(size_t)_ClientData;
         CTwVarAtom *Var = g_TwMgr->m_PopupBar->m_VarEnumLinkedToPopupList;
         CTwBar *Bar = g_TwMgr->m_PopupBar->m_BarLinkedToPopupList;
         if( Bar!=NULL && Var!=NULL && !Var->m_ReadOnly && (Var->m_Type>=TW_TYPE_ENUM_BASE && Var->m_Type<TW_TYPE_ENUM_BASE+(int)g_TwMgr->m_Enums.size()) )
@@ -5729,6 +6022,167 @@ static void ANT_CALL PopupCallback(void *_ClientData)
 
 //  ---------------------------------------------------------------------------
 
+void CTwBar::UpdatePopupList(int _NbLines)
+{
+    // A popup list only owns one button per displayed line. These buttons are
+    // bound to the entries of the enum that are in the displayed window each 
+    // time the list is updated, so the cost of opening and scrolling the list
+    // does not depend on the number of entries.
+    m_HierTags.resize(0);
+    m_NbHierLines = 0;
+    m_NbDisplayedLines = 0;
+    if( m_PopupEnum<0 || m_PopupEnum>=(int)g_TwMgr->m_Enums.size() )
+        return;
+
+    const CTwMgr::CEnum& e = g_TwMgr->m_Enums[m_PopupEnum];
+    bool Filtered = (m_PopupFilter.size()>0);
+    int NbEntries = Filtered ? (int)m_PopupMatches.size() : e.Size();
+    if( m_FirstLine>NbEntries-_NbLines )
+        m_FirstLine = NbEntries-_NbLines;
+    if( m_FirstLine<0 )
+        m_FirstLine = 0;
+    int NbDisplayed = min(_NbLines, NbEntries-m_FirstLine);
+
+    if( (int)m_VarRoot.m_Vars.size()<NbDisplayed )
+    {
+        bool HelpBarNotUpToDate = g_TwMgr->m_HelpBarNotUpToDate;
+        char Name[16];
+        for( int i=(int)m_VarRoot.m_Vars.size(); i<NbDisplayed; ++i )
+        {
+            sprintf(Name, "%d", i);
+            if( TwAddButton(this, Name, PopupCallback, NULL, NULL)==0 )
+                break;
+        }
+        g_TwMgr->m_HelpBarNotUpToDate = HelpBarNotUpToDate; // popup buttons are not listed by the help bar
+        NbDisplayed = min(NbDisplayed, (int)m_VarRoot.m_Vars.size());
+    }
+
+    char ValStr[16];
+    for( int i=0; i<NbDisplayed; ++i )
+    {
+        int Rank = Filtered ? m_PopupMatches[m_FirstLine+i] : m_FirstLine+i;
+        if( Rank>=e.Size() )
+            break;  // the enum has been redefined
+        unsigned int Value = e.m_Values[Rank];
+        CTwVarAtom *Btn = static_cast<CTwVarAtom *>(m_VarRoot.m_Vars[i]);
+        if( e.LabelLength(Rank)>0 )
+            Btn->m_Label.assign(e.Label(Rank), e.LabelLength(Rank));
+        else
+        {
+            sprintf(ValStr, "%u", Value);
+            Btn->m_Label = ValStr;
+        }
+        Btn->m_ClientData = (void *)(size_t)Value;
+        if( Value==m_PopupValue )
+        {
+            Btn->m_ColorPtr = &m_ColValTextNE;
+            Btn->m_BgColorPtr = &m_ColGrpBg;
+        }
+        else
+        {
+            Btn->m_ColorPtr = &m_ColLabelText;
+            Btn->m_BgColorPtr = &COLOR32_ZERO;
+        }
+        CHierTag Tag;
+        Tag.m_Var = Btn;
+        Tag.m_Level = 0;
+        Tag.m_Closing = false;
+        m_HierTags.push_back(Tag);
+    }
+    if( m_HierTags.size()>0 )
+        m_HierTags[m_HierTags.size()-1].m_Closing = true;
+    m_NbHierLines = NbEntries;
+    m_NbDisplayedLines = (int)m_HierTags.size();
+}
+
+//  ---------------------------------------------------------------------------
+
+static bool LabelContains(const char *_Label, size_t _Length, const string& _LowerText)
+{
+    size_t n = _LowerText.size();
+    if( n>_Length )
+        return false;
+    for( size_t i=0; i+n<=_Length; ++i )
+    {
+        size_t j = 0;
+        while( j<n && tolower((unsigned char)_Label[i+j])==(unsigned char)_LowerText[j] )
+            ++j;
+        if( j==n )
+            return true;
+    }
+    return false;
+}
+
+void CTwBar::SetPopupFilter(const std::string& _Filter)
+{
+    if( m_PopupEnum<0 || m_PopupEnum>=(int)g_TwMgr->m_Enums.size() )
+        return;
+
+    string Lower(_Filter);
+    for( size_t i=0; i<Lower.size(); ++i )
+        Lower[i] = (char)tolower((unsigned char)Lower[i]);
+
+    // Typing one more character only needs to filter the current matches
+    const CTwMgr::CEnum& e = g_TwMgr->m_Enums[m_PopupEnum];
+    bool Refine = m_PopupFilter.size()>0 && Lower.size()>m_PopupFilter.size() && Lower.compare(0, m_PopupFilter.size(), m_PopupFilter)==0;
+    if( Refine )
+    {
+        int n = 0;
+        for( int i=0; i<(int)m_PopupMatches.size(); ++i )
+            if( m_PopupMatches[i]<e.Size() && LabelContains(e.Label(m_PopupMatches[i]), e.LabelLength(m_PopupMatches[i]), Lower) )
+                m_PopupMatches[n++] = m_PopupMatches[i];
+        m_PopupMatches.resize(n);
+    }
+    else
+    {
+        m_PopupMatches.resize(0);
+        if( Lower.size()>0 )
+            for( int i=0; i<e.Size(); ++i )
+                if( LabelContains(e.Label(i), e.LabelLength(i), Lower) )
+                    m_PopupMatches.push_back(i);
+    }
+    m_PopupFilter = Lower;
+    m_FirstLine = 0;
+    m_HighlightedLine = 0;
+    m_HighlightedLineLastValid = 0;
+    NotUpToDate();
+}
+
+// Returns true if _Key is the shortcut of a visible var of a bar
+static bool IsVarShortcut(int _Key, int _Modifiers)
+{
+    bool DoIncr;
+    for( size_t i=0; i<g_TwMgr->m_Bars.size(); ++i )
+    {
+        CTwBar *Bar = g_TwMgr->m_Bars[i];
+        if( Bar!=NULL && Bar->m_Visible && !Bar->m_IsPopupList )
+        {
+            CTwVarAtom *Atom = Bar->m_VarRoot.FindShortcut(_Key, _Modifiers, &DoIncr);
+            if( Atom!=NULL && Atom->m_Visible )
+                return true;
+        }
+    }
+    return false;
+}
+
+// Only the keys that change the filter are used: the others (including var
+// shortcuts typed before the filter) are passed to the bars.
+bool CTwBar::PopupFilterKey(int _Key, int _Modifiers)
+{
+    if( _Key==TW_KEY_BACKSPACE && m_PopupFilter.size()>0 )
+        SetPopupFilter(m_PopupFilter.substr(0, m_PopupFilter.size()-1));
+    else if( _Key==TW_KEY_ESCAPE && m_PopupFilter.size()>0 )
+        SetPopupFilter("");
+    else if( _Key>=' ' && _Key<256 && _Key!=TW_KEY_DELETE && (_Modifiers&(TW_KMOD_CTRL|TW_KMOD_ALT|TW_KMOD_META))==0 
+             && (m_PopupFilter.size()>0 || !IsVarShortcut(_Key, _Modifiers)) )
+        SetPopupFilter(m_PopupFilter + (char)_Key);
+    else
+        return false;
+    return true;
+}
+
+//  ---------------------------------------------------------------------------
+
 bool CTwBar::MouseButton(ETwMouseButtonID _Button, bool _Pressed, int _X, int _Y)
 {
     assert(g_TwMgr->m_Graph && g_TwMgr->m_WndHeight>0 && g_TwMgr->m_WndWidth>0);
@@ -5819,7 +6273,7 @@ bool CTwBar::MouseButton(ETwMouseButtonID _Button, bool _Pressed, int _X, int _Y
                     g_TwMgr->m_PopupBar->m_PosX = m_PosX + m_VarX1 - 2;
                     g_TwMgr->m_PopupBar->m_PosY = m_PosY + m_VarY0 + (m_HighlightedLine+1)*(m_Font->m_CharHeight+m_Sep);
                     g_TwMgr->m_PopupBar->m_Width = m_Width - 2*m_Font->m_CharHeight;
-                    int popHeight0 = (int)e.m_Entries.size()*(m_Font->m_CharHeight+m_Sep) + m_Font->m_CharHeight/2+2;
+                    int popHeight0 = e.Size()*(m_Font->m_CharHeight+m_Sep) + m_Font->m_CharHeight/2+2;
                     int popHeight = popHeight0;
                     if( g_TwMgr->m_PopupBar->m_PosY+popHeight+2 > g_TwMgr->m_WndHeight )
                         popHeight = g_TwMgr->m_WndHeight-g_TwMgr->m_PopupBar->m_PosY-2;
@@ -5831,23 +6285,13 @@ bool CTwBar::MouseButton(ETwMouseButtonID _Button, bool _Pressed, int _X, int _Y
                     g_TwMgr->m_PopupBar->m_VarEnumLinkedToPopupList = Var;
                     g_TwMgr->m_PopupBar->m_BarLinkedToPopupList = this;
                     unsigned int CurrentEnumValue = (unsigned int)((int)Var->ValueToDouble());
-                    for( CTwMgr::CEnum::CEntries::iterator It=e.m_Entries.begin(); It!=e.m_Entries.end(); ++It )
-                    {
-                        char ID[64];
-                        sprintf(ID, "%u", It->first);
-                        //ultoa(It->first, ID, 10);
-                        TwAddButton(g_TwMgr->m_PopupBar, ID, PopupCallback, *(void**)&(It->first), NULL);
-                        CTwVar *Btn = g_TwMgr->m_PopupBar->Find(ID);
-                        if( Btn!=NULL )
-                        {
-                            Btn->m_Label = It->second.c_str();
-                            if( It->first==CurrentEnumValue )
-                            {
-                                Btn->m_ColorPtr = &m_ColValTextNE;
-                                Btn->m_BgColorPtr = &m_ColGrpBg;
-                            }
-                        }
-                    }
+                    g_TwMgr->m_PopupBar->m_PopupEnum = Var->m_Type-TW_TYPE_ENUM_BASE;
+                    g_TwMgr->m_PopupBar->m_PopupValue = CurrentEnumValue;
+                    // entries are bound to the popup buttons by UpdatePopupList; start with the current value in view
+                    int CurrentRank = e.Find(CurrentEnumValue);
+                    int NbPopupLines = max((popHeight-6-m_Sep)/(m_Font->m_CharHeight+m_Sep), 1);
+                    if( CurrentRank>=NbPopupLines )
+                        g_TwMgr->m_PopupBar->m_FirstLine = CurrentRank-NbPopupLines/2;
                     g_TwMgr->m_HelpBarNotUpToDate = false;
                 }
                 else if( (Var->m_ReadOnly && (Var->m_Type==TW_TYPE_CDSTRING || Var->m_Type==TW_TYPE_CDSTDSTRING || Var->m_Type==TW_TYPE_STDSTRING || (Var->m_Type>TW_TYPE_CSSTRING_BASE && Var->m_Type<=TW_TYPE_CSSTRING_MAX)) && EditInPlaceAcceptVar(Var))
@@ -5989,7 +6433,7 @@ bool CTwBar::MouseButton(ETwMouseButtonID _Button, bool _Pressed, int _X, int _Y
             if( m_FirstLine>0 )
             {
                 --m_FirstLine;
-                NotUpToDate();
+                ValuesNotUpToDate();
             }
         }
         else if( _Pressed && _Button==TW_MOUSE_LEFT && _X>=m_PosX+m_VarX2+2 && _X<m_PosX+m_Width-2 && _Y>=m_ScrollY1 && _Y<m_PosY+m_VarY1 )
@@ -5997,7 +6441,7 @@ bool CTwBar::MouseButton(ETwMouseButtonID _Button, bool _Pressed, int _X, int _Y
             if( m_FirstLine<m_NbHierLines-m_NbDisplayedLines )
             {
                 ++m_FirstLine;
-                NotUpToDate();
+                ValuesNotUpToDate();
             }
         }
         else if( _Pressed && !m_MouseDrag && m_Resizable && !m_IsPopupList && _Button==TW_MOUSE_LEFT && _X>=m_PosX && _X<m_PosX+m_Font->m_CharHeight && _Y>=m_PosY && _Y<m_PosY+m_Font->m_CharHeight )
@@ -6167,7 +6611,7 @@ bool CTwBar::MouseButton(ETwMouseButtonID _Button, bool _Pressed, int _X, int _Y
 
 //  ---------------------------------------------------------------------------
 
-bool CTwBar::MouseWheel(int _Pos, int _PrevPos, int _MouseX, int _MouseY)
+bool CTwBar::MouseWheel(int _NbLines, int _MouseX, int _MouseY)
 {
     assert(g_TwMgr->m_Graph && g_TwMgr->m_WndHeight>0 && g_TwMgr->m_WndWidth>0);
     if( !m_UpToDate )
@@ -6176,18 +6620,18 @@ bool CTwBar::MouseWheel(int _Pos, int _PrevPos, int _MouseX, int _MouseY)
     bool Handled = false;
     if( !m_IsMinimized && _MouseX>=m_PosX && _MouseX<m_PosX+m_Width && _MouseY>=m_PosY && _MouseY<m_PosY+m_Height )
     {
-        if( _Pos>_PrevPos && m_FirstLine>0 )
+        if( _NbLines>0 && m_FirstLine>0 )
         {
-            --m_FirstLine;
-            NotUpToDate();
+            m_FirstLine = max(m_FirstLine-_NbLines, 0);
+            ValuesNotUpToDate();
         }
-        else if( _Pos<_PrevPos && m_FirstLine<m_NbHierLines-m_NbDisplayedLines )
+        else if( _NbLines<0 && m_FirstLine<m_NbHierLines-m_NbDisplayedLines )
         {
-            ++m_FirstLine;
-            NotUpToDate();
+            m_FirstLine = min(m_FirstLine-_NbLines, m_NbHierLines-m_NbDisplayedLines);
+            ValuesNotUpToDate();
         }
 
-        if( _Pos!=_PrevPos )
+        if( _NbLines!=0 )
         {
             Handled = true;
             if( m_EditInPlace.m_Active )
@@ -6316,6 +6760,10 @@ bool CTwBar::KeyPressed(int _Key, int _Modifiers)
         {
             Handled = EditInPlaceKeyPressed(_Key, _Modifiers);
         }
+        else if( m_IsPopupList && PopupFilterKey(_Key, _Modifiers) )
+        {
+            Handled = true;
+        }
         else
         {
             bool BarActive = m_DrawHandles || m_IsPopupList;
@@ -6439,7 +6887,7 @@ bool CTwBar::KeyPressed(int _Key, int _Modifiers)
                         if( m_FirstLine>0 )
                         {
                             --m_FirstLine;
-                            NotUpToDate();
+                            ValuesNotUpToDate();
                         }
                     }
                     m_HighlightedLineLastValid = m_HighlightedLine;
@@ -6454,7 +6902,7 @@ bool CTwBar::KeyPressed(int _Key, int _Modifiers)
                         if( m_FirstLine<m_NbHierLines-m_NbDisplayedLines )
                         {
                             ++m_FirstLine;
-                            NotUpToDate();
+                            ValuesNotUpToDate();
                         }                    
                     }
                     m_HighlightedLineLastValid = m_HighlightedLine;
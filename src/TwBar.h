@@ -38,7 +38,7 @@ struct CTwVar
 
     virtual bool            IsGroup() const = 0;
     virtual const CTwVar *  Find(const char *_Name, struct CTwVarGroup **_Parent, int *_Index) const = 0;
-    virtual int             HasAttrib(const char *_Attrib, bool *_HasValue) const;
+    virtual int             HasAttrib(const char *_Attrib, int _Len, bool *_HasValue) const;
     virtual int             SetAttrib(int _AttribID, const char *_Value, TwBar *_Bar, struct CTwVarGroup *_VarParent, int _VarIndex);
     virtual ERetType        GetAttrib(int _AttribID, TwBar *_Bar, struct CTwVarGroup *_VarParent, int _VarIndex, std::vector<double>& outDouble, std::ostringstream& outString) const;
     virtual void            SetReadOnly(bool _ReadOnly) = 0;
@@ -114,13 +114,27 @@ struct CTwVarAtom : CTwVar
     };
     UVal                    m_Val;
 
+    enum EFormat            { FORMAT_UNKNOWN=0, FORMAT_NONE, FORMAT_BOOL, FORMAT_CHAR, FORMAT_CHAR_HEXA, FORMAT_INT, FORMAT_UINT, FORMAT_HEXA, FORMAT_GENERAL, FORMAT_FIXED };
+    mutable signed char     m_Format;       // display format resolved from m_Type and m_Val, reset to FORMAT_UNKNOWN when attributes change
+    mutable signed char     m_FormatDigits; // number of hexa digits or float precision
+    void                    UpdateFormat() const;
+    void                    FormatValue(const void *_Value, std::string *_Str) const;    // for types with a m_Format only
+
+    // Last value read by CachedValueToString, invalidated with m_Format
+    mutable bool            m_CacheValid;
+    mutable unsigned char   m_CacheBytes[8];
+    mutable std::string     m_CacheString;
+    mutable bool            m_CacheIsMin;   // stored by CTwBar::ListValues
+    mutable bool            m_CacheIsMax;
+    const std::string *     CachedValueToString(bool *_Unchanged) const;    // returns NULL if the type is not cached
+
     virtual bool            IsGroup() const { return false; }
     virtual void            ValueToString(std::string *_Str) const;
     virtual double          ValueToDouble() const;
     virtual void            ValueFromDouble(double _Val);
     virtual void            MinMaxStepToDouble(double *_Min, double *_Max, double *_Step) const;
     virtual const CTwVar *  Find(const char *_Name, struct CTwVarGroup **_Parent, int *_Index) const;
-    virtual int             HasAttrib(const char *_Attrib, bool *_HasValue) const;
+    virtual int             HasAttrib(const char *_Attrib, int _Len, bool *_HasValue) const;
     virtual int             SetAttrib(int _AttribID, const char *_Value, TwBar *_Bar, struct CTwVarGroup *_VarParent, int _VarIndex);
     virtual ERetType        GetAttrib(int _AttribID, TwBar *_Bar, struct CTwVarGroup *_VarParent, int _VarIndex, std::vector<double>& outDouble, std::ostringstream& outString) const;
     virtual void            Increment(int _Step);
@@ -141,10 +155,11 @@ struct CTwVarGroup : CTwVar
     void *                  m_SummaryClientData;
     void *                  m_StructValuePtr;
     TwType                  m_StructType;
+    std::vector<int>        m_LineOffsets;      // if open: line of each var relative to the first line below the group, followed by the number of lines of the group content (see CTwBar::CountHierLines)
 
     virtual bool            IsGroup() const { return true; }
     virtual const CTwVar *  Find(const char *_Name, CTwVarGroup **_Parent, int *_Index) const;
-    virtual int             HasAttrib(const char *_Attrib, bool *_HasValue) const;
+    virtual int             HasAttrib(const char *_Attrib, int _Len, bool *_HasValue) const;
     virtual int             SetAttrib(int _AttribID, const char *_Value, TwBar *_Bar, struct CTwVarGroup *_VarParent, int _VarIndex);
     virtual ERetType        GetAttrib(int _AttribID, TwBar *_Bar, struct CTwVarGroup *_VarParent, int _VarIndex, std::vector<double>& outDouble, std::ostringstream& outString) const;
     virtual CTwVarAtom *    FindShortcut(int _Key, int _Modifiers, bool *_DoIncr);
@@ -173,11 +188,17 @@ struct CTwBar
     int                     m_Sep;
     int                     m_FirstLine;
     float                   m_UpdatePeriod;
+    bool                    m_AutoRefresh;  // poll vars every m_UpdatePeriod; if false, only refreshed by NotUpToDate
     bool                    m_IsHelpBar;
     int                     m_MinNumber;    // accessed by TwDeleteBar
+    int                     m_RectIndex;    // index in g_TwMgr->m_BarRects, -1 if not indexed
     bool                    m_IsPopupList;
     CTwVarAtom *            m_VarEnumLinkedToPopupList;
     CTwBar *                m_BarLinkedToPopupList;
+    int                     m_PopupEnum;        // index in g_TwMgr->m_Enums of the enum listed by a popup
+    unsigned int            m_PopupValue;       // value of m_VarEnumLinkedToPopupList when the popup was opened
+    std::string             m_PopupFilter;      // text typed in the popup: only the entries whose label contains it are listed
+    std::vector<int>        m_PopupMatches;     // ranks of the listed entries if m_PopupFilter is not empty
     bool                    m_Resizable;
     bool                    m_Movable;
     bool                    m_Iconifiable;
@@ -185,19 +206,27 @@ struct CTwBar
 
     CTwVarGroup             m_VarRoot;
 
-    void                    NotUpToDate();
+    void                    NotUpToDate();          // the var hierarchy may have changed
+    void                    ValuesNotUpToDate();    // only the values or the scroll position changed
     void                    Draw();
+    bool                    NeedsRedraw() const;    // true if Draw would not produce the same image as the previous one
     const CTwVar *          Find(const char *_Name, CTwVarGroup **_Parent=NULL, int *_Index=NULL) const;
     CTwVar *                Find(const char *_Name, CTwVarGroup **_Parent=NULL, int *_Index=NULL);
-    int                     HasAttrib(const char *_Attrib, bool *_HasValue) const;
+    void                    IndexVar(CTwVar *_Var, CTwVarGroup *_Parent, int _Index);   // register _Var (and its sub-vars) in the name index
+    void                    UnindexVar(const CTwVar *_Var);                             // unregister _Var (and its sub-vars) from the name index
+    void                    ReindexVars(CTwVarGroup *_Parent, int _FirstIndex);         // update indices of _Parent's vars after an erase
+    bool                    RemoveVar(const CTwVar *_Var);  // delete _Var and the groups left empty, struct members included (used to roll back TwAddVarsBatch)
+    void                    InvalidateVarIndex() { m_VarIndex.clear(); m_VarIndexValid = false; } // index will be rebuilt by the next Find
+    int                     HasAttrib(const char *_Attrib, int _Len, bool *_HasValue) const;
     int                     SetAttrib(int _AttribID, const char *_Value);
     ERetType                GetAttrib(int _AttribID, std::vector<double>& outDouble, std::ostringstream& outString) const;
     bool                    MouseMotion(int _X, int _Y);
     bool                    MouseButton(ETwMouseButtonID _Button, bool _Pressed, int _X, int _Y);
-    bool                    MouseWheel(int _Pos, int _PrevPos, int _MouseX, int _MouseY);
+    bool                    MouseWheel(int _NbLines, int _MouseX, int _MouseY); // scroll up if _NbLines>0
     bool                    KeyPressed(int _Key, int _Modifiers);
     bool                    IsMinimized() const { return m_IsMinimized; }
     bool                    IsDragging() const  { return m_MouseDrag; }
+    bool                    HasMouseState() const;  // true if mouse events occurring outside the bar may still change it
     bool                    Show(CTwVar *_Var); // display the line associated to _Var
     bool                    OpenHier(CTwVarGroup *_Root, CTwVar *_Var); // open a hierarchy if it contains _Var
     int                     LineInHier(CTwVarGroup *_Root, CTwVar *_Var); // returns the number of the line associated to _Var
@@ -264,10 +293,25 @@ protected:
     int                     m_ScrollY1;
     int                     m_NbHierLines;
     int                     m_NbDisplayedLines;
+    bool                    m_HierLinesUpToDate;    // m_LineOffsets of the open groups are valid
     bool                    m_UpToDate;
     float                   m_LastUpdateTime;
     void                    Update();
 
+    // Name index: avoids recursive searches through the var hierarchy.
+    // Vars sharing a name are kept in insertion order, Find returns the first.
+    struct CVarIndexEntry
+    {
+        CTwVar *            m_Var;
+        CTwVarGroup *       m_Parent;
+        int                 m_Index;
+    };
+    typedef std::multimap<std::string, CVarIndexEntry> CVarIndex;
+    mutable CVarIndex       m_VarIndex;
+    mutable bool            m_VarIndexValid;
+    void                    BuildVarIndex(const CTwVarGroup *_Grp) const;
+    CVarIndex::iterator     FindVarIndexEntry(const CTwVar *_Var);
+
     bool                    m_MouseDrag;
     bool                    m_MouseDragVar;
     bool                    m_MouseDragTitle;
@@ -317,7 +361,17 @@ protected:
         bool                m_Closing;
     };
     std::vector<CHierTag>   m_HierTags;
-    void                    BrowseHierarchy(int *_LineNum, int _CurrLevel, const CTwVar *_Var, int _First, int _Last);
+    struct CHierFrame
+    {
+        const CTwVarGroup * m_Grp;
+        int                 m_Index;
+    };
+    std::vector<CHierFrame> m_HierStack;
+    static int              CountHierLines(CTwVarGroup *_Grp);
+    void                    BrowseHierarchy(int _First, int _Last);
+    void                    UpdatePopupList(int _NbLines);
+    void                    SetPopupFilter(const std::string& _Filter);
+    bool                    PopupFilterKey(int _Key, int _Modifiers);
     void *                  m_TitleTextObj;
     void *                  m_LabelsTextObj;
     void *                  m_ValuesTextObj;
@@ -325,6 +379,20 @@ protected:
     int                     m_ShortcutLine;
     void                    ListLabels(std::vector<std::string>& _Labels, std::vector<color32>& _Colors, std::vector<color32>& _BgColors, bool *_HasBgColors, const CTexFont *_Font, int _AtomWidthMax, int _GroupWidthMax);
     void                    ListValues(std::vector<std::string>& _Values, std::vector<color32>& _Colors, std::vector<color32>& _BgColors, const CTexFont *_Font, int _WidthMax);
+
+    // Lines last given to BuildText, used to update only the lines that changed
+    struct CTextLines
+    {
+        std::vector<std::string> m_Lines;
+        std::vector<color32> m_Colors;
+        std::vector<color32> m_BgColors;
+        const CTexFont *    m_Font;
+        int                 m_Sep;
+        int                 m_BgWidth;
+    };
+    CTextLines              m_LabelsLines;
+    CTextLines              m_ValuesLines;
+    void                    BuildTextLines(void *_TextObj, CTextLines *_Prev, std::vector<std::string>& _Lines, std::vector<color32>& _Colors, std::vector<color32>& _BgColors, int _Sep, int _BgWidth);
     void                    DrawHierHandle();
   
     // RotoSlider
@@ -412,6 +480,14 @@ protected:
     CustomMap               m_CustomRecords;
     CTwMgr::CStructProxy *  m_CustomActiveStructProxy;
 
+    // Retained draw cache (see ITwGraph::NewCacheObj)
+    enum { DRAW_KEY_SIZE = 12 };
+    void *                  m_DrawCache;
+    bool                    m_DrawCacheValid;
+    int                     m_DrawKey[DRAW_KEY_SIZE];   // key of the last Draw
+    bool                    m_DrawKeyValid;
+    bool                    GetDrawKey(int *_Key) const;
+
     friend struct CTwMgr;
 };
 
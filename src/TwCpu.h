@@ -0,0 +1,54 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwCpu.h
+//  @brief      Run-time selection of the SSE2 kernels
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  notes:      Private header
+//              TAB=4
+//
+//  ---------------------------------------------------------------------------
+
+
+#if !defined ANT_TW_CPU_INCLUDED
+#define ANT_TW_CPU_INCLUDED
+
+//  ---------------------------------------------------------------------------
+//  On x86, ANT_TW_SSE2_KERNELS is defined and the functions declared with
+//  ANT_TARGET_SSE2 are compiled for SSE2 whatever the compiler options. They
+//  must be called only if TwCpuHasSSE2() returns true.
+//  ---------------------------------------------------------------------------
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#   include <intrin.h>
+#   include <emmintrin.h>
+#   define ANT_TW_SSE2_KERNELS
+#   define ANT_TARGET_SSE2
+#elif (defined(__i386__) || defined(__x86_64__)) && (defined(__clang__) || __GNUC__>4 || (__GNUC__==4 && __GNUC_MINOR__>=9))
+#   include <emmintrin.h>
+#   define ANT_TW_SSE2_KERNELS
+#   define ANT_TARGET_SSE2  __attribute__((target("sse2")))
+#endif
+
+#ifdef ANT_TW_SSE2_KERNELS
+
+inline bool TwCpuHasSSE2()
+{
+#   if defined(_MSC_VER)
+        int Info[4];
+        __cpuid(Info, 1);
+        return (Info[3] & (1<<26))!=0;
+#   else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2")!=0;
+#   endif
+}
+
+#endif // ANT_TW_SSE2_KERNELS
+
+//  ---------------------------------------------------------------------------
+
+
+#endif // !defined ANT_TW_CPU_INCLUDED
@@ -16,6 +16,7 @@
 #define ANT_TW_DIRECT3D10_INCLUDED
 
 #include "TwGraph.h"
+#include "TwGlyphs.h"
 
 //  ---------------------------------------------------------------------------
 
@@ -42,10 +43,13 @@ public:
     virtual void                ChangeViewport(int _X0, int _Y0, int _Width, int _Height, int _OffsetX, int _OffsetY);
     virtual void                RestoreViewport();
 
+    virtual int                 GetDrawCallCount() { return m_NbDrawCalls; }
+
 protected:
     struct ID3D10Device *       m_D3DDev;
     unsigned int                m_D3DDevInitialRefCount;
     bool                        m_Drawing;
+    int                         m_NbDrawCalls;
     const CTexFont *            m_FontTex;
     struct ID3D10ShaderResourceView *m_FontD3DTexRV;
     int                         m_WndWidth;
@@ -77,6 +81,7 @@ protected:
         bool                    m_LineColors;
         bool                    m_LineBgColors;
     };
+    std::vector<CGlyphQuad>     m_LineQuads;    // scratch quads used by BuildText
 
     struct CState10 *               m_State;
     struct ID3D10DepthStencilState *m_DepthStencilState;
@@ -511,6 +511,7 @@ int CTwGraphDirect3D11::Init()
     m_D3DDevInitialRefCount = m_D3DDev->AddRef() - 1;
 
     m_Drawing = false;
+    m_NbDrawCalls = 0;
     m_OffsetX = m_OffsetY = 0;
     m_ViewportInit = new D3D11_VIEWPORT;
     m_FontTex = NULL;
@@ -865,6 +866,7 @@ void CTwGraphDirect3D11::BeginDraw(int _WndWidth, int _WndHeight)
 {
     assert(m_Drawing==false && _WndWidth>0 && _WndHeight>0);
     m_Drawing = true;
+    m_NbDrawCalls = 0;
 
     m_WndWidth  = _WndWidth;
     m_WndHeight = _WndHeight;
@@ -1013,6 +1015,7 @@ void CTwGraphDirect3D11::DrawLine(int _X0, int _Y0, int _X1, int _Y1, color32 _C
         {
             m_LineRectTech->GetPassByIndex(p)->Apply(0, m_D3DContext);
             m_D3DContext->Draw(2, 0);
+            ++m_NbDrawCalls;
         }
 
         if( _AntiAliased )
@@ -1093,6 +1096,7 @@ void CTwGraphDirect3D11::DrawRect(int _X0, int _Y0, int _X1, int _Y1, color32 _C
         {
             m_LineRectTech->GetPassByIndex(p)->Apply(0, m_D3DContext);
             m_D3DContext->Draw(4, 0);
+            ++m_NbDrawCalls;
         }
     }
 }
@@ -1205,9 +1209,8 @@ void CTwGraphDirect3D11::BuildText(void *_TextObj, const std::string *_TextLines
         }
     }
 
-    int x, x1, y, y1, i, len;
+    int y, y1, i, len;
     float px, px1, py, py1;
-    unsigned char ch;
     const unsigned char *text;
     color32 lineColor = COLOR32_RED;
     CTextVtx vtx;
@@ -1218,7 +1221,6 @@ void CTwGraphDirect3D11::BuildText(void *_TextObj, const std::string *_TextLines
     int bgVtxIndex = 0;
     for( line=0; line<_NbLines; ++line )
     {
-        x = 0;
         y = line * (_Font->m_CharHeight+_Sep);
         y1 = y+_Font->m_CharHeight;
         len = (int)_TextLines[line].length();
@@ -1226,57 +1228,56 @@ void CTwGraphDirect3D11::BuildText(void *_TextObj, const std::string *_TextLines
         if( _LineColors!=NULL )
             lineColor = ToR8G8B8A8(_LineColors[line]);
 
-        if( textVerts!=NULL )
+        if( textVerts!=NULL && len>0 )
+        {
+            m_LineQuads.resize(len);
+            TwBuildGlyphQuads(&(m_LineQuads[0]), text, len, y, _Font);
+            py  = ToNormScreenY(y,  m_WndHeight);
+            py1 = ToNormScreenY(y1, m_WndHeight);
+            vtx.m_Color = lineColor;
             for( i=0; i<len; ++i )
             {
-                ch = text[i];
-                x1 = x + _Font->m_CharWidth[ch];
-
-                px  = ToNormScreenX(x,  m_WndWidth);
-                py  = ToNormScreenY(y,  m_WndHeight);
-                px1 = ToNormScreenX(x1, m_WndWidth);
-                py1 = ToNormScreenY(y1, m_WndHeight);
-
-                vtx.m_Color  = lineColor;
+                const CGlyphQuad& q = m_LineQuads[i];
+                px  = ToNormScreenX((int)q.x0, m_WndWidth);
+                px1 = ToNormScreenX((int)q.x1, m_WndWidth);
 
                 vtx.m_Pos[0] = px;
                 vtx.m_Pos[1] = py;
-                vtx.m_UV [0] = _Font->m_CharU0[ch];
-                vtx.m_UV [1] = _Font->m_CharV0[ch];
+                vtx.m_UV [0] = q.u0;
+                vtx.m_UV [1] = q.v0;
                 textVerts[textVtxIndex++] = vtx;
 
                 vtx.m_Pos[0] = px1;
                 vtx.m_Pos[1] = py;
-                vtx.m_UV [0] = _Font->m_CharU1[ch];
-                vtx.m_UV [1] = _Font->m_CharV0[ch];
+                vtx.m_UV [0] = q.u1;
+                vtx.m_UV [1] = q.v0;
                 textVerts[textVtxIndex++] = vtx;
 
                 vtx.m_Pos[0] = px;
                 vtx.m_Pos[1] = py1;
-                vtx.m_UV [0] = _Font->m_CharU0[ch];
-                vtx.m_UV [1] = _Font->m_CharV1[ch];
+                vtx.m_UV [0] = q.u0;
+                vtx.m_UV [1] = q.v1;
                 textVerts[textVtxIndex++] = vtx;
 
                 vtx.m_Pos[0] = px1;
                 vtx.m_Pos[1] = py;
-                vtx.m_UV [0] = _Font->m_CharU1[ch];
-                vtx.m_UV [1] = _Font->m_CharV0[ch];
+                vtx.m_UV [0] = q.u1;
+                vtx.m_UV [1] = q.v0;
                 textVerts[textVtxIndex++] = vtx;
 
                 vtx.m_Pos[0] = px1;
                 vtx.m_Pos[1] = py1;
-                vtx.m_UV [0] = _Font->m_CharU1[ch];
-                vtx.m_UV [1] = _Font->m_CharV1[ch];
+                vtx.m_UV [0] = q.u1;
+                vtx.m_UV [1] = q.v1;
                 textVerts[textVtxIndex++] = vtx;
 
                 vtx.m_Pos[0] = px;
                 vtx.m_Pos[1] = py1;
-                vtx.m_UV [0] = _Font->m_CharU0[ch];
-                vtx.m_UV [1] = _Font->m_CharV1[ch];
+                vtx.m_UV [0] = q.u0;
+                vtx.m_UV [1] = q.v1;
                 textVerts[textVtxIndex++] = vtx;
-
-                x = x1;
             }
+        }
 
         if( _BgWidth>0 && bgVerts!=NULL )
         {
@@ -1373,6 +1374,7 @@ void CTwGraphDirect3D11::DrawText(void *_TextObj, int _X, int _Y, color32 _Color
         {
             tech->GetPassByIndex(p)->Apply(0, m_D3DContext);
             m_D3DContext->Draw(textObj->m_NbBgVerts, 0);
+            ++m_NbDrawCalls;
         }
     }
 
@@ -1407,6 +1409,7 @@ void CTwGraphDirect3D11::DrawText(void *_TextObj, int _X, int _Y, color32 _Color
         {
             tech->GetPassByIndex(p)->Apply(0, m_D3DContext);
             m_D3DContext->Draw(textObj->m_NbTextVerts, 0);
+            ++m_NbDrawCalls;
         }
     }
 }
@@ -1539,6 +1542,7 @@ void CTwGraphDirect3D11::DrawTriangles(int _NumTriangles, int *_Vertices, color3
         {
             m_LineRectTech->GetPassByIndex(p)->Apply(0, m_D3DContext);
             m_D3DContext->Draw(3*_NumTriangles, 0);
+            ++m_NbDrawCalls;
         }
 
         if( _CullMode==CULL_CW || _CullMode==CULL_CCW )
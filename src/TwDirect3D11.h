@@ -16,6 +16,7 @@
 #define ANT_TW_DIRECT3D11_INCLUDED
 
 #include "TwGraph.h"
+#include "TwGlyphs.h"
 #include "effects11/inc/d3dx11effect.h"
 
 //  ---------------------------------------------------------------------------
@@ -43,12 +44,15 @@ public:
     virtual void                ChangeViewport(int _X0, int _Y0, int _Width, int _Height, int _OffsetX, int _OffsetY);
     virtual void                RestoreViewport();
 
+    virtual int                 GetDrawCallCount() { return m_NbDrawCalls; }
+
 protected:
     struct ID3D11Device *       m_D3DDev;
     struct ID3D11DeviceContext *m_D3DContext;
 		D3D_FEATURE_LEVEL					  m_FeatureLevel;
     unsigned int                m_D3DDevInitialRefCount;
     bool                        m_Drawing;
+    int                         m_NbDrawCalls;
     const CTexFont *            m_FontTex;
     struct ID3D11ShaderResourceView *m_FontD3DTexRV;
     int                         m_WndWidth;
@@ -80,6 +84,7 @@ protected:
         bool                    m_LineColors;
         bool                    m_LineBgColors;
     };
+    std::vector<CGlyphQuad>     m_LineQuads;    // scratch quads used by BuildText
 
 		D3DX11_STATE_BLOCK_MASK					m_StateBlockMask;
     struct StateBlock *               m_State;
@@ -121,6 +121,7 @@ int CTwGraphDirect3D9::Init()
 
     m_D3DDev = static_cast<IDirect3DDevice9 *>(g_TwMgr->m_Device);
     m_Drawing = false;
+    m_NbDrawCalls = 0;
     m_FontTex = NULL;
     m_FontD3DTex = NULL;
     D3DDEVICE_CREATION_PARAMETERS cp;
@@ -160,6 +161,7 @@ void CTwGraphDirect3D9::BeginDraw(int _WndWidth, int _WndHeight)
 {
     assert(m_Drawing==false && _WndWidth>0 && _WndHeight>0);
     m_Drawing = true;
+    m_NbDrawCalls = 0;
 
     m_WndWidth  = _WndWidth;
     m_WndHeight = _WndHeight;
@@ -295,6 +297,7 @@ void CTwGraphDirect3D9::DrawLine(int _X0, int _Y0, int _X1, int _Y1, color32 _Co
     m_D3DDev->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
     m_D3DDev->SetFVF(D3DFVF_XYZRHW|D3DFVF_DIFFUSE);
     m_D3DDev->DrawPrimitiveUP(D3DPT_LINELIST, 1, p, sizeof(CVtx));
+    ++m_NbDrawCalls;
     //if( m_State->m_Caps.LineCaps & D3DLINECAPS_ANTIALIAS )
         m_D3DDev->SetRenderState(D3DRS_ANTIALIASEDLINEENABLE, FALSE);
 }
@@ -350,6 +353,7 @@ void CTwGraphDirect3D9::DrawRect(int _X0, int _Y0, int _X1, int _Y1, color32 _Co
     m_D3DDev->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
     m_D3DDev->SetFVF(D3DFVF_XYZRHW|D3DFVF_DIFFUSE);
     m_D3DDev->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, p, sizeof(CVtx));
+    ++m_NbDrawCalls;
 }
 
 //  ---------------------------------------------------------------------------
@@ -388,8 +392,7 @@ void CTwGraphDirect3D9::BuildText(void *_TextObj, const std::string *_TextLines,
     TextObj->m_LineColors = (_LineColors!=NULL);
     TextObj->m_LineBgColors = (_LineBgColors!=NULL);
 
-    int x, x1, y, y1, i, Len;
-    unsigned char ch;
+    int y, y1, i, Len;
     const unsigned char *Text;
     color32 LineColor = COLOR32_RED;
     CTextVtx Vtx;
@@ -400,7 +403,6 @@ void CTwGraphDirect3D9::BuildText(void *_TextObj, const std::string *_TextLines,
     BgVtx.m_Pos[3] = 1;
     for( int Line=0; Line<_NbLines; ++Line )
     {
-        x = 0;
         y = Line * (_Font->m_CharHeight+_Sep);
         y1 = y+_Font->m_CharHeight;
         Len = (int)_TextLines[Line].length();
@@ -408,50 +410,51 @@ void CTwGraphDirect3D9::BuildText(void *_TextObj, const std::string *_TextLines,
         if( _LineColors!=NULL )
             LineColor = _LineColors[Line];
 
+        if( Len>0 )
+        {
+            m_LineQuads.resize(Len);
+            TwBuildGlyphQuads(&(m_LineQuads[0]), Text, Len, y, _Font);
+        }
+        Vtx.m_Color = LineColor;
         for( i=0; i<Len; ++i )
         {
-            ch = Text[i];
-            x1 = x + _Font->m_CharWidth[ch];
+            const CGlyphQuad& q = m_LineQuads[i];
 
-            Vtx.m_Color  = LineColor;
-
-            Vtx.m_Pos[0] = (float)x;
-            Vtx.m_Pos[1] = (float)y;
-            Vtx.m_UV [0] = _Font->m_CharU0[ch];
-            Vtx.m_UV [1] = _Font->m_CharV0[ch];
+            Vtx.m_Pos[0] = q.x0;
+            Vtx.m_Pos[1] = q.y0;
+            Vtx.m_UV [0] = q.u0;
+            Vtx.m_UV [1] = q.v0;
             TextObj->m_TextVerts.push_back(Vtx);
 
-            Vtx.m_Pos[0] = (float)x1;
-            Vtx.m_Pos[1] = (float)y;
-            Vtx.m_UV [0] = _Font->m_CharU1[ch];
-            Vtx.m_UV [1] = _Font->m_CharV0[ch];
+            Vtx.m_Pos[0] = q.x1;
+            Vtx.m_Pos[1] = q.y0;
+            Vtx.m_UV [0] = q.u1;
+            Vtx.m_UV [1] = q.v0;
             TextObj->m_TextVerts.push_back(Vtx);
 
-            Vtx.m_Pos[0] = (float)x;
-            Vtx.m_Pos[1] = (float)y1;
-            Vtx.m_UV [0] = _Font->m_CharU0[ch];
-            Vtx.m_UV [1] = _Font->m_CharV1[ch];
+            Vtx.m_Pos[0] = q.x0;
+            Vtx.m_Pos[1] = q.y1;
+            Vtx.m_UV [0] = q.u0;
+            Vtx.m_UV [1] = q.v1;
             TextObj->m_TextVerts.push_back(Vtx);
 
-            Vtx.m_Pos[0] = (float)x1;
-            Vtx.m_Pos[1] = (float)y;
-            Vtx.m_UV [0] = _Font->m_CharU1[ch];
-            Vtx.m_UV [1] = _Font->m_CharV0[ch];
+            Vtx.m_Pos[0] = q.x1;
+            Vtx.m_Pos[1] = q.y0;
+            Vtx.m_UV [0] = q.u1;
+            Vtx.m_UV [1] = q.v0;
             TextObj->m_TextVerts.push_back(Vtx);
 
-            Vtx.m_Pos[0] = (float)x1;
-            Vtx.m_Pos[1] = (float)y1;
-            Vtx.m_UV [0] = _Font->m_CharU1[ch];
-            Vtx.m_UV [1] = _Font->m_CharV1[ch];
+            Vtx.m_Pos[0] = q.x1;
+            Vtx.m_Pos[1] = q.y1;
+            Vtx.m_UV [0] = q.u1;
+            Vtx.m_UV [1] = q.v1;
             TextObj->m_TextVerts.push_back(Vtx);
 
-            Vtx.m_Pos[0] = (float)x;
-            Vtx.m_Pos[1] = (float)y1;
-            Vtx.m_UV [0] = _Font->m_CharU0[ch];
-            Vtx.m_UV [1] = _Font->m_CharV1[ch];
+            Vtx.m_Pos[0] = q.x0;
+            Vtx.m_Pos[1] = q.y1;
+            Vtx.m_UV [0] = q.u0;
+            Vtx.m_UV [1] = q.v1;
             TextObj->m_TextVerts.push_back(Vtx);
-
-            x = x1;
         }
         if( _BgWidth>0 )
         {
@@ -516,6 +519,7 @@ void CTwGraphDirect3D9::DrawText(void *_TextObj, int _X, int _Y, color32 _Color,
         m_D3DDev->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
         m_D3DDev->SetFVF(D3DFVF_XYZRHW|D3DFVF_DIFFUSE);
         m_D3DDev->DrawPrimitiveUP(D3DPT_TRIANGLELIST, nb/3, &(TextObj->m_BgVerts[0]), sizeof(CBgVtx));
+        ++m_NbDrawCalls;
 
         for( i=0; i<nb; ++i )
         {
@@ -540,6 +544,7 @@ void CTwGraphDirect3D9::DrawText(void *_TextObj, int _X, int _Y, color32 _Color,
         m_D3DDev->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
         m_D3DDev->SetFVF(D3DFVF_XYZRHW|D3DFVF_DIFFUSE|D3DFVF_TEX1|D3DFVF_TEXCOORDSIZE2(0));
         m_D3DDev->DrawPrimitiveUP(D3DPT_TRIANGLELIST, nv/3, &(TextObj->m_TextVerts[0]), sizeof(CTextVtx));
+        ++m_NbDrawCalls;
 
         for( i=0; i<nv; ++i )
         {
@@ -579,40 +584,53 @@ void CTwGraphDirect3D9::RestoreViewport()
 
 //  ---------------------------------------------------------------------------
 
+static inline bool IsTriangleVisible(const int *_Vertices, ITwGraph::Cull _CullMode)
+{
+    // twice the signed area in screen coordinates (y down): >0 for clockwise triangles
+    int Area2 = (_Vertices[2]-_Vertices[0])*(_Vertices[5]-_Vertices[1]) - (_Vertices[4]-_Vertices[0])*(_Vertices[3]-_Vertices[1]);
+    if( _CullMode==ITwGraph::CULL_CW )
+        return Area2<0;
+    else if( _CullMode==ITwGraph::CULL_CCW )
+        return Area2>0;
+    else
+        return Area2!=0;
+}
+
 void CTwGraphDirect3D9::DrawTriangles(int _NumTriangles, int *_Vertices, color32 *_Colors, Cull _CullMode)
 {
     assert(m_Drawing==true);
 
-    if( _NumTriangles<0 )
+    if( _NumTriangles<=0 )
         return;
 
-    DWORD prevCullMode = D3DCULL_NONE;
-    m_D3DDev->GetRenderState(D3DRS_CULLMODE, &prevCullMode);
-    if( _CullMode==CULL_CW )
-        m_D3DDev->SetRenderState(D3DRS_CULLMODE, D3DCULL_CW);
-    else if( _CullMode==CULL_CCW )
-        m_D3DDev->SetRenderState(D3DRS_CULLMODE, D3DCULL_CCW);
-    else
-        m_D3DDev->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
-
     if( (int)m_TriVertices.size()<3*_NumTriangles )
         m_TriVertices.resize(3*_NumTriangles);
 
-    for( int i=0; i<3*_NumTriangles; ++i )
-    {
-        m_TriVertices[i].m_Pos[0] = (float)(_Vertices[2*i+0] + m_OffsetX);
-        m_TriVertices[i].m_Pos[1] = (float)(_Vertices[2*i+1] + m_OffsetY);
-        m_TriVertices[i].m_Pos[2] = 0;
-        m_TriVertices[i].m_Pos[3] = 1;
-        m_TriVertices[i].m_Color  = _Colors[i];
-    }
+    // Culling is done here: the cull mode render state set by BeginDraw
+    // (D3DCULL_NONE) is neither read nor changed for each call.
+    int NbVisible = 0;
+    for( int i=0; i<_NumTriangles; ++i )
+        if( IsTriangleVisible(_Vertices+6*i, _CullMode) )
+        {
+            for( int j=3*i; j<3*i+3; ++j )
+            {
+                CTriVtx& v = m_TriVertices[3*NbVisible+j-3*i];
+                v.m_Pos[0] = (float)(_Vertices[2*j+0] + m_OffsetX);
+                v.m_Pos[1] = (float)(_Vertices[2*j+1] + m_OffsetY);
+                v.m_Pos[2] = 0;
+                v.m_Pos[3] = 1;
+                v.m_Color  = _Colors[j];
+            }
+            ++NbVisible;
+        }
+    if( NbVisible==0 )
+        return;
 
     m_D3DDev->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_DISABLE);
     m_D3DDev->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
     m_D3DDev->SetFVF(D3DFVF_XYZRHW|D3DFVF_DIFFUSE);
-    m_D3DDev->DrawPrimitiveUP(D3DPT_TRIANGLELIST, _NumTriangles, &(m_TriVertices[0]), sizeof(CTriVtx));
-
-    m_D3DDev->SetRenderState(D3DRS_CULLMODE, prevCullMode);
+    m_D3DDev->DrawPrimitiveUP(D3DPT_TRIANGLELIST, NbVisible, &(m_TriVertices[0]), sizeof(CTriVtx));
+    ++m_NbDrawCalls;
 }
 
 //  ---------------------------------------------------------------------------
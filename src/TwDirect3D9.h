@@ -16,6 +16,7 @@
 #define ANT_TW_DIRECT3D9_INCLUDED
 
 #include "TwGraph.h"
+#include "TwGlyphs.h"
 
 #ifdef ANT_TW_SUPPORT_DX9
 //  ---------------------------------------------------------------------------
@@ -43,9 +44,12 @@ public:
     virtual void                ChangeViewport(int _X0, int _Y0, int _Width, int _Height, int _OffsetX, int _OffsetY);
     virtual void                RestoreViewport();
 
+    virtual int                 GetDrawCallCount() { return m_NbDrawCalls; }
+
 protected:
     struct IDirect3DDevice9 *   m_D3DDev;
     bool                        m_Drawing;
+    int                         m_NbDrawCalls;
     const CTexFont *            m_FontTex;
     struct IDirect3DTexture9 *  m_FontD3DTex;
     bool                        m_PureDevice;
@@ -74,6 +78,7 @@ protected:
         bool                    m_LineColors;
         bool                    m_LineBgColors;
     };
+    std::vector<CGlyphQuad>     m_LineQuads;    // scratch quads used by BuildText
 
     struct CTriVtx
     {
@@ -26,6 +26,8 @@ CTexFont::CTexFont()
         m_CharV0[i] = 0;
         m_CharV1[i] = 0;
         m_CharWidth[i] = 0;
+        m_GlyphWidth[i] = 0;
+        m_GlyphUV[i][0] = m_GlyphUV[i][1] = m_GlyphUV[i][2] = m_GlyphUV[i][3] = 0;
     }
     m_TexWidth = 0;
     m_TexHeight = 0;
@@ -146,7 +148,7 @@ CTexFont *TwGenerateFont(const unsigned char *_Bitmap, int _BmWidth, int _BmHeig
     assert( g_TwMgr!=NULL );
     if( g_TwMgr )
     {
-        if( g_TwMgr->m_GraphAPI==TW_OPENGL )
+        if( g_TwMgr->m_GraphAPI==TW_OPENGL || g_TwMgr->m_GraphAPI==TW_OPENGL_CORE )
         {
             du = 0;
             dv = 0;
@@ -188,6 +190,15 @@ CTexFont *TwGenerateFont(const unsigned char *_Bitmap, int _BmWidth, int _BmHeig
         TexFont->m_CharWidth[ch] = TexFont->m_CharWidth[Undef]/2;
     }
 
+    for( int i=0; i<256; ++i )
+    {
+        TexFont->m_GlyphWidth[i] = (float)TexFont->m_CharWidth[i];
+        TexFont->m_GlyphUV[i][0] = TexFont->m_CharU0[i];
+        TexFont->m_GlyphUV[i][1] = TexFont->m_CharV0[i];
+        TexFont->m_GlyphUV[i][2] = TexFont->m_CharU1[i];
+        TexFont->m_GlyphUV[i][3] = TexFont->m_CharV1[i];
+    }
+
     return TexFont;
 }
 
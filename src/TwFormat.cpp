@@ -0,0 +1,223 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwFormat.cpp
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  ---------------------------------------------------------------------------
+
+
+#include "TwPrecomp.h"
+#include "TwFormat.h"
+
+using namespace std;
+
+#if defined(_MSC_VER)
+    typedef unsigned __int64 TwUInt64;
+#else
+    typedef unsigned long long TwUInt64;
+#endif
+
+static const double g_Pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12 };   // exact
+static const TwUInt64 g_UPow10[] = { 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL };
+static const int MAX_FAST_PRECISION = 12;
+
+static const char g_Digits2[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+//  ---------------------------------------------------------------------------
+
+// Writes the _NbDigits last decimal digits of _Val (_NbDigits>0) ending at _End
+static inline void WriteDigits(char *_End, TwUInt64 _Val, int _NbDigits)
+{
+    while( _NbDigits>=2 )
+    {
+        int d = 2*(int)(_Val%100);
+        _Val /= 100;
+        *(--_End) = g_Digits2[d+1];
+        *(--_End) = g_Digits2[d];
+        _NbDigits -= 2;
+    }
+    if( _NbDigits>0 )
+        *(--_End) = (char)('0' + (int)(_Val%10));
+}
+
+static inline int CountDigits(TwUInt64 _Val)
+{
+    int n = 1;
+    while( _Val>=10000 )
+    {
+        _Val /= 10000;
+        n += 4;
+    }
+    while( _Val>=10 )
+    {
+        _Val /= 10;
+        ++n;
+    }
+    return n;
+}
+
+static inline int FormatUInt64(char *_Buf, TwUInt64 _Val)
+{
+    int n = CountDigits(_Val);
+    WriteDigits(_Buf+n, _Val, n);
+    _Buf[n] = '\0';
+    return n;
+}
+
+static inline bool IsNegative(double _Val)  // true for -0 too
+{
+    TwUInt64 Bits;
+    memcpy(&Bits, &_Val, sizeof(Bits));
+    return (Bits>>63)!=0;
+}
+
+// Rounds _Scaled>=0 to the nearest integer as printf does on the unscaled
+// value. _Scaled carries the rounding error of the scaling multiplication,
+// so values too close to a tie are rejected (returns false).
+static inline bool RoundScaled(double _Scaled, TwUInt64 *_Result)
+{
+    double r = floor(_Scaled);
+    double f = _Scaled - r;    // exact
+    double Margin = _Scaled*4.5e-16;
+    if( f-0.5<=Margin && 0.5-f<=Margin )
+        return false;
+    *_Result = (TwUInt64)r + ((f>0.5) ? 1 : 0);
+    return true;
+}
+
+//  ---------------------------------------------------------------------------
+
+int TwFormatUInt(char *_Buf, unsigned int _Val)
+{
+    return FormatUInt64(_Buf, _Val);
+}
+
+//  ---------------------------------------------------------------------------
+
+int TwFormatInt(char *_Buf, int _Val)
+{
+    if( _Val<0 )
+    {
+        _Buf[0] = '-';
+        return 1 + FormatUInt64(_Buf+1, 0U - (unsigned int)_Val);
+    }
+    else
+        return FormatUInt64(_Buf, (unsigned int)_Val);
+}
+
+//  ---------------------------------------------------------------------------
+
+int TwFormatHex(char *_Buf, unsigned int _Val, int _NbDigits)
+{
+    static const char HexDigits[] = "0123456789ABCDEF";
+    int n = (_Val!=0 || _NbDigits<0) ? 1 : 0;   // as printf, no digit for 0 with a null precision
+    for( unsigned int v=_Val>>4; v!=0; v>>=4 )
+        ++n;
+    if( n<_NbDigits )
+        n = _NbDigits;
+    _Buf[0] = '0';
+    _Buf[1] = 'x';
+    for( int i=n+1; i>=2; --i, _Val>>=4 )
+        _Buf[i] = HexDigits[_Val&0xf];
+    _Buf[n+2] = '\0';
+    return n+2;
+}
+
+//  ---------------------------------------------------------------------------
+
+int TwFormatFixed(char *_Buf, double _Val, int _Precision)
+{
+    double a = fabs(_Val);
+    TwUInt64 Scaled;
+    if( _Precision<0 || _Precision>MAX_FAST_PRECISION || !(a<4.5e15/g_Pow10[_Precision]) || !RoundScaled(a*g_Pow10[_Precision], &Scaled) )
+        return sprintf(_Buf, "%.*f", (_Precision<0) ? 6 : _Precision, _Val);
+
+    int n = 0;
+    if( IsNegative(_Val) )
+        _Buf[n++] = '-';
+    n += FormatUInt64(_Buf+n, Scaled/g_UPow10[_Precision]);
+    if( _Precision>0 )
+    {
+        _Buf[n++] = '.';
+        n += _Precision;
+        WriteDigits(_Buf+n, Scaled%g_UPow10[_Precision], _Precision);
+    }
+    _Buf[n] = '\0';
+    return n;
+}
+
+//  ---------------------------------------------------------------------------
+
+int TwFormatGeneral(char *_Buf, double _Val)
+{
+    // "%g": 6 significant digits; the fixed notation is used if the decimal
+    // exponent X of the value rounded to 6 digits is in [-4, 5], and
+    // trailing zeros are removed.
+    const int NB_SIGNIFICANT = 6;
+    double a = fabs(_Val);
+    if( a==0 )
+    {
+        if( IsNegative(_Val) )
+        {
+            _Buf[0] = '-'; _Buf[1] = '0'; _Buf[2] = '\0';
+            return 2;
+        }
+        _Buf[0] = '0'; _Buf[1] = '\0';
+        return 1;
+    }
+    if( !(a>=1e-5 && a<1e6) )  // also rejects NaN and infinities
+        return sprintf(_Buf, "%g", _Val);
+
+    // first guess of X, corrected below from the rounded digits
+    int X = 5;
+    while( X>-5 && a<g_Pow10[X+5]*1e-5 )
+        --X;
+    TwUInt64 Digits = 0;
+    for( int Iter=0; ; ++Iter )
+    {
+        if( Iter>2 || X<-4 || X>=NB_SIGNIFICANT )
+            return sprintf(_Buf, "%g", _Val);
+        if( !RoundScaled(a*g_Pow10[NB_SIGNIFICANT-1-X], &Digits) )
+            return sprintf(_Buf, "%g", _Val);
+        if( Digits>=g_UPow10[NB_SIGNIFICANT] )
+            ++X;
+        else if( Digits<g_UPow10[NB_SIGNIFICANT-1] )
+            --X;
+        else
+            break;
+    }
+
+    int n = 0;
+    if( IsNegative(_Val) )
+        _Buf[n++] = '-';
+    int NbDec = NB_SIGNIFICANT-1-X;
+    TwUInt64 Frac = Digits%g_UPow10[NbDec];
+    n += FormatUInt64(_Buf+n, Digits/g_UPow10[NbDec]);
+    if( Frac!=0 )
+    {
+        while( Frac%10==0 )
+        {
+            Frac /= 10;
+            --NbDec;
+        }
+        _Buf[n++] = '.';
+        n += NbDec;
+        WriteDigits(_Buf+n, Frac, NbDec);
+    }
+    _Buf[n] = '\0';
+    return n;
+}
+
+//  ---------------------------------------------------------------------------
@@ -0,0 +1,39 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwFormat.h
+//  @brief      Number to text conversions used to display var values
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  notes:      Private header
+//              TAB=4
+//
+//  ---------------------------------------------------------------------------
+
+
+#if !defined ANT_TW_FORMAT_INCLUDED
+#define ANT_TW_FORMAT_INCLUDED
+
+//  ---------------------------------------------------------------------------
+//  These functions write the same text as the printf format given in their
+//  comment, without parsing a format string. Values whose conversion cannot
+//  be done exactly with double arithmetic (very small or large values, and
+//  values close to a rounding tie) are passed to sprintf.
+//  The decimal point is always '.'. _Buf must hold TW_FORMAT_BUFFER_SIZE
+//  chars. Each function returns the length of the written text, which is
+//  also terminated by '\0'.
+//  ---------------------------------------------------------------------------
+
+const int TW_FORMAT_BUFFER_SIZE = 512;  // "%.12f" of DOUBLE_MAX fits
+
+int     TwFormatInt(char *_Buf, int _Val);                      // "%d"
+int     TwFormatUInt(char *_Buf, unsigned int _Val);            // "%u"
+int     TwFormatHex(char *_Buf, unsigned int _Val, int _NbDigits); // "0x%.<_NbDigits>X"
+int     TwFormatFixed(char *_Buf, double _Val, int _Precision); // "%.<_Precision>f"
+int     TwFormatGeneral(char *_Buf, double _Val);               // "%g"
+
+//  ---------------------------------------------------------------------------
+
+
+#endif // !defined ANT_TW_FORMAT_INCLUDED
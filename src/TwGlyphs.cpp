@@ -0,0 +1,118 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwGlyphs.cpp
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  ---------------------------------------------------------------------------
+
+
+#include "TwPrecomp.h"
+#include "TwMgr.h"
+#include "TwGlyphs.h"
+#include "TwCpu.h"
+
+using namespace std;
+
+typedef int (*GlyphQuadsKernel)(CGlyphQuad *_Quads, const unsigned char *_Text, int _Len, int _Y, const CTexFont *_Font);
+
+//  ---------------------------------------------------------------------------
+
+// Writes the quads of the _Len chars starting at _X, returns the x following the last char
+static inline float BuildGlyphQuadsFrom(CGlyphQuad *_Quads, const unsigned char *_Text, int _Len, float _X, float _Y0, float _Y1, const CTexFont *_Font)
+{
+    for( int i=0; i<_Len; ++i )
+    {
+        CGlyphQuad& q = _Quads[i];
+        const float *UV = _Font->m_GlyphUV[_Text[i]];
+        q.x0 = _X;
+        q.y0 = _Y0;
+        _X += _Font->m_GlyphWidth[_Text[i]];
+        q.x1 = _X;
+        q.y1 = _Y1;
+        q.u0 = UV[0];
+        q.v0 = UV[1];
+        q.u1 = UV[2];
+        q.v1 = UV[3];
+    }
+    return _X;
+}
+
+static int BuildGlyphQuadsScalar(CGlyphQuad *_Quads, const unsigned char *_Text, int _Len, int _Y, const CTexFont *_Font)
+{
+    return (int)BuildGlyphQuadsFrom(_Quads, _Text, _Len, 0, (float)_Y, (float)(_Y+_Font->m_CharHeight), _Font);
+}
+
+//  ---------------------------------------------------------------------------
+
+// x positions are sums of integer widths: they are exact whatever the order
+// of the additions, so the vector kernels write the same values as the scalar one.
+// (An AVX2 kernel processing 8 chars at a time was tried: it is not faster,
+// the quads written limit the throughput.)
+
+#ifdef ANT_TW_SSE2_KERNELS
+
+// Writes the quads of 4 chars starting at _X (x in all components), _Y is (y0, y1, y0, y1).
+// Returns the x following the 4 chars in all components.
+ANT_TARGET_SSE2 static inline __m128 BuildGlyphQuads4(CGlyphQuad *_Quads, const unsigned char *_Text, __m128 _X, __m128 _Y, const CTexFont *_Font)
+{
+    const float *W = _Font->m_GlyphWidth;
+    __m128 w = _mm_setr_ps(W[_Text[0]], W[_Text[1]], W[_Text[2]], W[_Text[3]]);
+    __m128 s = _mm_add_ps(w, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(w), 4)));
+    s = _mm_add_ps(s, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(s), 8)));
+    __m128 x1 = _mm_add_ps(_X, s);
+    __m128 x0 = _mm_sub_ps(x1, w);
+
+    __m128 a = _mm_unpacklo_ps(x0, x1);     // x0[0] x1[0] x0[1] x1[1]
+    __m128 b = _mm_unpackhi_ps(x0, x1);     // x0[2] x1[2] x0[3] x1[3]
+    float *q = &(_Quads[0].x0);
+    _mm_storeu_ps(q,    _mm_unpacklo_ps(a, _Y));
+    _mm_storeu_ps(q+4,  _mm_loadu_ps(_Font->m_GlyphUV[_Text[0]]));
+    _mm_storeu_ps(q+8,  _mm_unpackhi_ps(a, _Y));
+    _mm_storeu_ps(q+12, _mm_loadu_ps(_Font->m_GlyphUV[_Text[1]]));
+    _mm_storeu_ps(q+16, _mm_unpacklo_ps(b, _Y));
+    _mm_storeu_ps(q+20, _mm_loadu_ps(_Font->m_GlyphUV[_Text[2]]));
+    _mm_storeu_ps(q+24, _mm_unpackhi_ps(b, _Y));
+    _mm_storeu_ps(q+28, _mm_loadu_ps(_Font->m_GlyphUV[_Text[3]]));
+    return _mm_shuffle_ps(x1, x1, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+ANT_TARGET_SSE2 static int BuildGlyphQuadsSSE2(CGlyphQuad *_Quads, const unsigned char *_Text, int _Len, int _Y, const CTexFont *_Font)
+{
+    float y0 = (float)_Y;
+    float y1 = (float)(_Y+_Font->m_CharHeight);
+    __m128 Y = _mm_setr_ps(y0, y1, y0, y1);
+    __m128 X = _mm_setzero_ps();
+    int i = 0;
+    for( ; i+4<=_Len; i+=4 )
+        X = BuildGlyphQuads4(_Quads+i, _Text+i, X, Y, _Font);
+    return (int)BuildGlyphQuadsFrom(_Quads+i, _Text+i, _Len-i, _mm_cvtss_f32(X), y0, y1, _Font);
+}
+
+#endif // ANT_TW_SSE2_KERNELS
+
+//  ---------------------------------------------------------------------------
+
+static GlyphQuadsKernel SelectGlyphQuadsKernel()
+{
+#ifdef ANT_TW_SSE2_KERNELS
+    if( TwCpuHasSSE2() )
+        return BuildGlyphQuadsSSE2;
+#endif
+    return BuildGlyphQuadsScalar;
+}
+
+//  ---------------------------------------------------------------------------
+
+static GlyphQuadsKernel g_GlyphQuadsKernel = NULL;   // selected at the first call
+
+int TwBuildGlyphQuads(CGlyphQuad *_Quads, const unsigned char *_Text, int _Len, int _Y, const CTexFont *_Font)
+{
+    assert(_Font!=NULL);
+    if( g_GlyphQuadsKernel==NULL )
+        g_GlyphQuadsKernel = SelectGlyphQuadsKernel();
+    return g_GlyphQuadsKernel(_Quads, _Text, _Len, _Y, _Font);
+}
+
+//  ---------------------------------------------------------------------------
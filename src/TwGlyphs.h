@@ -0,0 +1,41 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwGlyphs.h
+//  @brief      Glyph quads of text lines, shared by the graph backends
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  notes:      Private header
+//              TAB=4
+//
+//  ---------------------------------------------------------------------------
+
+
+#if !defined ANT_TW_GLYPHS_INCLUDED
+#define ANT_TW_GLYPHS_INCLUDED
+
+struct CTexFont;
+
+//  ---------------------------------------------------------------------------
+//  A glyph quad is the screen rectangle (x0,y0)-(x1,y1) of a char relative to
+//  the text origin, and its rectangle (u0,v0)-(u1,v1) in the font texture.
+//  TwBuildGlyphQuads writes the _Len quads of a line of text placed at height
+//  _Y (one quad per char, zero-width chars included) and returns the width of
+//  the line. Quads are computed from the packed glyph tables of the font,
+//  4 chars at a time with SSE2 when the CPU supports it; both versions write
+//  the same values.
+//  ---------------------------------------------------------------------------
+
+struct CGlyphQuad
+{
+    float   x0, y0, x1, y1;
+    float   u0, v0, u1, v1;
+};
+
+int     TwBuildGlyphQuads(CGlyphQuad *_Quads, const unsigned char *_Text, int _Len, int _Y, const CTexFont *_Font);
+
+//  ---------------------------------------------------------------------------
+
+
+#endif // !defined ANT_TW_GLYPHS_INCLUDED
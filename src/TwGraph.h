@@ -47,12 +47,47 @@ public:
     virtual void        BuildText(void *_TextObj, const std::string *_TextLines, color32 *_LineColors, color32 *_LineBgColors, int _NbLines, const CTexFont *_Font, int _Sep, int _BgWidth) = 0;
     virtual void        DrawText(void *_TextObj, int _X, int _Y, color32 _Color, color32 _BgColor) = 0;
 
+    // Incremental text update (optional, returns false if the graph does not support it).
+    // Replaces line _Line of a text object built by BuildText with the same font, separation
+    // and background width; the glyphs of the other lines are kept.
+    virtual bool        UpdateTextLine(void *_TextObj, int _Line, const std::string& _TextLine, color32 _LineColor, color32 _LineBgColor, const CTexFont *_Font, int _Sep) { (void)_TextObj; (void)_Line; (void)_TextLine; (void)_LineColor; (void)_LineBgColor; (void)_Font; (void)_Sep; return false; }
+
     virtual void        ChangeViewport(int _X0, int _Y0, int _Width, int _Height, int _OffsetX, int _OffsetY) = 0;
     virtual void        RestoreViewport() = 0;
 
+    virtual int         GetDrawCallCount() = 0;     // number of draw calls issued since the last BeginDraw
+    virtual int         GetAPICallCount() { return -1; } // number of graphics API calls issued by the last BeginDraw..EndDraw, -1 if not counted
+
+    // Retained draw cache (optional, NewCacheObj returns NULL if the graph does not support it).
+    // Primitives drawn between BeginCache and EndCache are recorded in the cache object;
+    // DrawCache draws them again, or returns false if the cache cannot be used anymore.
+    virtual void *      NewCacheObj() { return NULL; }
+    virtual void        DeleteCacheObj(void *_CacheObj) { (void)_CacheObj; }
+    virtual void        BeginCache(void *_CacheObj) { (void)_CacheObj; }
+    virtual bool        EndCache(void *_CacheObj) { (void)_CacheObj; return false; }
+    virtual bool        DrawCache(void *_CacheObj) { (void)_CacheObj; return false; }
+
     virtual             ~ITwGraph() {}  // required by gcc
 };
 
 //  ---------------------------------------------------------------------------
 
+// Replaces _Count elements of _Vec starting at _First by the elements of _New.
+// Used by UpdateTextLine implementations: the other elements are moved only if
+// the number of elements changes.
+template <class T> 
+inline void ReplaceRange(std::vector<T>& _Vec, size_t _First, size_t _Count, const std::vector<T>& _New)
+{
+    assert( _First+_Count<=_Vec.size() );
+    if( _New.size()==_Count )
+        std::copy(_New.begin(), _New.end(), _Vec.begin()+_First);
+    else
+    {
+        _Vec.erase(_Vec.begin()+_First, _Vec.begin()+_First+_Count);
+        _Vec.insert(_Vec.begin()+_First, _New.begin(), _New.end());
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
 #endif  // ANT_TW_GRAPH_INCLUDED
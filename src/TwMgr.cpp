@@ -14,8 +14,11 @@
 #include <AntTweakBar.h>
 #include "TwMgr.h"
 #include "TwBar.h"
+#include "TwQuatMesh.h"
 #include "TwFonts.h"
 #include "TwOpenGL.h"
+#include "TwOpenGLCore.h"
+#include "TwSoftware.h"
 #ifdef ANT_WINDOWS
 #ifdef ANT_TW_SUPPORT_DX9
 #   include "TwDirect3D9.h"
@@ -52,6 +55,8 @@ TwCopyStdStringToClient g_InitCopyStdStringToClient = NULL;
 extern const char *g_ErrUnknownAttrib;
 extern const char *g_ErrNoValue;
 extern const char *g_ErrBadValue;
+extern const char *g_ErrInvalidAttrib;
+extern ETwMouseAction TW_MOUSE_MOTION;
 const char *g_ErrInit       = "Already initialized";
 const char *g_ErrShut       = "Already shutdown";
 const char *g_ErrNotInit    = "Not initialized";
@@ -63,6 +68,7 @@ const char *g_ErrNotFound   = "Not found";
 const char *g_ErrNthToDo    = "Nothing to do";
 const char *g_ErrBadSize    = "Bad size";
 const char *g_ErrIsDrawing  = "Asynchronous drawing detected";
+const char *g_ErrWrongThread= "Must be called from the render thread";
 const char *g_ErrIsProcessing="Asynchronous processing detected";
 const char *g_ErrOffset     = "Offset larger than StructSize";
 const char *g_ErrDelStruct  = "Cannot delete a struct member";
@@ -335,8 +341,7 @@ void ANT_CALL CColorExt::SummaryCB(char *_SummaryString, size_t /*_SummaryMaxLen
     CColorExt *ext = (CColorExt *)(_ExtValue);
     if( ext && ext->m_StructProxy && ext->m_StructProxy->m_StructData )
     {
-        if( ext->m_StructProxy->m_StructGetCallback )
-            ext->m_StructProxy->m_StructGetCallback(ext->m_StructProxy->m_StructData, ext->m_StructProxy->m_StructClientData);
+        ext->m_StructProxy->GetStruct();
         //if( *(unsigned int *)(ext->m_StructProxy->m_StructData)!=ext->m_PrevConvertedColor )
         CopyVarToExtCB(ext->m_StructProxy->m_StructData, ext, 99, NULL);
     }
@@ -396,6 +401,7 @@ void ANT_CALL CQuaternionExt::InitQuat4FCB(void *_ExtValue, void *_ClientData)
         ext->ConvertToAxisAngle();
         ext->m_Highlighted = false;
         ext->m_Rotating = false;
+        ext->m_ProjCache = NULL;
         if( ext->m_StructProxy!=NULL )
         {
             ext->m_StructProxy->m_CustomDrawCallback = CQuaternionExt::DrawCB;
@@ -431,6 +437,7 @@ void ANT_CALL CQuaternionExt::InitQuat4DCB(void *_ExtValue, void *_ClientData)
         ext->ConvertToAxisAngle();
         ext->m_Highlighted = false;
         ext->m_Rotating = false;
+        ext->m_ProjCache = NULL;
         if( ext->m_StructProxy!=NULL )
         {
             ext->m_StructProxy->m_CustomDrawCallback = CQuaternionExt::DrawCB;
@@ -467,6 +474,7 @@ void ANT_CALL CQuaternionExt::InitDir3FCB(void *_ExtValue, void *_ClientData)
         ext->ConvertToAxisAngle();
         ext->m_Highlighted = false;
         ext->m_Rotating = false;
+        ext->m_ProjCache = NULL;
         if( ext->m_StructProxy!=NULL )
         {
             ext->m_StructProxy->m_CustomDrawCallback = CQuaternionExt::DrawCB;
@@ -503,6 +511,7 @@ void ANT_CALL CQuaternionExt::InitDir3DCB(void *_ExtValue, void *_ClientData)
         ext->ConvertToAxisAngle();
         ext->m_Highlighted = false;
         ext->m_Rotating = false;
+        ext->m_ProjCache = NULL;
         if( ext->m_StructProxy!=NULL )
         {
             ext->m_StructProxy->m_CustomDrawCallback = CQuaternionExt::DrawCB;
@@ -760,12 +769,13 @@ void ANT_CALL CQuaternionExt::SummaryCB(char *_SummaryString, size_t _SummaryMax
 TwType CQuaternionExt::s_CustomType = TW_TYPE_UNDEF;
 vector<float>   CQuaternionExt::s_SphTri;
 vector<color32> CQuaternionExt::s_SphCol;
-vector<int>     CQuaternionExt::s_SphTriProj;
-vector<color32> CQuaternionExt::s_SphColLight;
 vector<float>   CQuaternionExt::s_ArrowTri[4];
 vector<float>   CQuaternionExt::s_ArrowNorm[4];
-vector<int>     CQuaternionExt::s_ArrowTriProj[4];
-vector<color32> CQuaternionExt::s_ArrowColLight[4];
+CQuatMesh       CQuaternionExt::s_SphMesh;
+CQuatMesh       CQuaternionExt::s_ArrowMesh[3][2][4];
+CQuatMesh       CQuaternionExt::s_DirArrowMesh[4];
+
+static const float SPH_RADIUS = 0.75f;  // radius of the sphere drawn by the quaternion widget
 
 void CQuaternionExt::CreateTypes()
 {
@@ -816,6 +826,7 @@ void CQuaternionExt::CreateTypes()
 
     CreateSphere();
     CreateArrow();
+    CreateMeshes();
 }
 
 void CQuaternionExt::ConvertToAxisAngle()
@@ -1026,10 +1037,6 @@ void CQuaternionExt::CreateSphere()
                 }
             }
     }
-    s_SphTriProj.clear();
-    s_SphTriProj.resize(2*s_SphCol.size(), 0);
-    s_SphColLight.clear();
-    s_SphColLight.resize(s_SphCol.size(), 0);
 }
 
 void CQuaternionExt::CreateArrow()
@@ -1099,14 +1106,6 @@ void CQuaternionExt::CreateArrow()
         s_ArrowNorm[ARROW_CONE_CAP].push_back(-1); s_ArrowNorm[ARROW_CONE_CAP].push_back(0); s_ArrowNorm[ARROW_CONE_CAP].push_back(0);
         s_ArrowNorm[ARROW_CONE_CAP].push_back(-1); s_ArrowNorm[ARROW_CONE_CAP].push_back(0); s_ArrowNorm[ARROW_CONE_CAP].push_back(0);
     }
-
-    for(i=0; i<4; ++i)
-    {
-        s_ArrowTriProj[i].clear();
-        s_ArrowTriProj[i].resize(2*(s_ArrowTri[i].size()/3), 0);
-        s_ArrowColLight[i].clear();
-        s_ArrowColLight[i].resize(s_ArrowTri[i].size()/3, 0);
-    }
 }
 
 static inline void QuatMult(double *out, const double *q1, const double *q2)
@@ -1164,6 +1163,64 @@ static inline void Vec3RotZ(float *x, float *y, float *z)
     *y = tmp;
 }
 
+void CQuaternionExt::CreateMeshes()
+{
+    // vertices of s_SphTri and s_ArrowTri as transformed by DrawCB before permutation and rotation
+    int i, j, l, c, n;
+    s_SphMesh.Clear();
+    n = (int)s_SphTri.size()/3;
+    for(i=0; i<n; ++i)
+        s_SphMesh.AddVertex(SPH_RADIUS*s_SphTri[3*i+0], SPH_RADIUS*s_SphTri[3*i+1], SPH_RADIUS*s_SphTri[3*i+2]);
+
+    float x, y, z, nx, ny, nz;
+    for(j=0; j<4; ++j)
+    {
+        assert( s_ArrowNorm[j].size()==s_ArrowTri[j].size() );
+        const float *tri = s_ArrowTri[j].empty() ? NULL : &(s_ArrowTri[j][0]);
+        const float *norm = s_ArrowNorm[j].empty() ? NULL : &(s_ArrowNorm[j][0]);
+        n = (int)s_ArrowTri[j].size()/3;
+        for(l=0; l<3; ++l)
+            for(c=0; c<2; ++c)
+            {
+                bool cone = (c==1);
+                s_ArrowMesh[l][c][j].Clear();
+                for(i=0; i<n; ++i)
+                {
+                    x = tri[3*i+0]; y = tri[3*i+1]; z = tri[3*i+2];
+                    if( cone && x<=0 )
+                        x = SPH_RADIUS;
+                    else if( !cone && x>0 )
+                        x = -SPH_RADIUS;
+                    nx = norm[3*i+0]; ny = norm[3*i+1]; nz = norm[3*i+2];
+                    if( l==1 )
+                    {
+                        Vec3RotZ(&x, &y, &z); 
+                        Vec3RotZ(&nx, &ny, &nz); 
+                    }
+                    else if( l==2 )
+                    {
+                        Vec3RotY(&x, &y, &z);
+                        Vec3RotY(&nx, &ny, &nz);
+                    }
+                    s_ArrowMesh[l][c][j].AddVertex(x, y, z, nx, ny, nz);
+                }
+            }
+
+        s_DirArrowMesh[j].Clear();
+        for(i=0; i<n; ++i)
+        {
+            x = tri[3*i+0]; y = tri[3*i+1]; z = tri[3*i+2];
+            if( x>0 )
+                x = 2.5f*x - 2.0f;
+            else
+                x += 0.2f;
+            y *= 1.5f;
+            z *= 1.5f;
+            s_DirArrowMesh[j].AddVertex(x, y, z, norm[3*i+0], norm[3*i+1], norm[3*i+2]);
+        }
+    }
+}
+
 void CQuaternionExt::ApplyQuat(float *outX, float *outY, float *outZ, float x, float y, float z, float qx, float qy, float qz, float qs)
 {
     float ps = - qx * x - qy * y - qz * z;
@@ -1244,6 +1301,63 @@ static inline float QuatIY(int y, int w, int h)
     return (-2.0f*(float)y + (float)h - 1.0f)/QuatD(w, h);
 }
 
+// Projected meshes of a quaternion widget, rebuilt by DrawCB when one of the key values changes
+struct CQuaternionExt::CProjCache
+{
+    struct CKey                 // compared with memcmp: only 4-byte members, no padding
+    {
+        float                   m_Quat[4];
+        float                   m_DirQuat[4];   // rotation of the direction arrow
+        float                   m_Permute[3][3];
+        int                     m_Width, m_Height;
+        color32                 m_Alpha;
+        color32                 m_DirColor;
+        int                     m_DrawDir;
+    };
+    struct CPart
+    {
+        int                     m_FirstVert;
+        int                     m_NbVerts;
+    };
+    CKey                        m_Key;
+    bool                        m_Valid;
+    std::vector<CPart>          m_Parts;        // in drawing order
+    std::vector<int>            m_Proj;
+    std::vector<float>          m_Z;
+    std::vector<color32>        m_Colors;
+
+    CProjCache() : m_Valid(false) { memset(&m_Key, 0, sizeof(m_Key)); }
+    void                        Clear() { m_Parts.clear(); m_Proj.clear(); m_Z.clear(); m_Colors.clear(); }
+    int                         AddPart(const CQuatMesh& _Mesh, const CQuatMeshTransform& _Transform, const color32 *_MeshColors, color32 _MeshColor, color32 _Mask);
+};
+
+// Appends the projection of _Mesh, returns the index of its first vertex
+int CQuaternionExt::CProjCache::AddPart(const CQuatMesh& _Mesh, const CQuatMeshTransform& _Transform, const color32 *_MeshColors, color32 _MeshColor, color32 _Mask)
+{
+    CPart part;
+    part.m_FirstVert = (int)m_Z.size();
+    part.m_NbVerts = _Mesh.NbVerts();
+    m_Parts.push_back(part);
+    if( part.m_NbVerts>0 )
+    {
+        m_Proj.resize(2*(part.m_FirstVert+part.m_NbVerts));
+        m_Z.resize(part.m_FirstVert+part.m_NbVerts);
+        m_Colors.resize(part.m_FirstVert+part.m_NbVerts);
+        TwTransformQuatMesh(&(m_Proj[2*part.m_FirstVert]), &(m_Z[part.m_FirstVert]), &(m_Colors[part.m_FirstVert]), _Mesh, _Transform, _MeshColors, _MeshColor, _Mask);
+    }
+    return part.m_FirstVert;
+}
+
+void CQuaternionExt::DeleteProjCache(void *_ExtValue)
+{
+    CQuaternionExt *ext = static_cast<CQuaternionExt *>(_ExtValue);
+    if( ext!=NULL && ext->m_ProjCache!=NULL )
+    {
+        delete ext->m_ProjCache;
+        ext->m_ProjCache = NULL;
+    }
+}
+
 void CQuaternionExt::DrawCB(int w, int h, void *_ExtValue, void *_ClientData, TwBar *_Bar, CTwVarGroup *varGrp)
 {
     if( g_TwMgr==NULL || g_TwMgr->m_Graph==NULL )
@@ -1286,14 +1400,11 @@ void CQuaternionExt::DrawCB(int w, int h, void *_ExtValue, void *_ClientData, Tw
     // force ext update
     static_cast<CTwVarAtom *>(varGrp->m_Vars[4])->ValueToDouble();
 
-    assert( s_SphTri.size()>0 );
-    assert( s_SphTri.size()==3*s_SphCol.size() );
-    assert( s_SphTriProj.size()==2*s_SphCol.size() );
-    assert( s_SphColLight.size()==s_SphCol.size() );
+    assert( s_SphMesh.NbVerts()>0 && s_SphMesh.NbVerts()==(int)s_SphCol.size() );
 
     if( QuatD(w, h)<=2 )
         return;
-    float x, y, z, nx, ny, nz, kx, ky, kz, qx, qy, qz, qs;
+    float kx, ky, kz, qx, qy, qz, qs;
     int i, j, k, l, m;
 
     // normalize quaternion
@@ -1325,6 +1436,14 @@ void CQuaternionExt::DrawCB(int w, int h, void *_ExtValue, void *_ClientData, Tw
     bool frameRightHanded = (ez[0]*pz[0]+ez[1]*pz[1]+ez[2]*pz[2]>=0);
     ITwGraph::Cull cull = frameRightHanded ? ITwGraph::CULL_CW : ITwGraph::CULL_CCW;
 
+    CProjCache::CKey key;
+    memset(&key, 0, sizeof(key));
+    key.m_Quat[0] = qx; key.m_Quat[1] = qy; key.m_Quat[2] = qz; key.m_Quat[3] = qs;
+    memcpy(key.m_Permute, ext->m_Permute, sizeof(key.m_Permute));
+    key.m_Width = w;
+    key.m_Height = h;
+    key.m_Alpha = alpha;
+    key.m_DrawDir = drawDir ? 1 : 0;
     if( drawDir )
     {
         float dir[] = {(float)ext->m_Dir[0], (float)ext->m_Dir[1], (float)ext->m_Dir[2]};
@@ -1343,142 +1462,104 @@ void CQuaternionExt::DrawCB(int w, int h, void *_ExtValue, void *_ClientData, Tw
         double rotDirAngle = acos(kx/normDir);
         double rotDirQuat[4];
         QuatFromAxisAngle(rotDirQuat, rotDirAxis, rotDirAngle);
-
-        kx = 1; ky = 0; kz = 0;
-        ext->Permute(&kx, &ky, &kz, kx, ky, kz);
-        ApplyQuat(&kx, &ky, &kz, kx, ky, kz, (float)rotDirQuat[0], (float)rotDirQuat[1], (float)rotDirQuat[2], (float)rotDirQuat[3]);
-        ApplyQuat(&kx, &ky, &kz, kx, ky, kz, qx, qy, qz, qs);
-        for(k=0; k<4; ++k) // 4 parts of the arrow
-        {
-            j = (kz>0) ? 3-k : k;
-            assert( s_ArrowTriProj[j].size()==2*(s_ArrowTri[j].size()/3) && s_ArrowColLight[j].size()==s_ArrowTri[j].size()/3 && s_ArrowNorm[j].size()==s_ArrowTri[j].size() ); 
-            const int ntri = (int)s_ArrowTri[j].size()/3;
-            const float *tri = &(s_ArrowTri[j][0]);
-            const float *norm = &(s_ArrowNorm[j][0]);
-            int *triProj = &(s_ArrowTriProj[j][0]);
-            color32 *colLight = &(s_ArrowColLight[j][0]);
-            for(i=0; i<ntri; ++i)
+        for(i=0; i<4; ++i)
+            key.m_DirQuat[i] = (float)rotDirQuat[i];
+        key.m_DirColor = ext->m_DirColor;
+    }
+
+    // project the meshes only if one of the values they depend on has changed
+    if( ext->m_ProjCache==NULL )
+        ext->m_ProjCache = new CProjCache;
+    CProjCache& cache = *ext->m_ProjCache;
+    if( !cache.m_Valid || memcmp(&cache.m_Key, &key, sizeof(key))!=0 )
+    {
+        cache.m_Key = key;
+        cache.m_Valid = true;
+        cache.Clear();
+        CQuatMeshTransform transform;
+        memcpy(transform.m_Permute, ext->m_Permute, sizeof(transform.m_Permute));
+        transform.m_Quats[0][0] = qx; transform.m_Quats[0][1] = qy; transform.m_Quats[0][2] = qz; transform.m_Quats[0][3] = qs;
+        transform.m_NbQuats = 1;
+        transform.m_Width = w;
+        transform.m_Height = h;
+        transform.m_LightScale = 1;
+
+        if( drawDir )
+        {
+            for(i=0; i<4; ++i)
             {
-                x = tri[3*i+0]; y = tri[3*i+1]; z = tri[3*i+2];
-                nx = norm[3*i+0]; ny = norm[3*i+1]; nz = norm[3*i+2];
-                if( x>0 )
-                    x = 2.5f*x - 2.0f;
-                else
-                    x += 0.2f;
-                y *= 1.5f;
-                z *= 1.5f;
-                ext->Permute(&x, &y, &z, x, y, z);
-                ApplyQuat(&x, &y, &z, x, y, z, (float)rotDirQuat[0], (float)rotDirQuat[1], (float)rotDirQuat[2], (float)rotDirQuat[3]);
-                ApplyQuat(&x, &y, &z, x, y, z, qx, qy, qz, qs);
-                ext->Permute(&nx, &ny, &nz, nx, ny, nz);
-                ApplyQuat(&nx, &ny, &nz, nx, ny, nz, (float)rotDirQuat[0], (float)rotDirQuat[1], (float)rotDirQuat[2], (float)rotDirQuat[3]);
-                ApplyQuat(&nx, &ny, &nz, nx, ny, nz, qx, qy, qz, qs);
-                triProj[2*i+0] = QuatPX(x, w, h);
-                triProj[2*i+1] = QuatPY(y, w, h);
-                color32 col = (ext->m_DirColor|0xff000000) & alpha;
-                colLight[i] = ColorBlend(0xff000000, col, fabsf(TClamp(nz, -1.0f, 1.0f)));
+                transform.m_Quats[1][i] = transform.m_Quats[0][i];
+                transform.m_Quats[0][i] = key.m_DirQuat[i];
+            }
+            transform.m_NbQuats = 2;
+            kx = 1; ky = 0; kz = 0;
+            ext->Permute(&kx, &ky, &kz, kx, ky, kz);
+            ApplyQuat(&kx, &ky, &kz, kx, ky, kz, key.m_DirQuat[0], key.m_DirQuat[1], key.m_DirQuat[2], key.m_DirQuat[3]);
+            ApplyQuat(&kx, &ky, &kz, kx, ky, kz, qx, qy, qz, qs);
+            for(k=0; k<4; ++k) // 4 parts of the arrow
+            {
+                j = (kz>0) ? 3-k : k;
+                cache.AddPart(s_DirArrowMesh[j], transform, NULL, (ext->m_DirColor|0xff000000) & alpha, 0xffffffff);
             }
-            if( s_ArrowTri[j].size()>=9 ) // 1 tri = 9 floats
-                g_TwMgr->m_Graph->DrawTriangles((int)s_ArrowTri[j].size()/9, triProj, colLight, cull);
         }
-    }
-    else
-    {
-        /*
-        int px0 = QuatPX(0, w, h)-1, py0 = QuatPY(0, w, h), r0 = (int)(0.5f*QuatD(w, h)-0.5f);
-        color32 col0 = 0x80000000;
-        DrawArc(px0-1, py0, r0, 0, 360, col0);
-        DrawArc(px0+1, py0, r0, 0, 360, col0);
-        DrawArc(px0, py0-1, r0, 0, 360, col0);
-        DrawArc(px0, py0+1, r0, 0, 360, col0);
-        */
-        // draw arrows & sphere
-        const float SPH_RADIUS = 0.75f;
-        for(m=0; m<2; ++m)  // m=0: back, m=1: front
-        {
-            for(l=0; l<3; ++l)  // draw 3 arrows
+        else
+        {
+            float alphaA = 1.0f;
+            Color32ToARGBf(alpha, &alphaA, NULL, NULL, NULL);
+            color32 alphaCol = Color32FromARGBf(alphaA, 1, 1, 1);
+            for(m=0; m<2; ++m)  // m=0: back, m=1: front
             {
-                kx = 1; ky = 0; kz = 0;
-                if( l==1 )
-                    Vec3RotZ(&kx, &ky, &kz); 
-                else if( l==2 )
-                    Vec3RotY(&kx, &ky, &kz);
-                ext->Permute(&kx, &ky, &kz, kx, ky, kz);
-                ApplyQuat(&kx, &ky, &kz, kx, ky, kz, qx, qy, qz, qs);
-                for(k=0; k<4; ++k) // 4 parts of the arrow
+                for(l=0; l<3; ++l)  // 3 arrows
                 {
-                    j = (kz>0) ? 3-k : k;
-                    bool cone = true;
-                    if( (m==0 && kz>0) || (m==1 && kz<=0) )
-                    {
-                        if( j==ARROW_CONE || j==ARROW_CONE_CAP ) // do not draw cone
-                            continue;
-                        else
-                            cone = false;
-                    }
-                    assert( s_ArrowTriProj[j].size()==2*(s_ArrowTri[j].size()/3) && s_ArrowColLight[j].size()==s_ArrowTri[j].size()/3 && s_ArrowNorm[j].size()==s_ArrowTri[j].size() ); 
-                    const int ntri = (int)s_ArrowTri[j].size()/3;
-                    const float *tri = &(s_ArrowTri[j][0]);
-                    const float *norm = &(s_ArrowNorm[j][0]);
-                    int *triProj = &(s_ArrowTriProj[j][0]);
-                    color32 *colLight = &(s_ArrowColLight[j][0]);
-                    for(i=0; i<ntri; ++i)
+                    kx = 1; ky = 0; kz = 0;
+                    if( l==1 )
+                        Vec3RotZ(&kx, &ky, &kz); 
+                    else if( l==2 )
+                        Vec3RotY(&kx, &ky, &kz);
+                    ext->Permute(&kx, &ky, &kz, kx, ky, kz);
+                    ApplyQuat(&kx, &ky, &kz, kx, ky, kz, qx, qy, qz, qs);
+                    for(k=0; k<4; ++k) // 4 parts of the arrow
                     {
-                        x = tri[3*i+0]; y = tri[3*i+1]; z = tri[3*i+2];
-                        if( cone && x<=0 )
-                            x = SPH_RADIUS;
-                        else if( !cone && x>0 )
-                            x = -SPH_RADIUS;
-                        nx = norm[3*i+0]; ny = norm[3*i+1]; nz = norm[3*i+2];
-                        if( l==1 )
+                        j = (kz>0) ? 3-k : k;
+                        bool cone = true;
+                        if( (m==0 && kz>0) || (m==1 && kz<=0) )
                         {
-                            Vec3RotZ(&x, &y, &z); 
-                            Vec3RotZ(&nx, &ny, &nz); 
+                            if( j==ARROW_CONE || j==ARROW_CONE_CAP ) // do not draw cone
+                                continue;
+                            else
+                                cone = false;
                         }
-                        else if( l==2 )
+                        color32 col = (l==0) ? 0xffff0000 : ( (l==1) ? 0xff00ff00 : 0xff0000ff );
+                        int first = cache.AddPart(s_ArrowMesh[l][cone ? 1 : 0][j], transform, NULL, col, 0xffffffff);
+                        for(i=first; i<(int)cache.m_Z.size(); ++i) // fade back arrows
                         {
-                            Vec3RotY(&x, &y, &z);
-                            Vec3RotY(&nx, &ny, &nz);
+                            float z = cache.m_Z[i];
+                            float fade = ( m==0 && z<0 ) ? TClamp(2.0f*z*z, 0.0f, 1.0f) : 0;
+                            cache.m_Colors[i] &= (fade>0) ? Color32FromARGBf(alphaA*(1.0f-fade), 1, 1, 1) : alphaCol;
                         }
-                        ext->Permute(&x, &y, &z, x, y, z);
-                        ApplyQuat(&x, &y, &z, x, y, z, qx, qy, qz, qs);
-                        ext->Permute(&nx, &ny, &nz, nx, ny, nz);
-                        ApplyQuat(&nx, &ny, &nz, nx, ny, nz, qx, qy, qz, qs);
-                        triProj[2*i+0] = QuatPX(x, w, h);
-                        triProj[2*i+1] = QuatPY(y, w, h);
-                        float fade = ( m==0 && z<0 ) ? TClamp(2.0f*z*z, 0.0f, 1.0f) : 0;
-                        float alphaFade = 1.0f;
-                        Color32ToARGBf(alpha, &alphaFade, NULL, NULL, NULL);
-                        alphaFade *= (1.0f-fade);
-                        color32 alphaFadeCol = Color32FromARGBf(alphaFade, 1, 1, 1);
-                        color32 col = (l==0) ? 0xffff0000 : ( (l==1) ? 0xff00ff00 : 0xff0000ff );
-                        colLight[i] = ColorBlend(0xff000000, col, fabsf(TClamp(nz, -1.0f, 1.0f))) & alphaFadeCol;
                     }
-                    if( s_ArrowTri[j].size()>=9 ) // 1 tri = 9 floats
-                        g_TwMgr->m_Graph->DrawTriangles((int)s_ArrowTri[j].size()/9, triProj, colLight, cull);
                 }
-            }
 
-            if( m==0 )
-            {
-                const float *tri = &(s_SphTri[0]);
-                int *triProj = &(s_SphTriProj[0]);
-                const color32 *col = &(s_SphCol[0]);
-                color32 *colLight = &(s_SphColLight[0]);
-                const int ntri = (int)s_SphTri.size()/3;
-                for(i=0; i<ntri; ++i)   // draw sphere
+                if( m==0 )  // sphere
                 {
-                    x = SPH_RADIUS*tri[3*i+0]; y = SPH_RADIUS*tri[3*i+1]; z = SPH_RADIUS*tri[3*i+2];
-                    ext->Permute(&x, &y, &z, x, y, z);
-                    ApplyQuat(&x, &y, &z, x, y, z, qx, qy, qz, qs);
-                    triProj[2*i+0] = QuatPX(x, w, h);
-                    triProj[2*i+1] = QuatPY(y, w, h);
-                    colLight[i] = ColorBlend(0xff000000, col[i], fabsf(TClamp(z/SPH_RADIUS, -1.0f, 1.0f))) & alpha;
+                    transform.m_LightScale = SPH_RADIUS;
+                    cache.AddPart(s_SphMesh, transform, &(s_SphCol[0]), 0, alpha);
+                    transform.m_LightScale = 1;
                 }
-                g_TwMgr->m_Graph->DrawTriangles((int)s_SphTri.size()/9, triProj, colLight, cull);
             }
         }
+    }
+
+    // draw arrows & sphere
+    for(i=0; i<(int)cache.m_Parts.size(); ++i)
+    {
+        const CProjCache::CPart& part = cache.m_Parts[i];
+        if( part.m_NbVerts>=3 )
+            g_TwMgr->m_Graph->DrawTriangles(part.m_NbVerts/3, &(cache.m_Proj[2*part.m_FirstVert]), &(cache.m_Colors[part.m_FirstVert]), cull);
+    }
 
+    if( !drawDir )
+    {
         // draw x
         g_TwMgr->m_Graph->DrawLine(w-12, h-36, w-12+5, h-36+5, 0xffc00000, true);
         g_TwMgr->m_Graph->DrawLine(w-12+5, h-36, w-12, h-36+5, 0xffc00000, true);
@@ -1674,6 +1755,18 @@ static int TwCreateGraph(ETwGraphAPI _GraphAPI)
     case TW_OPENGL:
         g_TwMgr->m_Graph = new CTwGraphOpenGL;
         break;
+    case TW_OPENGL_CORE:
+        g_TwMgr->m_Graph = new CTwGraphOpenGLCore;
+        break;
+    case TW_SOFTWARE:
+        if( g_TwMgr->m_Device!=NULL )
+            g_TwMgr->m_Graph = new CTwGraphSoftware;
+        else
+        {
+            g_TwMgr->SetLastError(g_ErrBadDevice);
+            return 0;
+        }
+        break;
 #ifdef ANT_WINDOWS
 #ifdef ANT_TW_SUPPORT_DX9
     case TW_DIRECT3D9:
@@ -1710,9 +1803,10 @@ static int TwCreateGraph(ETwGraphAPI _GraphAPI)
       }
       break;
 #endif
-    }
-
 #endif // ANT_WINDOWS
+    default:
+        break;
+    }
 
     if( g_TwMgr->m_Graph==NULL )
     {
@@ -1725,27 +1819,117 @@ static int TwCreateGraph(ETwGraphAPI _GraphAPI)
 
 //  ---------------------------------------------------------------------------
 
+// Functions that modify the bars, the vars, the types or the mailboxes must
+// be called from the render thread (the thread that called TwInit, it does
+// not change afterwards so other threads can read m_RenderThread without
+// synchronization): they fail with g_ErrWrongThread otherwise. Input and var change
+// notifications are queued instead (see TwMustQueueEvent).
+static inline int TwOnRenderThread()
+{
+    if( g_TwMgr && !TwSameThread(TwCurrentThread(), g_TwMgr->m_RenderThread) )
+    {
+        g_TwMgr->SetLastError(g_ErrWrongThread);
+        return 0;
+    }
+    return 1;
+}
+
+// Same, and fails with g_ErrIsDrawing while a frame is drawn.
 static inline int TwFreeAsyncDrawing()
 {
+    if( !TwOnRenderThread() )
+        return 0;
     if( g_TwMgr && g_TwMgr->m_Graph && g_TwMgr->m_Graph->IsDrawing() )
     {
-        const double SLEEP_MAX = 0.25; // wait at most 1/4 second
-        PerfTimer timer;
-        while( g_TwMgr->m_Graph->IsDrawing() && timer.GetTime()<SLEEP_MAX )
-        {
-            #if defined(ANT_WINDOWS)
-                Sleep(1); // milliseconds
-            #elif defined(ANT_UNIX) || defined(ANT_OSX)
-                usleep(1000); // microseconds
-            #endif
-        }
-        if( g_TwMgr->m_Graph->IsDrawing() )
+        g_TwMgr->SetLastError(g_ErrIsDrawing);
+        return 0;
+    }
+    return 1;
+}
+
+//  ---------------------------------------------------------------------------
+
+// True if an input event must be pushed to g_TwMgr->m_EventQueue rather than
+// processed now: it comes from a thread other than the render thread, or a
+// frame is being drawn.
+static inline bool TwMustQueueEvent()
+{
+    return !TwSameThread(TwCurrentThread(), g_TwMgr->m_RenderThread) || (g_TwMgr->m_Graph!=NULL && g_TwMgr->m_Graph->IsDrawing());
+}
+
+//  ---------------------------------------------------------------------------
+
+static int TwMouseEvent(ETwMouseAction _EventType, TwMouseButtonID _Button, int _MouseX, int _MouseY, int _WheelPos, const int *_WheelLines);
+static bool TwDispatchBatchedEvents();
+
+// Called by TwDraw at frame start: dispatches the events queued by other
+// threads and applies the values published into mailboxes.
+// Returns false if an event handler terminated the library.
+static bool TwProcessQueuedEvents()
+{
+    CTwQueuedEvent *Ev = g_TwMgr->m_EventQueue.PopAll();
+
+    // only the last of consecutive mouse motions needs to be processed
+    CTwQueuedEvent *LastMotion = NULL;
+    for( CTwQueuedEvent *e=Ev; e!=NULL; e=e->m_Next )
+        if( e->m_Type==CTwQueuedEvent::MOUSE && e->m_Args[0]==TW_MOUSE_MOTION )
         {
-            g_TwMgr->SetLastError(g_ErrIsDrawing);
-            return 0;
+            if( LastMotion!=NULL )
+                LastMotion->m_Skip = true;
+            LastMotion = e;
         }
+        else if( e->m_Type!=CTwQueuedEvent::NOTIFY_VAR )
+            LastMotion = NULL;
+
+    while( Ev!=NULL )
+    {
+        if( g_TwMgr!=NULL && !Ev->m_Skip )
+            switch( Ev->m_Type )
+            {
+            case CTwQueuedEvent::MOUSE:
+                TwMouseEvent((ETwMouseAction)Ev->m_Args[0], (TwMouseButtonID)Ev->m_Args[1], Ev->m_Args[2], Ev->m_Args[3], Ev->m_Args[4], NULL);
+                break;
+            case CTwQueuedEvent::KEY:
+                TwKeyPressed(Ev->m_Args[0], Ev->m_Args[1]);
+                break;
+            case CTwQueuedEvent::WINDOW_SIZE:
+                TwWindowSize(Ev->m_Args[0], Ev->m_Args[1]);
+                break;
+            case CTwQueuedEvent::NOTIFY_VAR:
+                for( size_t i=0; i<g_TwMgr->m_Bars.size(); ++i )
+                    if( g_TwMgr->m_Bars[i]==Ev->m_Bar ) // bar may have been deleted
+                    {
+                        TwNotifyVarChanged(Ev->m_Bar, Ev->m_AllVars ? NULL : Ev->m_VarName.c_str());
+                        break;
+                    }
+                break;
+            }
+        CTwQueuedEvent *Next = Ev->m_Next;
+        delete Ev;
+        Ev = Next;
     }
-    return 1;
+    if( g_TwMgr==NULL )
+        return false;
+
+    for( size_t i=0; i<g_TwMgr->m_Mailboxes.size(); ++i )
+    {
+        CTwMailbox *Mailbox = g_TwMgr->m_Mailboxes[i];
+        const void *Value = Mailbox->Fetch();
+        if( Value==NULL || Mailbox->m_Bar==NULL )
+            continue;
+        CTwVar *Var = Mailbox->m_Bar->Find(Mailbox->m_VarName.c_str());
+        if( Var==NULL || Var->IsGroup() )
+            continue;   // var has been removed
+        CTwVarAtom *Atom = static_cast<CTwVarAtom *>(Var);
+        if( CTwVar::GetDataSize(Atom->m_Type)!=Mailbox->m_Size )
+            continue;   // var has been re-added with another type
+        if( Atom->m_SetCallback!=NULL )
+            Atom->m_SetCallback(Value, Atom->m_ClientData);
+        else if( Atom->m_Ptr!=NULL )
+            memcpy(Atom->m_Ptr, Value, Mailbox->m_Size);
+        Mailbox->m_Bar->NotUpToDate();
+    }
+    return true;
 }
 
 //  ---------------------------------------------------------------------------
@@ -1919,6 +2103,14 @@ int ANT_CALL TwDraw()
     if( !TwFreeAsyncDrawing() )
         return 0;
 
+    // Process input and values sent by other threads
+    if( !TwProcessQueuedEvents() )
+        return 0;   // terminated by an event handler
+
+    // and the events merged since TwBeginEvents if TwEndEvents has not been called yet
+    if( !TwDispatchBatchedEvents() )
+        return 0;
+
     // Create cursors
     #if defined(ANT_WINDOWS) || defined(ANT_OSX)
         if( !g_TwMgr->m_CursorsCreated )
@@ -1984,17 +2176,55 @@ int ANT_CALL TwDraw()
             }
         }
         PERF( DT = Timer.GetTime(); printf("Draw=%.4fms ", 1000.0*DT); )
+        g_TwMgr->CheckBarRects();  // bars may have been clamped to the window and icons placed
 
         PERF( Timer.Reset(); )
         g_TwMgr->m_Graph->EndDraw();
-        PERF( DT = Timer.GetTime(); printf("End=%.4fms\n", 1000.0*DT); )
+        PERF( DT = Timer.GetTime(); printf("End=%.4fms DrawCalls=%d\n", 1000.0*DT, g_TwMgr->m_Graph->GetDrawCallCount()); )
+    }
+
+    // Remember what has been drawn for TwNeedsRedraw
+    g_TwMgr->m_DrawnBars.resize(0);
+    for( i=0; i<g_TwMgr->m_Bars.size(); ++i )
+    {
+        idx = g_TwMgr->m_Order[i];
+        if( g_TwMgr->m_Bars[idx]!=NULL && g_TwMgr->m_Bars[idx]->m_Visible )
+            g_TwMgr->m_DrawnBars.push_back(g_TwMgr->m_Bars[idx]);
     }
+    g_TwMgr->m_NeedsRedraw = false;
 
     return 1;
 }
 
 //  ---------------------------------------------------------------------------
 
+int ANT_CALL TwNeedsRedraw()
+{
+    if( g_TwMgr==NULL || g_TwMgr->m_Graph==NULL )
+    {
+        TwGlobalError(g_ErrNotInit);
+        return 0; // not initialized
+    }
+
+    if( g_TwMgr->m_NeedsRedraw || g_TwMgr->m_CanRepeatMousePressed )
+        return 1;
+
+    size_t i, n = 0;
+    for( i=0; i<g_TwMgr->m_Bars.size(); ++i )
+    {
+        const CTwBar *Bar = g_TwMgr->m_Bars[g_TwMgr->m_Order[i]];
+        if( Bar!=NULL && Bar->m_Visible )
+        {
+            if( n>=g_TwMgr->m_DrawnBars.size() || g_TwMgr->m_DrawnBars[n]!=Bar || Bar->NeedsRedraw() )
+                return 1;
+            ++n;
+        }
+    }
+    return ( n!=g_TwMgr->m_DrawnBars.size() ) ? 1 : 0;
+}
+
+//  ---------------------------------------------------------------------------
+
 int ANT_CALL TwWindowSize(int _Width, int _Height)
 {
     g_InitWndWidth = _Width;
@@ -2013,7 +2243,17 @@ int ANT_CALL TwWindowSize(int _Width, int _Height)
     }
 
     // For multi-thread savety
-    if( !TwFreeAsyncDrawing() )
+    if( TwMustQueueEvent() )
+    {
+        CTwQueuedEvent *Ev = new CTwQueuedEvent(CTwQueuedEvent::WINDOW_SIZE);
+        Ev->m_Args[0] = _Width;
+        Ev->m_Args[1] = _Height;
+        g_TwMgr->m_EventQueue.Push(Ev);
+        return 1;
+    }
+
+    // Merged mouse events occurred before
+    if( !TwDispatchBatchedEvents() )
         return 0;
 
     // Delete the extra text objects
@@ -2031,6 +2271,8 @@ int ANT_CALL TwWindowSize(int _Width, int _Height)
     g_TwMgr->m_WndWidth = _Width;
     g_TwMgr->m_WndHeight = _Height;
     g_TwMgr->m_Graph->Restore();
+    g_TwMgr->m_NeedsRedraw = true;
+    g_TwMgr->BarRectsNotUpToDate();
 
     // Recreate extra text objects
     if( g_TwMgr->m_WndWidth!=0 && g_TwMgr->m_WndHeight!=0 )
@@ -2082,6 +2324,15 @@ CTwMgr::CTwMgr(ETwGraphAPI _GraphAPI, void *_Device)
     m_LastMouseX = -1;
     m_LastMouseY = -1;
     m_LastMouseWheelPos = 0;
+    m_EventBatchLevel = 0;
+    m_BatchedMotion = false;
+    m_BatchedMouseX = m_BatchedMouseY = 0;
+    m_BatchedWheel = false;
+    m_BatchedWheelPos = m_BatchedWheelLines = 0;
+    m_BatchedHandled = false;
+    m_BarCellsX = m_BarCellsY = 0;
+    m_LowestOpenBars[0] = m_LowestOpenBars[1] = NULL;
+    m_BarRectsUpToDate = false;
     m_IconPos = 0;
     m_IconAlign = 0;
     m_IconMarginX = m_IconMarginY = 8;
@@ -2106,6 +2357,13 @@ CTwMgr::CTwMgr(ETwGraphAPI _GraphAPI, void *_Device)
     m_IsRepeatingMousePressed = false;
     m_UseOldColorScheme = false;
     m_Contained = false;
+    m_UseVBO = false;
+    m_GLState = 0;
+    m_UseDrawCache = false;
+    m_NeedsRedraw = true;
+    m_RenderThread = TwCurrentThread();
+    m_RefreshEpoch = 0;
+    m_LastRefreshEpoch = 0;
     
     m_CursorsCreated = false;   
     #if defined(ANT_UNIX)
@@ -2122,6 +2380,8 @@ CTwMgr::CTwMgr(ETwGraphAPI _GraphAPI, void *_Device)
 
 CTwMgr::~CTwMgr()
 {
+    for( size_t i=0; i<m_Mailboxes.size(); ++i )
+        delete m_Mailboxes[i];
 }
 
 //  ---------------------------------------------------------------------------
@@ -2140,32 +2400,137 @@ int CTwMgr::FindBar(const char *_Name) const
 
 //  ---------------------------------------------------------------------------
 
-int CTwMgr::HasAttrib(const char *_Attrib, bool *_HasValue) const
-{
-    *_HasValue = true;
-    if( _stricmp(_Attrib, "help")==0 )
-        return MGR_HELP;
-    else if( _stricmp(_Attrib, "fontsize")==0 )
-        return MGR_FONT_SIZE;
-    else if( _stricmp(_Attrib, "iconpos")==0 )
-        return MGR_ICON_POS;
-    else if( _stricmp(_Attrib, "iconalign")==0 )
-        return MGR_ICON_ALIGN;
-    else if( _stricmp(_Attrib, "iconmargin")==0 )
-        return MGR_ICON_MARGIN;
-    else if( _stricmp(_Attrib, "fontresizable")==0 )
-        return MGR_FONT_RESIZABLE;
-    else if( _stricmp(_Attrib, "colorscheme")==0 )
-        return MGR_COLOR_SCHEME;
-    else if( _stricmp(_Attrib, "contained")==0 )
-        return MGR_CONTAINED;
+CTwAttribTable::CTwAttribTable(const CTwAttribName *_Names, int _NbNames)
+{
+    assert( _NbNames>0 && _NbNames<128 );
+    m_Names = _Names;
+    unsigned int Size = 1;
+    while( Size<2*(unsigned int)_NbNames )
+        Size *= 2;
+    for( ;; Size *= 2 )
+    {
+        m_Mask = Size-1;
+        m_Slots.assign(Size, -1);
+        for( m_Seed=0; m_Seed<256; ++m_Seed )
+        {
+            int i;
+            for( i=0; i<_NbNames; ++i )
+            {
+                signed char& Slot = m_Slots[Hash(_Names[i].m_Name, (int)strlen(_Names[i].m_Name), m_Seed) & m_Mask];
+                if( Slot>=0 )
+                    break;  // collision
+                Slot = (signed char)i;
+            }
+            if( i==_NbNames )
+                return;
+            m_Slots.assign(Size, -1);
+        }
+    }
+}
+
+unsigned int CTwAttribTable::Hash(const char *_Str, int _Len, unsigned int _Seed)
+{
+    unsigned int h = 2166136261u ^ (_Seed*16777619u);
+    for( int i=0; i<_Len; ++i )
+    {
+        unsigned int c = (unsigned char)_Str[i];
+        if( c>='A' && c<='Z' )
+            c += 'a'-'A';
+        h = (h^c) * 16777619u;
+    }
+    return h ^ (h>>15);
+}
+
+bool CTwAttribTable::SameName(const char *_Name, const char *_Attrib, int _Len)
+{
+    for( int i=0; i<_Len; ++i )
+    {
+        char c = _Attrib[i];
+        if( c>='A' && c<='Z' )
+            c += 'a'-'A';
+        if( _Name[i]!=c )   // also stops at the end of _Name
+            return false;
+    }
+    return _Name[_Len]=='\0';
+}
+
+int CTwAttribTable::Find(const char *_Attrib, int _Len, bool *_HasValue) const
+{
+    int i = m_Slots[Hash(_Attrib, _Len, m_Seed) & m_Mask];
+    if( i<0 || !SameName(m_Names[i].m_Name, _Attrib, _Len) )
+        return 0;
+    *_HasValue = m_Names[i].m_HasValue;
+    return m_Names[i].m_ID;
+}
+
+//  ---------------------------------------------------------------------------
+
+static const CTwAttribName g_MgrAttribNames[] =
+{
+    { "help",           MGR_HELP,           true },
+    { "fontsize",       MGR_FONT_SIZE,      true },
+    { "iconpos",        MGR_ICON_POS,       true },
+    { "iconalign",      MGR_ICON_ALIGN,     true },
+    { "iconmargin",     MGR_ICON_MARGIN,    true },
+    { "fontresizable",  MGR_FONT_RESIZABLE, true },
+    { "colorscheme",    MGR_COLOR_SCHEME,   true },
+    { "contained",      MGR_CONTAINED,      true },
+    { "vbo",            MGR_VBO,            true },
+    { "drawcache",      MGR_DRAW_CACHE,     true },
+    { "drawcalls",      MGR_DRAW_CALLS,     true },
+    { "glstate",        MGR_GL_STATE,       true },
+    { "glcalls",        MGR_GL_CALLS,       true }
+};
+static const CTwAttribTable g_MgrAttribs(g_MgrAttribNames, sizeof(g_MgrAttribNames)/sizeof(g_MgrAttribNames[0]));
+
+// "glstate" values: "full", or a list of the state groups guaranteed by the application
+struct CGLStateName { const char *m_Name; int m_Flags; };
+static const CGLStateName g_GLStateNames[] =
+{
+    { "none",       GLSTATE_COOPERATIVE },
+    { "caps",       GLSTATE_COOPERATIVE|GLSTATE_CAPS },
+    { "texunits",   GLSTATE_COOPERATIVE|GLSTATE_TEXUNITS },
+    { "values",     GLSTATE_COOPERATIVE|GLSTATE_VALUES },
+    { "bindings",   GLSTATE_COOPERATIVE|GLSTATE_BINDINGS },
+    { "arrays",     GLSTATE_COOPERATIVE|GLSTATE_ARRAYS },
+    { "viewport",   GLSTATE_COOPERATIVE|GLSTATE_VIEWPORT },
+    { "all",        GLSTATE_ALL }
+};
+static const int g_NbGLStateNames = (int)(sizeof(g_GLStateNames)/sizeof(g_GLStateNames[0]));
+
+static bool ParseGLState(const char *_Value, int *_Flags)
+{
+    istringstream Stream(_Value);
+    string Name;
+    int Flags = 0;
+    bool Full = false;
+    while( Stream >> Name )
+    {
+        int i = 0;
+        while( i<g_NbGLStateNames && _stricmp(Name.c_str(), g_GLStateNames[i].m_Name)!=0 )
+            ++i;
+        if( i<g_NbGLStateNames )
+            Flags |= g_GLStateNames[i].m_Flags;
+        else if( _stricmp(Name.c_str(), "full")==0 )
+            Full = true;
+        else
+            return false;
+    }
+    if( Full && Flags!=0 )
+        return false;   // "full" cannot be combined with state groups
+    *_Flags = Flags;
+    return true;
+}
 
+int CTwMgr::HasAttrib(const char *_Attrib, int _Len, bool *_HasValue) const
+{
     *_HasValue = false;
-    return 0; // not found
+    return g_MgrAttribs.Find(_Attrib, _Len, _HasValue);
 }
 
 int CTwMgr::SetAttrib(int _AttribID, const char *_Value)
 {
+    m_BarRectsUpToDate = false; // icon position, font size... may change
     switch( _AttribID )
     {
     case MGR_HELP:
@@ -2357,6 +2722,63 @@ int CTwMgr::SetAttrib(int _AttribID, const char *_Value)
             g_TwMgr->SetLastError(g_ErrNoValue);
             return 0;
         }
+    case MGR_VBO:
+        if( _Value && strlen(_Value)>0 )
+        {
+            if( _stricmp(_Value, "1")==0 || _stricmp(_Value, "true")==0 )
+                m_UseVBO = true;
+            else if( _stricmp(_Value, "0")==0 || _stricmp(_Value, "false")==0 )
+                m_UseVBO = false;
+            else
+            {
+                g_TwMgr->SetLastError(g_ErrBadValue);
+                return 0;
+            }
+            return 1;
+        }
+        else
+        {
+            g_TwMgr->SetLastError(g_ErrNoValue);
+            return 0;
+        }
+    case MGR_DRAW_CACHE:
+        if( _Value && strlen(_Value)>0 )
+        {
+            if( _stricmp(_Value, "1")==0 || _stricmp(_Value, "true")==0 )
+                m_UseDrawCache = true;
+            else if( _stricmp(_Value, "0")==0 || _stricmp(_Value, "false")==0 )
+                m_UseDrawCache = false;
+            else
+            {
+                g_TwMgr->SetLastError(g_ErrBadValue);
+                return 0;
+            }
+            return 1;
+        }
+        else
+        {
+            g_TwMgr->SetLastError(g_ErrNoValue);
+            return 0;
+        }
+    case MGR_GL_STATE:
+        if( _Value && strlen(_Value)>0 )
+        {
+            if( !ParseGLState(_Value, &m_GLState) )
+            {
+                g_TwMgr->SetLastError(g_ErrBadValue);
+                return 0;
+            }
+            return 1;
+        }
+        else
+        {
+            g_TwMgr->SetLastError(g_ErrNoValue);
+            return 0;
+        }
+    case MGR_DRAW_CALLS:    // read-only
+    case MGR_GL_CALLS:
+        g_TwMgr->SetLastError(g_ErrInvalidAttrib);
+        return 0;
     default:
         g_TwMgr->SetLastError(g_ErrUnknownAttrib);
         return 0;
@@ -2431,6 +2853,36 @@ ERetType CTwMgr::GetAttrib(int _AttribID, std::vector<double>& outDoubles, std::
             outDoubles.push_back(contained);
             return RET_DOUBLE;
         }
+    case MGR_VBO:
+        outDoubles.push_back(m_UseVBO);
+        return RET_DOUBLE;
+    case MGR_DRAW_CACHE:
+        outDoubles.push_back(m_UseDrawCache);
+        return RET_DOUBLE;
+    case MGR_DRAW_CALLS:    // draw calls issued by the graph API during the last TwDraw
+        outDoubles.push_back(m_Graph!=NULL ? m_Graph->GetDrawCallCount() : 0);
+        return RET_DOUBLE;
+    case MGR_GL_STATE:
+        if( (m_GLState & GLSTATE_COOPERATIVE)==0 )
+            outString << "full";
+        else if( m_GLState==GLSTATE_ALL )
+            outString << "all";
+        else if( m_GLState==GLSTATE_COOPERATIVE )
+            outString << "none";
+        else
+        {
+            bool First = true;
+            for( int i=0; i<g_NbGLStateNames; ++i )
+                if( g_GLStateNames[i].m_Flags!=GLSTATE_COOPERATIVE && g_GLStateNames[i].m_Flags!=GLSTATE_ALL && (m_GLState & g_GLStateNames[i].m_Flags)==g_GLStateNames[i].m_Flags )
+                {
+                    outString << (First ? "" : " ") << g_GLStateNames[i].m_Name;
+                    First = false;
+                }
+        }
+        return RET_STRING;
+    case MGR_GL_CALLS:      // GL calls issued by the OpenGL graph during the last TwDraw (-1 for the other graphs)
+        outDoubles.push_back(m_Graph!=NULL ? m_Graph->GetAPICallCount() : 0);
+        return RET_DOUBLE;
     default:
         g_TwMgr->SetLastError(g_ErrUnknownAttrib);
         return RET_ERROR;
@@ -2460,6 +2912,7 @@ void CTwMgr::Minimize(TwBar *_Bar)
         _Bar->m_MinNumber = -1;
     _Bar->m_IsMinimized = true;
     _Bar->NotUpToDate();
+    m_BarRectsUpToDate = false;
 }
 
 //  ---------------------------------------------------------------------------
@@ -2482,6 +2935,7 @@ void CTwMgr::Maximize(TwBar *_Bar)
     _Bar->NotUpToDate();
     if( _Bar->m_IsHelpBar )
         m_HelpBarNotUpToDate = true;
+    m_BarRectsUpToDate = false;
 }
 
 //  ---------------------------------------------------------------------------
@@ -2501,6 +2955,7 @@ void CTwMgr::Hide(TwBar *_Bar)
         _Bar->m_Visible = false;
     if( !_Bar->m_IsHelpBar )
         m_HelpBarNotUpToDate = true;
+    m_BarRectsUpToDate = false;
 }
 
 //  ---------------------------------------------------------------------------
@@ -2521,21 +2976,265 @@ void CTwMgr::Unhide(TwBar *_Bar)
     _Bar->NotUpToDate();
     if( !_Bar->m_IsHelpBar )
         m_HelpBarNotUpToDate = true;
+    m_BarRectsUpToDate = false;
 }
 
 //  ---------------------------------------------------------------------------
 
-void CTwMgr::SetFont(const CTexFont *_Font, bool _ResizeBars)
-{
-    assert(m_Graph!=NULL);
-    assert(_Font!=NULL);
-
-    m_CurrentFont = _Font;
+static const int BAR_CELL_SIZE = 64;    // in pixels
 
-    for( int i=0; i<(int)m_Bars.size(); ++i )
-        if( m_Bars[i]!=NULL )
+// Same areas as the ones tested by CTwBar::MouseMotion and MouseButton
+void CTwMgr::GetBarRect(const TwBar *_Bar, CBarRect *_Rect)
+{
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    if( _Bar->m_Visible && !_Bar->m_IsMinimized )
+    {
+        x0 = _Bar->m_PosX;
+        y0 = _Bar->m_PosY;
+        x1 = _Bar->m_PosX + _Bar->m_Width;
+        y1 = _Bar->m_PosY + _Bar->m_Height;
+        // custom widget areas are updated by Draw, they may be out of the bar until then
+        for( CTwBar::CustomMap::const_iterator it=_Bar->m_CustomRecords.begin(); it!=_Bar->m_CustomRecords.end(); ++it )
         {
-            int fh = m_Bars[i]->m_Font->m_CharHeight;
+            const CTwBar::CCustomRecord& r = it->second;
+            if( r.m_XMin<r.m_XMax && r.m_YMin<r.m_YMax )
+            {
+                x0 = min(x0, r.m_XMin);
+                y0 = min(y0, r.m_YMin);
+                x1 = max(x1, r.m_XMax);
+                y1 = max(y1, r.m_YMax);
+            }
+        }
+    }
+    else if( _Bar->m_Visible && _Bar->m_Iconifiable )
+    {
+        x0 = _Bar->m_MinPosX + 2;
+        y0 = _Bar->m_MinPosY + 1;
+        x1 = _Bar->m_MinPosX + _Bar->m_Font->m_CharHeight;
+        y1 = _Bar->m_MinPosY + _Bar->m_Font->m_CharHeight - 2;
+    }
+    _Rect->m_Bar = const_cast<TwBar *>(_Bar);
+    _Rect->m_X0 = x0;
+    _Rect->m_Y0 = y0;
+    _Rect->m_X1 = max(x1, x0);
+    _Rect->m_Y1 = max(y1, y0);
+}
+
+static inline bool InBarRect(const CTwMgr::CBarRect& _Rect, int _X, int _Y)
+{
+    return _X>=_Rect.m_X0 && _X<_Rect.m_X1 && _Y>=_Rect.m_Y0 && _Y<_Rect.m_Y1;
+}
+
+void CTwMgr::UpdateBarRects()
+{
+    if( m_BarRectsUpToDate )
+        return;
+
+    m_BarRects.resize(0);
+    m_MouseBars.resize(0);
+    m_LowestOpenBars[0] = m_LowestOpenBars[1] = NULL;
+    for( int i=(int)m_Bars.size()-1; i>=0; --i )
+    {
+        TwBar *Bar = m_Bars[m_Order[i]];
+        if( Bar==NULL )
+            continue;
+        Bar->m_RectIndex = -1;
+        if( !Bar->m_Visible )
+            continue;
+        CBarRect Rect;
+        GetBarRect(Bar, &Rect);
+        Bar->m_RectIndex = (int)m_BarRects.size();
+        m_BarRects.push_back(Rect);
+        if( !Bar->m_IsMinimized )
+        {
+            m_LowestOpenBars[1] = m_LowestOpenBars[0];
+            m_LowestOpenBars[0] = Bar;
+        }
+        if( Bar->HasMouseState() )
+            m_MouseBars.push_back(Bar);
+    }
+
+    // list the rects overlapping each cell of the grid
+    m_BarCellsX = (m_WndWidth>0) ? (m_WndWidth+BAR_CELL_SIZE-1)/BAR_CELL_SIZE : 0;
+    m_BarCellsY = (m_WndHeight>0) ? (m_WndHeight+BAR_CELL_SIZE-1)/BAR_CELL_SIZE : 0;
+    int NbCells = m_BarCellsX*m_BarCellsY;
+    m_BarCellStart.assign(NbCells+1, 0);
+    for( int Pass=0; Pass<2; ++Pass )
+    {
+        for( int r=0; r<(int)m_BarRects.size(); ++r )
+        {
+            const CBarRect& Rect = m_BarRects[r];
+            if( Rect.m_X0>=Rect.m_X1 || Rect.m_Y0>=Rect.m_Y1 )
+                continue;
+            int cx0 = max(Rect.m_X0, 0)/BAR_CELL_SIZE;
+            int cy0 = max(Rect.m_Y0, 0)/BAR_CELL_SIZE;
+            int cx1 = min((Rect.m_X1-1)/BAR_CELL_SIZE, m_BarCellsX-1);
+            int cy1 = min((Rect.m_Y1-1)/BAR_CELL_SIZE, m_BarCellsY-1);
+            for( int cy=cy0; cy<=cy1; ++cy )
+                for( int cx=cx0; cx<=cx1; ++cx )
+                    if( Pass==0 )
+                        ++m_BarCellStart[cy*m_BarCellsX+cx+1];
+                    else
+                        m_BarCells[m_BarCellStart[cy*m_BarCellsX+cx]++] = r;
+        }
+        if( Pass==0 )
+        {
+            for( int c=0; c<NbCells; ++c )
+                m_BarCellStart[c+1] += m_BarCellStart[c];
+            m_BarCells.resize(m_BarCellStart[NbCells]);
+        }
+        else    // the second pass moved each start to the start of the next cell
+        {
+            for( int c=NbCells; c>0; --c )
+                m_BarCellStart[c] = m_BarCellStart[c-1];
+            m_BarCellStart[0] = 0;
+        }
+    }
+
+    m_BarRectsUpToDate = true;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwMgr::CheckBarRects()
+{
+    if( !m_BarRectsUpToDate )
+        return; // everything will be recomputed
+
+    CBarRect Rect;
+    for( size_t i=0; i<m_Bars.size(); ++i )
+    {
+        const TwBar *Bar = m_Bars[i];
+        if( Bar==NULL )
+            continue;
+        if( Bar->m_Visible!=(Bar->m_RectIndex>=0) )
+        {
+            m_BarRectsUpToDate = false;
+            return;
+        }
+        if( Bar->m_RectIndex>=0 )
+        {
+            const CBarRect& Prev = m_BarRects[Bar->m_RectIndex];
+            GetBarRect(Bar, &Rect);
+            if( Rect.m_X0!=Prev.m_X0 || Rect.m_Y0!=Prev.m_Y0 || Rect.m_X1!=Prev.m_X1 || Rect.m_Y1!=Prev.m_Y1 )
+            {
+                m_BarRectsUpToDate = false;
+                return;
+            }
+        }
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwMgr::GetMouseTargets(int _X, int _Y, std::vector<TwBar*>& _Targets)
+{
+    UpdateBarRects();
+    _Targets.resize(0);
+
+    // the bar being dragged has the focus, it comes first
+    TwBar *BarDragging = NULL;
+    for( size_t i=0; i<m_MouseBars.size(); ++i )
+        if( m_MouseBars[i]->IsDragging() && (BarDragging==NULL || m_MouseBars[i]->m_RectIndex<BarDragging->m_RectIndex) )
+            BarDragging = m_MouseBars[i];
+    if( BarDragging!=NULL )
+        _Targets.push_back(BarDragging);
+
+    // then the bars under the mouse, top-most first
+    if( _X>=0 && _Y>=0 && _X/BAR_CELL_SIZE<m_BarCellsX && _Y/BAR_CELL_SIZE<m_BarCellsY )
+    {
+        int c = (_Y/BAR_CELL_SIZE)*m_BarCellsX + _X/BAR_CELL_SIZE;
+        for( int i=m_BarCellStart[c]; i<m_BarCellStart[c+1]; ++i )
+            if( InBarRect(m_BarRects[m_BarCells[i]], _X, _Y) && m_BarRects[m_BarCells[i]].m_Bar!=BarDragging )
+                _Targets.push_back(m_BarRects[m_BarCells[i]].m_Bar);
+    }
+    else    // outside the window
+        for( size_t r=0; r<m_BarRects.size(); ++r )
+            if( InBarRect(m_BarRects[r], _X, _Y) && m_BarRects[r].m_Bar!=BarDragging )
+                _Targets.push_back(m_BarRects[r].m_Bar);
+
+    // and the other bars which may still react to the event
+    size_t NbHit = _Targets.size();
+    for( size_t i=0; i<m_MouseBars.size(); ++i )
+        if( find(_Targets.begin(), _Targets.end(), m_MouseBars[i])==_Targets.end() )
+            _Targets.push_back(m_MouseBars[i]);
+    if( _Targets.size()>NbHit )
+    {
+        size_t First = (BarDragging!=NULL) ? 1 : 0;
+        for( size_t i=First+1; i<_Targets.size(); ++i )   // insertion sort by depth, there are only a few bars
+            for( size_t j=i; j>First && _Targets[j]->m_RectIndex<_Targets[j-1]->m_RectIndex; --j )
+                swap(_Targets[j], _Targets[j-1]);
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwMgr::MouseMotionNotHandled(const std::vector<TwBar*>& _Targets)
+{
+    UpdateBarRects();
+
+    // All the bars have been tried, the last one being the bottom-most. If it
+    // has been skipped, do what its MouseMotion would have done.
+    TwBar *Last = m_LowestOpenBars[0];
+    if( Last!=NULL && _Targets.size()>0 && Last==_Targets[0] && Last->IsDragging() && m_LowestOpenBars[1]!=NULL )
+        Last = m_LowestOpenBars[1];   // the bar with mousedrag enabled is tried first
+    if( Last!=NULL && find(_Targets.begin(), _Targets.end(), Last)==_Targets.end() )
+    {
+        for( size_t i=0; i<m_MouseBars.size(); ++i )    // the other bars have no handle or highlighted title
+        {
+            m_MouseBars[i]->m_DrawHandles = false;
+            m_MouseBars[i]->m_HighlightTitle = false;
+        }
+        SetCursor(m_CursorArrow);
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwMgr::MouseProcessed(TwBar *_Bar)
+{
+    if( !m_BarRectsUpToDate )
+        return; // everything will be recomputed
+    assert( _Bar->m_RectIndex>=0 && _Bar->m_RectIndex<(int)m_BarRects.size() );
+
+    // the bar may have been moved, resized or minimized
+    const CBarRect& Prev = m_BarRects[_Bar->m_RectIndex];
+    CBarRect Rect;
+    GetBarRect(_Bar, &Rect);
+    if( !_Bar->m_Visible || Rect.m_X0!=Prev.m_X0 || Rect.m_Y0!=Prev.m_Y0 || Rect.m_X1!=Prev.m_X1 || Rect.m_Y1!=Prev.m_Y1 )
+    {
+        m_BarRectsUpToDate = false;
+        return;
+    }
+
+    vector<TwBar*>::iterator it = find(m_MouseBars.begin(), m_MouseBars.end(), _Bar);
+    bool HasState = _Bar->HasMouseState();
+    if( HasState && it==m_MouseBars.end() )
+        m_MouseBars.push_back(_Bar);
+    else if( !HasState && it!=m_MouseBars.end() )
+        m_MouseBars.erase(it);
+}
+
+void CTwMgr::MouseStateSet(TwBar *_Bar)
+{
+    if( m_BarRectsUpToDate && _Bar->m_RectIndex>=0 && find(m_MouseBars.begin(), m_MouseBars.end(), _Bar)==m_MouseBars.end() )
+        m_MouseBars.push_back(_Bar);
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwMgr::SetFont(const CTexFont *_Font, bool _ResizeBars)
+{
+    assert(m_Graph!=NULL);
+    assert(_Font!=NULL);
+
+    m_CurrentFont = _Font;
+    m_BarRectsUpToDate = false;
+
+    for( int i=0; i<(int)m_Bars.size(); ++i )
+        if( m_Bars[i]!=NULL )
+        {
+            int fh = m_Bars[i]->m_Font->m_CharHeight;
             m_Bars[i]->m_Font = _Font;
             if( _ResizeBars )
             {
@@ -2681,7 +3380,9 @@ TwBar *ANT_CALL TwNewBar(const char *_Name)
         return NULL; // not initialized
     }
 
-    TwFreeAsyncDrawing(); // For multi-thread savety
+    // For multi-thread savety
+    if( !TwFreeAsyncDrawing() )
+        return NULL;
 
     if( _Name==NULL || strlen(_Name)<=0 )
     {
@@ -2709,6 +3410,7 @@ TwBar *ANT_CALL TwNewBar(const char *_Name)
     TwBar *Bar = new CTwBar(_Name);
     g_TwMgr->m_Bars.push_back(Bar);
     g_TwMgr->m_Order.push_back((int)g_TwMgr->m_Bars.size()-1);
+    g_TwMgr->BarRectsNotUpToDate();
     g_TwMgr->m_MinOccupied.push_back(false);
     g_TwMgr->m_HelpBarNotUpToDate = true;
 
@@ -2730,7 +3432,9 @@ int ANT_CALL TwDeleteBar(TwBar *_Bar)
         return 0;
     }
 
-    TwFreeAsyncDrawing(); // For multi-thread savety
+    // For multi-thread savety
+    if( !TwFreeAsyncDrawing() )
+        return 0;
 
     vector<TwBar*>::iterator BarIt;
     int i = 0;
@@ -2773,9 +3477,15 @@ int ANT_CALL TwDeleteBar(TwBar *_Bar)
     assert( BarOrderIt!=g_TwMgr->m_Order.end() );
     g_TwMgr->m_Order.erase(BarOrderIt);
 
+    // detach mailboxes
+    for( size_t k=0; k<g_TwMgr->m_Mailboxes.size(); ++k )
+        if( g_TwMgr->m_Mailboxes[k]->m_Bar==_Bar )
+            g_TwMgr->m_Mailboxes[k]->m_Bar = NULL;
+
     // erase & delete _Bar
     g_TwMgr->m_Bars.erase(BarIt);
     delete _Bar;
+    g_TwMgr->BarRectsNotUpToDate();
 
     g_TwMgr->m_HelpBarNotUpToDate = true;
     return 1;
@@ -2791,7 +3501,9 @@ int ANT_CALL TwDeleteAllBars()
         return 0; // not initialized
     }
 
-    TwFreeAsyncDrawing(); // For multi-thread savety
+    // For multi-thread savety
+    if( !TwFreeAsyncDrawing() )
+        return 0;
 
     int n = 0;
     for( size_t i=0; i<g_TwMgr->m_Bars.size(); ++i )
@@ -2804,6 +3516,7 @@ int ANT_CALL TwDeleteAllBars()
     g_TwMgr->m_Bars.clear();
     g_TwMgr->m_Order.clear();
     g_TwMgr->m_MinOccupied.clear();
+    g_TwMgr->BarRectsNotUpToDate();
     g_TwMgr->m_HelpBarNotUpToDate = true;
 
     if( n==0 )
@@ -2830,7 +3543,9 @@ int ANT_CALL TwSetTopBar(const TwBar *_Bar)
         return 0;
     }
 
-    TwFreeAsyncDrawing(); // For multi-thread savety
+    // For multi-thread savety
+    if( !TwFreeAsyncDrawing() )
+        return 0;
 
     if( _Bar!=g_TwMgr->m_PopupBar && g_TwMgr->m_BarAlwaysOnBottom.length()>0 )
     {
@@ -2855,6 +3570,7 @@ int ANT_CALL TwSetTopBar(const TwBar *_Bar)
     for( int j=iOrder; j<(int)g_TwMgr->m_Bars.size()-1; ++j )
         g_TwMgr->m_Order[j] = g_TwMgr->m_Order[j+1];
     g_TwMgr->m_Order[(int)g_TwMgr->m_Bars.size()-1] = i;
+    g_TwMgr->BarRectsNotUpToDate();
 
     if( _Bar!=g_TwMgr->m_PopupBar && g_TwMgr->m_BarAlwaysOnTop.length()>0 )
     {
@@ -2903,7 +3619,9 @@ int ANT_CALL TwSetBottomBar(const TwBar *_Bar)
         return 0;
     }
 
-    TwFreeAsyncDrawing(); // For multi-thread savety
+    // For multi-thread savety
+    if( !TwFreeAsyncDrawing() )
+        return 0;
 
     if( _Bar!=g_TwMgr->m_PopupBar && g_TwMgr->m_BarAlwaysOnTop.length()>0 )
     {
@@ -2929,6 +3647,7 @@ int ANT_CALL TwSetBottomBar(const TwBar *_Bar)
         for( int j=iOrder-1; j>=0; --j )
             g_TwMgr->m_Order[j+1] = g_TwMgr->m_Order[j];
     g_TwMgr->m_Order[0] = i;
+    g_TwMgr->BarRectsNotUpToDate();
 
     if( _Bar!=g_TwMgr->m_PopupBar && g_TwMgr->m_BarAlwaysOnBottom.length()>0 )
     {
@@ -2972,7 +3691,9 @@ int ANT_CALL TwSetBarState(TwBar *_Bar, TwState _State)
         return 0;
     }
 
-    TwFreeAsyncDrawing(); // For multi-thread savety
+    // For multi-thread savety
+    if( !TwFreeAsyncDrawing() )
+        return 0;
 
     switch( _State )
     {
@@ -3114,7 +3835,7 @@ int ANT_CALL TwRefreshBar(TwBar *bar)
         vector<TwBar*>::iterator BarIt;
         for( BarIt=g_TwMgr->m_Bars.begin(); BarIt!=g_TwMgr->m_Bars.end(); ++BarIt )
             if( *BarIt!=NULL )
-                (*BarIt)->NotUpToDate();
+                (*BarIt)->ValuesNotUpToDate();
     }
     else
     {
@@ -3129,14 +3850,135 @@ int ANT_CALL TwRefreshBar(TwBar *bar)
             return 0;
         }
 
-        bar->NotUpToDate();
+        bar->ValuesNotUpToDate();
+    }
+    return 1;
+}
+
+//  ---------------------------------------------------------------------------
+
+int ANT_CALL TwNotifyVarChanged(TwBar *bar, const char *varName)
+{
+    if( g_TwMgr==NULL )
+    {
+        TwGlobalError(g_ErrNotInit);
+        return 0;  // not initialized
+    }
+    if( bar==NULL || bar==TW_GLOBAL_BAR )
+    {
+        g_TwMgr->SetLastError(g_ErrBadParam);
+        return 0;
+    }
+
+    // For multi-thread savety
+    if( TwMustQueueEvent() )
+    {
+        CTwQueuedEvent *Ev = new CTwQueuedEvent(CTwQueuedEvent::NOTIFY_VAR);
+        Ev->m_Bar = bar;
+        if( varName!=NULL )
+            Ev->m_VarName = varName;
+        else
+            Ev->m_AllVars = true;
+        g_TwMgr->m_EventQueue.Push(Ev);
+        return 1;
+    }
+
+    if( varName!=NULL && bar->Find(varName)==NULL )
+    {
+        _snprintf(g_ErrParse, sizeof(g_ErrParse), "Unknown var '%s/%s'", bar->m_Name.c_str(), varName);
+        g_ErrParse[sizeof(g_ErrParse)-1] = '\0';
+        g_TwMgr->SetLastError(g_ErrParse);
+        return 0;
+    }
+
+    bar->NotUpToDate();
+    return 1;
+}
+
+//  ---------------------------------------------------------------------------
+
+TwMailbox *ANT_CALL TwNewMailbox(TwBar *bar, const char *varName)
+{
+    if( g_TwMgr==NULL )
+    {
+        TwGlobalError(g_ErrNotInit);
+        return NULL;  // not initialized
+    }
+    if( bar==NULL || bar==TW_GLOBAL_BAR || varName==NULL )
+    {
+        g_TwMgr->SetLastError(g_ErrBadParam);
+        return NULL;
+    }
+
+    // For multi-thread savety
+    if( !TwFreeAsyncDrawing() )
+        return NULL;
+
+    CTwVar *Var = bar->Find(varName);
+    if( Var==NULL )
+    {
+        _snprintf(g_ErrParse, sizeof(g_ErrParse), "Unknown var '%s/%s'", bar->m_Name.c_str(), varName);
+        g_ErrParse[sizeof(g_ErrParse)-1] = '\0';
+        g_TwMgr->SetLastError(g_ErrParse);
+        return NULL;
+    }
+
+    // only vars stored in a fixed number of bytes can be published
+    CTwVarAtom *Atom = Var->IsGroup() ? NULL : static_cast<CTwVarAtom *>(Var);
+    size_t Size = (Atom!=NULL) ? CTwVar::GetDataSize(Atom->m_Type) : 0;
+    if( Size==0 || Atom->m_Type==TW_TYPE_CDSTRING || Atom->m_Type==TW_TYPE_STDSTRING || Atom->m_Type==TW_TYPE_CDSTDSTRING 
+        || (Atom->m_SetCallback==NULL && Atom->m_Ptr==NULL) )
+    {
+        g_TwMgr->SetLastError(g_ErrBadType);
+        return NULL;
     }
+
+    CTwMailbox *Mailbox = new CTwMailbox(bar, varName, Size);
+    g_TwMgr->m_Mailboxes.push_back(Mailbox);
+    return Mailbox;
+}
+
+//  ---------------------------------------------------------------------------
+
+int ANT_CALL TwPublishVarValue(TwMailbox *mailbox, const void *value)
+{
+    // may be called from any thread: g_TwMgr is not accessed
+    if( mailbox==NULL || value==NULL )
+        return 0;
+
+    mailbox->Publish(value);
     return 1;
 }
 
 //  ---------------------------------------------------------------------------
 
-int BarVarHasAttrib(CTwBar *_Bar, CTwVar *_Var, const char *_Attrib, bool *_HasValue);
+int ANT_CALL TwDeleteMailbox(TwMailbox *mailbox)
+{
+    if( g_TwMgr==NULL )
+    {
+        TwGlobalError(g_ErrNotInit);
+        return 0;  // not initialized
+    }
+
+    // For multi-thread savety
+    if( !TwFreeAsyncDrawing() )
+        return 0;
+
+    for( vector<CTwMailbox *>::iterator it=g_TwMgr->m_Mailboxes.begin(); it!=g_TwMgr->m_Mailboxes.end(); ++it )
+        if( *it==mailbox )
+        {
+            g_TwMgr->m_Mailboxes.erase(it);
+            delete mailbox;
+            return 1;
+        }
+
+    g_TwMgr->SetLastError(g_ErrNotFound);
+    return 0;
+}
+
+//  ---------------------------------------------------------------------------
+
+int BarVarHasAttrib(CTwBar *_Bar, CTwVar *_Var, const char *_Attrib, int _Len, bool *_HasValue);
 int BarVarSetAttrib(CTwBar *_Bar, CTwVar *_Var, CTwVarGroup *_VarParent, int _VarIndex, int _AttribID, const char *_Value);
 ERetType BarVarGetAttrib(CTwBar *_Bar, CTwVar *_Var, CTwVarGroup *_VarParent, int _VarIndex, int _AttribID, std::vector<double>& outDouble, std::ostringstream& outString);
 
@@ -3193,7 +4035,7 @@ int ANT_CALL TwGetParam(TwBar *bar, const char *varName, const char *paramName,
     }
 
     bool hasValue = false;
-    int paramID = BarVarHasAttrib(bar, var, paramName, &hasValue);
+    int paramID = BarVarHasAttrib(bar, var, paramName, (int)strlen(paramName), &hasValue);
     if( paramID>0 )
     {
         std::ostringstream valStr;
@@ -3303,7 +4145,9 @@ int ANT_CALL TwSetParam(TwBar *bar, const char *varName, const char *paramName,
         return 0;
     }
 
-    TwFreeAsyncDrawing(); // For multi-thread savety
+    // For multi-thread savety
+    if( !TwFreeAsyncDrawing() )
+        return 0;
 
     if( bar==NULL ) 
         bar = TW_GLOBAL_BAR;
@@ -3337,7 +4181,7 @@ int ANT_CALL TwSetParam(TwBar *bar, const char *varName, const char *paramName,
     }
 
     bool hasValue = false;
-    int paramID = BarVarHasAttrib(bar, var, paramName, &hasValue);
+    int paramID = BarVarHasAttrib(bar, var, paramName, (int)strlen(paramName), &hasValue);
     if( paramID>0 )
     {
         int ret = 0;
@@ -3400,6 +4244,7 @@ int ANT_CALL TwSetParam(TwBar *bar, const char *varName, const char *paramName,
             g_ErrParse[sizeof(g_ErrParse)-1] = '\0';
             g_TwMgr->SetLastError(g_ErrParse);
         }
+        g_TwMgr->m_NeedsRedraw = true;
         return ret;
     } 
     else
@@ -3433,6 +4278,8 @@ CTwMgr::CStructProxy::~CStructProxy()
     }
     if( m_StructExtData!=NULL )
     {
+        if( m_CustomDrawCallback==CQuaternionExt::DrawCB )
+            CQuaternionExt::DeleteProjCache(m_StructExtData);
         //if( g_TwMgr!=NULL && m_Type>=TW_TYPE_STRUCT_BASE && m_Type<TW_TYPE_STRUCT_BASE+(int)g_TwMgr->m_Structs.size() )
         //  g_TwMgr->UninitVarData(m_Type, m_StructExtData, g_TwMgr->m_Structs[m_Type-TW_TYPE_STRUCT_BASE].m_Size);
         delete[] (char*)m_StructExtData;
@@ -3440,6 +4287,17 @@ CTwMgr::CStructProxy::~CStructProxy()
     memset(this, 0, sizeof(*this));
 }
 
+void CTwMgr::CStructProxy::GetStruct() const
+{
+    if( m_StructGetCallback==NULL || m_StructData==NULL )
+        return;
+    unsigned int Epoch = (g_TwMgr!=NULL) ? g_TwMgr->m_RefreshEpoch : 0;
+    if( Epoch!=0 && m_GetEpoch==Epoch )
+        return; // already fetched during this refresh
+    m_GetEpoch = Epoch;
+    m_StructGetCallback(m_StructData, m_StructClientData);
+}
+
 /*
 void CTwMgr::InitVarData(TwType _Type, void *_Data, size_t _Size)
 {
@@ -3592,8 +4450,7 @@ void ANT_CALL CTwMgr::CMemberProxy::GetCB(void *_Value, void *_ClientData)
                     CTwMgr::CStructMember& m = s.m_Members[mProxy->m_MemberIndex];
                     if( m.m_Size>0 && m.m_Type!=TW_TYPE_BUTTON )
                     {
-                        if( sProxy->m_StructGetCallback )
-                            sProxy->m_StructGetCallback(sProxy->m_StructData, sProxy->m_StructClientData);
+                        sProxy->GetStruct();
                         if( s.m_IsExt )
                         {
                             if( s.m_CopyVarToExtCallback && sProxy->m_StructExtData )
@@ -3683,7 +4540,77 @@ static int s_SeparatorTag = 0;
 
 //  ---------------------------------------------------------------------------
 
-static int AddVar(TwBar *_Bar, const char *_Name, ETwType _Type, void *_VarPtr, bool _ReadOnly, TwSetVarCallback _SetCallback, TwGetVarCallback _GetCallback, TwButtonCallback _ButtonCallback, void *_ClientData, const char *_Def)
+static int ParseDefine(const char *_Def, CTwBar *_Bar, CTwVar *_Var, CTwVarGroup *_VarParent, int _VarIndex);
+
+//  ---------------------------------------------------------------------------
+
+// Convert color and rotation types to the struct types created by TwInit
+static TwType ConvertVarType(TwType _Type)
+{
+    // Convert color types
+    if( _Type==TW_TYPE_COLOR32 )
+        return g_TwMgr->m_TypeColor32;
+    else if( _Type==TW_TYPE_COLOR3F )
+        return g_TwMgr->m_TypeColor3F;
+    else if( _Type==TW_TYPE_COLOR4F )
+        return g_TwMgr->m_TypeColor4F;
+
+    // Convert rotation types
+    if( _Type==TW_TYPE_QUAT4F )
+        return g_TwMgr->m_TypeQuat4F;
+    else if( _Type==TW_TYPE_QUAT4D )
+        return g_TwMgr->m_TypeQuat4D;
+    else if( _Type==TW_TYPE_DIR3F )
+        return g_TwMgr->m_TypeDir3F;
+    else if( _Type==TW_TYPE_DIR3D )
+        return g_TwMgr->m_TypeDir3D;
+
+    return _Type;
+}
+
+static inline bool IsAtomVarType(TwType _Type)
+{
+    return     (_Type>TW_TYPE_UNDEF && _Type<TW_TYPE_STRUCT_BASE)
+            || (_Type>=TW_TYPE_ENUM_BASE && _Type<TW_TYPE_ENUM_BASE+(int)g_TwMgr->m_Enums.size()) 
+            || (_Type>TW_TYPE_CSSTRING_BASE && _Type<=TW_TYPE_CSSTRING_MAX)
+            || _Type==TW_TYPE_CDSTDSTRING 
+            || (_Type>=TW_TYPE_CUSTOM_BASE && _Type<TW_TYPE_CUSTOM_BASE+(int)g_TwMgr->m_Customs.size());
+}
+
+static inline bool IsStructVarType(TwType _Type)
+{
+    return _Type>=TW_TYPE_STRUCT_BASE && _Type<TW_TYPE_STRUCT_BASE+(TwType)g_TwMgr->m_Structs.size();
+}
+
+// State of a TwAddVarsBatch call. The names of the vars have been checked
+// before, and the bar is invalidated once all the vars have been added.
+struct CAddVarBatch
+{
+    std::vector<const CTwVar *> m_Added;    // atoms added
+    int                         m_DefRes;   // 0 if a def string has an error
+};
+
+// Apply the def string of the var _Name. In a batch, the var is accessed
+// directly and the bar is not invalidated.
+static int DefineVar(CTwBar *_Bar, const string& _Name, const string& _Def, CAddVarBatch *_Batch)
+{
+    if( _Batch==NULL )
+        return TwDefine(('`' + _Bar->m_Name + "`/`" + _Name + "` " + _Def).c_str());
+
+    CTwVarGroup *Parent = NULL;
+    int Index = -1;
+    CTwVar *Var = _Bar->Find(_Name.c_str(), &Parent, &Index);
+    if( Var==NULL )
+    {
+        g_TwMgr->SetLastError(g_ErrNotFound);
+        return 0;
+    }
+    return ParseDefine(_Def.c_str(), _Bar, Var, Parent, Index);
+}
+
+//  ---------------------------------------------------------------------------
+
+static int AddVar(TwBar *_Bar, const char *_Name, ETwType _Type, void *_VarPtr, bool _ReadOnly, TwSetVarCallback _SetCallback, TwGetVarCallback _GetCallback, TwButtonCallback _ButtonCallback, void *_ClientData, const char *_Def, CAddVarBatch *_Batch=NULL)
 {
     CTwFPU fpu; // force fpu precision
 
@@ -3693,6 +4620,10 @@ static int AddVar(TwBar *_Bar, const char *_Name, ETwType _Type, void *_VarPtr,
         return 0; // not initialized
     }
 
+    // For multi-thread savety
+    if( !TwOnRenderThread() )
+        return 0;
+
     char unnamedVarName[64];
     if( _Name==NULL || strlen(_Name)==0 ) // create a name automatically
     {
@@ -3707,7 +4638,7 @@ static int AddVar(TwBar *_Bar, const char *_Name, ETwType _Type, void *_VarPtr,
         g_TwMgr->SetLastError(g_ErrBadParam);
         return 0;
     }
-    if( _Bar->Find(_Name)!=NULL )
+    if( _Batch==NULL && _Bar->Find(_Name)!=NULL )  // names of a batch have already been checked
     {
         g_TwMgr->SetLastError(g_ErrExist);
         return 0;
@@ -3722,23 +4653,7 @@ static int AddVar(TwBar *_Bar, const char *_Name, ETwType _Type, void *_VarPtr,
     if( _VarPtr==NULL && _Type!=TW_TYPE_BUTTON && _GetCallback!=NULL && _SetCallback==NULL )
         _ReadOnly = true;   // force readonly in this case
 
-    // Convert color types
-    if( _Type==TW_TYPE_COLOR32 )
-        _Type = g_TwMgr->m_TypeColor32;
-    else if( _Type==TW_TYPE_COLOR3F )
-        _Type = g_TwMgr->m_TypeColor3F;
-    else if( _Type==TW_TYPE_COLOR4F )
-        _Type = g_TwMgr->m_TypeColor4F;
-
-    // Convert rotation types
-    if( _Type==TW_TYPE_QUAT4F )
-        _Type = g_TwMgr->m_TypeQuat4F;
-    else if( _Type==TW_TYPE_QUAT4D )
-        _Type = g_TwMgr->m_TypeQuat4D;
-    else if( _Type==TW_TYPE_DIR3F )
-        _Type = g_TwMgr->m_TypeDir3F;
-    else if( _Type==TW_TYPE_DIR3D )
-        _Type = g_TwMgr->m_TypeDir3D;
+    _Type = ConvertVarType(_Type);
 
     // VC++ uses a different definition of std::string in Debug and Release modes.
     // sizeof(std::string) is encoded in TW_TYPE_STDSTRING to overcome this issue.
@@ -3773,13 +4688,9 @@ static int AddVar(TwBar *_Bar, const char *_Name, ETwType _Type, void *_VarPtr,
             SetCB = NULL;
         if( _VarPtr==NULL && _GetCallback==NULL )
             GetCB = NULL;
-        return AddVar(_Bar, _Name, TW_TYPE_CDSTDSTRING, NULL, _ReadOnly, SetCB, GetCB, NULL, &CDStdString, _Def);
+        return AddVar(_Bar, _Name, TW_TYPE_CDSTDSTRING, NULL, _ReadOnly, SetCB, GetCB, NULL, &CDStdString, _Def, _Batch);
     }
-    else if(    (_Type>TW_TYPE_UNDEF && _Type<TW_TYPE_STRUCT_BASE)
-             || (_Type>=TW_TYPE_ENUM_BASE && _Type<TW_TYPE_ENUM_BASE+(int)g_TwMgr->m_Enums.size()) 
-             || (_Type>TW_TYPE_CSSTRING_BASE && _Type<=TW_TYPE_CSSTRING_MAX)
-             || _Type==TW_TYPE_CDSTDSTRING 
-             || (_Type>=TW_TYPE_CUSTOM_BASE && _Type<TW_TYPE_CUSTOM_BASE+(int)g_TwMgr->m_Customs.size()) )
+    else if( IsAtomVarType(_Type) )
     {
         CTwVarAtom *Var = new CTwVarAtom;
         Var->m_Name = _Name;
@@ -3829,18 +4740,23 @@ static int AddVar(TwBar *_Bar, const char *_Name, ETwType _Type, void *_VarPtr,
         }
 
         _Bar->m_VarRoot.m_Vars.push_back(Var);
+        _Bar->IndexVar(Var, &(_Bar->m_VarRoot), (int)_Bar->m_VarRoot.m_Vars.size()-1);
+        if( _Batch!=NULL )
+        {
+            _Batch->m_Added.push_back(Var);
+            if( _Def!=NULL && strlen(_Def)>0 && !ParseDefine(_Def, _Bar, Var, &(_Bar->m_VarRoot), (int)_Bar->m_VarRoot.m_Vars.size()-1) )
+                _Batch->m_DefRes = 0;   // the var is kept, as with TwAddVarRW
+            return 1;
+        }
         _Bar->NotUpToDate();
         g_TwMgr->m_HelpBarNotUpToDate = true;
 
         if( _Def!=NULL && strlen(_Def)>0 )
-        {
-            string d = '`' + _Bar->m_Name + "`/`" + _Name + "` " + _Def;
-            return TwDefine(d.c_str());
-        }
+            return ParseDefine(_Def, _Bar, Var, &(_Bar->m_VarRoot), (int)_Bar->m_VarRoot.m_Vars.size()-1);
         else
             return 1;
     }
-    else if(_Type>=TW_TYPE_STRUCT_BASE && _Type<TW_TYPE_STRUCT_BASE+(TwType)g_TwMgr->m_Structs.size())
+    else if( IsStructVarType(_Type) )
     {
         CTwMgr::CStruct& s = g_TwMgr->m_Structs[_Type-TW_TYPE_STRUCT_BASE];
         CTwMgr::CStructProxy *sProxy = NULL;
@@ -3926,7 +4842,7 @@ static int AddVar(TwBar *_Bar, const char *_Name, ETwType _Type, void *_VarPtr,
             string def  = "label=`" + m.m_Name + "` group=`" + _Name + "` " + access; // + m.m_DefString;  // member def must be done after group def
             if( _VarPtr!=NULL )
             {
-                if( TwAddVarRW(_Bar, name.c_str(), m.m_Type, (char*)vPtr+m.m_Offset, def.c_str())==0 )
+                if( AddVar(_Bar, name.c_str(), m.m_Type, (char*)vPtr+m.m_Offset, false, NULL, NULL, NULL, NULL, def.c_str(), _Batch)==0 )
                     return 0;
             }
             else
@@ -3938,7 +4854,7 @@ static int AddVar(TwBar *_Bar, const char *_Name, ETwType _Type, void *_VarPtr,
                 mProxy.m_StructProxy = sProxy;
                 mProxy.m_MemberIndex = i;
                 assert( !(s.m_IsExt && (m.m_Type==TW_TYPE_STDSTRING || m.m_Type==TW_TYPE_CDSTDSTRING)) );   // forbidden because this case is not handled by UnrollCDStdString
-                if( TwAddVarCB(_Bar, name.c_str(), m.m_Type, CTwMgr::CMemberProxy::SetCB, CTwMgr::CMemberProxy::GetCB, &mProxy, def.c_str())==0 )
+                if( AddVar(_Bar, name.c_str(), m.m_Type, NULL, false, CTwMgr::CMemberProxy::SetCB, CTwMgr::CMemberProxy::GetCB, NULL, &mProxy, def.c_str(), _Batch)==0 )
                     return 0;
                 mProxy.m_Var = _Bar->Find(name.c_str(), &mProxy.m_VarParent, NULL);
                 mProxy.m_Bar = _Bar;
@@ -3954,20 +4870,25 @@ static int AddVar(TwBar *_Bar, const char *_Name, ETwType _Type, void *_VarPtr,
         }
         char structInfo[64];
         sprintf(structInfo, "typeid=%d valptr=%p close ", _Type, vPtr);
-        string grpDef = '`' + _Bar->m_Name + "`/`" + _Name + "` " + structInfo;
+        string grpDef = structInfo;
         if( _Def!=NULL && strlen(_Def)>0 )
             grpDef += _Def;
-        int ret = TwDefine(grpDef.c_str());
+        int ret = DefineVar(_Bar, _Name, grpDef, _Batch);
         for( int i=0; i<(int)s.m_Members.size(); ++i ) // members must be defined even if grpDef has error
         {
             CTwMgr::CStructMember& m = s.m_Members[i];
             if( m.m_DefString.length()>0 )
             {
-                string memberDef = '`' + _Bar->m_Name + "`/`" + _Name + '.' + m.m_Name + "` " + m.m_DefString;
-                if( !TwDefine(memberDef.c_str()) ) // all members must be defined even if memberDef has error
+                if( !DefineVar(_Bar, string(_Name) + '.' + m.m_Name, m.m_DefString, _Batch) ) // all members must be defined even if memberDef has error
                     ret = 0;
             }
         }
+        if( _Batch!=NULL )
+        {
+            if( !ret )
+                _Batch->m_DefRes = 0;
+            return 1;
+        }
         return ret;
     }
     else
@@ -4017,6 +4938,161 @@ int ANT_CALL TwAddSeparator(TwBar *_Bar, const char *_Name, const char *_Def)
 
 //  ---------------------------------------------------------------------------
 
+// Returns the error to report if a var of type _Type cannot be added, NULL
+// otherwise. Same checks as AddVar, without registering the std::string size.
+static const char *CheckVarType(TwType _Type)
+{
+    if( (_Type&0xffff0000)==(TW_TYPE_STDSTRING&0xffff0000) )
+    {
+        size_t clientStdStringStructSize = (_Type&0xffff);
+        size_t stdStringStructSize = g_TwMgr->m_ClientStdStringStructSize;
+        if( stdStringStructSize==0 )
+            stdStringStructSize = clientStdStringStructSize;
+        int diff = abs((int)stdStringStructSize - (int)sizeof(std::string));
+        if( stdStringStructSize!=clientStdStringStructSize || stdStringStructSize==0 || (diff!=0 && diff!=sizeof(void*)) )
+            return g_ErrStdString;
+        return NULL;
+    }
+    if( _Type==TW_TYPE_STDSTRING || IsAtomVarType(_Type) || IsStructVarType(_Type) )
+        return NULL;
+    return ( _Type==TW_TYPE_CSSTRING_BASE ) ? g_ErrBadSize : g_ErrNotFound;
+}
+
+// Check that _Name and the names of the members created for it if _Type is a
+// struct are not used by _Bar, and collect them in _Names to check the batch
+// for duplicates (member names are stored in _MemberNames).
+typedef pair<unsigned int, const char *> CBatchName;   // hash and name
+
+static bool CheckBatchVarName(TwBar *_Bar, const char *_Name, TwType _Type, vector<CBatchName>& _Names, list<string>& _MemberNames)
+{
+    if( _Bar->Find(_Name)!=NULL )
+        return false;
+    unsigned int Hash = 2166136261u;    // FNV-1a
+    for( const char *c=_Name; *c!='\0'; ++c )
+        Hash = (Hash ^ (unsigned char)*c) * 16777619u;
+    _Names.push_back(CBatchName(Hash, _Name));
+    if( IsStructVarType(_Type) )
+    {
+        const CTwMgr::CStruct& s = g_TwMgr->m_Structs[_Type-TW_TYPE_STRUCT_BASE];
+        for( size_t i=0; i<s.m_Members.size(); ++i )
+        {
+            _MemberNames.push_back(string(_Name) + '.' + s.m_Members[i].m_Name);
+            if( !CheckBatchVarName(_Bar, _MemberNames.back().c_str(), ConvertVarType(s.m_Members[i].m_Type), _Names, _MemberNames) )
+                return false;
+        }
+    }
+    return true;
+}
+
+// Returns true if _Names contains the same name twice
+static bool HasDuplicateName(vector<CBatchName>& _Names)
+{
+    sort(_Names.begin(), _Names.end());   // by hash, names are compared only if their hashes are equal
+    for( size_t i=1; i<_Names.size(); ++i )
+        for( size_t j=i; j>0 && _Names[j-1].first==_Names[i].first; --j )
+            if( strcmp(_Names[j-1].second, _Names[i].second)==0 )
+                return true;
+    return false;
+}
+
+int ANT_CALL TwAddVarsBatch(TwBar *_Bar, const TwVarDesc *_Vars, unsigned int _NbVars)
+{
+    CTwFPU fpu; // force fpu precision
+
+    if( g_TwMgr==NULL )
+    {
+        TwGlobalError(g_ErrNotInit);
+        return 0; // not initialized
+    }
+    if( _Bar==NULL || (_Vars==NULL && _NbVars>0) )
+    {
+        g_TwMgr->SetLastError(g_ErrBadParam);
+        return 0;
+    }
+
+    // For multi-thread savety
+    if( !TwOnRenderThread() )
+        return 0;
+
+    // validate all the vars and the names of their members before adding anything
+    vector<CBatchName> Names;
+    list<string> MemberNames;
+    Names.reserve(_NbVars);
+    for( unsigned int i=0; i<_NbVars; ++i )
+    {
+        const TwVarDesc& d = _Vars[i];
+        TwType Type = TW_TYPE_BUTTON;
+        if( d.ButtonCallback==NULL )
+        {
+            if( d.Var==NULL && d.GetCallback==NULL )
+            {
+                g_TwMgr->SetLastError(g_ErrBadParam);
+                return 0;
+            }
+            Type = ConvertVarType(d.Type);
+            const char *Err = CheckVarType(Type);
+            if( Err!=NULL )
+            {
+                g_TwMgr->SetLastError(Err);
+                return 0;
+            }
+        }
+        if( d.Name==NULL || strlen(d.Name)==0 )
+            continue;   // a name will be created automatically
+        if( strstr(d.Name, "`")!=NULL )
+        {
+            g_TwMgr->SetLastError(g_ErrNoBackQuote);
+            return 0;
+        }
+        if( !CheckBatchVarName(_Bar, d.Name, Type, Names, MemberNames) )
+        {
+            g_TwMgr->SetLastError(g_ErrExist);
+            return 0;
+        }
+    }
+    if( HasDuplicateName(Names) )
+    {
+        g_TwMgr->SetLastError(g_ErrExist);
+        return 0;
+    }
+
+    // add the vars and apply their defs; the bar is invalidated once at the end
+    CAddVarBatch Batch;
+    Batch.m_Added.reserve(_NbVars);
+    Batch.m_DefRes = 1;
+    size_t NbStructProxies = g_TwMgr->m_StructProxies.size();
+    size_t NbMemberProxies = g_TwMgr->m_MemberProxies.size();
+    for( unsigned int i=0; i<_NbVars; ++i )
+    {
+        const TwVarDesc& d = _Vars[i];
+        int Res;
+        if( d.ButtonCallback!=NULL )
+            Res = AddVar(_Bar, d.Name, TW_TYPE_BUTTON, NULL, false, NULL, NULL, d.ButtonCallback, d.ClientData, d.DefString, &Batch);
+        else
+            Res = AddVar(_Bar, d.Name, d.Type, d.Var, d.ReadOnly!=0, (d.Var==NULL) ? d.SetCallback : NULL, (d.Var==NULL) ? d.GetCallback : NULL, NULL, (d.Var==NULL) ? d.ClientData : NULL, d.DefString, &Batch);
+        if( Res==0 )
+        {
+            // error not detected by the validation (eg. a back quote in a struct
+            // member name): remove the atoms added, the groups created for them
+            // and the proxies of the struct vars
+            for( int j=(int)Batch.m_Added.size()-1; j>=0; --j )
+                _Bar->RemoveVar(Batch.m_Added[j]);
+            while( g_TwMgr->m_MemberProxies.size()>NbMemberProxies )
+                g_TwMgr->m_MemberProxies.pop_back();
+            while( g_TwMgr->m_StructProxies.size()>NbStructProxies )
+                g_TwMgr->m_StructProxies.pop_back();
+            return 0;
+        }
+    }
+
+    _Bar->NotUpToDate();
+    g_TwMgr->m_NeedsRedraw = true;
+    g_TwMgr->m_HelpBarNotUpToDate = true;
+    return Batch.m_DefRes;
+}
+
+//  ---------------------------------------------------------------------------
+
 int ANT_CALL TwRemoveVar(TwBar *_Bar, const char *_Name)
 {
     if( g_TwMgr==NULL )
@@ -4030,6 +5106,10 @@ int ANT_CALL TwRemoveVar(TwBar *_Bar, const char *_Name)
         return 0;
     }
 
+    // For multi-thread savety
+    if( !TwOnRenderThread() )
+        return 0;
+
     if( g_TwMgr->m_PopupBar!=NULL && _Bar!=g_TwMgr->m_PopupBar )    // delete popup bar first if it exists
     {
         TwDeleteBar(g_TwMgr->m_PopupBar);
@@ -4049,8 +5129,10 @@ int ANT_CALL TwRemoveVar(TwBar *_Bar, const char *_Name)
             return 0;
         }
 
+        _Bar->UnindexVar(Var);
         delete Var;
         Parent->m_Vars.erase(Parent->m_Vars.begin()+Index);
+        _Bar->ReindexVars(Parent, Index);
         if( Parent!=&(_Bar->m_VarRoot) && Parent->m_Vars.size()<=0 )
             TwRemoveVar(_Bar, Parent->m_Name.c_str());
         _Bar->NotUpToDate();
@@ -4078,6 +5160,10 @@ int ANT_CALL TwRemoveAllVars(TwBar *_Bar)
         return 0;
     }
 
+    // For multi-thread savety
+    if( !TwOnRenderThread() )
+        return 0;
+
     if( g_TwMgr->m_PopupBar!=NULL && _Bar!=g_TwMgr->m_PopupBar && _Bar!=g_TwMgr->m_HelpBar )    // delete popup bar first if it exists
     {
         TwDeleteBar(g_TwMgr->m_PopupBar);
@@ -4093,6 +5179,7 @@ int ANT_CALL TwRemoveAllVars(TwBar *_Bar)
             *it = NULL;
         }
     _Bar->m_VarRoot.m_Vars.resize(0);
+    _Bar->InvalidateVarIndex();
     _Bar->NotUpToDate();
     g_TwMgr->m_HelpBarNotUpToDate = true;
     return 1;
@@ -4100,15 +5187,22 @@ int ANT_CALL TwRemoveAllVars(TwBar *_Bar)
 
 //  ---------------------------------------------------------------------------
 
-int ParseToken(string& _Token, const char *_Def, int& Line, int& Column, bool _KeepQuotes, bool _EndCR, char _Sep1='\0', char _Sep2='\0')
+// The token is returned as a view (_Token, _TokenLen) of _Def, except if
+// quotes have to be removed: it is then copied to _Buffer by runs of
+// characters and the view points to _Buffer.
+int ParseToken(const char *& _Token, int& _TokenLen, string& _Buffer, const char *_Def, int& Line, int& Column, bool _KeepQuotes, bool _EndCR, char _Sep1='\0', char _Sep2='\0')
 {
     const char *Cur = _Def;
-    _Token = "";
+    _Token = _Def;
+    _TokenLen = 0;
     // skip spaces
     while( *Cur==' ' || *Cur=='\t' || *Cur=='\r' || *Cur=='\n' )
     {
         if( *Cur=='\n' && _EndCR )
+        {
+            _Token = Cur;
             return (int)(Cur-_Def); // a CR has been found
+        }
         ++Cur;
         if( *Cur=='\n' )
         {
@@ -4122,31 +5216,38 @@ int ParseToken(string& _Token, const char *_Def, int& Line, int& Column, bool _K
     }
     // read token
     int QuoteLine=0, QuoteColumn=0;
-    const char *QuoteCur;
     char Quote = 0;
-    bool AddChar;
+    bool SkipChar;
     bool LineJustIncremented = false;
+    bool Copied = false;
+    const char *Start = Cur;
+    const char *Run = Cur;  // first char not copied to _Buffer yet
     while(    (Quote==0 && (*Cur!='\0' && *Cur!=' ' && *Cur!='\t' && *Cur!='\r' && *Cur!='\n' && *Cur!=_Sep1 && *Cur!=_Sep2))
            || (Quote!=0 && (*Cur!='\0' /* && *Cur!='\r' && *Cur!='\n' */)) ) // allow multi-line strings
     {
         LineJustIncremented = false;
-        AddChar = true;
+        SkipChar = false;
         if( Quote==0 && (*Cur=='\'' || *Cur=='\"' || *Cur=='`') )
         {
             Quote = *Cur;
             QuoteLine = Line;
             QuoteColumn = Column;
-            QuoteCur = Cur;
-            AddChar = _KeepQuotes;
+            SkipChar = !_KeepQuotes;
         }
         else if ( Quote!=0 && *Cur==Quote )
         {
             Quote = 0;
-            AddChar = _KeepQuotes;
+            SkipChar = !_KeepQuotes;
         }
 
-        if( AddChar )
-            _Token += *Cur;
+        if( SkipChar )
+        {
+            if( !Copied )
+                _Buffer.resize(0);
+            Copied = true;
+            _Buffer.append(Run, Cur-Run);
+            Run = Cur+1;
+        }
         ++Cur;
         if( *Cur=='\t' )
             Column += g_TabLength;
@@ -4168,6 +5269,17 @@ int ParseToken(string& _Token, const char *_Def, int& Line, int& Column, bool _K
     }
     else
     {
+        if( Copied )
+        {
+            _Buffer.append(Run, Cur-Run);
+            _Token = _Buffer.c_str();
+            _TokenLen = (int)_Buffer.size();
+        }
+        else
+        {
+            _Token = Start;
+            _TokenLen = (int)(Cur-Start);
+        }
         if( *Cur=='\n' )
         {
             if( !LineJustIncremented )
@@ -4184,31 +5296,48 @@ int ParseToken(string& _Token, const char *_Def, int& Line, int& Column, bool _K
 
 //  ---------------------------------------------------------------------------
 
-int GetBarVarFromString(CTwBar **_Bar, CTwVar **_Var, CTwVarGroup **_VarParent, int *_VarIndex, const char *_Str)
-{
-    *_Bar = NULL;
-    *_Var = NULL;
-    *_VarParent = NULL;
-    *_VarIndex = -1;
-    vector<string> Names;
-    string Token;
-    const char *Cur =_Str;
+// Split a "bar/var" name. Returns the number of names read (1 or 2), or 0 if
+// the name cannot be parsed. _Str[_Len] must be a space, a separator or '\0'
+// (_Str may be a token of a def string).
+static int SplitBarVarName(const char *_Str, int _Len, string& _BarName, string& _VarName)
+{
+    string Buffer;
+    string Extra;
+    string *Names[3] = { &_BarName, &_VarName, &Extra };
+    int NbNames = 0;
+    const char *Cur = _Str;
+    const char *End = _Str + _Len;
+    const char *Token;
+    int TokenLen;
     int l=1, c=1, p=1;
-    while( *Cur!='\0' && p>0 && Names.size()<=3 )
+    while( Cur<End && p>0 && NbNames<3 )
     {
-        p = ParseToken(Token, Cur, l, c, false, true, '/', '\\');
-        if( p>0 && Token.size()>0 )
+        p = ParseToken(Token, TokenLen, Buffer, Cur, l, c, false, true, '/', '\\');
+        if( p>0 && TokenLen>0 )
         {
-            Names.push_back(Token);
+            Names[NbNames]->assign(Token, TokenLen);
+            ++NbNames;
             Cur += p + ((Cur[p]!='\0')?1:0);
         }
+        else if( p>0 )
+            p = 0;  // empty name
     }
-    if( p<=0 || (Names.size()!=1 && Names.size()!=2) )
+    if( p<=0 || (NbNames!=1 && NbNames!=2) )
         return 0;   // parse error
-    int BarIdx = g_TwMgr->FindBar(Names[0].c_str());
+    return NbNames;
+}
+
+// Find the bar and var named _BarName/_VarName (_VarName may be NULL).
+static int FindBarVar(CTwBar **_Bar, CTwVar **_Var, CTwVarGroup **_VarParent, int *_VarIndex, const char *_BarName, const char *_VarName)
+{
+    *_Bar = NULL;
+    *_Var = NULL;
+    *_VarParent = NULL;
+    *_VarIndex = -1;
+    int BarIdx = g_TwMgr->FindBar(_BarName);
     if( BarIdx<0 )
     {
-        if( Names.size()==1 && strcmp(Names[0].c_str(), "GLOBAL")==0 )
+        if( _VarName==NULL && strcmp(_BarName, "GLOBAL")==0 )
         {
             *_Bar = TW_GLOBAL_BAR;
             return +3;  // 'GLOBAL' found
@@ -4217,28 +5346,41 @@ int GetBarVarFromString(CTwBar **_Bar, CTwVar **_Var, CTwVarGroup **_VarParent,
             return -1;  // bar not found
     }
     *_Bar = g_TwMgr->m_Bars[BarIdx];
-    if( Names.size()==1 )
+    if( _VarName==NULL )
         return 1;   // bar found, no var name parsed
-    *_Var = (*_Bar)->Find(Names[1].c_str(), _VarParent, _VarIndex);
+    *_Var = (*_Bar)->Find(_VarName, _VarParent, _VarIndex);
     if( *_Var==NULL )
         return -2;  // var not found
     return 2;       // bar and var found
 }
 
+int GetBarVarFromString(CTwBar **_Bar, CTwVar **_Var, CTwVarGroup **_VarParent, int *_VarIndex, const char *_Str)
+{
+    *_Bar = NULL;
+    *_Var = NULL;
+    *_VarParent = NULL;
+    *_VarIndex = -1;
+    string BarName, VarName;
+    int NbNames = SplitBarVarName(_Str, (int)strlen(_Str), BarName, VarName);
+    if( NbNames==0 )
+        return 0;   // parse error
+    return FindBarVar(_Bar, _Var, _VarParent, _VarIndex, BarName.c_str(), (NbNames==2) ? VarName.c_str() : NULL);
+}
+
 
-int BarVarHasAttrib(CTwBar *_Bar, CTwVar *_Var, const char *_Attrib, bool *_HasValue)
+int BarVarHasAttrib(CTwBar *_Bar, CTwVar *_Var, const char *_Attrib, int _Len, bool *_HasValue)
 {
-    assert(_Bar!=NULL && _HasValue!=NULL && _Attrib!=NULL && strlen(_Attrib)>0);
+    assert(_Bar!=NULL && _HasValue!=NULL && _Attrib!=NULL && _Len>0);
     *_HasValue = false;
     if( _Bar==TW_GLOBAL_BAR )
     {
         assert( _Var==NULL );
-        return g_TwMgr->HasAttrib(_Attrib, _HasValue);
+        return g_TwMgr->HasAttrib(_Attrib, _Len, _HasValue);
     }
     else if( _Var==NULL )
-        return _Bar->HasAttrib(_Attrib, _HasValue);
+        return _Bar->HasAttrib(_Attrib, _Len, _HasValue);
     else
-        return _Var->HasAttrib(_Attrib, _HasValue);
+        return _Var->HasAttrib(_Attrib, _Len, _HasValue);
 }
 
 
@@ -4300,80 +5442,119 @@ static inline std::string ErrorPosition(bool _MultiLine, int _Line, int _Column)
 
 //  ---------------------------------------------------------------------------
 
-int ANT_CALL TwDefine(const char *_Def)
+static int DefineNameError(int _Err, bool _MultiLine, int _Line, int _Column, const char *_Name, int _NameLen)
 {
-    CTwFPU fpu; // force fpu precision
+    if( _Err==-1 )
+        _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string: Bar not found%s [%-16.*s...]", ErrorPosition(_MultiLine, _Line, _Column).c_str(), _NameLen, _Name);
+    else if( _Err==-2 )
+        _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string: Variable not found%s [%-16.*s...]", ErrorPosition(_MultiLine, _Line, _Column).c_str(), _NameLen, _Name);
+    else
+        _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string%s [%-16.*s...]", ErrorPosition(_MultiLine, _Line, _Column).c_str(), _NameLen, _Name);
+    g_ErrParse[sizeof(g_ErrParse)-1] = '\0';
+    g_TwMgr->SetLastError(g_ErrParse);
+    return 0;
+}
 
-    if( g_TwMgr==NULL )
-    {
-        TwGlobalError(g_ErrNotInit);
-        return 0; // not initialized
-    }
-    if( _Def==NULL )
+static int DefineAttribError(const char *_Msg, bool _MultiLine, int _Line, int _Column, const char *_Attrib, int _AttribLen)
+{
+    _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string%s%s [%-16.*s...]", _Msg, ErrorPosition(_MultiLine, _Line, _Column).c_str(), _AttribLen, _Attrib);
+    g_ErrParse[sizeof(g_ErrParse)-1] = '\0';
+    g_TwMgr->SetLastError(g_ErrParse);
+    return 0;
+}
+
+static int DefineSetAttrib(CTwBar *_Bar, CTwVar *_Var, CTwVarGroup *_VarParent, int _VarIndex, int _AttribID, const char *_Value, bool _MultiLine, int _Line, int _Column, const char *_Attrib, int _AttribLen)
+{
+    const char *PrevLastErrorPtr = g_TwMgr->CheckLastError();
+    if( BarVarSetAttrib(_Bar, _Var, _VarParent, _VarIndex, _AttribID, _Value)==0 )
     {
-        g_TwMgr->SetLastError(g_ErrBadParam);
+        if( g_TwMgr->CheckLastError()==NULL || strlen(g_TwMgr->CheckLastError())<=0 || g_TwMgr->CheckLastError()==PrevLastErrorPtr )
+            _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string: wrong attribute value%s [%-16.*s...]", ErrorPosition(_MultiLine, _Line, _Column).c_str(), _AttribLen, _Attrib);
+        else
+            _snprintf(g_ErrParse, sizeof(g_ErrParse), "%s%s [%-16.*s...]", g_TwMgr->CheckLastError(), ErrorPosition(_MultiLine, _Line, _Column).c_str(), _AttribLen, _Attrib);
+        g_ErrParse[sizeof(g_ErrParse)-1] = '\0';
+        g_TwMgr->SetLastError(g_ErrParse);
         return 0;
     }
+    return 1;
+}
 
-    bool MultiLine = false;
-    const char *Cur = _Def;
-    while( *Cur!='\0' )
+// Attributes that may be used without value when followed by a space
+static inline bool IsValueOptional(const char *_Attrib, int _Len)
+{
+    return CTwAttribTable::SameName("readonly", _Attrib, _Len) || CTwAttribTable::SameName("hexa", _Attrib, _Len);
+}
+
+// Skip spaces after an attribute or its value. Returns true if the end of the
+// line has been reached (_Sep is the separator that ended the last token).
+static inline bool DefineEndOfLine(const char *& _Cur, char _Sep, int& _Line, int& _Column)
+{
+    while( *_Cur==' ' || *_Cur=='\t' || *_Cur=='\r' )
     {
-        if( *Cur=='\n' )
-        {
-            MultiLine = true;
-            break;
-        }
-        ++Cur;
+        ++_Cur;
+        if( *_Cur=='\t' )
+            _Column += g_TabLength;
+        else if( *_Cur!='\r' )
+            ++_Column;
+    }
+    if( *_Cur=='\n' )   // new line detected
+    {
+        ++_Line;
+        _Column = 1;
+        return true;
     }
+    return ( _Sep=='\n' ); // new line already read by ParseToken
+}
+
+//  ---------------------------------------------------------------------------
 
+// Parse a def string. If _Bar is not NULL, parsing starts directly with the
+// attributes of _Bar/_Var (the def string does not begin with a bar/var name).
+static int ParseDefine(const char *_Def, CTwBar *_Bar, CTwVar *_Var, CTwVarGroup *_VarParent, int _VarIndex)
+{
+    bool MultiLine = ( strchr(_Def, '\n')!=NULL );
     int Line = 1;
     int Column = 1;
     enum EState { PARSE_NAME, PARSE_ATTRIB };
-    EState State = PARSE_NAME;
-    string Token;
+    EState State = (_Bar!=NULL) ? PARSE_ATTRIB : PARSE_NAME;
+    // tokens are views of _Def; strings are only used for quoted tokens,
+    // names and values (which must end with '\0'), and are reused
+    const char *Token, *Tok;
+    int TokenLen, TokLen;
+    string Buffer;
     string Value;
-    CTwBar *Bar = NULL;
-    CTwVar *Var = NULL;
-    CTwVarGroup *VarParent = NULL;
-    int VarIndex = -1;
+    string BarName;
+    string VarName;
+    string AttribName;
+    CTwBar *Bar = _Bar;
+    CTwVar *Var = _Var;
+    CTwVarGroup *VarParent = _VarParent;
+    int VarIndex = _VarIndex;
     int p; 
 
-    Cur = _Def;
+    const char *Cur = _Def;
     while( *Cur!='\0' )
     {
         const char *PrevCur = Cur;
-        p = ParseToken(Token, Cur, Line, Column, (State==PARSE_NAME), (State==PARSE_ATTRIB), (State==PARSE_ATTRIB)?'=':'\0');
-        if( p<=0 || Token.size()<=0 )
+        p = ParseToken(Token, TokenLen, Buffer, Cur, Line, Column, (State==PARSE_NAME), (State==PARSE_ATTRIB), (State==PARSE_ATTRIB)?'=':'\0');
+        if( p<=0 || TokenLen<=0 )
         {
             if( p>0 && Cur[p]=='\0' )
             {
                 Cur += p;
                 continue;
             }
-            _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string%s [%-16s...]", ErrorPosition(MultiLine, Line, Column).c_str(), (p<0)?(Cur-p):PrevCur);
-            g_ErrParse[sizeof(g_ErrParse)-1] = '\0';
-            g_TwMgr->SetLastError(g_ErrParse);
-            return 0;
+            return DefineNameError(0, MultiLine, Line, Column, (p<0)?(Cur-p):PrevCur, -1);
         }
         char CurSep = Cur[p];
         Cur += p + ((CurSep!='\0')?1:0);
 
         if( State==PARSE_NAME )
         {
-            int Err = GetBarVarFromString(&Bar, &Var, &VarParent, &VarIndex, Token.c_str());
+            int NbNames = SplitBarVarName(Token, TokenLen, BarName, VarName);
+            int Err = (NbNames>0) ? FindBarVar(&Bar, &Var, &VarParent, &VarIndex, BarName.c_str(), (NbNames==2) ? VarName.c_str() : NULL) : 0;
             if( Err<=0 )
-            {
-                if( Err==-1 )
-                    _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string: Bar not found%s [%-16s...]", ErrorPosition(MultiLine, Line, Column).c_str(), Token.c_str());
-                else if( Err==-2 )
-                    _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string: Variable not found%s [%-16s...]", ErrorPosition(MultiLine, Line, Column).c_str(), Token.c_str());
-                else
-                    _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string%s [%-16s...]", ErrorPosition(MultiLine, Line, Column).c_str(), Token.c_str());
-                g_ErrParse[sizeof(g_ErrParse)-1] = '\0';
-                g_TwMgr->SetLastError(g_ErrParse);
-                return 0;
-            }
+                return DefineNameError(Err, MultiLine, Line, Column, Token, TokenLen);
             State = PARSE_ATTRIB;
         }
         else // State==PARSE_ATTRIB
@@ -4382,18 +5563,17 @@ int ANT_CALL TwDefine(const char *_Def)
             assert(Bar!=NULL);
 
             bool HasValue = false;
-            Value = "";
-            int AttribID = BarVarHasAttrib(Bar, Var, Token.c_str(), &HasValue);
+            int AttribID = BarVarHasAttrib(Bar, Var, Token, TokenLen, &HasValue);
             if( AttribID<=0 )
+                return DefineAttribError(": Unknown attribute", MultiLine, Line, Column, Token, TokenLen);
+            if( Token==Buffer.c_str() )
             {
-                _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string: Unknown attribute%s [%-16s...]", ErrorPosition(MultiLine, Line, Column).c_str(), Token.c_str());
-                g_ErrParse[sizeof(g_ErrParse)-1] = '\0';    
-                g_TwMgr->SetLastError(g_ErrParse);
-                return 0;
+                AttribName = Buffer;    // Buffer is reused by the next tokens
+                Token = AttribName.c_str();
             }
 
             // special case for backward compatibility
-            if( HasValue && ( _stricmp(Token.c_str(), "readonly")==0 || _stricmp(Token.c_str(), "hexa")==0 ) )
+            if( HasValue && IsValueOptional(Token, TokenLen) )
             {
                 if( CurSep==' ' || CurSep=='\t' )
                 {
@@ -4409,62 +5589,293 @@ int ANT_CALL TwDefine(const char *_Def)
             {
                 if( CurSep!='=' )
                 {
-                    string EqualStr;
-                    p = ParseToken(EqualStr, Cur, Line, Column, true, true, '=');
+                    p = ParseToken(Tok, TokLen, Buffer, Cur, Line, Column, true, true, '=');
                     CurSep = Cur[p];
-                    if( p<0 || EqualStr.size()>0 || CurSep!='=' )
-                    {
-                        _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string: '=' not found while reading attribute value%s [%-16s...]", ErrorPosition(MultiLine, Line, Column).c_str(), Token.c_str());
-                        g_ErrParse[sizeof(g_ErrParse)-1] = '\0';
-                        g_TwMgr->SetLastError(g_ErrParse);
-                        return 0;
-                    }
+                    if( p<0 || TokLen>0 || CurSep!='=' )
+                        return DefineAttribError(": '=' not found while reading attribute value", MultiLine, Line, Column, Token, TokenLen);
                     Cur += p + 1;
                 }
-                p = ParseToken(Value, Cur, Line, Column, false, true);
+                p = ParseToken(Tok, TokLen, Buffer, Cur, Line, Column, false, true);
                 if( p<=0 )
-                {
-                    _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string: can't read attribute value%s [%-16s...]", ErrorPosition(MultiLine, Line, Column).c_str(), Token.c_str());
-                    g_ErrParse[sizeof(g_ErrParse)-1] = '\0';
-                    g_TwMgr->SetLastError(g_ErrParse);
-                    return 0;
-                }
+                    return DefineAttribError(": can't read attribute value", MultiLine, Line, Column, Token, TokenLen);
+                Value.assign(Tok, TokLen);
                 CurSep = Cur[p];
                 Cur += p + ((CurSep!='\0')?1:0);
             }
-            const char *PrevLastErrorPtr = g_TwMgr->CheckLastError();
-            if( BarVarSetAttrib(Bar, Var, VarParent, VarIndex, AttribID, HasValue?Value.c_str():NULL)==0 )
-            {
-                if( g_TwMgr->CheckLastError()==NULL || strlen(g_TwMgr->CheckLastError())<=0 || g_TwMgr->CheckLastError()==PrevLastErrorPtr )
-                    _snprintf(g_ErrParse, sizeof(g_ErrParse), "Parsing error in def string: wrong attribute value%s [%-16s...]", ErrorPosition(MultiLine, Line, Column).c_str(), Token.c_str());
-                else
-                    _snprintf(g_ErrParse, sizeof(g_ErrParse), "%s%s [%-16s...]", g_TwMgr->CheckLastError(), ErrorPosition(MultiLine, Line, Column).c_str(), Token.c_str());
-                g_ErrParse[sizeof(g_ErrParse)-1] = '\0';
-                g_TwMgr->SetLastError(g_ErrParse);
+            if( !DefineSetAttrib(Bar, Var, VarParent, VarIndex, AttribID, HasValue?Value.c_str():NULL, MultiLine, Line, Column, Token, TokenLen) )
                 return 0;
+            if( DefineEndOfLine(Cur, CurSep, Line, Column) )
+                State = PARSE_NAME;
+        }
+    }
+
+    return 1;
+}
+
+int ANT_CALL TwDefine(const char *_Def)
+{
+    CTwFPU fpu; // force fpu precision
+
+    if( g_TwMgr==NULL )
+    {
+        TwGlobalError(g_ErrNotInit);
+        return 0; // not initialized
+    }
+    if( _Def==NULL )
+    {
+        g_TwMgr->SetLastError(g_ErrBadParam);
+        return 0;
+    }
+
+    // For multi-thread savety
+    if( !TwOnRenderThread() )
+        return 0;
+
+    g_TwMgr->m_NeedsRedraw = true;
+    if( !ParseDefine(_Def, NULL, NULL, NULL, -1) )
+        return 0;
+
+    g_TwMgr->m_HelpBarNotUpToDate = true;
+    return 1;
+}
+
+//  ---------------------------------------------------------------------------
+
+// A def string split into its targets (bar or var names) and their attributes.
+// Names are resolved each time the define is applied because bars and vars
+// may have been created, deleted or regrouped in between (possibly by the
+// define itself); attribute IDs are kept while the kind of target does not
+// change.
+struct CTwCompiledDefine
+{
+    enum ETargetKind    { TARGET_GLOBAL, TARGET_BAR, TARGET_ATOM, TARGET_GROUP };
+    struct CTarget
+    {
+        int             m_Name;         // offsets in m_Strings
+        int             m_BarName;
+        int             m_VarName;      // -1 if the target is a bar
+        int             m_Line, m_Column;
+        int             m_FirstAttrib;
+        int             m_NbAttribs;
+    };
+    struct CAttrib
+    {
+        int             m_Name;         // offsets in m_Strings
+        int             m_NameLen;
+        int             m_Value;        // -1 if no value is given
+        int             m_Line, m_Column;
+        bool            m_ValueOptional;// followed by a space but not by '='
+        int             m_Kind;         // kind of target m_ID has been found for, -1 if not found yet
+        int             m_ID;
+        bool            m_HasValue;     // m_ID expects a value
+    };
+    std::vector<CTarget> m_Targets;
+    std::vector<CAttrib> m_Attribs;
+    std::vector<char>   m_Strings;
+    bool                m_MultiLine;
+    int                 AddString(const char *_Str, int _Len) { int Offset = (int)m_Strings.size(); m_Strings.insert(m_Strings.end(), _Str, _Str+_Len); m_Strings.push_back('\0'); return Offset; }
+};
+
+// Same syntax as ParseDefine, except that the target kind is not known while
+// compiling: an attribute has a value if it is followed by '='.
+static int CompileDefine(const char *_Def, CTwCompiledDefine *_Compiled)
+{
+    bool MultiLine = ( strchr(_Def, '\n')!=NULL );
+    int Line = 1;
+    int Column = 1;
+    enum EState { PARSE_NAME, PARSE_ATTRIB };
+    EState State = PARSE_NAME;
+    const char *Token, *Tok;
+    int TokenLen, TokLen;
+    string Buffer;
+    string BarName;
+    string VarName;
+    int p;
+
+    _Compiled->m_MultiLine = MultiLine;
+    const char *Cur = _Def;
+    while( *Cur!='\0' )
+    {
+        const char *PrevCur = Cur;
+        p = ParseToken(Token, TokenLen, Buffer, Cur, Line, Column, (State==PARSE_NAME), (State==PARSE_ATTRIB), (State==PARSE_ATTRIB)?'=':'\0');
+        if( p<=0 || TokenLen<=0 )
+        {
+            if( p>0 && Cur[p]=='\0' )
+            {
+                Cur += p;
+                continue;
             }
-            // sweep spaces to detect next attrib
-            while( *Cur==' ' || *Cur=='\t' || *Cur=='\r' )
+            return DefineNameError(0, MultiLine, Line, Column, (p<0)?(Cur-p):PrevCur, -1);
+        }
+        char CurSep = Cur[p];
+        Cur += p + ((CurSep!='\0')?1:0);
+
+        if( State==PARSE_NAME )
+        {
+            int NbNames = SplitBarVarName(Token, TokenLen, BarName, VarName);
+            if( NbNames<=0 )
+                return DefineNameError(0, MultiLine, Line, Column, Token, TokenLen);
+            CTwCompiledDefine::CTarget Target;
+            Target.m_Name = _Compiled->AddString(Token, TokenLen);
+            Target.m_BarName = _Compiled->AddString(BarName.c_str(), (int)BarName.size());
+            Target.m_VarName = (NbNames==2) ? _Compiled->AddString(VarName.c_str(), (int)VarName.size()) : -1;
+            Target.m_Line = Line;
+            Target.m_Column = Column;
+            Target.m_FirstAttrib = (int)_Compiled->m_Attribs.size();
+            Target.m_NbAttribs = 0;
+            _Compiled->m_Targets.push_back(Target);
+            State = PARSE_ATTRIB;
+        }
+        else // State==PARSE_ATTRIB
+        {
+            CTwCompiledDefine::CAttrib Attrib;
+            Attrib.m_Name = _Compiled->AddString(Token, TokenLen);
+            Attrib.m_NameLen = TokenLen;
+            Attrib.m_Value = -1;
+            Attrib.m_Line = Line;
+            Attrib.m_Column = Column;
+            Attrib.m_ValueOptional = false;
+            Attrib.m_Kind = -1;
+            Attrib.m_ID = 0;
+            Attrib.m_HasValue = false;
+
+            if( CurSep==' ' || CurSep=='\t' )
             {
-                ++Cur;
-                if( *Cur=='\t' )
-                    Column += g_TabLength;
-                else if( *Cur!='\r' )
-                    ++Column;
+                const char *ch = Cur;
+                while( *ch==' ' || *ch=='\t' ) // find next non-space character
+                    ++ch;
+                if( *ch=='=' )
+                {
+                    p = ParseToken(Tok, TokLen, Buffer, Cur, Line, Column, true, true, '=');
+                    CurSep = Cur[p];
+                    Cur += p + 1;
+                }
+                else
+                    Attrib.m_ValueOptional = true;
             }
-            if( *Cur=='\n' )    // new line detected
+            if( CurSep=='=' )
             {
-                ++Line;
-                Column = 1;
+                p = ParseToken(Tok, TokLen, Buffer, Cur, Line, Column, false, true);
+                if( p<=0 )
+                    return DefineAttribError(": can't read attribute value", MultiLine, Line, Column, &(_Compiled->m_Strings[Attrib.m_Name]), Attrib.m_NameLen);
+                Attrib.m_Value = _Compiled->AddString(Tok, TokLen);
+                CurSep = Cur[p];
+                Cur += p + ((CurSep!='\0')?1:0);
+            }
+            _Compiled->m_Attribs.push_back(Attrib);
+            _Compiled->m_Targets.back().m_NbAttribs += 1;
+            if( DefineEndOfLine(Cur, CurSep, Line, Column) )
                 State = PARSE_NAME;
+        }
+    }
+
+    return 1;
+}
+
+static int ApplyCompiledDefine(CTwCompiledDefine *_Compiled)
+{
+    const char *Str = _Compiled->m_Strings.empty() ? "" : &(_Compiled->m_Strings[0]);
+    bool MultiLine = _Compiled->m_MultiLine;
+    CTwBar *Bar;
+    CTwVar *Var;
+    CTwVarGroup *VarParent;
+    int VarIndex;
+
+    for( size_t t=0; t<_Compiled->m_Targets.size(); ++t )
+    {
+        const CTwCompiledDefine::CTarget& Target = _Compiled->m_Targets[t];
+        int Err = FindBarVar(&Bar, &Var, &VarParent, &VarIndex, Str+Target.m_BarName, (Target.m_VarName>=0) ? Str+Target.m_VarName : NULL);
+        if( Err<=0 )
+            return DefineNameError(Err, MultiLine, Target.m_Line, Target.m_Column, Str+Target.m_Name, -1);
+        int Kind;
+        if( Bar==TW_GLOBAL_BAR )
+            Kind = CTwCompiledDefine::TARGET_GLOBAL;
+        else if( Var==NULL )
+            Kind = CTwCompiledDefine::TARGET_BAR;
+        else
+            Kind = Var->IsGroup() ? CTwCompiledDefine::TARGET_GROUP : CTwCompiledDefine::TARGET_ATOM;
+
+        for( int a=Target.m_FirstAttrib; a<Target.m_FirstAttrib+Target.m_NbAttribs; ++a )
+        {
+            CTwCompiledDefine::CAttrib& Attrib = _Compiled->m_Attribs[a];
+            const char *Name = Str+Attrib.m_Name;
+            if( Attrib.m_Kind!=Kind )
+            {
+                Attrib.m_ID = BarVarHasAttrib(Bar, Var, Name, Attrib.m_NameLen, &Attrib.m_HasValue);
+                Attrib.m_Kind = Kind;
             }
+            if( Attrib.m_ID<=0 )
+                return DefineAttribError(": Unknown attribute", MultiLine, Attrib.m_Line, Attrib.m_Column, Name, Attrib.m_NameLen);
+            const char *Value = (Attrib.m_Value>=0) ? Str+Attrib.m_Value : NULL;
+            if( Attrib.m_HasValue && Value==NULL && !(Attrib.m_ValueOptional && IsValueOptional(Name, Attrib.m_NameLen)) )
+                return DefineAttribError(": '=' not found while reading attribute value", MultiLine, Attrib.m_Line, Attrib.m_Column, Name, Attrib.m_NameLen);
+            if( !Attrib.m_HasValue && Value!=NULL )
+                return DefineAttribError("", MultiLine, Attrib.m_Line, Attrib.m_Column, Name, Attrib.m_NameLen);
+            if( !DefineSetAttrib(Bar, Var, VarParent, VarIndex, Attrib.m_ID, Value, MultiLine, Attrib.m_Line, Attrib.m_Column, Name, Attrib.m_NameLen) )
+                return 0;
         }
     }
 
+    return 1;
+}
+
+TwCompiledDefine *ANT_CALL TwCompileDefine(const char *_Def)
+{
+    if( g_TwMgr==NULL )
+    {
+        TwGlobalError(g_ErrNotInit);
+        return NULL; // not initialized
+    }
+    if( _Def==NULL )
+    {
+        g_TwMgr->SetLastError(g_ErrBadParam);
+        return NULL;
+    }
+
+    CTwCompiledDefine *Compiled = new CTwCompiledDefine;
+    if( !CompileDefine(_Def, Compiled) )
+    {
+        delete Compiled;
+        return NULL;
+    }
+    return Compiled;
+}
+
+int ANT_CALL TwApplyCompiledDefine(TwCompiledDefine *_CompiledDef)
+{
+    CTwFPU fpu; // force fpu precision
+
+    if( g_TwMgr==NULL )
+    {
+        TwGlobalError(g_ErrNotInit);
+        return 0; // not initialized
+    }
+    if( _CompiledDef==NULL )
+    {
+        g_TwMgr->SetLastError(g_ErrBadParam);
+        return 0;
+    }
+
+    // For multi-thread savety
+    if( !TwOnRenderThread() )
+        return 0;
+
+    g_TwMgr->m_NeedsRedraw = true;
+    if( !ApplyCompiledDefine(_CompiledDef) )
+        return 0;
+
     g_TwMgr->m_HelpBarNotUpToDate = true;
     return 1;
 }
 
+int ANT_CALL TwDeleteCompiledDefine(TwCompiledDefine *_CompiledDef)
+{
+    if( _CompiledDef==NULL )
+        return 0;
+    delete _CompiledDef;
+    return 1;
+}
+
 //  ---------------------------------------------------------------------------
 
 TwType ANT_CALL TwDefineEnum(const char *_Name, const TwEnumVal *_EnumValues, unsigned int _NbValues)
@@ -4482,6 +5893,10 @@ TwType ANT_CALL TwDefineEnum(const char *_Name, const TwEnumVal *_EnumValues, un
         return TW_TYPE_UNDEF;
     }
 
+    // For multi-thread savety
+    if( !TwOnRenderThread() )
+        return TW_TYPE_UNDEF;
+
     if( g_TwMgr->m_PopupBar!=NULL ) // delete popup bar first if it exists
     {
         TwDeleteBar(g_TwMgr->m_PopupBar);
@@ -4504,20 +5919,118 @@ TwType ANT_CALL TwDefineEnum(const char *_Name, const TwEnumVal *_EnumValues, un
         e.m_Name = _Name;
     else
         e.m_Name = "";
-    e.m_Entries.clear();
+    e.Clear();
+    vector<CTwMgr::CEnum::CEntry> Entries(_NbValues);
     for(unsigned int i=0; i<_NbValues; ++i)
     {
-        CTwMgr::CEnum::CEntries::value_type Entry(_EnumValues[i].Value, (_EnumValues[i].Label!=NULL)?_EnumValues[i].Label:"");
-        pair<CTwMgr::CEnum::CEntries::iterator, bool> Result = e.m_Entries.insert(Entry);
-        if( !Result.second )
-            (Result.first)->second = Entry.second;
+        Entries[i].m_Value = _EnumValues[i].Value;
+        Entries[i].m_Label = (_EnumValues[i].Label!=NULL) ? _EnumValues[i].Label : "";
+        Entries[i].m_Length = (int)strlen(Entries[i].m_Label);
     }
+    e.Insert(Entries);
 
     return TwType( TW_TYPE_ENUM_BASE + enumIndex );
 }
 
 //  ---------------------------------------------------------------------------
 
+int CTwMgr::CEnum::Find(unsigned int _Value) const
+{
+    int NbValues = (int)m_Values.size();
+    if( NbValues==0 )
+        return -1;
+    if( m_Dense )
+    {
+        unsigned int Rank = _Value-m_Values[0];
+        return (Rank<(unsigned int)NbValues) ? (int)Rank : -1;
+    }
+    if( m_LastRank<NbValues && m_Values[m_LastRank]==_Value )
+        return m_LastRank;
+    int First = 0, Last = NbValues;
+    while( First<Last )
+    {
+        int Mid = (First+Last)/2;
+        if( m_Values[Mid]<_Value )
+            First = Mid+1;
+        else
+            Last = Mid;
+    }
+    if( First<NbValues && m_Values[First]==_Value )
+    {
+        m_LastRank = First;
+        return First;
+    }
+    return -1;
+}
+
+void CTwMgr::CEnum::Clear()
+{
+    m_Values.clear();
+    m_LabelOffsets.resize(1);
+    m_Labels.clear();
+    m_Dense = true;
+    m_LastRank = 0;
+}
+
+static bool EnumEntryLess(const CTwMgr::CEnum::CEntry& _A, const CTwMgr::CEnum::CEntry& _B)
+{
+    return _A.m_Value<_B.m_Value;
+}
+
+void CTwMgr::CEnum::Insert(vector<CEntry>& _Entries)
+{
+    // stable: the last of equal values is the one kept
+    stable_sort(_Entries.begin(), _Entries.end(), EnumEntryLess);
+
+    size_t LabelsSize = m_Labels.size();
+    for( size_t j=0; j<_Entries.size(); ++j )
+        LabelsSize += _Entries[j].m_Length+1;
+    vector<unsigned int> Values;
+    vector<unsigned int> Offsets;
+    vector<char> Labels;
+    Values.reserve(m_Values.size()+_Entries.size());
+    Offsets.reserve(m_Values.size()+_Entries.size()+1);
+    Labels.reserve(LabelsSize);
+    Offsets.push_back(0);
+
+    // merge the sorted old and new entries
+    size_t i = 0, j = 0;
+    while( i<m_Values.size() || j<_Entries.size() )
+    {
+        const char *Label;
+        int Length;
+        if( j<_Entries.size() && (i>=m_Values.size() || _Entries[j].m_Value<=m_Values[i]) )
+        {
+            while( j+1<_Entries.size() && _Entries[j+1].m_Value==_Entries[j].m_Value )
+                ++j;
+            if( i<m_Values.size() && m_Values[i]==_Entries[j].m_Value )
+                ++i;
+            Values.push_back(_Entries[j].m_Value);
+            Label = _Entries[j].m_Label;
+            Length = _Entries[j].m_Length;
+            ++j;
+        }
+        else
+        {
+            Values.push_back(m_Values[i]);
+            Label = this->Label((int)i);
+            Length = LabelLength((int)i);
+            ++i;
+        }
+        Labels.insert(Labels.end(), Label, Label+Length);
+        Labels.push_back('\0');
+        Offsets.push_back((unsigned int)Labels.size());
+    }
+
+    m_Values.swap(Values);
+    m_LabelOffsets.swap(Offsets);
+    m_Labels.swap(Labels);
+    m_Dense = m_Values.empty() || m_Values.back()-m_Values.front()==(unsigned int)(m_Values.size()-1);
+    m_LastRank = 0;
+}
+
+//  ---------------------------------------------------------------------------
+
 void ANT_CALL CTwMgr::CStruct::DefaultSummary(char *_SummaryString, size_t _SummaryMaxLength, const void *_Value, void *_ClientData)
 {
     const CTwVarGroup *varGroup = static_cast<const CTwVarGroup *>(_Value); // special case
@@ -4607,6 +6120,10 @@ TwType ANT_CALL TwDefineStruct(const char *_StructName, const TwStructMember *_S
         return TW_TYPE_UNDEF;
     }
 
+    // For multi-thread savety
+    if( !TwOnRenderThread() )
+        return TW_TYPE_UNDEF;
+
     if( _StructName!=NULL && strlen(_StructName)>0 )
         for( size_t j=0; j<g_TwMgr->m_Structs.size(); ++j )
             if( strcmp(_StructName, g_TwMgr->m_Structs[j].m_Name.c_str())==0 )
@@ -5003,7 +6520,9 @@ ETwMouseAction   TW_MOUSE_MOTION = (ETwMouseAction)(-2);
 ETwMouseAction   TW_MOUSE_WHEEL = (ETwMouseAction)(-3);
 ETwMouseButtonID TW_MOUSE_NA = (ETwMouseButtonID)(-1);
 
-static int TwMouseEvent(ETwMouseAction _EventType, TwMouseButtonID _Button, int _MouseX, int _MouseY, int _WheelPos)
+// _WheelLines: for a wheel event, the number of lines to scroll; if NULL it is
+// deduced from the previous wheel position.
+static int TwMouseEvent(ETwMouseAction _EventType, TwMouseButtonID _Button, int _MouseX, int _MouseY, int _WheelPos, const int *_WheelLines)
 {
     CTwFPU fpu; // force fpu precision
 
@@ -5012,16 +6531,56 @@ static int TwMouseEvent(ETwMouseAction _EventType, TwMouseButtonID _Button, int
         // TwGlobalError(g_ErrNotInit); -> not an error here
         return 0; // not initialized
     }
+
+    // For multi-thread safety
+    if( TwMustQueueEvent() )
+    {
+        CTwQueuedEvent *Ev = new CTwQueuedEvent(CTwQueuedEvent::MOUSE);
+        Ev->m_Args[0] = _EventType;
+        Ev->m_Args[1] = _Button;
+        Ev->m_Args[2] = _MouseX;
+        Ev->m_Args[3] = _MouseY;
+        Ev->m_Args[4] = _WheelPos;
+        g_TwMgr->m_EventQueue.Push(Ev);
+        return 0;   // not known yet if the event is handled, see TwEventsQueued
+    }
+
+    // Merge the events occurring between TwBeginEvents and TwEndEvents
+    if( g_TwMgr->m_EventBatchLevel>0 )
+    {
+        if( _EventType==TW_MOUSE_MOTION )
+        {
+            if( g_TwMgr->m_BatchedWheel && !TwDispatchBatchedEvents() )   // the wheel steps occurred at the previous position
+                return 0;
+            g_TwMgr->m_BatchedMotion = true;
+            g_TwMgr->m_BatchedMouseX = _MouseX;
+            g_TwMgr->m_BatchedMouseY = _MouseY;
+            return 0;   // not known yet if the event is handled
+        }
+        else if( _EventType==TW_MOUSE_WHEEL )
+        {
+            int PrevPos = g_TwMgr->m_BatchedWheel ? g_TwMgr->m_BatchedWheelPos : g_TwMgr->m_LastMouseWheelPos;
+            if( _WheelPos!=PrevPos && abs(_WheelPos-PrevPos)<4 ) // avoid crazy wheel positions
+            {
+                int Step = (_WheelPos>PrevPos) ? 1 : -1;
+                if( g_TwMgr->m_BatchedWheelLines*Step<0 && !TwDispatchBatchedEvents() )  // a bar clamps its scrolling, so steps in opposite directions do not cancel out
+                    return 0;
+                g_TwMgr->m_BatchedWheelLines += Step;
+            }
+            g_TwMgr->m_BatchedWheel = true;
+            g_TwMgr->m_BatchedWheelPos = _WheelPos;
+            return 0;
+        }
+        else if( !TwDispatchBatchedEvents() )   // buttons are processed in order
+            return 0;
+    }
+
     if( g_TwMgr->m_WndHeight<=0 || g_TwMgr->m_WndWidth<=0 )
     {
         //g_TwMgr->SetLastError(g_ErrBadWndSize);   // not an error, windows not yet ready.
         return 0;
     }
 
-    // For multi-thread safety
-    if( !TwFreeAsyncDrawing() )
-        return 0;
-
     if( _MouseX==TW_MOUSE_NOMOTION )
         _MouseX = g_TwMgr->m_LastMouseX;
     else
@@ -5047,51 +6606,59 @@ static int TwMouseEvent(ETwMouseAction _EventType, TwMouseButtonID _Button, int
         g_TwMgr->m_IsRepeatingMousePressed = false;
     }
 
-    bool Handled = false;
-    bool wasPopup = (g_TwMgr->m_PopupBar!=NULL);
-    CTwBar *Bar = NULL;
-    int i;
-
-    // search for a bar with mousedrag enabled
-    CTwBar *BarDragging = NULL;
-    for( i=((int)g_TwMgr->m_Bars.size())-1; i>=0; --i )
+    int WheelLines = 0;
+    bool WheelValid = false;
+    if( _EventType==TW_MOUSE_WHEEL )
     {
-        Bar = g_TwMgr->m_Bars[g_TwMgr->m_Order[i]];
-        if( Bar!=NULL && Bar->m_Visible && Bar->IsDragging() )
+        if( _WheelLines!=NULL )
         {
-            BarDragging = Bar;
-            break;
+            WheelLines = *_WheelLines;
+            WheelValid = true;
         }
-    }
-
-    for( i=(int)g_TwMgr->m_Bars.size(); i>=0; --i )
-    {
-        if( i==(int)g_TwMgr->m_Bars.size() )    // first try the bar with mousedrag enabled (this bar has the focus)
-            Bar = BarDragging;
         else
         {
-            Bar = g_TwMgr->m_Bars[g_TwMgr->m_Order[i]];
-            if( Bar==BarDragging )
-                continue;
-        }
-        if( Bar!=NULL && Bar->m_Visible )
-        {
-            if( _EventType==TW_MOUSE_MOTION )
-                Handled = Bar->MouseMotion(_MouseX, _MouseY);
-            else if( _EventType==TW_MOUSE_PRESSED || _EventType==TW_MOUSE_RELEASED )
-                Handled = Bar->MouseButton(_Button, (_EventType==TW_MOUSE_PRESSED), _MouseX, _MouseY);
-            else if( _EventType==TW_MOUSE_WHEEL )
-            {
-                if( abs(_WheelPos-g_TwMgr->m_LastMouseWheelPos)<4 ) // avoid crazy wheel positions
-                    Handled = Bar->MouseWheel(_WheelPos, g_TwMgr->m_LastMouseWheelPos, _MouseX, _MouseY);
-            }
-            if( Handled )
-                break;
+            WheelLines = (_WheelPos>g_TwMgr->m_LastMouseWheelPos) ? 1 : ((_WheelPos<g_TwMgr->m_LastMouseWheelPos) ? -1 : 0);
+            WheelValid = abs(_WheelPos-g_TwMgr->m_LastMouseWheelPos)<4;   // avoid crazy wheel positions
         }
     }
 
-    if( g_TwMgr==NULL ) // Mgr might have been destroyed by the client inside a callback call
-        return 1;
+    bool Handled = false;
+    bool wasPopup = (g_TwMgr->m_PopupBar!=NULL);
+    CTwBar *Bar = NULL;
+
+    // Pass the event to the bar with mousedrag enabled (this bar has the focus),
+    // then to the bars under the mouse from top to bottom. The other bars
+    // ignore it, except those still having a mouse state (highlighted line,
+    // edit in place...) which are called in their z-order.
+    vector<TwBar *> Targets;
+    Targets.swap(g_TwMgr->m_MouseTargets);  // reuse the buffer (and stay reentrant)
+    g_TwMgr->GetMouseTargets(_MouseX, _MouseY, Targets);
+    for( size_t i=0; i<Targets.size() && !Handled; ++i )
+    {
+        Bar = Targets[i];
+        if( !g_TwMgr->m_BarRectsUpToDate && find(g_TwMgr->m_Bars.begin(), g_TwMgr->m_Bars.end(), Bar)==g_TwMgr->m_Bars.end() )
+            continue;   // deleted by a callback
+        if( !Bar->m_Visible )
+            continue;
+        if( _EventType==TW_MOUSE_MOTION )
+            Handled = Bar->MouseMotion(_MouseX, _MouseY);
+        else if( _EventType==TW_MOUSE_PRESSED || _EventType==TW_MOUSE_RELEASED )
+            Handled = Bar->MouseButton(_Button, (_EventType==TW_MOUSE_PRESSED), _MouseX, _MouseY);
+        else if( _EventType==TW_MOUSE_WHEEL )
+        {
+            if( WheelValid )
+                Handled = Bar->MouseWheel(WheelLines, _MouseX, _MouseY);
+        }
+
+        if( g_TwMgr==NULL ) // Mgr might have been destroyed by the client inside a callback call
+            return 1;
+        g_TwMgr->MouseProcessed(Bar);
+    }
+    if( !Handled && _EventType==TW_MOUSE_MOTION )
+        g_TwMgr->MouseMotionNotHandled(Targets);
+    if( !Handled )
+        Bar = NULL;
+    Targets.swap(g_TwMgr->m_MouseTargets);
 
     /*
     if( i>=0 && Bar!=NULL && Handled && (_EventType==TW_MOUSE_PRESSED || Bar->IsMinimized()) && i!=((int)g_TwMgr->m_Bars.size())-1 )
@@ -5110,7 +6677,7 @@ static int TwMouseEvent(ETwMouseAction _EventType, TwMouseButtonID _Button, int
             g_TwMgr->m_PopupBar = NULL;
         }
 
-        if( i>=0 && Bar!=NULL && Handled && !wasPopup )
+        if( Bar!=NULL && Handled && !wasPopup )
             TwSetTopBar(Bar);
     }
 
@@ -5122,17 +6689,104 @@ static int TwMouseEvent(ETwMouseAction _EventType, TwMouseButtonID _Button, int
 
 int ANT_CALL TwMouseButton(ETwMouseAction _EventType, TwMouseButtonID _Button)
 {
-    return TwMouseEvent(_EventType, _Button, TW_MOUSE_NOMOTION, TW_MOUSE_NOMOTION, 0);
+    return TwMouseEvent(_EventType, _Button, TW_MOUSE_NOMOTION, TW_MOUSE_NOMOTION, 0, NULL);
 }
 
 int ANT_CALL TwMouseMotion(int _MouseX, int _MouseY)
 {
-    return TwMouseEvent(TW_MOUSE_MOTION, TW_MOUSE_NA, _MouseX, _MouseY, 0);
+    return TwMouseEvent(TW_MOUSE_MOTION, TW_MOUSE_NA, _MouseX, _MouseY, 0, NULL);
 }
 
 int ANT_CALL TwMouseWheel(int _Pos)
 {
-    return TwMouseEvent(TW_MOUSE_WHEEL, TW_MOUSE_NA, TW_MOUSE_NOMOTION, TW_MOUSE_NOMOTION, _Pos);
+    return TwMouseEvent(TW_MOUSE_WHEEL, TW_MOUSE_NA, TW_MOUSE_NOMOTION, TW_MOUSE_NOMOTION, _Pos, NULL);
+}
+
+//  ---------------------------------------------------------------------------
+
+int ANT_CALL TwEventsQueued()
+{
+    if( g_TwMgr==NULL )
+        return 0;   // not initialized
+
+    return g_TwMgr->m_EventQueue.IsEmpty() ? 0 : 1;
+}
+
+//  ---------------------------------------------------------------------------
+
+// Dispatches the mouse motion and wheel steps merged since TwBeginEvents.
+// Returns false if an event handler terminated the library.
+static bool TwDispatchBatchedEvents()
+{
+    if( !g_TwMgr->m_BatchedMotion && !g_TwMgr->m_BatchedWheel )
+        return true;
+
+    int Level = g_TwMgr->m_EventBatchLevel;
+    g_TwMgr->m_EventBatchLevel = 0;     // so that TwMouseEvent does not merge them again
+    int Handled = 0;
+    if( g_TwMgr->m_BatchedMotion )
+    {
+        g_TwMgr->m_BatchedMotion = false;
+        Handled |= TwMouseEvent(TW_MOUSE_MOTION, TW_MOUSE_NA, g_TwMgr->m_BatchedMouseX, g_TwMgr->m_BatchedMouseY, 0, NULL);
+    }
+    if( g_TwMgr!=NULL && g_TwMgr->m_BatchedWheel )
+    {
+        g_TwMgr->m_BatchedWheel = false;
+        int Lines = g_TwMgr->m_BatchedWheelLines;
+        g_TwMgr->m_BatchedWheelLines = 0;
+        if( Lines!=0 )
+            Handled |= TwMouseEvent(TW_MOUSE_WHEEL, TW_MOUSE_NA, TW_MOUSE_NOMOTION, TW_MOUSE_NOMOTION, g_TwMgr->m_BatchedWheelPos, &Lines);
+        else
+            g_TwMgr->m_LastMouseWheelPos = g_TwMgr->m_BatchedWheelPos;
+    }
+    if( g_TwMgr==NULL ) // Mgr might have been destroyed by the client inside a callback call
+        return false;
+    g_TwMgr->m_EventBatchLevel = Level;
+    if( Handled )
+        g_TwMgr->m_BatchedHandled = true;
+    return true;
+}
+
+//  ---------------------------------------------------------------------------
+
+int ANT_CALL TwBeginEvents()
+{
+    if( g_TwMgr==NULL || g_TwMgr->m_Graph==NULL )
+    {
+        TwGlobalError(g_ErrNotInit);
+        return 0; // not initialized
+    }
+
+    if( g_TwMgr->m_EventBatchLevel==0 )
+        g_TwMgr->m_BatchedHandled = false;
+    ++g_TwMgr->m_EventBatchLevel;
+    return 1;
+}
+
+//  ---------------------------------------------------------------------------
+
+int ANT_CALL TwEndEvents()
+{
+    if( g_TwMgr==NULL || g_TwMgr->m_Graph==NULL )
+    {
+        TwGlobalError(g_ErrNotInit);
+        return 0; // not initialized
+    }
+    if( g_TwMgr->m_EventBatchLevel<=0 )
+    {
+        g_TwMgr->SetLastError(g_ErrNthToDo);
+        return 0;
+    }
+
+    if( g_TwMgr->m_EventBatchLevel>1 )
+    {
+        --g_TwMgr->m_EventBatchLevel;
+        return 0;   // the outer TwEndEvents dispatches the events
+    }
+    if( !TwDispatchBatchedEvents() )
+        return 1;   // terminated by an event handler
+    g_TwMgr->m_EventBatchLevel = 0;
+    return g_TwMgr->m_BatchedHandled ? 1 : 0;
 }
 
 //  ---------------------------------------------------------------------------
@@ -5205,16 +6859,27 @@ int ANT_CALL TwKeyPressed(int _Key, int _Modifiers)
         // TwGlobalError(g_ErrNotInit); -> not an error here
         return 0; // not initialized
     }
+
+    // For multi-thread savety
+    if( TwMustQueueEvent() )
+    {
+        CTwQueuedEvent *Ev = new CTwQueuedEvent(CTwQueuedEvent::KEY);
+        Ev->m_Args[0] = _Key;
+        Ev->m_Args[1] = _Modifiers;
+        g_TwMgr->m_EventQueue.Push(Ev);
+        return 0;   // not known yet if the key is handled, see TwEventsQueued
+    }
+
+    // Merged mouse events occurred before
+    if( !TwDispatchBatchedEvents() )
+        return 0;
+
     if( g_TwMgr->m_WndHeight<=0 || g_TwMgr->m_WndWidth<=0 )
     {
         //g_TwMgr->SetLastError(g_ErrBadWndSize);   // not an error, windows not yet ready.
         return 0;
     }
 
-    // For multi-thread savety
-    if( !TwFreeAsyncDrawing() )
-        return 0;
-
     /*
     // Test for TwDeleteBar
     if( _Key>='0' && _Key<='9' )
@@ -5309,6 +6974,13 @@ int ANT_CALL TwKeyPressed(int _Key, int _Modifiers)
         }
     }
 
+    // keys may move bars or highlight lines (see CTwBar::HasMouseState)
+    if( g_TwMgr->m_BarRectsUpToDate )
+        for( i=0; i<(int)g_TwMgr->m_Bars.size(); ++i )
+            if( g_TwMgr->m_Bars[i]!=NULL && g_TwMgr->m_Bars[i]->HasMouseState() )
+                g_TwMgr->MouseStateSet(g_TwMgr->m_Bars[i]);
+    g_TwMgr->CheckBarRects();
+
     if( Handled && Bar!=g_TwMgr->m_PopupBar && g_TwMgr->m_PopupBar!=NULL && g_TwMgr->m_PopupBar==PopupBar )  // delete popup
     {
         TwDeleteBar(g_TwMgr->m_PopupBar);
@@ -5780,6 +7452,7 @@ void CTwMgr::UpdateHelpBar()
     AppendHelpString(RotoGrp, "Moving the mouse far form the circle allows precise increase or decrease, while moving near the circle allows fast increase or decrease.", 0, m_HelpBar->m_VarX2-m_HelpBar->m_VarX0, TW_TYPE_HELP_ATOM);
 
     SynchroHierarchy(&m_HelpBar->m_VarRoot, &prevHierarchy);
+    m_HelpBar->InvalidateVarIndex();    // hierarchy has been built directly
 
     m_HelpBarNotUpToDate = false;
 }
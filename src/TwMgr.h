@@ -22,6 +22,7 @@
 #include "TwFonts.h"
 #include "TwGraph.h"
 #include "AntPerfTimer.h"
+#include "TwSync.h"
 
 
 //#define BENCH // uncomment to activate benchmarks
@@ -89,6 +90,25 @@ struct CTwMgr
     std::vector<TwBar*> m_Bars;
     std::vector<int>    m_Order;
 
+    // Screen-space index of the visible bars used to route mouse events
+    struct CBarRect     { TwBar *m_Bar; int m_X0, m_Y0, m_X1, m_Y1; };  // hit area [m_X0,m_X1)x[m_Y0,m_Y1), empty if the bar cannot be hit
+    std::vector<CBarRect> m_BarRects;   // visible bars, top-most first
+    std::vector<int>    m_BarCells;     // for each cell of a grid covering the window, indices of the rects overlapping it, top-most first
+    std::vector<int>    m_BarCellStart; // rects of cell c are m_BarCells[m_BarCellStart[c]] to m_BarCells[m_BarCellStart[c+1]-1]
+    int                 m_BarCellsX, m_BarCellsY;
+    TwBar *             m_LowestOpenBars[2];    // the two bottom-most visible bars which are not minimized
+    bool                m_BarRectsUpToDate;
+    std::vector<TwBar*> m_MouseBars;    // visible bars having a mouse state (see CTwBar::HasMouseState)
+    std::vector<TwBar*> m_MouseTargets; // buffer used by TwMouseEvent
+    void                BarRectsNotUpToDate() { m_BarRectsUpToDate = false; }   // bars moved, resized, reordered, created or deleted
+    void                UpdateBarRects();
+    void                CheckBarRects();    // invalidate the index if a bar has moved, been resized, shown or hidden since it was built
+    static void         GetBarRect(const TwBar *_Bar, CBarRect *_Rect);
+    void                GetMouseTargets(int _X, int _Y, std::vector<TwBar*>& _Targets);    // bars to which a mouse event must be passed, in order
+    void                MouseProcessed(TwBar *_Bar);    // update the index after _Bar has processed a mouse event
+    void                MouseStateSet(TwBar *_Bar);     // _Bar has got a mouse state outside of a mouse event
+    void                MouseMotionNotHandled(const std::vector<TwBar*>& _Targets);    // do what the bars not in _Targets would have done
+
     std::vector<bool>   m_MinOccupied;
     void                Minimize(TwBar *_Bar);
     void                Maximize(TwBar *_Bar);
@@ -98,6 +118,12 @@ struct CTwMgr
     int                 m_LastMouseX;
     int                 m_LastMouseY;
     int                 m_LastMouseWheelPos;
+    int                 m_EventBatchLevel;  // >0 between TwBeginEvents and TwEndEvents
+    bool                m_BatchedMotion;    // a mouse motion to m_BatchedMouseX,Y has been merged and not dispatched yet
+    int                 m_BatchedMouseX, m_BatchedMouseY;
+    bool                m_BatchedWheel;     // same for the wheel steps accumulated after the pending motion
+    int                 m_BatchedWheelPos, m_BatchedWheelLines;
+    bool                m_BatchedHandled;   // one of the merged events has been handled
     int                 m_IconPos;      // 0: bottom-left, 1:bottom-right, 2:top-left, 3:top-right
     int                 m_IconAlign;    // 0: vertical, 1: horizontal
     int                 m_IconMarginX, m_IconMarginY;
@@ -106,6 +132,16 @@ struct CTwMgr
     std::string         m_BarAlwaysOnBottom;
     bool                m_UseOldColorScheme;
     bool                m_Contained;
+    bool                m_UseVBO;       // OpenGL: store text and stream primitives in vertex buffer objects
+    int                 m_GLState;      // OpenGL: combination of EGLState flags (see the "glstate" attrib)
+    bool                m_UseDrawCache; // replay the primitives of bars that did not change since the last frame
+    bool                m_NeedsRedraw;  // set by changes not tracked by the bars, cleared by TwDraw
+    std::vector<const TwBar *> m_DrawnBars; // visible bars in drawing order during the last TwDraw
+    CTwThreadID         m_RenderThread; // thread that called TwInit, constant afterwards
+    CTwEventQueue       m_EventQueue;   // input received from other threads or while drawing, processed by TwDraw
+    std::vector<CTwMailbox *> m_Mailboxes;
+    unsigned int        m_RefreshEpoch; // non-zero while bars are refreshed (see CTwRefreshScope)
+    unsigned int        m_LastRefreshEpoch;
 
     std::string         m_Help;
     TwBar *             m_HelpBar;
@@ -121,7 +157,7 @@ struct CTwMgr
     bool                m_InfoBuildText;
     int                 m_BarInitColorHue;
     int                 FindBar(const char *_Name) const;
-    int                 HasAttrib(const char *_Attrib, bool *_HasValue) const;
+    int                 HasAttrib(const char *_Attrib, int _Len, bool *_HasValue) const;
     int                 SetAttrib(int _AttribID, const char *_Value);
     ERetType            GetAttrib(int _AttribID, std::vector<double>& outDouble, std::ostringstream& outString) const;
     void                SetLastError(const char *_StaticErrorMesssage); // _StaticErrorMesssage must be a static string
@@ -186,8 +222,10 @@ struct CTwMgr
         bool             m_CustomCaptureFocus;
         int              m_CustomIndexFirst;
         int              m_CustomIndexLast;
+        mutable unsigned int m_GetEpoch;    // refresh epoch of the last m_StructGetCallback call
         CStructProxy();
         ~CStructProxy();
+        void             GetStruct() const; // calls m_StructGetCallback at most once per refresh
     };
     struct CMemberProxy
     {
@@ -209,8 +247,22 @@ struct CTwMgr
     struct CEnum
     {
         std::string     m_Name;
-        typedef std::map<unsigned int, std::string> CEntries;
-        CEntries        m_Entries;
+        // Entries are sorted by value and their labels are packed in a single 
+        // buffer, each followed by '\0'. m_LabelOffsets has one more element 
+        // than m_Values.
+        std::vector<unsigned int> m_Values;
+        std::vector<unsigned int> m_LabelOffsets;
+        std::vector<char> m_Labels;
+        bool            m_Dense;        // m_Values are consecutive: the rank of a value is directly computed
+        mutable int     m_LastRank;     // rank of the last value found (Increment and popup lists look up neighbors)
+        struct CEntry   { unsigned int m_Value; const char *m_Label; int m_Length; };
+                        CEnum() : m_Dense(true), m_LastRank(0) { m_LabelOffsets.push_back(0); }
+        int             Size() const { return (int)m_Values.size(); }
+        int             Find(unsigned int _Value) const;    // rank of _Value, or -1
+        const char *    Label(int _Rank) const { return &m_Labels[m_LabelOffsets[_Rank]]; }
+        int             LabelLength(int _Rank) const { return (int)(m_LabelOffsets[_Rank+1]-m_LabelOffsets[_Rank])-1; }
+        void            Clear();
+        void            Insert(std::vector<CEntry>& _Entries);  // existing values are relabeled, the last duplicate wins
     };
     std::vector<CEnum>  m_Enums;
 
@@ -363,7 +415,61 @@ enum EMgrAttribs
     MGR_ICON_MARGIN,
     MGR_FONT_RESIZABLE,
     MGR_COLOR_SCHEME,
-    MGR_CONTAINED
+    MGR_CONTAINED,
+    MGR_VBO,
+    MGR_DRAW_CACHE,
+    MGR_DRAW_CALLS,
+    MGR_GL_STATE,
+    MGR_GL_CALLS
+};
+
+// "glstate" attrib. By default the OpenGL graph saves the whole GL state before
+// drawing (glPushAttrib and queries) and restores it after. In cooperative mode
+// the application declares the state groups that have their GL default value
+// when TwDraw is called: they are neither queried nor saved, and only the
+// state actually changed by the graph is reset after drawing (vertex array
+// pointers are not restored).
+enum EGLState
+{
+    GLSTATE_COOPERATIVE = 1<<0,
+    GLSTATE_CAPS        = 1<<1, // capabilities (depth test, blend, textures, clip planes...) disabled
+    GLSTATE_TEXUNITS    = 1<<2, // texture unit 0 active, no texture enabled in the other units
+    GLSTATE_VALUES      = 1<<3, // line width, polygon mode, texture env, blend func and equation, matrix mode
+    GLSTATE_BINDINGS    = 1<<4, // no texture, buffer object or program bound
+    GLSTATE_ARRAYS      = 1<<5, // client arrays disabled
+    GLSTATE_VIEWPORT    = 1<<6, // viewport covering the window set by TwWindowSize
+    GLSTATE_ALL         = (1<<7)-1
+};
+
+
+//  ---------------------------------------------------------------------------
+//  Attribute name lookup
+//  ---------------------------------------------------------------------------
+
+
+struct CTwAttribName
+{
+    const char *        m_Name;
+    int                 m_ID;
+    bool                m_HasValue;
+};
+
+// Perfect hash of a fixed list of attribute names (case insensitive): the
+// seed is chosen at construction so that each name has its own slot, so a
+// lookup costs one hash and one string comparison. Names are looked up from
+// a (pointer, length) view of the def string, they need not end with '\0'.
+class CTwAttribTable
+{
+public:
+                        CTwAttribTable(const CTwAttribName *_Names, int _NbNames);
+    int                 Find(const char *_Attrib, int _Len, bool *_HasValue) const; // returns 0 if not found (_HasValue is unchanged)
+    static bool         SameName(const char *_Name, const char *_Attrib, int _Len); // case insensitive, _Name is lower case
+protected:
+    const CTwAttribName*m_Names;
+    std::vector<signed char> m_Slots;   // index in m_Names, -1 for an empty slot
+    unsigned int        m_Seed;
+    unsigned int        m_Mask;
+    static unsigned int Hash(const char *_Str, int _Len, unsigned int _Seed);
 };
 
 
@@ -399,6 +505,8 @@ struct CColorExt
 //  ---------------------------------------------------------------------------
 
 
+struct CQuatMesh;
+
 struct CQuaternionExt
 {
     double               Qx, Qy, Qz, Qs;    // Quat value
@@ -430,15 +538,18 @@ struct CQuaternionExt
     void                 CopyToVar();
     static std::vector<float>   s_SphTri;
     static std::vector<color32> s_SphCol;
-    static std::vector<int>     s_SphTriProj;
-    static std::vector<color32> s_SphColLight;
     static std::vector<float>   s_ArrowTri[4];
-    static std::vector<int>     s_ArrowTriProj[4];
     static std::vector<float>   s_ArrowNorm[4];
-    static std::vector<color32> s_ArrowColLight[4];
     enum EArrowParts     { ARROW_CONE, ARROW_CONE_CAP, ARROW_CYL, ARROW_CYL_CAP };
+    static CQuatMesh     s_SphMesh;             // sphere scaled to its drawn radius
+    static CQuatMesh     s_ArrowMesh[3][2][4];  // [axis][without/with cone][part] arrows of the quaternion mode
+    static CQuatMesh     s_DirArrowMesh[4];     // [part] arrow of the direction mode
     static void          CreateSphere();
     static void          CreateArrow();
+    static void          CreateMeshes();
+    struct CProjCache;
+    CProjCache *         m_ProjCache;       // projected meshes of the last draw, allocated by DrawCB
+    static void          DeleteProjCache(void *_ExtValue);
     static void          ApplyQuat(float *outX, float *outY, float *outZ, float x, float y, float z, float qx, float qy, float qz, float qs);
     static void          QuatFromDir(double *outQx, double *outQy, double *outQz, double *outQs, double dx, double dy, double dz);
     inline void          Permute(float *outX, float *outY, float *outZ, float x, float y, float z);
@@ -482,6 +593,34 @@ private:
     unsigned int state0;
 };
 
+//  ---------------------------------------------------------------------------
+//  While a CTwRefreshScope object exists, the get callback of a struct var
+//  added with TwAddVarCB is called only once, and all the reads of its members
+//  are served from the fetched struct. Scopes can be nested.
+//  ---------------------------------------------------------------------------
+
+
+struct CTwRefreshScope
+{
+    CTwRefreshScope()
+    {
+        m_Outer = (g_TwMgr->m_RefreshEpoch!=0);
+        if( !m_Outer )
+        {
+            if( ++g_TwMgr->m_LastRefreshEpoch==0 )
+                g_TwMgr->m_LastRefreshEpoch = 1;
+            g_TwMgr->m_RefreshEpoch = g_TwMgr->m_LastRefreshEpoch;
+        }
+    }
+    ~CTwRefreshScope()
+    {
+        if( !m_Outer && g_TwMgr!=NULL ) // g_TwMgr may have been destroyed by a client callback
+            g_TwMgr->m_RefreshEpoch = 0;
+    }
+private:
+    bool m_Outer;
+};
+
 //  ---------------------------------------------------------------------------
 
 
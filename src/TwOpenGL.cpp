@@ -37,6 +37,9 @@ typedef void (APIENTRY * PFNGLClientActiveTextureARB)(GLenum texture);
 typedef void (APIENTRY * PFNGLBlendEquation)(GLenum mode);
 typedef void (APIENTRY * PFNGLBlendEquationSeparate)(GLenum srcMode, GLenum dstMode);
 typedef void (APIENTRY * PFNGLBlendFuncSeparate)(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+typedef void (APIENTRY * PFNGLGenBuffersARB)(GLsizei n, GLuint *buffers);
+typedef void (APIENTRY * PFNGLDeleteBuffersARB)(GLsizei n, const GLuint *buffers);
+typedef void (APIENTRY * PFNGLBufferDataARB)(GLenum target, ptrdiff_t size, const GLvoid *data, GLenum usage);
 PFNGLBindBufferARB _glBindBufferARB = NULL;
 PFNGLBindProgramARB _glBindProgramARB = NULL;
 PFNGLGetHandleARB _glGetHandleARB = NULL;
@@ -47,6 +50,9 @@ PFNGLClientActiveTextureARB _glClientActiveTextureARB = NULL;
 PFNGLBlendEquation _glBlendEquation = NULL;
 PFNGLBlendEquationSeparate _glBlendEquationSeparate = NULL;
 PFNGLBlendFuncSeparate _glBlendFuncSeparate = NULL;
+PFNGLGenBuffersARB _glGenBuffersARB = NULL;
+PFNGLDeleteBuffersARB _glDeleteBuffersARB = NULL;
+PFNGLBufferDataARB _glBufferDataARB = NULL;
 #ifndef GL_ARRAY_BUFFER_ARB
 #   define GL_ARRAY_BUFFER_ARB 0x8892
 #endif
@@ -59,6 +65,9 @@ PFNGLBlendFuncSeparate _glBlendFuncSeparate = NULL;
 #ifndef GL_ELEMENT_ARRAY_BUFFER_BINDING_ARB
 #   define GL_ELEMENT_ARRAY_BUFFER_BINDING_ARB 0x8895
 #endif
+#ifndef GL_STREAM_DRAW_ARB
+#   define GL_STREAM_DRAW_ARB 0x88E0
+#endif
 #ifndef GL_VERTEX_PROGRAM_ARB
 #   define GL_VERTEX_PROGRAM_ARB 0x8620
 #endif
@@ -137,6 +146,21 @@ PFNGLBlendFuncSeparate _glBlendFuncSeparate = NULL;
 
 static GLuint BindFont(const CTexFont *_Font)
 {
+    // The texture is white, the font bitmap gives its alpha. It is expanded
+    // here to luminance-alpha rather than by the pixel transfer biases, which
+    // would change the application GL state.
+    // The texel at (0, CharHeight+1) lies in the empty margin below the first 
+    // row of characters. It is made opaque so that untextured primitives can
+    // be drawn with the font texture bound, and thus batched with the text.
+    int NbTexels = _Font->m_TexWidth*_Font->m_TexHeight;
+    vector<unsigned char> TexBytes(2*NbTexels);
+    for( int i=0; i<NbTexels; ++i )
+    {
+        TexBytes[2*i+0] = 255;
+        TexBytes[2*i+1] = _Font->m_TexBytes[i];
+    }
+    TexBytes[2*(_Font->m_CharHeight+1)*_Font->m_TexWidth+1] = 255;
+
     GLuint TexID = 0;
     _glGenTextures(1, &TexID);
     _glBindTexture(GL_TEXTURE_2D, TexID);
@@ -146,22 +170,13 @@ static GLuint BindFont(const CTexFont *_Font)
     _glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
     _glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
     _glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    _glPixelTransferf(GL_ALPHA_SCALE, 1);
-    _glPixelTransferf(GL_ALPHA_BIAS, 0);
-    _glPixelTransferf(GL_RED_BIAS, 1);
-    _glPixelTransferf(GL_GREEN_BIAS, 1);
-    _glPixelTransferf(GL_BLUE_BIAS, 1);
-    _glTexImage2D(GL_TEXTURE_2D, 0, 4, _Font->m_TexWidth, _Font->m_TexHeight, 0, GL_ALPHA, GL_UNSIGNED_BYTE, _Font->m_TexBytes);
+    _glTexImage2D(GL_TEXTURE_2D, 0, 4, _Font->m_TexWidth, _Font->m_TexHeight, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, &(TexBytes[0]));
     _glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
     _glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
     _glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,GL_NEAREST);
     _glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,GL_NEAREST);
     _glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
     _glBindTexture(GL_TEXTURE_2D, 0);
-    _glPixelTransferf(GL_ALPHA_BIAS, 0);
-    _glPixelTransferf(GL_RED_BIAS, 0);
-    _glPixelTransferf(GL_GREEN_BIAS, 0);
-    _glPixelTransferf(GL_BLUE_BIAS, 0);
 
     return TexID;
 }
@@ -174,6 +189,18 @@ static void UnbindFont(GLuint _FontTexID)
 
 //  ---------------------------------------------------------------------------
 
+static inline color32 ToGLColor(color32 _Color)    // ARGB -> ABGR (RGBA bytes)
+{
+    return (_Color&0xff00ff00) | GLubyte(_Color>>16) | (GLubyte(_Color)<<16);
+}
+
+#define BUFFER_OFFSET(_Offset)  ((const GLvoid *)((const char *)NULL + (_Offset)))
+
+// GL calls issued while drawing are counted (see GetAPICallCount)
+#define GLCALL(_Fct)            (++m_NbGLCalls, _Fct)
+
+//  ---------------------------------------------------------------------------
+
 int CTwGraphOpenGL::Init()
 {
     if( LoadOpenGL()==0 )
@@ -186,6 +213,19 @@ int CTwGraphOpenGL::Init()
     m_FontTexID = 0;
     m_FontTex = NULL;
     m_MaxClipPlanes = -1;
+    m_MaxTexUnits = 1;
+    m_StateCaps.resize(0);  // built by the first BeginDraw
+    m_GLState = 0;
+    m_NbGLCalls = 0;
+    m_UseVBO = false;
+    m_BatchVBO = 0;
+    m_WhiteU = m_WhiteV = 0;
+    m_NbDrawCalls = 0;
+    m_CurBatchViewport = -1;
+    m_BatchBase = 0;
+    m_RecordCache = NULL;
+    m_RecordBroken = false;
+    m_FontGeneration = 0;
 
     // Get extensions
     _glBindBufferARB = reinterpret_cast<PFNGLBindBufferARB>(_glGetProcAddress("glBindBufferARB"));
@@ -198,6 +238,9 @@ int CTwGraphOpenGL::Init()
     _glBlendEquation = reinterpret_cast<PFNGLBlendEquation>(_glGetProcAddress("glBlendEquation"));
     _glBlendEquationSeparate = reinterpret_cast<PFNGLBlendEquationSeparate>(_glGetProcAddress("glBlendEquationSeparate"));
     _glBlendFuncSeparate = reinterpret_cast<PFNGLBlendFuncSeparate>(_glGetProcAddress("glBlendFuncSeparate"));
+    _glGenBuffersARB = reinterpret_cast<PFNGLGenBuffersARB>(_glGetProcAddress("glGenBuffersARB"));
+    _glDeleteBuffersARB = reinterpret_cast<PFNGLDeleteBuffersARB>(_glGetProcAddress("glDeleteBuffersARB"));
+    _glBufferDataARB = reinterpret_cast<PFNGLBufferDataARB>(_glGetProcAddress("glBufferDataARB"));
 
 #if !defined(ANT_OSX)
     const char *ext = (const char *)_glGetString(GL_EXTENSIONS);
@@ -216,7 +259,8 @@ int CTwGraphOpenGL::Shut()
 {
     assert(m_Drawing==false);
 
-    UnbindFont(m_FontTexID);
+    DeleteFontTexs();
+    DeleteBuffers();
 
     int Res = 1;
     if( UnloadOpenGL()==0 )
@@ -236,158 +280,155 @@ void CTwGraphOpenGL::BeginDraw(int _WndWidth, int _WndHeight)
     m_Drawing = true;
     m_WndWidth = _WndWidth;
     m_WndHeight = _WndHeight;
+    m_NbDrawCalls = 0;
+    m_NbGLCalls = 0;
+    m_UseVBO = g_TwMgr->m_UseVBO && _glBindBufferARB!=NULL && _glGenBuffersARB!=NULL && _glDeleteBuffersARB!=NULL && _glBufferDataARB!=NULL;
+    m_GLState = g_TwMgr->m_GLState;
+    bool Cooperative = (m_GLState & GLSTATE_COOPERATIVE)!=0;
 
     CHECK_GL_ERROR;
 
-    _glPushAttrib(GL_ALL_ATTRIB_BITS);
-    _glPushClientAttrib(GL_CLIENT_ALL_ATTRIB_BITS);
+    if( m_StateCaps.empty() )
+        InitStateShadow();
 
-    if( _glActiveTextureARB )
+    if( Cooperative )
+        SaveHostState();
+    else
     {
-        _glGetIntegerv(GL_ACTIVE_TEXTURE_ARB, &m_PrevActiveTextureARB);
-        int maxTexUnits = 1;
-        _glGetIntegerv(GL_MAX_TEXTURE_UNITS_ARB, &maxTexUnits);
-        maxTexUnits = max(1, min(32, maxTexUnits));
-        for( int i=0; i<maxTexUnits; ++i )
-        {
-            _glActiveTextureARB(GL_TEXTURE0_ARB+i);
-            m_PrevActiveTexture1D[i] = _glIsEnabled(GL_TEXTURE_1D);
-            m_PrevActiveTexture2D[i] = _glIsEnabled(GL_TEXTURE_2D);
-            m_PrevActiveTexture3D[i] = _glIsEnabled(GL_TEXTURE_3D);
-            _glDisable(GL_TEXTURE_1D);
-            _glDisable(GL_TEXTURE_2D);
-            _glDisable(GL_TEXTURE_3D);
-        }
-        _glActiveTextureARB(GL_TEXTURE0_ARB);
-    }
-
-    _glMatrixMode(GL_TEXTURE);
-    _glPushMatrix();
-    _glLoadIdentity();
-    _glMatrixMode(GL_MODELVIEW);
-    _glPushMatrix();
-    _glLoadIdentity();
-    _glMatrixMode(GL_PROJECTION);
-    _glPushMatrix();
-    GLint Vp[4];
-    _glGetIntegerv(GL_VIEWPORT, Vp);
-    /*
-    if( _WndWidth>0 && _WndHeight>0 )
+        GLCALL(_glPushAttrib)(GL_ALL_ATTRIB_BITS);
+        GLCALL(_glPushClientAttrib)(GL_CLIENT_ALL_ATTRIB_BITS);
+        SaveTexUnits(0);
+    }
+
+    m_ViewportInit[0] = 0;
+    m_ViewportInit[1] = 0;
+    m_ViewportInit[2] = _WndWidth-1;
+    m_ViewportInit[3] = _WndHeight-1;
+    GLCALL(_glMatrixMode)(GL_TEXTURE);
+    GLCALL(_glPushMatrix)();
+    GLCALL(_glLoadIdentity)();
+    GLCALL(_glMatrixMode)(GL_MODELVIEW);
+    GLCALL(_glPushMatrix)();
+    GLCALL(_glLoadIdentity)();
+    GLCALL(_glMatrixMode)(GL_PROJECTION);
+    GLCALL(_glPushMatrix)();
+    GLCALL(_glLoadIdentity)();
+    GLCALL(_glOrtho)(0, m_ViewportInit[2], m_ViewportInit[3], 0, -1, 1);
+    m_CurBatchViewport = -1;
+    memcpy(m_DrawState.m_Viewport, m_ViewportInit, sizeof(m_ViewportInit));
+
+    if( Cooperative )
     {
-        Vp[0] = 0;
-        Vp[1] = 0;
-        Vp[2] = _WndWidth;
-        Vp[3] = _WndHeight;
-        _glViewport(Vp[0], Vp[1], Vp[2], Vp[3]);
+        // The state set by FlushBatches before each draw call keeps its host
+        // value until then, and the element array buffer is not used.
+        m_DrawState.m_Caps[CAP_TEXTURE_2D] = m_HostState.m_Caps[CAP_TEXTURE_2D];
+        m_DrawState.m_Caps[CAP_LINE_SMOOTH] = m_HostState.m_Caps[CAP_LINE_SMOOTH];
+        m_DrawState.m_Arrays[ARRAY_VERTEX] = m_HostState.m_Arrays[ARRAY_VERTEX];
+        m_DrawState.m_Arrays[ARRAY_TEXCOORD] = m_HostState.m_Arrays[ARRAY_TEXCOORD];
+        m_DrawState.m_Arrays[ARRAY_COLOR] = m_HostState.m_Arrays[ARRAY_COLOR];
+        m_DrawState.m_Texture = m_HostState.m_Texture;
+        m_DrawState.m_ArrayBuffer = m_HostState.m_ArrayBuffer;
+        m_DrawState.m_ElementArrayBuffer = m_HostState.m_ElementArrayBuffer;
+        m_CurState = m_HostState;
+        ApplyState(m_DrawState);
+        CHECK_GL_ERROR;
+        return;
     }
-    _glLoadIdentity();
-    //_glOrtho(Vp[0], Vp[0]+Vp[2]-1, Vp[1]+Vp[3]-1, Vp[1], -1, 1); // Doesn't work
-    _glOrtho(Vp[0], Vp[0]+Vp[2], Vp[1]+Vp[3], Vp[1], -1, 1);
-    */
-    if( _WndWidth>0 && _WndHeight>0 )
-    {
-        Vp[0] = 0;
-        Vp[1] = 0;
-        Vp[2] = _WndWidth-1;
-        Vp[3] = _WndHeight-1;
-        _glViewport(Vp[0], Vp[1], Vp[2], Vp[3]);
-    }
-    _glLoadIdentity();
-    _glOrtho(Vp[0], Vp[0]+Vp[2], Vp[1]+Vp[3], Vp[1], -1, 1);
-    _glGetIntegerv(GL_VIEWPORT, m_ViewportInit);
-    _glGetFloatv(GL_PROJECTION_MATRIX, m_ProjMatrixInit);
-
-    _glGetFloatv(GL_LINE_WIDTH, &m_PrevLineWidth);
-    _glDisable(GL_POLYGON_STIPPLE);
-    _glLineWidth(1);
-    _glDisable(GL_LINE_SMOOTH);
-    _glDisable(GL_LINE_STIPPLE);
-    _glDisable(GL_CULL_FACE);
-    _glDisable(GL_DEPTH_TEST);
-    _glDisable(GL_LIGHTING);
-    _glEnable(GL_BLEND);
-    _glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    _glGetTexEnviv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, &m_PrevTexEnv);
-    _glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-    _glGetIntegerv(GL_POLYGON_MODE, m_PrevPolygonMode);
-    _glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    _glDisable(GL_ALPHA_TEST);
+
+    GLCALL(_glViewport)(m_ViewportInit[0], m_ViewportInit[1], m_ViewportInit[2], m_ViewportInit[3]);
+    GLCALL(_glGetFloatv)(GL_LINE_WIDTH, &m_PrevLineWidth);
+    GLCALL(_glDisable)(GL_POLYGON_STIPPLE);
+    GLCALL(_glLineWidth)(1);
+    GLCALL(_glDisable)(GL_LINE_SMOOTH);
+    GLCALL(_glDisable)(GL_LINE_STIPPLE);
+    GLCALL(_glDisable)(GL_CULL_FACE);
+    GLCALL(_glDisable)(GL_DEPTH_TEST);
+    GLCALL(_glDisable)(GL_LIGHTING);
+    GLCALL(_glEnable)(GL_BLEND);
+    GLCALL(_glBlendFunc)(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLCALL(_glGetTexEnviv)(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, &m_PrevTexEnv);
+    GLCALL(_glTexEnvi)(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    GLCALL(_glGetIntegerv)(GL_POLYGON_MODE, m_PrevPolygonMode);
+    GLCALL(_glPolygonMode)(GL_FRONT_AND_BACK, GL_FILL);
+    GLCALL(_glDisable)(GL_ALPHA_TEST);
     //_glEnable(GL_ALPHA_TEST);
     //_glAlphaFunc(GL_GREATER, 0);
-    _glDisable(GL_FOG);
-    _glDisable(GL_LOGIC_OP);
-    _glDisable(GL_SCISSOR_TEST);
-    if( m_MaxClipPlanes<0 )
-    {
-        _glGetIntegerv(GL_MAX_CLIP_PLANES, &m_MaxClipPlanes);
-        if( m_MaxClipPlanes<0 || m_MaxClipPlanes>255 )
-            m_MaxClipPlanes = 6;
-    }
+    GLCALL(_glDisable)(GL_FOG);
+    GLCALL(_glDisable)(GL_LOGIC_OP);
+    GLCALL(_glDisable)(GL_SCISSOR_TEST);
     for( int i=0; i<m_MaxClipPlanes; ++i )
-        _glDisable(GL_CLIP_PLANE0+i);
+        GLCALL(_glDisable)(GL_CLIP_PLANE0+i);
     m_PrevTexture = 0;
-    _glGetIntegerv(GL_TEXTURE_BINDING_2D, &m_PrevTexture);
+    GLCALL(_glGetIntegerv)(GL_TEXTURE_BINDING_2D, &m_PrevTexture);
 
-    _glDisableClientState(GL_VERTEX_ARRAY);
-    _glDisableClientState(GL_NORMAL_ARRAY);
-    _glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-    _glDisableClientState(GL_INDEX_ARRAY);
-    _glDisableClientState(GL_COLOR_ARRAY);
-    _glDisableClientState(GL_EDGE_FLAG_ARRAY);
+    GLCALL(_glDisableClientState)(GL_VERTEX_ARRAY);
+    GLCALL(_glDisableClientState)(GL_NORMAL_ARRAY);
+    GLCALL(_glDisableClientState)(GL_TEXTURE_COORD_ARRAY);
+    GLCALL(_glDisableClientState)(GL_INDEX_ARRAY);
+    GLCALL(_glDisableClientState)(GL_COLOR_ARRAY);
+    GLCALL(_glDisableClientState)(GL_EDGE_FLAG_ARRAY);
 
     if( _glBindBufferARB!=NULL )
     {
         m_PrevArrayBufferARB = m_PrevElementArrayBufferARB = 0;
-        _glGetIntegerv(GL_ARRAY_BUFFER_BINDING_ARB, &m_PrevArrayBufferARB);
-        _glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING_ARB, &m_PrevElementArrayBufferARB);
-        _glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-        _glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+        GLCALL(_glGetIntegerv)(GL_ARRAY_BUFFER_BINDING_ARB, &m_PrevArrayBufferARB);
+        GLCALL(_glGetIntegerv)(GL_ELEMENT_ARRAY_BUFFER_BINDING_ARB, &m_PrevElementArrayBufferARB);
+        GLCALL(_glBindBufferARB)(GL_ARRAY_BUFFER_ARB, 0);
+        GLCALL(_glBindBufferARB)(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
     }
     if( _glBindProgramARB!=NULL )
     {
-        m_PrevVertexProgramARB = _glIsEnabled(GL_VERTEX_PROGRAM_ARB);
-        m_PrevFragmentProgramARB = _glIsEnabled(GL_FRAGMENT_PROGRAM_ARB);
-        _glDisable(GL_VERTEX_PROGRAM_ARB);
-        _glDisable(GL_FRAGMENT_PROGRAM_ARB);
+        m_PrevVertexProgramARB = GLCALL(_glIsEnabled)(GL_VERTEX_PROGRAM_ARB);
+        m_PrevFragmentProgramARB = GLCALL(_glIsEnabled)(GL_FRAGMENT_PROGRAM_ARB);
+        GLCALL(_glDisable)(GL_VERTEX_PROGRAM_ARB);
+        GLCALL(_glDisable)(GL_FRAGMENT_PROGRAM_ARB);
     }
     if( _glGetHandleARB!=NULL && _glUseProgramObjectARB!=NULL )
     {
-        m_PrevProgramObjectARB = _glGetHandleARB(GL_PROGRAM_OBJECT_ARB);
-        _glUseProgramObjectARB(0);
+        m_PrevProgramObjectARB = GLCALL(_glGetHandleARB)(GL_PROGRAM_OBJECT_ARB);
+        GLCALL(_glUseProgramObjectARB)(0);
     }
-    _glDisable(GL_TEXTURE_1D);
-    _glDisable(GL_TEXTURE_2D);
+    GLCALL(_glDisable)(GL_TEXTURE_1D);
+    GLCALL(_glDisable)(GL_TEXTURE_2D);
     if( _glTexImage3D!=NULL )
     {
-        m_PrevTexture3D = _glIsEnabled(GL_TEXTURE_3D);
-        _glDisable(GL_TEXTURE_3D);
+        m_PrevTexture3D = GLCALL(_glIsEnabled)(GL_TEXTURE_3D);
+        GLCALL(_glDisable)(GL_TEXTURE_3D);
     }
 
     if( m_SupportTexRect )
     {
-        m_PrevTexRectARB = _glIsEnabled(GL_TEXTURE_RECTANGLE_ARB);
-        _glDisable(GL_TEXTURE_RECTANGLE_ARB);
+        m_PrevTexRectARB = GLCALL(_glIsEnabled)(GL_TEXTURE_RECTANGLE_ARB);
+        GLCALL(_glDisable)(GL_TEXTURE_RECTANGLE_ARB);
     }
     if( _glBlendEquationSeparate!=NULL )
     {
-        _glGetIntegerv(GL_BLEND_EQUATION_RGB, &m_PrevBlendEquationRGB);
-        _glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &m_PrevBlendEquationAlpha);
-        _glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+        GLCALL(_glGetIntegerv)(GL_BLEND_EQUATION_RGB, &m_PrevBlendEquationRGB);
+        GLCALL(_glGetIntegerv)(GL_BLEND_EQUATION_ALPHA, &m_PrevBlendEquationAlpha);
+        GLCALL(_glBlendEquationSeparate)(GL_FUNC_ADD, GL_FUNC_ADD);
     }
     if( _glBlendFuncSeparate!=NULL )
     {
-        _glGetIntegerv(GL_BLEND_SRC_RGB, &m_PrevBlendSrcRGB);
-        _glGetIntegerv(GL_BLEND_DST_RGB, &m_PrevBlendDstRGB);
-        _glGetIntegerv(GL_BLEND_SRC_ALPHA, &m_PrevBlendSrcAlpha);
-        _glGetIntegerv(GL_BLEND_DST_ALPHA, &m_PrevBlendDstAlpha);
-        _glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GLCALL(_glGetIntegerv)(GL_BLEND_SRC_RGB, &m_PrevBlendSrcRGB);
+        GLCALL(_glGetIntegerv)(GL_BLEND_DST_RGB, &m_PrevBlendDstRGB);
+        GLCALL(_glGetIntegerv)(GL_BLEND_SRC_ALPHA, &m_PrevBlendSrcAlpha);
+        GLCALL(_glGetIntegerv)(GL_BLEND_DST_ALPHA, &m_PrevBlendDstAlpha);
+        GLCALL(_glBlendFuncSeparate)(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     }
     if( _glBlendEquation!=NULL )
     {
-        _glGetIntegerv(GL_BLEND_EQUATION, &m_PrevBlendEquation);
-        _glBlendEquation(GL_FUNC_ADD);
+        GLCALL(_glGetIntegerv)(GL_BLEND_EQUATION, &m_PrevBlendEquation);
+        GLCALL(_glBlendEquation)(GL_FUNC_ADD);
     }
 
+    // state set above
+    m_CurState = m_DrawState;
+    m_CurState.m_Caps[CAP_TEXTURE_2D] = m_CurState.m_Caps[CAP_LINE_SMOOTH] = GL_FALSE;
+    for( int i=0; i<NB_STATE_ARRAYS; ++i )
+        m_CurState.m_Arrays[i] = GL_FALSE;
+    m_CurState.m_Texture = m_PrevTexture;
+    m_CurState.m_ArrayBuffer = m_CurState.m_ElementArrayBuffer = 0;
+
     CHECK_GL_ERROR;
 }
 
@@ -396,66 +437,363 @@ void CTwGraphOpenGL::BeginDraw(int _WndWidth, int _WndHeight)
 void CTwGraphOpenGL::EndDraw()
 {
     assert(m_Drawing==true);
+    FlushBatches();
     m_Drawing = false;
 
-    _glBindTexture(GL_TEXTURE_2D, m_PrevTexture);
+    if( m_GLState & GLSTATE_COOPERATIVE )
+    {
+        ApplyState(m_HostState);
+        GLCALL(_glMatrixMode)(GL_PROJECTION);
+        GLCALL(_glPopMatrix)();
+        GLCALL(_glMatrixMode)(GL_TEXTURE);
+        GLCALL(_glPopMatrix)();
+        GLCALL(_glMatrixMode)(GL_MODELVIEW);
+        GLCALL(_glPopMatrix)();
+        if( m_HostState.m_MatrixMode!=GL_MODELVIEW )
+            GLCALL(_glMatrixMode)(m_HostState.m_MatrixMode);
+        if( (m_GLState & GLSTATE_TEXUNITS)==0 )
+            RestoreTexUnits(1);
+        CHECK_GL_ERROR;
+        return;
+    }
+
+    GLCALL(_glBindTexture)(GL_TEXTURE_2D, m_PrevTexture);
     if( _glBindBufferARB!=NULL )
     {
-        _glBindBufferARB(GL_ARRAY_BUFFER_ARB, m_PrevArrayBufferARB);
-        _glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, m_PrevElementArrayBufferARB);
+        GLCALL(_glBindBufferARB)(GL_ARRAY_BUFFER_ARB, m_PrevArrayBufferARB);
+        GLCALL(_glBindBufferARB)(GL_ELEMENT_ARRAY_BUFFER_ARB, m_PrevElementArrayBufferARB);
     }
     if( _glBindProgramARB!=NULL )
     {
         if( m_PrevVertexProgramARB )
-            _glEnable(GL_VERTEX_PROGRAM_ARB);
+            GLCALL(_glEnable)(GL_VERTEX_PROGRAM_ARB);
         if( m_PrevFragmentProgramARB )
-            _glEnable(GL_FRAGMENT_PROGRAM_ARB);
+            GLCALL(_glEnable)(GL_FRAGMENT_PROGRAM_ARB);
     }
     if( _glGetHandleARB!=NULL && _glUseProgramObjectARB!=NULL )
-        _glUseProgramObjectARB(m_PrevProgramObjectARB);
+        GLCALL(_glUseProgramObjectARB)(m_PrevProgramObjectARB);
     if( _glTexImage3D!=NULL && m_PrevTexture3D )
-        _glEnable(GL_TEXTURE_3D);
+        GLCALL(_glEnable)(GL_TEXTURE_3D);
     if( m_SupportTexRect && m_PrevTexRectARB )
-        _glEnable(GL_TEXTURE_RECTANGLE_ARB);
+        GLCALL(_glEnable)(GL_TEXTURE_RECTANGLE_ARB);
     if( _glBlendEquation!=NULL )
-        _glBlendEquation(m_PrevBlendEquation);
+        GLCALL(_glBlendEquation)(m_PrevBlendEquation);
     if( _glBlendEquationSeparate!=NULL )
-        _glBlendEquationSeparate(m_PrevBlendEquationRGB, m_PrevBlendEquationAlpha);
+        GLCALL(_glBlendEquationSeparate)(m_PrevBlendEquationRGB, m_PrevBlendEquationAlpha);
     if( _glBlendFuncSeparate!=NULL )
-        _glBlendFuncSeparate(m_PrevBlendSrcRGB, m_PrevBlendDstRGB, m_PrevBlendSrcAlpha, m_PrevBlendDstAlpha);
+        GLCALL(_glBlendFuncSeparate)(m_PrevBlendSrcRGB, m_PrevBlendDstRGB, m_PrevBlendSrcAlpha, m_PrevBlendDstAlpha);
     
-    _glPolygonMode(GL_FRONT, m_PrevPolygonMode[0]);
-    _glPolygonMode(GL_BACK, m_PrevPolygonMode[1]);
-    _glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, m_PrevTexEnv);
-    _glLineWidth(m_PrevLineWidth);
-    _glMatrixMode(GL_PROJECTION);
-    _glPopMatrix();
-    _glMatrixMode(GL_MODELVIEW);
-    _glPopMatrix();
-    _glMatrixMode(GL_TEXTURE);
-    _glPopMatrix();
-    _glPopClientAttrib();
-    _glPopAttrib();
-
-    if( _glActiveTextureARB )
-    {
-        int maxTexUnits = 1;
-        _glGetIntegerv(GL_MAX_TEXTURE_UNITS_ARB, &maxTexUnits);
-        maxTexUnits = max(1, min(32, maxTexUnits));
-        for( int i=0; i<maxTexUnits; ++i )
+    GLCALL(_glPolygonMode)(GL_FRONT, m_PrevPolygonMode[0]);
+    GLCALL(_glPolygonMode)(GL_BACK, m_PrevPolygonMode[1]);
+    GLCALL(_glTexEnvi)(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, m_PrevTexEnv);
+    GLCALL(_glLineWidth)(m_PrevLineWidth);
+    GLCALL(_glMatrixMode)(GL_PROJECTION);
+    GLCALL(_glPopMatrix)();
+    GLCALL(_glMatrixMode)(GL_MODELVIEW);
+    GLCALL(_glPopMatrix)();
+    GLCALL(_glMatrixMode)(GL_TEXTURE);
+    GLCALL(_glPopMatrix)();
+    GLCALL(_glPopClientAttrib)();
+    GLCALL(_glPopAttrib)();
+    RestoreTexUnits(0);
+
+    CHECK_GL_ERROR;
+}
+
+//  ---------------------------------------------------------------------------
+
+// Saves the textures enabled in the units from _FirstUnit and disables them, then activates unit 0
+void CTwGraphOpenGL::SaveTexUnits(int _FirstUnit)
+{
+    if( _glActiveTextureARB==NULL )
+        return;
+    GLCALL(_glGetIntegerv)(GL_ACTIVE_TEXTURE_ARB, &m_PrevActiveTextureARB);
+    for( int i=_FirstUnit; i<m_MaxTexUnits; ++i )
+    {
+        GLCALL(_glActiveTextureARB)(GL_TEXTURE0_ARB+i);
+        m_PrevActiveTexture1D[i] = GLCALL(_glIsEnabled)(GL_TEXTURE_1D);
+        m_PrevActiveTexture2D[i] = GLCALL(_glIsEnabled)(GL_TEXTURE_2D);
+        m_PrevActiveTexture3D[i] = GLCALL(_glIsEnabled)(GL_TEXTURE_3D);
+        if( _FirstUnit==0 )
+        {
+            GLCALL(_glDisable)(GL_TEXTURE_1D);
+            GLCALL(_glDisable)(GL_TEXTURE_2D);
+            GLCALL(_glDisable)(GL_TEXTURE_3D);
+        }
+        else
         {
-            _glActiveTextureARB(GL_TEXTURE0_ARB+i);
             if( m_PrevActiveTexture1D[i] )
-                _glEnable(GL_TEXTURE_1D);
+                GLCALL(_glDisable)(GL_TEXTURE_1D);
             if( m_PrevActiveTexture2D[i] )
-                _glEnable(GL_TEXTURE_2D);
+                GLCALL(_glDisable)(GL_TEXTURE_2D);
             if( m_PrevActiveTexture3D[i] )
-                _glEnable(GL_TEXTURE_3D);
+                GLCALL(_glDisable)(GL_TEXTURE_3D);
         }
-        _glActiveTextureARB(m_PrevActiveTextureARB);
     }
+    if( _FirstUnit<m_MaxTexUnits || m_PrevActiveTextureARB!=GL_TEXTURE0_ARB )
+        GLCALL(_glActiveTextureARB)(GL_TEXTURE0_ARB);
+}
 
-    CHECK_GL_ERROR;
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::RestoreTexUnits(int _FirstUnit)
+{
+    if( _glActiveTextureARB==NULL )
+        return;
+    bool Activated = false;
+    for( int i=_FirstUnit; i<m_MaxTexUnits; ++i )
+    {
+        if( _FirstUnit>0 && !m_PrevActiveTexture1D[i] && !m_PrevActiveTexture2D[i] && !m_PrevActiveTexture3D[i] )
+            continue;   // nothing disabled in this unit
+        GLCALL(_glActiveTextureARB)(GL_TEXTURE0_ARB+i);
+        Activated = true;
+        if( m_PrevActiveTexture1D[i] )
+            GLCALL(_glEnable)(GL_TEXTURE_1D);
+        if( m_PrevActiveTexture2D[i] )
+            GLCALL(_glEnable)(GL_TEXTURE_2D);
+        if( m_PrevActiveTexture3D[i] )
+            GLCALL(_glEnable)(GL_TEXTURE_3D);
+    }
+    if( Activated || m_PrevActiveTextureARB!=GL_TEXTURE0_ARB )
+        GLCALL(_glActiveTextureARB)(m_PrevActiveTextureARB);
+}
+
+//  ---------------------------------------------------------------------------
+
+// Lists the capabilities disabled while drawing, and sets the default and draw states
+void CTwGraphOpenGL::InitStateShadow()
+{
+    m_MaxTexUnits = 1;
+    if( _glActiveTextureARB!=NULL )
+    {
+        GLCALL(_glGetIntegerv)(GL_MAX_TEXTURE_UNITS_ARB, &m_MaxTexUnits);
+        m_MaxTexUnits = max(1, min(32, (int)m_MaxTexUnits));
+    }
+    GLCALL(_glGetIntegerv)(GL_MAX_CLIP_PLANES, &m_MaxClipPlanes);
+    if( m_MaxClipPlanes<0 || m_MaxClipPlanes>255 )
+        m_MaxClipPlanes = 6;
+
+    static const GLenum Caps[] = { GL_TEXTURE_2D, GL_LINE_SMOOTH, GL_BLEND, GL_POLYGON_STIPPLE, GL_LINE_STIPPLE, GL_CULL_FACE, GL_DEPTH_TEST, GL_LIGHTING, GL_ALPHA_TEST, GL_FOG, GL_LOGIC_OP, GL_SCISSOR_TEST, GL_TEXTURE_1D };
+    m_StateCaps.assign(Caps, Caps+sizeof(Caps)/sizeof(Caps[0]));
+    for( int i=0; i<m_MaxClipPlanes; ++i )
+        m_StateCaps.push_back(GL_CLIP_PLANE0+i);
+    if( _glBindProgramARB!=NULL )
+    {
+        m_StateCaps.push_back(GL_VERTEX_PROGRAM_ARB);
+        m_StateCaps.push_back(GL_FRAGMENT_PROGRAM_ARB);
+    }
+    if( _glTexImage3D!=NULL )
+        m_StateCaps.push_back(GL_TEXTURE_3D);
+    if( m_SupportTexRect )
+        m_StateCaps.push_back(GL_TEXTURE_RECTANGLE_ARB);
+
+    CGLState& Def = m_DefaultState;
+    Def.m_Caps.assign(m_StateCaps.size(), GL_FALSE);
+    for( int i=0; i<NB_STATE_ARRAYS; ++i )
+        Def.m_Arrays[i] = GL_FALSE;
+    Def.m_LineWidth = 1;
+    Def.m_PolygonMode[0] = Def.m_PolygonMode[1] = GL_FILL;
+    Def.m_TexEnv = GL_MODULATE;
+    Def.m_BlendFunc[0] = Def.m_BlendFunc[2] = GL_ONE;
+    Def.m_BlendFunc[1] = Def.m_BlendFunc[3] = GL_ZERO;
+    Def.m_BlendEquation[0] = Def.m_BlendEquation[1] = GL_FUNC_ADD;
+    Def.m_MatrixMode = GL_MODELVIEW;
+    Def.m_Texture = 0;
+    Def.m_ArrayBuffer = 0;
+    Def.m_ElementArrayBuffer = 0;
+    Def.m_ProgramObject = 0;
+    Def.m_Viewport[0] = Def.m_Viewport[1] = Def.m_Viewport[2] = Def.m_Viewport[3] = 0;
+
+    m_DrawState = Def;
+    m_DrawState.m_Caps[CAP_BLEND] = GL_TRUE;
+    m_DrawState.m_BlendFunc[0] = m_DrawState.m_BlendFunc[2] = GL_SRC_ALPHA;
+    m_DrawState.m_BlendFunc[1] = m_DrawState.m_BlendFunc[3] = GL_ONE_MINUS_SRC_ALPHA;
+}
+
+//  ---------------------------------------------------------------------------
+
+// Reads the host state that is not guaranteed by the application (cooperative mode)
+void CTwGraphOpenGL::SaveHostState()
+{
+    if( (m_GLState & GLSTATE_TEXUNITS)==0 )
+        SaveTexUnits(1);    // before the caps of unit 0 are read
+
+    CGLState& Host = m_HostState;
+    Host = m_DefaultState;
+    if( (m_GLState & GLSTATE_CAPS)==0 )
+        for( size_t i=0; i<m_StateCaps.size(); ++i )
+            Host.m_Caps[i] = GLCALL(_glIsEnabled)(m_StateCaps[i]);
+    if( (m_GLState & GLSTATE_ARRAYS)==0 )
+    {
+        static const GLenum Arrays[NB_STATE_ARRAYS] = { GL_VERTEX_ARRAY, GL_NORMAL_ARRAY, GL_TEXTURE_COORD_ARRAY, GL_INDEX_ARRAY, GL_COLOR_ARRAY, GL_EDGE_FLAG_ARRAY };
+        for( int i=0; i<NB_STATE_ARRAYS; ++i )
+            Host.m_Arrays[i] = GLCALL(_glIsEnabled)(Arrays[i]);
+    }
+    if( (m_GLState & GLSTATE_VALUES)==0 )
+    {
+        GLCALL(_glGetFloatv)(GL_LINE_WIDTH, &Host.m_LineWidth);
+        GLCALL(_glGetIntegerv)(GL_POLYGON_MODE, Host.m_PolygonMode);
+        GLCALL(_glGetTexEnviv)(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, &Host.m_TexEnv);
+        if( _glBlendFuncSeparate!=NULL )
+        {
+            GLCALL(_glGetIntegerv)(GL_BLEND_SRC_RGB, &Host.m_BlendFunc[0]);
+            GLCALL(_glGetIntegerv)(GL_BLEND_DST_RGB, &Host.m_BlendFunc[1]);
+            GLCALL(_glGetIntegerv)(GL_BLEND_SRC_ALPHA, &Host.m_BlendFunc[2]);
+            GLCALL(_glGetIntegerv)(GL_BLEND_DST_ALPHA, &Host.m_BlendFunc[3]);
+        }
+        else
+        {
+            GLCALL(_glGetIntegerv)(GL_BLEND_SRC, &Host.m_BlendFunc[0]);
+            GLCALL(_glGetIntegerv)(GL_BLEND_DST, &Host.m_BlendFunc[1]);
+            Host.m_BlendFunc[2] = Host.m_BlendFunc[0];
+            Host.m_BlendFunc[3] = Host.m_BlendFunc[1];
+        }
+        if( _glBlendEquationSeparate!=NULL )
+        {
+            GLCALL(_glGetIntegerv)(GL_BLEND_EQUATION_RGB, &Host.m_BlendEquation[0]);
+            GLCALL(_glGetIntegerv)(GL_BLEND_EQUATION_ALPHA, &Host.m_BlendEquation[1]);
+        }
+        else if( _glBlendEquation!=NULL )
+        {
+            GLCALL(_glGetIntegerv)(GL_BLEND_EQUATION, &Host.m_BlendEquation[0]);
+            Host.m_BlendEquation[1] = Host.m_BlendEquation[0];
+        }
+        GLCALL(_glGetIntegerv)(GL_MATRIX_MODE, &Host.m_MatrixMode);
+    }
+    if( (m_GLState & GLSTATE_BINDINGS)==0 )
+    {
+        GLCALL(_glGetIntegerv)(GL_TEXTURE_BINDING_2D, &Host.m_Texture);
+        if( _glBindBufferARB!=NULL )
+        {
+            GLCALL(_glGetIntegerv)(GL_ARRAY_BUFFER_BINDING_ARB, &Host.m_ArrayBuffer);
+            GLCALL(_glGetIntegerv)(GL_ELEMENT_ARRAY_BUFFER_BINDING_ARB, &Host.m_ElementArrayBuffer);
+        }
+        if( _glGetHandleARB!=NULL && _glUseProgramObjectARB!=NULL )
+            Host.m_ProgramObject = GLCALL(_glGetHandleARB)(GL_PROGRAM_OBJECT_ARB);
+    }
+    if( (m_GLState & GLSTATE_VIEWPORT)==0 )
+        GLCALL(_glGetIntegerv)(GL_VIEWPORT, Host.m_Viewport);
+    else
+    {
+        Host.m_Viewport[2] = m_WndWidth;
+        Host.m_Viewport[3] = m_WndHeight;
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+// Issues the changes needed to go from m_CurState to _State (but the matrix mode)
+void CTwGraphOpenGL::ApplyState(const CGLState& _State)
+{
+    CGLState& Cur = m_CurState;
+    assert(&_State!=&Cur && _State.m_Caps.size()==Cur.m_Caps.size());
+    for( size_t i=0; i<Cur.m_Caps.size(); ++i )
+        SetCap((int)i, _State.m_Caps[i]!=GL_FALSE);
+    for( int i=0; i<NB_STATE_ARRAYS; ++i )
+        SetArray(i, _State.m_Arrays[i]!=GL_FALSE);
+    if( _State.m_LineWidth!=Cur.m_LineWidth )
+        GLCALL(_glLineWidth)(_State.m_LineWidth);
+    if( _State.m_PolygonMode[0]!=Cur.m_PolygonMode[0] || _State.m_PolygonMode[1]!=Cur.m_PolygonMode[1] )
+    {
+        if( _State.m_PolygonMode[0]==_State.m_PolygonMode[1] )
+            GLCALL(_glPolygonMode)(GL_FRONT_AND_BACK, _State.m_PolygonMode[0]);
+        else
+        {
+            GLCALL(_glPolygonMode)(GL_FRONT, _State.m_PolygonMode[0]);
+            GLCALL(_glPolygonMode)(GL_BACK, _State.m_PolygonMode[1]);
+        }
+    }
+    if( _State.m_TexEnv!=Cur.m_TexEnv )
+        GLCALL(_glTexEnvi)(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, _State.m_TexEnv);
+    if( memcmp(_State.m_BlendFunc, Cur.m_BlendFunc, sizeof(Cur.m_BlendFunc))!=0 )
+    {
+        if( _glBlendFuncSeparate!=NULL )
+            GLCALL(_glBlendFuncSeparate)(_State.m_BlendFunc[0], _State.m_BlendFunc[1], _State.m_BlendFunc[2], _State.m_BlendFunc[3]);
+        else
+            GLCALL(_glBlendFunc)(_State.m_BlendFunc[0], _State.m_BlendFunc[1]);
+    }
+    if( _State.m_BlendEquation[0]!=Cur.m_BlendEquation[0] || _State.m_BlendEquation[1]!=Cur.m_BlendEquation[1] )
+    {
+        if( _glBlendEquationSeparate!=NULL )
+            GLCALL(_glBlendEquationSeparate)(_State.m_BlendEquation[0], _State.m_BlendEquation[1]);
+        else if( _glBlendEquation!=NULL )
+            GLCALL(_glBlendEquation)(_State.m_BlendEquation[0]);
+    }
+    SetTexture(_State.m_Texture);
+    SetArrayBuffer(_State.m_ArrayBuffer);
+    if( _State.m_ElementArrayBuffer!=Cur.m_ElementArrayBuffer && _glBindBufferARB!=NULL )
+        GLCALL(_glBindBufferARB)(GL_ELEMENT_ARRAY_BUFFER_ARB, _State.m_ElementArrayBuffer);
+    if( _State.m_ProgramObject!=Cur.m_ProgramObject && _glUseProgramObjectARB!=NULL )
+        GLCALL(_glUseProgramObjectARB)(_State.m_ProgramObject);
+    SetViewport(_State.m_Viewport);
+    GLint MatrixMode = Cur.m_MatrixMode;
+    Cur = _State;
+    Cur.m_MatrixMode = MatrixMode;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::SetCap(int _Cap, bool _Enabled)
+{
+    GLboolean Enabled = _Enabled ? GL_TRUE : GL_FALSE;
+    if( m_CurState.m_Caps[_Cap]!=Enabled )
+    {
+        if( _Enabled )
+            GLCALL(_glEnable)(m_StateCaps[_Cap]);
+        else
+            GLCALL(_glDisable)(m_StateCaps[_Cap]);
+        m_CurState.m_Caps[_Cap] = Enabled;
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::SetArray(int _Array, bool _Enabled)
+{
+    static const GLenum Arrays[NB_STATE_ARRAYS] = { GL_VERTEX_ARRAY, GL_NORMAL_ARRAY, GL_TEXTURE_COORD_ARRAY, GL_INDEX_ARRAY, GL_COLOR_ARRAY, GL_EDGE_FLAG_ARRAY };
+    GLboolean Enabled = _Enabled ? GL_TRUE : GL_FALSE;
+    if( m_CurState.m_Arrays[_Array]!=Enabled )
+    {
+        if( _Enabled )
+            GLCALL(_glEnableClientState)(Arrays[_Array]);
+        else
+            GLCALL(_glDisableClientState)(Arrays[_Array]);
+        m_CurState.m_Arrays[_Array] = Enabled;
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::SetTexture(GLint _TexID)
+{
+    if( m_CurState.m_Texture!=_TexID )
+    {
+        GLCALL(_glBindTexture)(GL_TEXTURE_2D, _TexID);
+        m_CurState.m_Texture = _TexID;
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::SetArrayBuffer(GLint _BufferID)
+{
+    if( m_CurState.m_ArrayBuffer!=_BufferID && _glBindBufferARB!=NULL )
+    {
+        GLCALL(_glBindBufferARB)(GL_ARRAY_BUFFER_ARB, _BufferID);
+        m_CurState.m_ArrayBuffer = _BufferID;
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::SetViewport(const GLint *_Viewport)
+{
+    GLint *Cur = m_CurState.m_Viewport;
+    if( Cur[0]!=_Viewport[0] || Cur[1]!=_Viewport[1] || Cur[2]!=_Viewport[2] || Cur[3]!=_Viewport[3] )
+    {
+        GLCALL(_glViewport)(_Viewport[0], _Viewport[1], _Viewport[2], _Viewport[3]);
+        memcpy(Cur, _Viewport, 4*sizeof(GLint));
+    }
 }
 
 //  ---------------------------------------------------------------------------
@@ -469,11 +807,152 @@ bool CTwGraphOpenGL::IsDrawing()
 
 void CTwGraphOpenGL::Restore()
 {
-    UnbindFont(m_FontTexID);
-    m_FontTexID = 0;
-    m_FontTex = NULL;
+    m_BatchVerts.resize(0);
+    m_Batches.resize(0);
+    m_BatchViewports.resize(0);
+    m_CurBatchViewport = -1;
+    m_BatchBase = 0;
+    DeleteFontTexs();
+    DeleteBuffers();
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::DeleteBuffers()
+{
+    if( m_BatchVBO!=0 && _glDeleteBuffersARB!=NULL )
+        _glDeleteBuffersARB(1, &m_BatchVBO);
+    m_BatchVBO = 0;
+}
+
+//  ---------------------------------------------------------------------------
+
+CTwGraphOpenGL::CBatchVertex *CTwGraphOpenGL::AddBatchVerts(GLenum _Mode, bool _AntiAliased, int _NbVerts)
+{
+    assert(m_Drawing==true && _NbVerts>0);
+    int First = (int)m_BatchVerts.size();
+    if( m_Batches.size()<=m_BatchBase || m_Batches.back().m_Mode!=_Mode || m_Batches.back().m_TexID!=m_FontTexID || m_Batches.back().m_AntiAliased!=_AntiAliased || m_Batches.back().m_Viewport!=m_CurBatchViewport )
+    {
+        CBatch Batch;
+        Batch.m_Mode = _Mode;
+        Batch.m_TexID = m_FontTexID;
+        Batch.m_AntiAliased = _AntiAliased;
+        Batch.m_Viewport = m_CurBatchViewport;
+        Batch.m_First = First;
+        Batch.m_Count = 0;
+        m_Batches.push_back(Batch);
+    }
+    m_Batches.back().m_Count += _NbVerts;
+    m_BatchVerts.resize(First+_NbVerts);
+    return &(m_BatchVerts[First]);
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::AddBatchQuad(GLfloat _X0, GLfloat _Y0, GLfloat _X1, GLfloat _Y1, color32 _Color00, color32 _Color10, color32 _Color01, color32 _Color11)
+{
+    CBatchVertex *v = AddBatchVerts(GL_TRIANGLES, false, 6);
+    v[0].x = _X0; v[0].y = _Y0; v[0].c = _Color00;
+    v[1].x = _X1; v[1].y = _Y0; v[1].c = _Color10;
+    v[2].x = _X0; v[2].y = _Y1; v[2].c = _Color01;
+    v[3].x = _X1; v[3].y = _Y0; v[3].c = _Color10;
+    v[4].x = _X1; v[4].y = _Y1; v[4].c = _Color11;
+    v[5].x = _X0; v[5].y = _Y1; v[5].c = _Color01;
+    for( int i=0; i<6; ++i )
+    {
+        v[i].u = m_WhiteU;
+        v[i].v = m_WhiteV;
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::FlushBatches()
+{
+    if( m_Batches.empty() )
+        return;
+    if( m_RecordCache!=NULL )
+        m_RecordBroken = true;  // recorded batches are gone
+
+    const char *Base = (const char *)&(m_BatchVerts[0]);
+    if( m_UseVBO )
+    {
+        if( m_BatchVBO==0 )
+            GLCALL(_glGenBuffersARB)(1, &m_BatchVBO);
+        SetArrayBuffer(m_BatchVBO);
+        // the whole frame is (re)specified at once: the driver orphans the previous storage
+        GLCALL(_glBufferDataARB)(GL_ARRAY_BUFFER_ARB, m_BatchVerts.size()*sizeof(CBatchVertex), Base, GL_STREAM_DRAW_ARB);
+        Base = NULL;
+    }
+    else
+        SetArrayBuffer(0);
+
+    // arrays, texture and line smooth are set through the state shadow and
+    // left as they are after the draw calls: EndDraw restores them
+    GLCALL(_glMatrixMode)(GL_MODELVIEW);
+    GLCALL(_glLoadIdentity)();
+    SetArray(ARRAY_VERTEX, true);
+    SetArray(ARRAY_TEXCOORD, true);
+    SetArray(ARRAY_COLOR, true);
+    GLCALL(_glVertexPointer)(2, GL_FLOAT, sizeof(CBatchVertex), Base);
+    GLCALL(_glTexCoordPointer)(2, GL_FLOAT, sizeof(CBatchVertex), Base+2*sizeof(GLfloat));
+    GLCALL(_glColorPointer)(4, GL_UNSIGNED_BYTE, sizeof(CBatchVertex), Base+4*sizeof(GLfloat));
+
+    int Viewport = -1;
+    for( size_t i=0; i<m_Batches.size(); ++i )
+    {
+        const CBatch& Batch = m_Batches[i];
+        if( Batch.m_Viewport!=Viewport )
+        {
+            ApplyBatchViewport(Batch.m_Viewport);
+            Viewport = Batch.m_Viewport;
+        }
+        SetCap(CAP_TEXTURE_2D, Batch.m_TexID!=0);
+        if( Batch.m_TexID!=0 )
+            SetTexture(Batch.m_TexID);
+        SetCap(CAP_LINE_SMOOTH, Batch.m_AntiAliased);
+        GLCALL(_glDrawArrays)(Batch.m_Mode, Batch.m_First, Batch.m_Count);
+        ++m_NbDrawCalls;
+    }
+
+    if( Viewport!=-1 )
+        ApplyBatchViewport(-1);
+
+    m_BatchVerts.resize(0);
+    m_Batches.resize(0);
+    m_BatchBase = 0;
+    if( m_CurBatchViewport>=0 )
+    {
+        // keep the current viewport for the next primitives
+        CBatchViewport Vp = m_BatchViewports[m_CurBatchViewport];
+        m_BatchViewports.resize(1);
+        m_BatchViewports[0] = Vp;
+        m_CurBatchViewport = 0;
+    }
+    else
+        m_BatchViewports.resize(0);
 }
 
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::ApplyBatchViewport(int _Viewport)
+{
+    // called by FlushBatches: matrix mode is GL_MODELVIEW
+    GLCALL(_glMatrixMode)(GL_PROJECTION);
+    GLCALL(_glLoadIdentity)();
+    if( _Viewport<0 )
+    {
+        SetViewport(m_ViewportInit);
+        GLCALL(_glOrtho)(0, m_ViewportInit[2], m_ViewportInit[3], 0, -1, 1);   // as set by BeginDraw
+    }
+    else
+    {
+        const CBatchViewport& Vp = m_BatchViewports[_Viewport];
+        SetViewport(Vp.m_Viewport);
+        GLCALL(_glOrtho)(Vp.m_Ortho[0], Vp.m_Ortho[1], Vp.m_Ortho[2], Vp.m_Ortho[3], -1, 1);
+    }
+    GLCALL(_glMatrixMode)(GL_MODELVIEW);
+}
 
 //  ---------------------------------------------------------------------------
 
@@ -495,22 +974,40 @@ void CTwGraphOpenGL::DrawLine(int _X0, int _Y0, int _X1, int _Y1, color32 _Color
     const GLfloat dx = +0.5f;
     //GLfloat dy = -0.2f;
     const GLfloat dy = -0.5f;
-    if( _AntiAliased )
-        _glEnable(GL_LINE_SMOOTH);
-    else
-        _glDisable(GL_LINE_SMOOTH);
-    _glDisable(GL_TEXTURE_2D);
-    _glMatrixMode(GL_MODELVIEW);
-    _glLoadIdentity();
-    _glBegin(GL_LINES);
-        _glColor4ub(GLubyte(_Color0>>16), GLubyte(_Color0>>8), GLubyte(_Color0), GLubyte(_Color0>>24));
-        _glVertex2f((GLfloat)_X0+dx, (GLfloat)_Y0+dy);
-        _glColor4ub(GLubyte(_Color1>>16), GLubyte(_Color1>>8), GLubyte(_Color1), GLubyte(_Color1>>24));
-        _glVertex2f((GLfloat)_X1+dx, (GLfloat)_Y1+dy);
-        //_glVertex2i(_X0, _Y0);
-        //_glVertex2i(_X1, _Y1);
-    _glEnd();
-    _glDisable(GL_LINE_SMOOTH);
+
+    if( !_AntiAliased && (_X0==_X1 || _Y0==_Y1) )
+    {
+        // Horizontal and vertical lines are batched as 1-pixel wide quads 
+        // covering the pixels defined by the GL line rasterization rule 
+        // (first pixel included, last pixel excluded).
+        if( _X0==_X1 && _Y0==_Y1 )
+            return;
+        color32 c0 = ToGLColor(_Color0);
+        color32 c1 = ToGLColor(_Color1);
+        if( _Y0==_Y1 )
+        {
+            GLfloat y0 = (GLfloat)_Y0+dy-0.5f;
+            if( _X0<_X1 )
+                AddBatchQuad((GLfloat)_X0, y0, (GLfloat)_X1, y0+1, c0, c1, c0, c1);
+            else
+                AddBatchQuad((GLfloat)(_X1+1), y0, (GLfloat)(_X0+1), y0+1, c1, c0, c1, c0);
+        }
+        else
+        {
+            GLfloat x0 = (GLfloat)_X0+dx-0.5f;
+            if( _Y0<_Y1 )
+                AddBatchQuad(x0, (GLfloat)_Y0+dy-0.5f, x0+1, (GLfloat)_Y1+dy-0.5f, c0, c0, c1, c1);
+            else
+                AddBatchQuad(x0, (GLfloat)_Y1+dy+0.5f, x0+1, (GLfloat)_Y0+dy+0.5f, c1, c1, c0, c0);
+        }
+        return;
+    }
+
+    CBatchVertex *v = AddBatchVerts(GL_LINES, _AntiAliased, 2);
+    v[0].x = (GLfloat)_X0+dx; v[0].y = (GLfloat)_Y0+dy; v[0].c = ToGLColor(_Color0);
+    v[1].x = (GLfloat)_X1+dx; v[1].y = (GLfloat)_Y1+dy; v[1].c = ToGLColor(_Color1);
+    v[0].u = v[1].u = m_WhiteU;
+    v[0].v = v[1].v = m_WhiteV;
 }
   
 //  ---------------------------------------------------------------------------
@@ -542,25 +1039,7 @@ void CTwGraphOpenGL::DrawRect(int _X0, int _Y0, int _X1, int _Y1, color32 _Color
     const GLfloat dx = +0.0f;
     const GLfloat dy = +0.0f;
 
-    _glDisable(GL_TEXTURE_2D);
-    _glMatrixMode(GL_MODELVIEW);
-    _glLoadIdentity();
-    //GLubyte r = GLubyte(_Color>>16);
-    //GLubyte g = GLubyte(_Color>>8);
-    //GLubyte b = GLubyte(_Color);
-    //GLubyte a = GLubyte(_Color>>24);
-    //_glColor4ub(GLubyte(_Color>>16), GLubyte(_Color>>8), GLubyte(_Color), GLubyte(_Color>>24));
-    //_glColor4ub(r, g, b, a);
-    _glBegin(GL_QUADS);
-        _glColor4ub(GLubyte(_Color00>>16), GLubyte(_Color00>>8), GLubyte(_Color00), GLubyte(_Color00>>24));
-        _glVertex2f((GLfloat)_X0+dx, (GLfloat)_Y0+dy);
-        _glColor4ub(GLubyte(_Color10>>16), GLubyte(_Color10>>8), GLubyte(_Color10), GLubyte(_Color10>>24));
-        _glVertex2f((GLfloat)_X1+dx, (GLfloat)_Y0+dy);
-        _glColor4ub(GLubyte(_Color11>>16), GLubyte(_Color11>>8), GLubyte(_Color11), GLubyte(_Color11>>24));
-        _glVertex2f((GLfloat)_X1+dx, (GLfloat)_Y1+dy);
-        _glColor4ub(GLubyte(_Color01>>16), GLubyte(_Color01>>8), GLubyte(_Color01), GLubyte(_Color01>>24));
-        _glVertex2f((GLfloat)_X0+dx, (GLfloat)_Y1+dy);
-    _glEnd();
+    AddBatchQuad((GLfloat)_X0+dx, (GLfloat)_Y0+dy, (GLfloat)_X1+dx, (GLfloat)_Y1+dy, ToGLColor(_Color00), ToGLColor(_Color10), ToGLColor(_Color01), ToGLColor(_Color11));
 }
 
 //  ---------------------------------------------------------------------------
@@ -572,6 +1051,47 @@ void *CTwGraphOpenGL::NewTextObj()
 
 //  ---------------------------------------------------------------------------
 
+void CTwGraphOpenGL::SetFontTex(const CTexFont *_Font)
+{
+    if( _Font==m_FontTex )
+        return;
+
+    // a texture is created the first time a font is used, and then reused
+    GLuint TexID = 0;
+    for( size_t i=0; i<m_FontTexs.size() && TexID==0; ++i )
+        if( m_FontTexs[i].m_Font==_Font )
+            TexID = m_FontTexs[i].m_TexID;
+    if( TexID==0 )
+    {
+        CFontTex FontTex;
+        FontTex.m_Font = _Font;
+        _glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+        FontTex.m_TexID = TexID = BindFont(_Font);
+        _glPopClientAttrib();
+        m_FontTexs.push_back(FontTex);
+        m_CurState.m_Texture = 0;   // texture binding and env left by BindFont
+        m_CurState.m_TexEnv = GL_MODULATE;
+    }
+    m_FontTexID = TexID;
+    m_FontTex = _Font;
+    m_WhiteU = 0.5f/(GLfloat)_Font->m_TexWidth;
+    m_WhiteV = ((GLfloat)_Font->m_CharHeight+1.5f)/(GLfloat)_Font->m_TexHeight;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::DeleteFontTexs()
+{
+    for( size_t i=0; i<m_FontTexs.size(); ++i )
+        UnbindFont(m_FontTexs[i].m_TexID);
+    m_FontTexs.resize(0);
+    m_FontTexID = 0;
+    m_FontTex = NULL;
+    ++m_FontGeneration; // cached batches may refer to the deleted textures
+}
+
+//  ---------------------------------------------------------------------------
+
 void CTwGraphOpenGL::DeleteTextObj(void *_TextObj)
 {
     assert(_TextObj!=NULL);
@@ -586,85 +1106,74 @@ void CTwGraphOpenGL::BuildText(void *_TextObj, const std::string *_TextLines, co
     assert(_TextObj!=NULL);
     assert(_Font!=NULL);
 
-    if( _Font != m_FontTex )
-    {
-        UnbindFont(m_FontTexID);
-        m_FontTexID = BindFont(_Font);
-        m_FontTex = _Font;
-    }
     CTextObj *TextObj = static_cast<CTextObj *>(_TextObj);
-    TextObj->m_TextVerts.resize(0);
-    TextObj->m_TextUVs.resize(0);
-    TextObj->m_BgVerts.resize(0);
-    TextObj->m_Colors.resize(0);
-    TextObj->m_BgColors.resize(0);
-
-    int x, x1, y, y1, i, Len;
-    unsigned char ch;
-    const unsigned char *Text;
-    color32 LineColor = COLOR32_RED;
+    TextObj->m_Font = _Font;
+    TextObj->m_BgWidth = _BgWidth;
+    TextObj->m_LineColors = (_LineColors!=NULL);
+    TextObj->m_LineBgColors = (_LineBgColors!=NULL && _BgWidth>0);
+    TextObj->m_Lines.resize(_NbLines);
+    TextObj->m_Glyphs.resize(0);
+
+    size_t NbChars = 0;
+    for( int Line=0; Line<_NbLines; ++Line )
+        NbChars += _TextLines[Line].length();
+    TextObj->m_Glyphs.reserve(NbChars);
+
     for( int Line=0; Line<_NbLines; ++Line )
     {
-        x = 0;
-        y = Line * (_Font->m_CharHeight+_Sep);
-        y1 = y+_Font->m_CharHeight;
-        Len = (int)_TextLines[Line].length();
-        Text = (const unsigned char *)(_TextLines[Line].c_str());
-        if( _LineColors!=NULL )
-            LineColor = (_LineColors[Line]&0xff00ff00) | GLubyte(_LineColors[Line]>>16) | (GLubyte(_LineColors[Line])<<16);
+        CTextLine& TextLine = TextObj->m_Lines[Line];
+        int y = Line * (_Font->m_CharHeight+_Sep);
+        TextLine.m_FirstGlyph = (int)TextObj->m_Glyphs.size();
+        TextLine.m_Y0 = (GLfloat)y;
+        TextLine.m_Y1 = (GLfloat)(y+_Font->m_CharHeight);
+        TextLine.m_Color = (_LineColors!=NULL) ? ToGLColor(_LineColors[Line]) : 0;
+        TextLine.m_BgColor = TextObj->m_LineBgColors ? ToGLColor(_LineBgColors[Line]) : 0;
+        AppendTextLine(TextObj->m_Glyphs, _TextLines[Line], y, _Font);
+    }
+}
 
-        for( i=0; i<Len; ++i )
-        {
-            ch = Text[i];
-            x1 = x + _Font->m_CharWidth[ch];
-
-            TextObj->m_TextVerts.push_back(Vec2(x , y ));
-            TextObj->m_TextVerts.push_back(Vec2(x1, y ));
-            TextObj->m_TextVerts.push_back(Vec2(x , y1));
-            TextObj->m_TextVerts.push_back(Vec2(x1, y ));
-            TextObj->m_TextVerts.push_back(Vec2(x1, y1));
-            TextObj->m_TextVerts.push_back(Vec2(x , y1));
-
-            TextObj->m_TextUVs.push_back(Vec2(_Font->m_CharU0[ch], _Font->m_CharV0[ch]));
-            TextObj->m_TextUVs.push_back(Vec2(_Font->m_CharU1[ch], _Font->m_CharV0[ch]));
-            TextObj->m_TextUVs.push_back(Vec2(_Font->m_CharU0[ch], _Font->m_CharV1[ch]));
-            TextObj->m_TextUVs.push_back(Vec2(_Font->m_CharU1[ch], _Font->m_CharV0[ch]));
-            TextObj->m_TextUVs.push_back(Vec2(_Font->m_CharU1[ch], _Font->m_CharV1[ch]));
-            TextObj->m_TextUVs.push_back(Vec2(_Font->m_CharU0[ch], _Font->m_CharV1[ch]));
-
-            if( _LineColors!=NULL )
-            {
-                TextObj->m_Colors.push_back(LineColor);
-                TextObj->m_Colors.push_back(LineColor);
-                TextObj->m_Colors.push_back(LineColor);
-                TextObj->m_Colors.push_back(LineColor);
-                TextObj->m_Colors.push_back(LineColor);
-                TextObj->m_Colors.push_back(LineColor);
-            }
+//  ---------------------------------------------------------------------------
 
-            x = x1;
-        }
-        if( _BgWidth>0 )
-        {
-            TextObj->m_BgVerts.push_back(Vec2(-1        , y ));
-            TextObj->m_BgVerts.push_back(Vec2(_BgWidth+1, y ));
-            TextObj->m_BgVerts.push_back(Vec2(-1        , y1));
-            TextObj->m_BgVerts.push_back(Vec2(_BgWidth+1, y ));
-            TextObj->m_BgVerts.push_back(Vec2(_BgWidth+1, y1));
-            TextObj->m_BgVerts.push_back(Vec2(-1        , y1));
-
-            if( _LineBgColors!=NULL )
-            {
-                color32 LineBgColor = (_LineBgColors[Line]&0xff00ff00) | GLubyte(_LineBgColors[Line]>>16) | (GLubyte(_LineBgColors[Line])<<16);
-                TextObj->m_BgColors.push_back(LineBgColor);
-                TextObj->m_BgColors.push_back(LineBgColor);
-                TextObj->m_BgColors.push_back(LineBgColor);
-                TextObj->m_BgColors.push_back(LineBgColor);
-                TextObj->m_BgColors.push_back(LineBgColor);
-                TextObj->m_BgColors.push_back(LineBgColor);
-            }
-        }
-    }
+void CTwGraphOpenGL::AppendTextLine(std::vector<CGlyph>& _Glyphs, const std::string& _TextLine, int _Y, const CTexFont *_Font)
+{
+    int Len = (int)_TextLine.length();
+    if( Len==0 )
+        return;
+    size_t First = _Glyphs.size();
+    _Glyphs.resize(First+Len);
+    TwBuildGlyphQuads(&(_Glyphs[First]), (const unsigned char *)(_TextLine.c_str()), Len, _Y, _Font);
+}
+
+//  ---------------------------------------------------------------------------
+
+bool CTwGraphOpenGL::UpdateTextLine(void *_TextObj, int _Line, const std::string& _TextLine, color32 _LineColor, color32 _LineBgColor, const CTexFont *_Font, int _Sep)
+{
+    assert(m_Drawing==true);
+    assert(_TextObj!=NULL);
+    assert(_Font!=NULL);
+    CTextObj *TextObj = static_cast<CTextObj *>(_TextObj);
+    if( _Font!=TextObj->m_Font || _Line<0 || _Line>=(int)TextObj->m_Lines.size() )
+        return false;   // BuildText is required
+
+    // Build the new glyphs of the line, then replace the previous ones
+    std::vector<CGlyph>& NewGlyphs = m_TextLineGlyphs;
+    NewGlyphs.resize(0);
+    AppendTextLine(NewGlyphs, _TextLine, _Line*(_Font->m_CharHeight+_Sep), _Font);
+
+    size_t First = TextObj->m_Lines[_Line].m_FirstGlyph;
+    size_t Count = TextObj->LineEnd(_Line) - First;
+    ReplaceRange(TextObj->m_Glyphs, First, Count, NewGlyphs);
+    int Delta = (int)NewGlyphs.size() - (int)Count;
+    if( Delta!=0 )
+        for( size_t l=_Line+1; l<TextObj->m_Lines.size(); ++l )
+            TextObj->m_Lines[l].m_FirstGlyph += Delta;
+
+    if( TextObj->m_LineColors )
+        TextObj->m_Lines[_Line].m_Color = ToGLColor(_LineColor);
+    if( TextObj->m_LineBgColors )
+        TextObj->m_Lines[_Line].m_BgColor = ToGLColor(_LineBgColor);
+
+    return true;
 }
 
 //  ---------------------------------------------------------------------------
@@ -675,53 +1184,69 @@ void CTwGraphOpenGL::DrawText(void *_TextObj, int _X, int _Y, color32 _Color, co
     assert(_TextObj!=NULL);
     CTextObj *TextObj = static_cast<CTextObj *>(_TextObj);
 
-    if( TextObj->m_TextVerts.size()<4 && TextObj->m_BgVerts.size()<4 )
+    int NbLines = (int)TextObj->m_Lines.size();
+    bool DrawBg = ( NbLines>0 && TextObj->m_BgWidth>0 && (_BgColor!=0 || TextObj->m_LineBgColors) );
+    if( TextObj->m_Glyphs.size()==0 && !DrawBg )
         return; // nothing to draw
-
-    _glMatrixMode(GL_MODELVIEW);
-    _glLoadIdentity();
-    _glTranslatef((GLfloat)_X, (GLfloat)_Y, 0);
-    _glEnableClientState(GL_VERTEX_ARRAY);
-    if( (_BgColor!=0 || TextObj->m_BgColors.size()==TextObj->m_BgVerts.size()) && TextObj->m_BgVerts.size()>=4 )
+    if( TextObj->m_Font!=NULL )
+        SetFontTex(TextObj->m_Font);
+
+    // Quads are expanded to triangles (translated by _X,_Y) into the frame batch
+    GLfloat x = (GLfloat)_X;
+    GLfloat y = (GLfloat)_Y;
+    int Line;
+    CBatchVertex *v;
+    if( DrawBg )
     {
-        _glDisable(GL_TEXTURE_2D);
-        _glVertexPointer(2, GL_FLOAT, 0, &(TextObj->m_BgVerts[0]));
-        if( TextObj->m_BgColors.size()==TextObj->m_BgVerts.size() && _BgColor==0 )
+        v = AddBatchVerts(GL_TRIANGLES, false, 6*NbLines);
+        bool PerLineColors = ( TextObj->m_LineBgColors && _BgColor==0 );
+        color32 c = ToGLColor(_BgColor);
+        GLfloat x0 = x - 1;
+        GLfloat x1 = x + (GLfloat)(TextObj->m_BgWidth+1);
+        for( Line=0; Line<NbLines; ++Line, v+=6 )
         {
-            _glEnableClientState(GL_COLOR_ARRAY);
-            _glColorPointer(4, GL_UNSIGNED_BYTE, 0, &(TextObj->m_BgColors[0]));
-        }
-        else
-        {
-            _glDisableClientState(GL_COLOR_ARRAY);
-            _glColor4ub(GLubyte(_BgColor>>16), GLubyte(_BgColor>>8), GLubyte(_BgColor), GLubyte(_BgColor>>24));
+            const CTextLine& TextLine = TextObj->m_Lines[Line];
+            GLfloat y0 = TextLine.m_Y0 + y;
+            GLfloat y1 = TextLine.m_Y1 + y;
+            v[0].x = x0; v[0].y = y0;
+            v[1].x = x1; v[1].y = y0;
+            v[2].x = x0; v[2].y = y1;
+            v[3].x = x1; v[3].y = y0;
+            v[4].x = x1; v[4].y = y1;
+            v[5].x = x0; v[5].y = y1;
+            color32 LineColor = PerLineColors ? TextLine.m_BgColor : c;
+            for( int i=0; i<6; ++i )
+            {
+                v[i].u = m_WhiteU;
+                v[i].v = m_WhiteV;
+                v[i].c = LineColor;
+            }
         }
-        _glDrawArrays(GL_TRIANGLES, 0, (int)TextObj->m_BgVerts.size());
     }
-    _glEnable(GL_TEXTURE_2D);
-    _glBindTexture(GL_TEXTURE_2D, m_FontTexID);
-    _glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    if( TextObj->m_TextVerts.size()>=4 )
+    if( TextObj->m_Glyphs.size()>0 )
     {
-        _glVertexPointer(2, GL_FLOAT, 0, &(TextObj->m_TextVerts[0]));
-        _glTexCoordPointer(2, GL_FLOAT, 0, &(TextObj->m_TextUVs[0]));
-        if( TextObj->m_Colors.size()==TextObj->m_TextVerts.size() && _Color==0 )
-        {
-            _glEnableClientState(GL_COLOR_ARRAY);
-            _glColorPointer(4, GL_UNSIGNED_BYTE, 0, &(TextObj->m_Colors[0]));
-        }
-        else
+        v = AddBatchVerts(GL_TRIANGLES, false, 6*(int)TextObj->m_Glyphs.size());
+        bool PerLineColors = ( TextObj->m_LineColors && _Color==0 );
+        color32 c = ToGLColor(_Color);
+        for( Line=0; Line<NbLines; ++Line )
         {
-            _glDisableClientState(GL_COLOR_ARRAY);
-            _glColor4ub(GLubyte(_Color>>16), GLubyte(_Color>>8), GLubyte(_Color), GLubyte(_Color>>24));
+            color32 LineColor = PerLineColors ? TextObj->m_Lines[Line].m_Color : c;
+            const CGlyph *g = &(TextObj->m_Glyphs[0]) + TextObj->m_Lines[Line].m_FirstGlyph;
+            const CGlyph *gEnd = &(TextObj->m_Glyphs[0]) + TextObj->LineEnd(Line);
+            for( ; g<gEnd; ++g, v+=6 )
+            {
+                GLfloat x0 = g->x0 + x, x1 = g->x1 + x;
+                GLfloat y0 = g->y0 + y, y1 = g->y1 + y;
+                v[0].x = x0; v[0].y = y0; v[0].u = g->u0; v[0].v = g->v0;
+                v[1].x = x1; v[1].y = y0; v[1].u = g->u1; v[1].v = g->v0;
+                v[2].x = x0; v[2].y = y1; v[2].u = g->u0; v[2].v = g->v1;
+                v[3].x = x1; v[3].y = y0; v[3].u = g->u1; v[3].v = g->v0;
+                v[4].x = x1; v[4].y = y1; v[4].u = g->u1; v[4].v = g->v1;
+                v[5].x = x0; v[5].y = y1; v[5].u = g->u0; v[5].v = g->v1;
+                v[0].c = v[1].c = v[2].c = v[3].c = v[4].c = v[5].c = LineColor;
+            }
         }
-
-        _glDrawArrays(GL_TRIANGLES, 0, (int)TextObj->m_TextVerts.size());
     }
-    
-    _glDisableClientState(GL_VERTEX_ARRAY);
-    _glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-    _glDisableClientState(GL_COLOR_ARRAY);
 }
 
 //  ---------------------------------------------------------------------------
@@ -730,19 +1255,18 @@ void CTwGraphOpenGL::ChangeViewport(int _X0, int _Y0, int _Width, int _Height, i
 {
     if( _Width>0 && _Height>0 )
     {
-        GLint vp[4];
-        vp[0] = _X0;
-        vp[1] = _Y0;
-        vp[2] = _Width-1;
-        vp[3] = _Height-1;
-        _glViewport(vp[0], m_WndHeight-vp[1]-vp[3], vp[2], vp[3]);
-
-        GLint matrixMode = 0;
-        _glGetIntegerv(GL_MATRIX_MODE, &matrixMode);
-        _glMatrixMode(GL_PROJECTION);
-        _glLoadIdentity();
-        _glOrtho(_OffsetX, _OffsetX+vp[2], vp[3]-_OffsetY, -_OffsetY, -1, 1);
-        _glMatrixMode(matrixMode);
+        // the viewport is applied by FlushBatches
+        CBatchViewport Vp;
+        Vp.m_Viewport[0] = _X0;
+        Vp.m_Viewport[1] = m_WndHeight-_Y0-(_Height-1);
+        Vp.m_Viewport[2] = _Width-1;
+        Vp.m_Viewport[3] = _Height-1;
+        Vp.m_Ortho[0] = _OffsetX;
+        Vp.m_Ortho[1] = _OffsetX+Vp.m_Viewport[2];
+        Vp.m_Ortho[2] = Vp.m_Viewport[3]-_OffsetY;
+        Vp.m_Ortho[3] = -_OffsetY;
+        m_CurBatchViewport = (int)m_BatchViewports.size();
+        m_BatchViewports.push_back(Vp);
     }
 }
 
@@ -750,55 +1274,136 @@ void CTwGraphOpenGL::ChangeViewport(int _X0, int _Y0, int _Width, int _Height, i
 
 void CTwGraphOpenGL::RestoreViewport()
 {
-    _glViewport(m_ViewportInit[0], m_ViewportInit[1], m_ViewportInit[2], m_ViewportInit[3]);
-
-    GLint matrixMode = 0;
-    _glGetIntegerv(GL_MATRIX_MODE, &matrixMode);
-    _glMatrixMode(GL_PROJECTION);
-    _glLoadMatrixf(m_ProjMatrixInit);
-    _glMatrixMode(matrixMode);
+    m_CurBatchViewport = -1;
 }
 
 //  ---------------------------------------------------------------------------
 
+static inline bool IsTriangleVisible(const int *_Vertices, ITwGraph::Cull _CullMode)
+{
+    // twice the signed area in window coordinates (y down): >0 for clockwise triangles
+    int Area2 = (_Vertices[2]-_Vertices[0])*(_Vertices[5]-_Vertices[1]) - (_Vertices[4]-_Vertices[0])*(_Vertices[3]-_Vertices[1]);
+    if( _CullMode==ITwGraph::CULL_CW )
+        return Area2<0;
+    else if( _CullMode==ITwGraph::CULL_CCW )
+        return Area2>0;
+    else
+        return Area2!=0;
+}
+
 void CTwGraphOpenGL::DrawTriangles(int _NumTriangles, int *_Vertices, color32 *_Colors, Cull _CullMode)
 {
     assert(m_Drawing==true);
 
-    const GLfloat dx = +0.0f;
-    const GLfloat dy = +0.0f;
+    if( _NumTriangles<=0 )
+        return;
+
+    // Culling is done here rather than through GL state so that triangles can
+    // be batched with the other primitives. Vertices are added for all the
+    // triangles in one pass, and those of the culled triangles are removed.
+    CBatchVertex *v0 = AddBatchVerts(GL_TRIANGLES, false, 3*_NumTriangles);
+    CBatchVertex *v = v0;
+    for( int i=0; i<_NumTriangles; ++i )
+        if( IsTriangleVisible(_Vertices+6*i, _CullMode) )
+            for( int j=3*i; j<3*i+3; ++j, ++v )
+            {
+                v->x = (GLfloat)_Vertices[2*j+0];
+                v->y = (GLfloat)_Vertices[2*j+1];
+                v->u = m_WhiteU;
+                v->v = m_WhiteV;
+                v->c = ToGLColor(_Colors[j]);
+            }
+    int NbCulled = 3*_NumTriangles - (int)(v-v0);
+    if( NbCulled>0 )
+    {
+        m_BatchVerts.resize(m_BatchVerts.size()-NbCulled);
+        if( (m_Batches.back().m_Count-=NbCulled)==0 )
+            m_Batches.pop_back();
+    }
+}
 
-    int prevCullFaceMode, prevFrontFace;
-    _glGetIntegerv(GL_CULL_FACE_MODE, &prevCullFaceMode);
-    _glGetIntegerv(GL_FRONT_FACE, &prevFrontFace);
-    GLboolean prevCullEnable = _glIsEnabled(GL_CULL_FACE);
-    _glCullFace(GL_BACK);
-    _glEnable(GL_CULL_FACE);
-    if( _CullMode==CULL_CW )
-        _glFrontFace(GL_CCW);
-    else if( _CullMode==CULL_CCW )
-        _glFrontFace(GL_CW);
-    else
-        _glDisable(GL_CULL_FACE);
+//  ---------------------------------------------------------------------------
 
-    _glDisable(GL_TEXTURE_2D);
-    _glMatrixMode(GL_MODELVIEW);
-    _glLoadIdentity();
-    _glBegin(GL_TRIANGLES);
-    for(int i=0; i<3*_NumTriangles; ++i)
+void *CTwGraphOpenGL::NewCacheObj()
+{
+    CCacheObj *Cache = new CCacheObj;
+    Cache->m_FontGeneration = -1;
+    Cache->m_Valid = false;
+    return Cache;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::DeleteCacheObj(void *_CacheObj)
+{
+    assert(_CacheObj!=NULL);
+    if( m_RecordCache==_CacheObj )
+        m_RecordCache = NULL;
+    delete static_cast<CCacheObj *>(_CacheObj);
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGL::BeginCache(void *_CacheObj)
+{
+    assert(m_Drawing==true && _CacheObj!=NULL && m_RecordCache==NULL);
+    m_RecordCache = static_cast<CCacheObj *>(_CacheObj);
+    m_RecordFirstVert = m_BatchVerts.size();
+    m_RecordFirstBatch = m_Batches.size();
+    m_RecordFirstViewport = m_BatchViewports.size();
+    m_RecordBroken = (m_CurBatchViewport>=0);
+    m_BatchBase = m_Batches.size();
+}
+
+//  ---------------------------------------------------------------------------
+
+bool CTwGraphOpenGL::EndCache(void *_CacheObj)
+{
+    assert(m_Drawing==true && _CacheObj==m_RecordCache);
+    CCacheObj *Cache = static_cast<CCacheObj *>(_CacheObj);
+    m_RecordCache = NULL;
+    m_BatchBase = m_Batches.size();
+    Cache->m_Valid = false;
+    if( m_RecordBroken || m_CurBatchViewport>=0 )
+        return false;
+
+    Cache->m_Verts.assign(m_BatchVerts.begin()+m_RecordFirstVert, m_BatchVerts.end());
+    Cache->m_Batches.assign(m_Batches.begin()+m_RecordFirstBatch, m_Batches.end());
+    Cache->m_Viewports.assign(m_BatchViewports.begin()+m_RecordFirstViewport, m_BatchViewports.end());
+    for( size_t i=0; i<Cache->m_Batches.size(); ++i )
     {
-        color32 col = _Colors[i];
-        _glColor4ub(GLubyte(col>>16), GLubyte(col>>8), GLubyte(col), GLubyte(col>>24));
-        _glVertex2f((GLfloat)_Vertices[2*i+0]+dx, (GLfloat)_Vertices[2*i+1]+dy);
+        Cache->m_Batches[i].m_First -= (int)m_RecordFirstVert;
+        if( Cache->m_Batches[i].m_Viewport>=0 )
+            Cache->m_Batches[i].m_Viewport -= (int)m_RecordFirstViewport;
     }
-    _glEnd();
+    Cache->m_FontGeneration = m_FontGeneration;
+    Cache->m_Valid = true;
+    return true;
+}
 
-    _glCullFace(prevCullFaceMode);
-    _glFrontFace(prevFrontFace);
-    if( prevCullEnable )
-        _glEnable(GL_CULL_FACE);
-    else
-        _glDisable(GL_CULL_FACE);
+//  ---------------------------------------------------------------------------
+
+bool CTwGraphOpenGL::DrawCache(void *_CacheObj)
+{
+    assert(m_Drawing==true && _CacheObj!=NULL);
+    const CCacheObj *Cache = static_cast<const CCacheObj *>(_CacheObj);
+    if( !Cache->m_Valid || Cache->m_FontGeneration!=m_FontGeneration || m_RecordCache!=NULL || m_CurBatchViewport>=0 )
+        return false;
+
+    int FirstVert = (int)m_BatchVerts.size();
+    int FirstViewport = (int)m_BatchViewports.size();
+    m_BatchVerts.insert(m_BatchVerts.end(), Cache->m_Verts.begin(), Cache->m_Verts.end());
+    m_BatchViewports.insert(m_BatchViewports.end(), Cache->m_Viewports.begin(), Cache->m_Viewports.end());
+    for( size_t i=0; i<Cache->m_Batches.size(); ++i )
+    {
+        CBatch Batch = Cache->m_Batches[i];
+        Batch.m_First += FirstVert;
+        if( Batch.m_Viewport>=0 )
+            Batch.m_Viewport += FirstViewport;
+        m_Batches.push_back(Batch);
+    }
+    m_BatchBase = m_Batches.size();
+    return true;
 }
 
 //  ---------------------------------------------------------------------------
@@ -16,6 +16,7 @@
 #define ANT_TW_OPENGL_INCLUDED
 
 #include "TwGraph.h"
+#include "TwGlyphs.h"
 
 //  ---------------------------------------------------------------------------
 
@@ -38,18 +39,33 @@ public:
     virtual void        DeleteTextObj(void *_TextObj);
     virtual void        BuildText(void *_TextObj, const std::string *_TextLines, color32 *_LineColors, color32 *_LineBgColors, int _NbLines, const CTexFont *_Font, int _Sep, int _BgWidth);
     virtual void        DrawText(void *_TextObj, int _X, int _Y, color32 _Color, color32 _BgColor);
+    virtual bool        UpdateTextLine(void *_TextObj, int _Line, const std::string& _TextLine, color32 _LineColor, color32 _LineBgColor, const CTexFont *_Font, int _Sep);
 
     virtual void        ChangeViewport(int _X0, int _Y0, int _Width, int _Height, int _OffsetX, int _OffsetY);
     virtual void        RestoreViewport();
 
+    virtual int         GetDrawCallCount() { return m_NbDrawCalls; }
+    virtual int         GetAPICallCount() { return m_NbGLCalls; }
+
+    virtual void *      NewCacheObj();
+    virtual void        DeleteCacheObj(void *_CacheObj);
+    virtual void        BeginCache(void *_CacheObj);
+    virtual bool        EndCache(void *_CacheObj);
+    virtual bool        DrawCache(void *_CacheObj);
+
 protected:
     bool                m_Drawing;
-    GLuint              m_FontTexID;
+    GLuint              m_FontTexID;    // texture of m_FontTex, used by the primitives added to the batches
     const CTexFont *    m_FontTex;
+    struct CFontTex     { const CTexFont *m_Font; GLuint m_TexID; };
+    std::vector<CFontTex> m_FontTexs;   // textures of the fonts used so far, kept until Restore or Shut
+    void                SetFontTex(const CTexFont *_Font);
+    void                DeleteFontTexs();
     GLfloat             m_PrevLineWidth;
     GLint               m_PrevTexEnv;
     GLint               m_PrevPolygonMode[2];
     GLint               m_MaxClipPlanes;
+    GLint               m_MaxTexUnits;
     GLint               m_PrevTexture;
     GLint               m_PrevArrayBufferARB;
     GLint               m_PrevElementArrayBufferARB;
@@ -71,19 +87,102 @@ protected:
     GLint               m_PrevBlendSrcAlpha;
     GLint               m_PrevBlendDstAlpha;
     GLint               m_ViewportInit[4];
-    GLfloat             m_ProjMatrixInit[16];
     int                 m_WndWidth;
     int                 m_WndHeight;
+    void                SaveTexUnits(int _FirstUnit);
+    void                RestoreTexUnits(int _FirstUnit);
+
+    // GL state shadow. m_CurState is the state set while drawing, so that only
+    // actual changes are issued. In cooperative mode (see EGLState), BeginDraw
+    // reads into m_HostState the groups not guaranteed by the application and
+    // applies the differences with m_DrawState; EndDraw applies m_HostState back.
+    enum                { CAP_TEXTURE_2D=0, CAP_LINE_SMOOTH, CAP_BLEND };   // first entries of m_StateCaps
+    enum                { ARRAY_VERTEX=0, ARRAY_NORMAL, ARRAY_TEXCOORD, ARRAY_INDEX, ARRAY_COLOR, ARRAY_EDGE_FLAG, NB_STATE_ARRAYS };
+    struct CGLState
+    {
+        std::vector<GLboolean> m_Caps;          // enabled capabilities of m_StateCaps
+        GLboolean           m_Arrays[NB_STATE_ARRAYS];
+        GLfloat             m_LineWidth;
+        GLint               m_PolygonMode[2];   // front, back
+        GLint               m_TexEnv;
+        GLint               m_BlendFunc[4];     // src rgb, dst rgb, src alpha, dst alpha
+        GLint               m_BlendEquation[2]; // rgb, alpha
+        GLint               m_MatrixMode;       // not applied: restored by EndDraw
+        GLint               m_Texture;          // texture bound to GL_TEXTURE_2D
+        GLint               m_ArrayBuffer;
+        GLint               m_ElementArrayBuffer;
+        GLuint              m_ProgramObject;
+        GLint               m_Viewport[4];
+    };
+    std::vector<GLenum> m_StateCaps;    // capabilities disabled while drawing, but CAP_BLEND
+    CGLState            m_DefaultState; // GL default values
+    CGLState            m_DrawState;
+    CGLState            m_HostState;
+    CGLState            m_CurState;
+    int                 m_GLState;      // EGLState flags of the current frame
+    int                 m_NbGLCalls;
+    void                InitStateShadow();
+    void                SaveHostState();
+    void                ApplyState(const CGLState& _State);
+    void                SetCap(int _Cap, bool _Enabled);
+    void                SetArray(int _Array, bool _Enabled);
+    void                SetTexture(GLint _TexID);
+    void                SetArrayBuffer(GLint _BufferID);
+    void                SetViewport(const GLint *_Viewport);
 
-    struct Vec2         { GLfloat x, y; Vec2(){} Vec2(GLfloat _X, GLfloat _Y):x(_X),y(_Y){} Vec2(int _X, int _Y):x(GLfloat(_X)),y(GLfloat(_Y)){} };
+    // Text is stored as one textured quad per glyph (expanded to two triangles
+    // by DrawText) and one color and background rectangle per line.
+    typedef CGlyphQuad  CGlyph;
+    struct CTextLine    { int m_FirstGlyph; GLfloat m_Y0, m_Y1; color32 m_Color, m_BgColor; }; // colors in GL byte order
     struct CTextObj
     {
-        std::vector<Vec2>   m_TextVerts;
-        std::vector<Vec2>   m_TextUVs;
-        std::vector<Vec2>   m_BgVerts;
-        std::vector<color32>m_Colors;
-        std::vector<color32>m_BgColors;
+        std::vector<CGlyph> m_Glyphs;
+        std::vector<CTextLine> m_Lines;
+        int                 m_BgWidth;
+        bool                m_LineColors;
+        bool                m_LineBgColors;
+        const CTexFont *    m_Font;         // font used by BuildText
+                            CTextObj() : m_BgWidth(0), m_LineColors(false), m_LineBgColors(false), m_Font(NULL) {}
+        size_t              LineEnd(int _Line) const { return (_Line+1<(int)m_Lines.size()) ? m_Lines[_Line+1].m_FirstGlyph : m_Glyphs.size(); }
+    };
+    std::vector<CGlyph> m_TextLineGlyphs;   // scratch buffer used by UpdateTextLine
+    static void         AppendTextLine(std::vector<CGlyph>& _Glyphs, const std::string& _TextLine, int _Y, const CTexFont *_Font);
+
+    // Frame batching: primitives are accumulated in submission order and 
+    // drawn by FlushBatches with one draw call per run of identical state.
+    struct CBatchVertex { GLfloat x, y, u, v; color32 c; };
+    struct CBatch       { GLenum m_Mode; GLuint m_TexID; bool m_AntiAliased; int m_Viewport; int m_First; int m_Count; };
+    struct CBatchViewport { GLint m_Viewport[4]; GLdouble m_Ortho[4]; }; // set by ChangeViewport
+    std::vector<CBatchVertex> m_BatchVerts;
+    std::vector<CBatch> m_Batches;
+    std::vector<CBatchViewport> m_BatchViewports;
+    int                 m_CurBatchViewport; // index in m_BatchViewports, -1 for the initial viewport
+    size_t              m_BatchBase;    // batches before this index are not extended (cache boundaries)
+    GLfloat             m_WhiteU, m_WhiteV; // uv of the opaque texel of the font texture
+    GLuint              m_BatchVBO;     // VBO mode: frame vertices are streamed through this buffer
+    bool                m_UseVBO;
+    int                 m_NbDrawCalls;
+    CBatchVertex *      AddBatchVerts(GLenum _Mode, bool _AntiAliased, int _NbVerts);
+    void                AddBatchQuad(GLfloat _X0, GLfloat _Y0, GLfloat _X1, GLfloat _Y1, color32 _Color00, color32 _Color10, color32 _Color01, color32 _Color11);
+    void                FlushBatches();
+    void                ApplyBatchViewport(int _Viewport);
+    void                DeleteBuffers();
+
+    // Retained draw cache: a copy of the batches recorded between BeginCache and EndCache
+    struct CCacheObj
+    {
+        std::vector<CBatchVertex> m_Verts;
+        std::vector<CBatch> m_Batches;
+        std::vector<CBatchViewport> m_Viewports;
+        int             m_FontGeneration;
+        bool            m_Valid;
     };
+    CCacheObj *         m_RecordCache;
+    size_t              m_RecordFirstVert;
+    size_t              m_RecordFirstBatch;
+    size_t              m_RecordFirstViewport;
+    bool                m_RecordBroken;
+    int                 m_FontGeneration;   // incremented each time the font textures are deleted
 };
 
 //  ---------------------------------------------------------------------------
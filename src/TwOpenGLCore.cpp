@@ -0,0 +1,1105 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwOpenGLCore.cpp
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  note:       TAB=4
+//
+//  ---------------------------------------------------------------------------
+
+
+#include "TwPrecomp.h"
+#include "LoadOGL.h"
+#include "TwOpenGLCore.h"
+#include "TwMgr.h"
+
+using namespace std;
+
+extern const char *g_ErrCantLoadOGL;
+extern const char *g_ErrCantUnloadOGL;
+const char *g_ErrCantLoadOGLCore    = "Cannot load OpenGL core profile functions (OpenGL 3.3 required)";
+const char *g_ErrCompileShader      = "OpenGL core profile shader compilation failed";
+
+//  ---------------------------------------------------------------------------
+//  OpenGL 2.0 to 3.3 functions used by the core profile graph.
+//  Functions of OpenGL 1.1 still available in core profile are loaded by LoadOGL.
+
+namespace GLCore
+{
+    typedef GLuint (APIENTRY * PFNglCreateShader)(GLenum type);
+    typedef void (APIENTRY * PFNglDeleteShader)(GLuint shader);
+    typedef void (APIENTRY * PFNglShaderSource)(GLuint shader, GLsizei count, const char **string, const GLint *length);
+    typedef void (APIENTRY * PFNglCompileShader)(GLuint shader);
+    typedef void (APIENTRY * PFNglGetShaderiv)(GLuint shader, GLenum pname, GLint *params);
+    typedef GLuint (APIENTRY * PFNglCreateProgram)(void);
+    typedef void (APIENTRY * PFNglDeleteProgram)(GLuint program);
+    typedef void (APIENTRY * PFNglAttachShader)(GLuint program, GLuint shader);
+    typedef void (APIENTRY * PFNglDetachShader)(GLuint program, GLuint shader);
+    typedef void (APIENTRY * PFNglBindAttribLocation)(GLuint program, GLuint index, const char *name);
+    typedef void (APIENTRY * PFNglLinkProgram)(GLuint program);
+    typedef void (APIENTRY * PFNglGetProgramiv)(GLuint program, GLenum pname, GLint *params);
+    typedef void (APIENTRY * PFNglUseProgram)(GLuint program);
+    typedef GLint (APIENTRY * PFNglGetUniformLocation)(GLuint program, const char *name);
+    typedef void (APIENTRY * PFNglUniform1i)(GLint location, GLint v0);
+    typedef void (APIENTRY * PFNglUniform4fv)(GLint location, GLsizei count, const GLfloat *value);
+    typedef void (APIENTRY * PFNglGenVertexArrays)(GLsizei n, GLuint *arrays);
+    typedef void (APIENTRY * PFNglDeleteVertexArrays)(GLsizei n, const GLuint *arrays);
+    typedef void (APIENTRY * PFNglBindVertexArray)(GLuint array);
+    typedef void (APIENTRY * PFNglGenBuffers)(GLsizei n, GLuint *buffers);
+    typedef void (APIENTRY * PFNglDeleteBuffers)(GLsizei n, const GLuint *buffers);
+    typedef void (APIENTRY * PFNglBindBuffer)(GLenum target, GLuint buffer);
+    typedef void (APIENTRY * PFNglBufferData)(GLenum target, ptrdiff_t size, const GLvoid *data, GLenum usage);
+    typedef void (APIENTRY * PFNglEnableVertexAttribArray)(GLuint index);
+    typedef void (APIENTRY * PFNglVertexAttribPointer)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer);
+    typedef void (APIENTRY * PFNglActiveTexture)(GLenum texture);
+    typedef void (APIENTRY * PFNglBlendEquationSeparate)(GLenum modeRGB, GLenum modeAlpha);
+    typedef void (APIENTRY * PFNglBlendFuncSeparate)(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+    typedef void (APIENTRY * PFNglBindSampler)(GLuint unit, GLuint sampler);
+
+    PFNglCreateShader _glCreateShader = NULL;
+    PFNglDeleteShader _glDeleteShader = NULL;
+    PFNglShaderSource _glShaderSource = NULL;
+    PFNglCompileShader _glCompileShader = NULL;
+    PFNglGetShaderiv _glGetShaderiv = NULL;
+    PFNglCreateProgram _glCreateProgram = NULL;
+    PFNglDeleteProgram _glDeleteProgram = NULL;
+    PFNglAttachShader _glAttachShader = NULL;
+    PFNglDetachShader _glDetachShader = NULL;
+    PFNglBindAttribLocation _glBindAttribLocation = NULL;
+    PFNglLinkProgram _glLinkProgram = NULL;
+    PFNglGetProgramiv _glGetProgramiv = NULL;
+    PFNglUseProgram _glUseProgram = NULL;
+    PFNglGetUniformLocation _glGetUniformLocation = NULL;
+    PFNglUniform1i _glUniform1i = NULL;
+    PFNglUniform4fv _glUniform4fv = NULL;
+    PFNglGenVertexArrays _glGenVertexArrays = NULL;
+    PFNglDeleteVertexArrays _glDeleteVertexArrays = NULL;
+    PFNglBindVertexArray _glBindVertexArray = NULL;
+    PFNglGenBuffers _glGenBuffers = NULL;
+    PFNglDeleteBuffers _glDeleteBuffers = NULL;
+    PFNglBindBuffer _glBindBuffer = NULL;
+    PFNglBufferData _glBufferData = NULL;
+    PFNglEnableVertexAttribArray _glEnableVertexAttribArray = NULL;
+    PFNglVertexAttribPointer _glVertexAttribPointer = NULL;
+    PFNglActiveTexture _glActiveTexture = NULL;
+    PFNglBlendEquationSeparate _glBlendEquationSeparate = NULL;
+    PFNglBlendFuncSeparate _glBlendFuncSeparate = NULL;
+    PFNglBindSampler _glBindSampler = NULL;    // optional (OpenGL 3.3)
+}
+using namespace GLCore;
+
+#ifndef GL_ARRAY_BUFFER
+#   define GL_ARRAY_BUFFER 0x8892
+#endif
+#ifndef GL_ARRAY_BUFFER_BINDING
+#   define GL_ARRAY_BUFFER_BINDING 0x8894
+#endif
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#   define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_PIXEL_UNPACK_BUFFER_BINDING
+#   define GL_PIXEL_UNPACK_BUFFER_BINDING 0x88EF
+#endif
+#ifndef GL_STREAM_DRAW
+#   define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_VERTEX_ARRAY_BINDING
+#   define GL_VERTEX_ARRAY_BINDING 0x85B5
+#endif
+#ifndef GL_FRAGMENT_SHADER
+#   define GL_FRAGMENT_SHADER 0x8B30
+#endif
+#ifndef GL_VERTEX_SHADER
+#   define GL_VERTEX_SHADER 0x8B31
+#endif
+#ifndef GL_COMPILE_STATUS
+#   define GL_COMPILE_STATUS 0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#   define GL_LINK_STATUS 0x8B82
+#endif
+#ifndef GL_CURRENT_PROGRAM
+#   define GL_CURRENT_PROGRAM 0x8B8D
+#endif
+#ifndef GL_TEXTURE0
+#   define GL_TEXTURE0 0x84C0
+#endif
+#ifndef GL_ACTIVE_TEXTURE
+#   define GL_ACTIVE_TEXTURE 0x84E0
+#endif
+#ifndef GL_SAMPLER_BINDING
+#   define GL_SAMPLER_BINDING 0x8919
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#   define GL_CLAMP_TO_EDGE 0x812F
+#endif
+#ifndef GL_R8
+#   define GL_R8 0x8229
+#endif
+#ifndef GL_FUNC_ADD
+#   define GL_FUNC_ADD 0x8006
+#endif
+#ifndef GL_BLEND_EQUATION_RGB
+#   define GL_BLEND_EQUATION_RGB 0x8009
+#endif
+#ifndef GL_BLEND_EQUATION_ALPHA
+#   define GL_BLEND_EQUATION_ALPHA 0x883D
+#endif
+#ifndef GL_BLEND_SRC_RGB
+#   define GL_BLEND_SRC_RGB 0x80C9
+#endif
+#ifndef GL_BLEND_DST_RGB
+#   define GL_BLEND_DST_RGB 0x80C8
+#endif
+#ifndef GL_BLEND_SRC_ALPHA
+#   define GL_BLEND_SRC_ALPHA 0x80CB
+#endif
+#ifndef GL_BLEND_DST_ALPHA
+#   define GL_BLEND_DST_ALPHA 0x80CA
+#endif
+
+//  ---------------------------------------------------------------------------
+
+#ifdef _DEBUG
+    static void CheckGLCoreError(const char *file, int line, const char *func)
+    {
+        int err=0;
+        char msg[256];
+        while( (err=_glGetError())!=0 )
+        {
+            sprintf(msg, "%s(%d) : [%s] GL_CORE_ERROR=0x%x\n", file, line, func, err);
+            #ifdef ANT_WINDOWS
+                OutputDebugString(msg);
+            #endif
+            fprintf(stderr, msg);
+        }
+    }
+#   ifdef __FUNCTION__
+#       define CHECK_GL_ERROR CheckGLCoreError(__FILE__, __LINE__, __FUNCTION__)
+#   else
+#       define CHECK_GL_ERROR CheckGLCoreError(__FILE__, __LINE__, "")
+#   endif
+#else
+#   define CHECK_GL_ERROR ((void)(0))
+#endif
+
+//  ---------------------------------------------------------------------------
+
+static const char *g_VertShaderSrc =
+    "#version 330 core\n"
+    "uniform vec4 Transform;\n"
+    "in vec2 Vertex;\n"
+    "in vec2 UV;\n"
+    "in vec4 Color;\n"
+    "out vec2 fUV;\n"
+    "out vec4 fColor;\n"
+    "void main() { gl_Position = vec4(Vertex*Transform.xy + Transform.zw, 0.0, 1.0); fUV = UV; fColor = Color; }\n";
+
+static const char *g_FragShaderSrc =
+    "#version 330 core\n"
+    "uniform sampler2D Tex;\n"
+    "in vec2 fUV;\n"
+    "in vec4 fColor;\n"
+    "out vec4 outColor;\n"
+    "void main() { outColor = vec4(fColor.rgb, fColor.a*texture(Tex, fUV).r); }\n";
+
+enum EAttribs { ATTRIB_VERTEX = 0, ATTRIB_UV, ATTRIB_COLOR };
+
+//  ---------------------------------------------------------------------------
+
+static GLuint CompileShader(GLenum _Type, const char *_Src)
+{
+    GLuint Shader = _glCreateShader(_Type);
+    _glShaderSource(Shader, 1, &_Src, NULL);
+    _glCompileShader(Shader);
+    GLint Compiled = 0;
+    _glGetShaderiv(Shader, GL_COMPILE_STATUS, &Compiled);
+    if( !Compiled )
+    {
+        _glDeleteShader(Shader);
+        return 0;
+    }
+    return Shader;
+}
+
+//  ---------------------------------------------------------------------------
+
+static GLuint TexImage(GLsizei _Width, GLsizei _Height, const GLvoid *_Bytes)
+{
+    // unpack state is saved and restored since it is not part of BeginDraw/EndDraw
+    GLint PrevUnpackBuffer = 0, PrevAlignment = 4, PrevRowLength = 0, PrevSkipRows = 0, PrevSkipPixels = 0;
+    _glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &PrevUnpackBuffer);
+    _glGetIntegerv(GL_UNPACK_ALIGNMENT, &PrevAlignment);
+    _glGetIntegerv(GL_UNPACK_ROW_LENGTH, &PrevRowLength);
+    _glGetIntegerv(GL_UNPACK_SKIP_ROWS, &PrevSkipRows);
+    _glGetIntegerv(GL_UNPACK_SKIP_PIXELS, &PrevSkipPixels);
+    if( PrevUnpackBuffer!=0 )
+        _glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    _glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    _glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    _glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    _glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+
+    GLuint TexID = 0;
+    _glGenTextures(1, &TexID);
+    _glBindTexture(GL_TEXTURE_2D, TexID);
+    _glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, _Width, _Height, 0, GL_RED, GL_UNSIGNED_BYTE, _Bytes);
+    _glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    _glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    _glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    _glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    _glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+    _glPixelStorei(GL_UNPACK_ALIGNMENT, PrevAlignment);
+    _glPixelStorei(GL_UNPACK_ROW_LENGTH, PrevRowLength);
+    _glPixelStorei(GL_UNPACK_SKIP_ROWS, PrevSkipRows);
+    _glPixelStorei(GL_UNPACK_SKIP_PIXELS, PrevSkipPixels);
+    if( PrevUnpackBuffer!=0 )
+        _glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PrevUnpackBuffer);
+
+    return TexID;
+}
+
+//  ---------------------------------------------------------------------------
+
+static GLuint BindFont(const CTexFont *_Font)
+{
+    // Alpha is stored in the red channel (GL_ALPHA textures are not available
+    // in core profile). As in CTwGraphOpenGL, the texel at (0, CharHeight+1)
+    // is made opaque to draw untextured primitives in the same batches.
+    vector<unsigned char> TexBytes(_Font->m_TexBytes, _Font->m_TexBytes+_Font->m_TexWidth*_Font->m_TexHeight);
+    TexBytes[(_Font->m_CharHeight+1)*_Font->m_TexWidth] = 255;
+    return TexImage(_Font->m_TexWidth, _Font->m_TexHeight, &(TexBytes[0]));
+}
+
+static void UnbindFont(GLuint _FontTexID)
+{
+    if( _FontTexID>0 )
+        _glDeleteTextures(1, &_FontTexID);
+}
+
+//  ---------------------------------------------------------------------------
+
+static inline color32 ToGLColor(color32 _Color)    // ARGB -> ABGR (RGBA bytes)
+{
+    return (_Color&0xff00ff00) | GLubyte(_Color>>16) | (GLubyte(_Color)<<16);
+}
+
+#define BUFFER_OFFSET(_Offset)  ((const GLvoid *)((const char *)NULL + (_Offset)))
+
+// Transform equivalent to glOrtho(_Left, _Right, _Bottom, _Top, -1, 1) applied to 2D vertices
+static void OrthoTransform(GLfloat *_Transform, GLfloat _Left, GLfloat _Right, GLfloat _Bottom, GLfloat _Top)
+{
+    _Transform[0] = 2.0f/(_Right-_Left);
+    _Transform[1] = 2.0f/(_Top-_Bottom);
+    _Transform[2] = -(_Right+_Left)/(_Right-_Left);
+    _Transform[3] = -(_Top+_Bottom)/(_Top-_Bottom);
+}
+
+//  ---------------------------------------------------------------------------
+
+#define LOAD_GL_CORE_FUNC(_Fct) \
+    if( (_##_Fct = reinterpret_cast<PFN##_Fct>(_glGetProcAddress(#_Fct)))==NULL ) Res = 0;
+
+int CTwGraphOpenGLCore::Init()
+{
+    if( LoadOpenGL()==0 )
+    {
+        g_TwMgr->SetLastError(g_ErrCantLoadOGL);
+        return 0;
+    }
+
+    m_Drawing = false;
+    m_FontTexID = 0;
+    m_FontTex = NULL;
+    m_WhiteU = m_WhiteV = 0;
+    m_NbDrawCalls = 0;
+    m_VertShader = m_FragShader = m_Program = 0;
+    m_VAO = m_VBO = 0;
+    m_WhiteTexID = 0;
+    m_CurBatchViewport = -1;
+    m_BatchBase = 0;
+    m_RecordCache = NULL;
+    m_RecordBroken = false;
+    m_FontGeneration = 0;
+
+    int Res = 1;
+    LOAD_GL_CORE_FUNC(glCreateShader)
+    LOAD_GL_CORE_FUNC(glDeleteShader)
+    LOAD_GL_CORE_FUNC(glShaderSource)
+    LOAD_GL_CORE_FUNC(glCompileShader)
+    LOAD_GL_CORE_FUNC(glGetShaderiv)
+    LOAD_GL_CORE_FUNC(glCreateProgram)
+    LOAD_GL_CORE_FUNC(glDeleteProgram)
+    LOAD_GL_CORE_FUNC(glAttachShader)
+    LOAD_GL_CORE_FUNC(glDetachShader)
+    LOAD_GL_CORE_FUNC(glBindAttribLocation)
+    LOAD_GL_CORE_FUNC(glLinkProgram)
+    LOAD_GL_CORE_FUNC(glGetProgramiv)
+    LOAD_GL_CORE_FUNC(glUseProgram)
+    LOAD_GL_CORE_FUNC(glGetUniformLocation)
+    LOAD_GL_CORE_FUNC(glUniform1i)
+    LOAD_GL_CORE_FUNC(glUniform4fv)
+    LOAD_GL_CORE_FUNC(glGenVertexArrays)
+    LOAD_GL_CORE_FUNC(glDeleteVertexArrays)
+    LOAD_GL_CORE_FUNC(glBindVertexArray)
+    LOAD_GL_CORE_FUNC(glGenBuffers)
+    LOAD_GL_CORE_FUNC(glDeleteBuffers)
+    LOAD_GL_CORE_FUNC(glBindBuffer)
+    LOAD_GL_CORE_FUNC(glBufferData)
+    LOAD_GL_CORE_FUNC(glEnableVertexAttribArray)
+    LOAD_GL_CORE_FUNC(glVertexAttribPointer)
+    LOAD_GL_CORE_FUNC(glActiveTexture)
+    LOAD_GL_CORE_FUNC(glBlendEquationSeparate)
+    LOAD_GL_CORE_FUNC(glBlendFuncSeparate)
+    _glBindSampler = reinterpret_cast<PFNglBindSampler>(_glGetProcAddress("glBindSampler"));
+    if( Res==0 )
+    {
+        g_TwMgr->SetLastError(g_ErrCantLoadOGLCore);
+        return 0;
+    }
+
+    m_VertShader = CompileShader(GL_VERTEX_SHADER, g_VertShaderSrc);
+    m_FragShader = CompileShader(GL_FRAGMENT_SHADER, g_FragShaderSrc);
+    if( m_VertShader==0 || m_FragShader==0 )
+    {
+        Shut();
+        g_TwMgr->SetLastError(g_ErrCompileShader);
+        return 0;
+    }
+    m_Program = _glCreateProgram();
+    _glAttachShader(m_Program, m_VertShader);
+    _glAttachShader(m_Program, m_FragShader);
+    _glBindAttribLocation(m_Program, ATTRIB_VERTEX, "Vertex");
+    _glBindAttribLocation(m_Program, ATTRIB_UV, "UV");
+    _glBindAttribLocation(m_Program, ATTRIB_COLOR, "Color");
+    _glLinkProgram(m_Program);
+    GLint Linked = 0;
+    _glGetProgramiv(m_Program, GL_LINK_STATUS, &Linked);
+    if( !Linked )
+    {
+        Shut();
+        g_TwMgr->SetLastError(g_ErrCompileShader);
+        return 0;
+    }
+    m_TransformLoc = _glGetUniformLocation(m_Program, "Transform");
+    m_TexLoc = _glGetUniformLocation(m_Program, "Tex");
+
+    // Vertex layout is recorded once in our VAO
+    GLint PrevVAO = 0, PrevArrayBuffer = 0;
+    _glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &PrevVAO);
+    _glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &PrevArrayBuffer);
+    _glGenVertexArrays(1, &m_VAO);
+    _glGenBuffers(1, &m_VBO);
+    _glBindVertexArray(m_VAO);
+    _glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    _glEnableVertexAttribArray(ATTRIB_VERTEX);
+    _glEnableVertexAttribArray(ATTRIB_UV);
+    _glEnableVertexAttribArray(ATTRIB_COLOR);
+    _glVertexAttribPointer(ATTRIB_VERTEX, 2, GL_FLOAT, GL_FALSE, sizeof(CBatchVertex), BUFFER_OFFSET(0));
+    _glVertexAttribPointer(ATTRIB_UV, 2, GL_FLOAT, GL_FALSE, sizeof(CBatchVertex), BUFFER_OFFSET(2*sizeof(GLfloat)));
+    _glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(CBatchVertex), BUFFER_OFFSET(4*sizeof(GLfloat)));
+    _glBindVertexArray(PrevVAO);
+    _glBindBuffer(GL_ARRAY_BUFFER, PrevArrayBuffer);
+
+    GLint PrevTexture = 0;
+    _glGetIntegerv(GL_TEXTURE_BINDING_2D, &PrevTexture);
+    const unsigned char White = 255;
+    m_WhiteTexID = TexImage(1, 1, &White);
+    _glBindTexture(GL_TEXTURE_2D, PrevTexture);
+
+    CHECK_GL_ERROR;
+    return 1;
+}
+
+//  ---------------------------------------------------------------------------
+
+int CTwGraphOpenGLCore::Shut()
+{
+    assert(m_Drawing==false);
+
+    DeleteFontTexs();
+    UnbindFont(m_WhiteTexID);
+    m_WhiteTexID = 0;
+    if( m_VBO!=0 )
+        _glDeleteBuffers(1, &m_VBO);
+    m_VBO = 0;
+    if( m_VAO!=0 )
+        _glDeleteVertexArrays(1, &m_VAO);
+    m_VAO = 0;
+    if( m_Program!=0 )
+    {
+        if( m_VertShader!=0 )
+            _glDetachShader(m_Program, m_VertShader);
+        if( m_FragShader!=0 )
+            _glDetachShader(m_Program, m_FragShader);
+        _glDeleteProgram(m_Program);
+    }
+    m_Program = 0;
+    if( m_VertShader!=0 )
+        _glDeleteShader(m_VertShader);
+    m_VertShader = 0;
+    if( m_FragShader!=0 )
+        _glDeleteShader(m_FragShader);
+    m_FragShader = 0;
+
+    int Res = 1;
+    if( UnloadOpenGL()==0 )
+    {
+        g_TwMgr->SetLastError(g_ErrCantUnloadOGL);
+        Res = 0;
+    }
+
+    return Res;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::BeginDraw(int _WndWidth, int _WndHeight)
+{
+    assert(m_Drawing==false && _WndWidth>0 && _WndHeight>0);
+    m_Drawing = true;
+    m_WndWidth = _WndWidth;
+    m_WndHeight = _WndHeight;
+    m_NbDrawCalls = 0;
+
+    CHECK_GL_ERROR;
+
+    // Save only the state modified by this graph (no glPushAttrib in core profile)
+    _glGetIntegerv(GL_CURRENT_PROGRAM, &m_PrevProgram);
+    _glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &m_PrevVAO);
+    _glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &m_PrevArrayBuffer);
+    _glGetIntegerv(GL_ACTIVE_TEXTURE, &m_PrevActiveTexture);
+    _glActiveTexture(GL_TEXTURE0);
+    _glGetIntegerv(GL_TEXTURE_BINDING_2D, &m_PrevTexture);
+    m_PrevSampler = 0;
+    if( _glBindSampler!=NULL )
+    {
+        _glGetIntegerv(GL_SAMPLER_BINDING, &m_PrevSampler);
+        if( m_PrevSampler!=0 )
+            _glBindSampler(0, 0);
+    }
+    _glGetIntegerv(GL_VIEWPORT, m_PrevViewport);
+    _glGetIntegerv(GL_POLYGON_MODE, m_PrevPolygonMode);
+    m_PrevBlend = _glIsEnabled(GL_BLEND);
+    m_PrevCullFace = _glIsEnabled(GL_CULL_FACE);
+    m_PrevDepthTest = _glIsEnabled(GL_DEPTH_TEST);
+    m_PrevScissorTest = _glIsEnabled(GL_SCISSOR_TEST);
+    m_PrevStencilTest = _glIsEnabled(GL_STENCIL_TEST);
+    m_PrevLineSmooth = _glIsEnabled(GL_LINE_SMOOTH);
+    _glGetIntegerv(GL_BLEND_EQUATION_RGB, &m_PrevBlendEquationRGB);
+    _glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &m_PrevBlendEquationAlpha);
+    _glGetIntegerv(GL_BLEND_SRC_RGB, &m_PrevBlendSrcRGB);
+    _glGetIntegerv(GL_BLEND_DST_RGB, &m_PrevBlendDstRGB);
+    _glGetIntegerv(GL_BLEND_SRC_ALPHA, &m_PrevBlendSrcAlpha);
+    _glGetIntegerv(GL_BLEND_DST_ALPHA, &m_PrevBlendDstAlpha);
+
+    // Same pixel mapping as CTwGraphOpenGL
+    _glViewport(0, 0, _WndWidth-1, _WndHeight-1);
+    _glGetIntegerv(GL_VIEWPORT, m_ViewportInit);
+    OrthoTransform(m_TransformInit, 0, (GLfloat)(_WndWidth-1), (GLfloat)(_WndHeight-1), 0);
+    m_CurBatchViewport = -1;
+
+    _glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    _glEnable(GL_BLEND);
+    _glDisable(GL_CULL_FACE);
+    _glDisable(GL_DEPTH_TEST);
+    _glDisable(GL_SCISSOR_TEST);
+    _glDisable(GL_STENCIL_TEST);
+    _glDisable(GL_LINE_SMOOTH);
+    _glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+    _glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    _glUseProgram(m_Program);
+    _glUniform1i(m_TexLoc, 0);
+    _glBindVertexArray(m_VAO);
+    _glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+
+    CHECK_GL_ERROR;
+}
+
+//  ---------------------------------------------------------------------------
+
+static inline void RestoreEnable(GLenum _Cap, GLboolean _Enabled)
+{
+    if( _Enabled )
+        _glEnable(_Cap);
+    else
+        _glDisable(_Cap);
+}
+
+void CTwGraphOpenGLCore::EndDraw()
+{
+    assert(m_Drawing==true);
+    FlushBatches();
+    m_Drawing = false;
+
+    _glBindTexture(GL_TEXTURE_2D, m_PrevTexture);
+    if( _glBindSampler!=NULL && m_PrevSampler!=0 )
+        _glBindSampler(0, m_PrevSampler);
+    _glActiveTexture(m_PrevActiveTexture);
+    _glBindBuffer(GL_ARRAY_BUFFER, m_PrevArrayBuffer);
+    _glBindVertexArray(m_PrevVAO);
+    _glUseProgram(m_PrevProgram);
+    _glViewport(m_PrevViewport[0], m_PrevViewport[1], m_PrevViewport[2], m_PrevViewport[3]);
+    _glPolygonMode(GL_FRONT_AND_BACK, m_PrevPolygonMode[0]);
+    RestoreEnable(GL_BLEND, m_PrevBlend);
+    RestoreEnable(GL_CULL_FACE, m_PrevCullFace);
+    RestoreEnable(GL_DEPTH_TEST, m_PrevDepthTest);
+    RestoreEnable(GL_SCISSOR_TEST, m_PrevScissorTest);
+    RestoreEnable(GL_STENCIL_TEST, m_PrevStencilTest);
+    RestoreEnable(GL_LINE_SMOOTH, m_PrevLineSmooth);
+    _glBlendEquationSeparate(m_PrevBlendEquationRGB, m_PrevBlendEquationAlpha);
+    _glBlendFuncSeparate(m_PrevBlendSrcRGB, m_PrevBlendDstRGB, m_PrevBlendSrcAlpha, m_PrevBlendDstAlpha);
+
+    CHECK_GL_ERROR;
+}
+
+//  ---------------------------------------------------------------------------
+
+bool CTwGraphOpenGLCore::IsDrawing()
+{
+    return m_Drawing;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::Restore()
+{
+    m_BatchVerts.resize(0);
+    m_Batches.resize(0);
+    m_BatchViewports.resize(0);
+    m_BatchBase = 0;
+    DeleteFontTexs();
+}
+
+//  ---------------------------------------------------------------------------
+
+CTwGraphOpenGLCore::CBatchVertex *CTwGraphOpenGLCore::AddBatchVerts(GLenum _Mode, bool _AntiAliased, int _NbVerts)
+{
+    assert(m_Drawing==true && _NbVerts>0);
+    GLuint TexID = (m_FontTexID!=0) ? m_FontTexID : m_WhiteTexID;
+    int First = (int)m_BatchVerts.size();
+    if( m_Batches.size()<=m_BatchBase || m_Batches.back().m_Mode!=_Mode || m_Batches.back().m_TexID!=TexID || m_Batches.back().m_AntiAliased!=_AntiAliased || m_Batches.back().m_Viewport!=m_CurBatchViewport )
+    {
+        CBatch Batch;
+        Batch.m_Mode = _Mode;
+        Batch.m_TexID = TexID;
+        Batch.m_AntiAliased = _AntiAliased;
+        Batch.m_Viewport = m_CurBatchViewport;
+        Batch.m_First = First;
+        Batch.m_Count = 0;
+        m_Batches.push_back(Batch);
+    }
+    m_Batches.back().m_Count += _NbVerts;
+    m_BatchVerts.resize(First+_NbVerts);
+    return &(m_BatchVerts[First]);
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::AddBatchQuad(GLfloat _X0, GLfloat _Y0, GLfloat _X1, GLfloat _Y1, color32 _Color00, color32 _Color10, color32 _Color01, color32 _Color11)
+{
+    CBatchVertex *v = AddBatchVerts(GL_TRIANGLES, false, 6);
+    v[0].x = _X0; v[0].y = _Y0; v[0].c = _Color00;
+    v[1].x = _X1; v[1].y = _Y0; v[1].c = _Color10;
+    v[2].x = _X0; v[2].y = _Y1; v[2].c = _Color01;
+    v[3].x = _X1; v[3].y = _Y0; v[3].c = _Color10;
+    v[4].x = _X1; v[4].y = _Y1; v[4].c = _Color11;
+    v[5].x = _X0; v[5].y = _Y1; v[5].c = _Color01;
+    for( int i=0; i<6; ++i )
+    {
+        v[i].u = m_WhiteU;
+        v[i].v = m_WhiteV;
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::FlushBatches()
+{
+    if( m_Batches.empty() )
+        return;
+    if( m_RecordCache!=NULL )
+        m_RecordBroken = true;  // recorded batches are gone
+
+    // the whole stream is respecified at once: the driver orphans the previous storage
+    _glBufferData(GL_ARRAY_BUFFER, m_BatchVerts.size()*sizeof(CBatchVertex), &(m_BatchVerts[0]), GL_STREAM_DRAW);
+    ApplyBatchViewport(-1);
+
+    GLuint BoundTexID = 0;
+    int Viewport = -1;
+    for( size_t i=0; i<m_Batches.size(); ++i )
+    {
+        const CBatch& Batch = m_Batches[i];
+        if( Batch.m_Viewport!=Viewport )
+        {
+            ApplyBatchViewport(Batch.m_Viewport);
+            Viewport = Batch.m_Viewport;
+        }
+        if( Batch.m_TexID!=BoundTexID )
+        {
+            _glBindTexture(GL_TEXTURE_2D, Batch.m_TexID);
+            BoundTexID = Batch.m_TexID;
+        }
+        if( Batch.m_AntiAliased )
+            _glEnable(GL_LINE_SMOOTH);
+        _glDrawArrays(Batch.m_Mode, Batch.m_First, Batch.m_Count);
+        ++m_NbDrawCalls;
+        if( Batch.m_AntiAliased )
+            _glDisable(GL_LINE_SMOOTH);
+    }
+    if( Viewport!=-1 )
+        ApplyBatchViewport(-1);
+
+    m_BatchVerts.resize(0);
+    m_Batches.resize(0);
+    m_BatchBase = 0;
+    if( m_CurBatchViewport>=0 )
+    {
+        // keep the current viewport for the next primitives
+        CBatchViewport Vp = m_BatchViewports[m_CurBatchViewport];
+        m_BatchViewports.resize(1);
+        m_BatchViewports[0] = Vp;
+        m_CurBatchViewport = 0;
+    }
+    else
+        m_BatchViewports.resize(0);
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::ApplyBatchViewport(int _Viewport)
+{
+    if( _Viewport<0 )
+    {
+        _glViewport(m_ViewportInit[0], m_ViewportInit[1], m_ViewportInit[2], m_ViewportInit[3]);
+        _glUniform4fv(m_TransformLoc, 1, m_TransformInit);
+    }
+    else
+    {
+        const CBatchViewport& Vp = m_BatchViewports[_Viewport];
+        _glViewport(Vp.m_Viewport[0], Vp.m_Viewport[1], Vp.m_Viewport[2], Vp.m_Viewport[3]);
+        _glUniform4fv(m_TransformLoc, 1, Vp.m_Transform);
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::DrawLine(int _X0, int _Y0, int _X1, int _Y1, color32 _Color0, color32 _Color1, bool _AntiAliased)
+{
+    assert(m_Drawing==true);
+    const GLfloat dx = +0.5f;
+    const GLfloat dy = -0.5f;
+
+    if( !_AntiAliased && (_X0==_X1 || _Y0==_Y1) )
+    {
+        // Horizontal and vertical lines are batched as 1-pixel wide quads
+        // (first pixel included, last pixel excluded).
+        if( _X0==_X1 && _Y0==_Y1 )
+            return;
+        color32 c0 = ToGLColor(_Color0);
+        color32 c1 = ToGLColor(_Color1);
+        if( _Y0==_Y1 )
+        {
+            GLfloat y0 = (GLfloat)_Y0+dy-0.5f;
+            if( _X0<_X1 )
+                AddBatchQuad((GLfloat)_X0, y0, (GLfloat)_X1, y0+1, c0, c1, c0, c1);
+            else
+                AddBatchQuad((GLfloat)(_X1+1), y0, (GLfloat)(_X0+1), y0+1, c1, c0, c1, c0);
+        }
+        else
+        {
+            GLfloat x0 = (GLfloat)_X0+dx-0.5f;
+            if( _Y0<_Y1 )
+                AddBatchQuad(x0, (GLfloat)_Y0+dy-0.5f, x0+1, (GLfloat)_Y1+dy-0.5f, c0, c0, c1, c1);
+            else
+                AddBatchQuad(x0, (GLfloat)_Y1+dy+0.5f, x0+1, (GLfloat)_Y0+dy+0.5f, c1, c1, c0, c0);
+        }
+        return;
+    }
+
+    CBatchVertex *v = AddBatchVerts(GL_LINES, _AntiAliased, 2);
+    v[0].x = (GLfloat)_X0+dx; v[0].y = (GLfloat)_Y0+dy; v[0].c = ToGLColor(_Color0);
+    v[1].x = (GLfloat)_X1+dx; v[1].y = (GLfloat)_Y1+dy; v[1].c = ToGLColor(_Color1);
+    v[0].u = v[1].u = m_WhiteU;
+    v[0].v = v[1].v = m_WhiteV;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::DrawRect(int _X0, int _Y0, int _X1, int _Y1, color32 _Color00, color32 _Color10, color32 _Color01, color32 _Color11)
+{
+    assert(m_Drawing==true);
+
+    // border adjustment
+    if(_X0<_X1)
+        ++_X1;
+    else if(_X0>_X1)
+        ++_X0;
+    if(_Y0<_Y1)
+        --_Y0;
+    else if(_Y0>_Y1)
+        --_Y1;
+
+    AddBatchQuad((GLfloat)_X0, (GLfloat)_Y0, (GLfloat)_X1, (GLfloat)_Y1, ToGLColor(_Color00), ToGLColor(_Color10), ToGLColor(_Color01), ToGLColor(_Color11));
+}
+
+//  ---------------------------------------------------------------------------
+
+void *CTwGraphOpenGLCore::NewTextObj()
+{
+    return new CTextObj;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::SetFontTex(const CTexFont *_Font)
+{
+    if( _Font==m_FontTex )
+        return;
+
+    // a texture is created the first time a font is used, and then reused
+    GLuint TexID = 0;
+    for( size_t i=0; i<m_FontTexs.size() && TexID==0; ++i )
+        if( m_FontTexs[i].m_Font==_Font )
+            TexID = m_FontTexs[i].m_TexID;
+    if( TexID==0 )
+    {
+        CFontTex FontTex;
+        FontTex.m_Font = _Font;
+        FontTex.m_TexID = TexID = BindFont(_Font);
+        m_FontTexs.push_back(FontTex);
+    }
+    m_FontTexID = TexID;
+    m_FontTex = _Font;
+    m_WhiteU = 0.5f/(GLfloat)_Font->m_TexWidth;
+    m_WhiteV = ((GLfloat)_Font->m_CharHeight+1.5f)/(GLfloat)_Font->m_TexHeight;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::DeleteFontTexs()
+{
+    for( size_t i=0; i<m_FontTexs.size(); ++i )
+        UnbindFont(m_FontTexs[i].m_TexID);
+    m_FontTexs.resize(0);
+    m_FontTexID = 0;
+    m_FontTex = NULL;
+    ++m_FontGeneration; // cached batches may refer to the deleted textures
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::DeleteTextObj(void *_TextObj)
+{
+    assert(_TextObj!=NULL);
+    delete static_cast<CTextObj *>(_TextObj);
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::BuildText(void *_TextObj, const std::string *_TextLines, color32 *_LineColors, color32 *_LineBgColors, int _NbLines, const CTexFont *_Font, int _Sep, int _BgWidth)
+{
+    assert(m_Drawing==true);
+    assert(_TextObj!=NULL);
+    assert(_Font!=NULL);
+
+    CTextObj *TextObj = static_cast<CTextObj *>(_TextObj);
+    TextObj->m_Font = _Font;
+    TextObj->m_BgWidth = _BgWidth;
+    TextObj->m_LineColors = (_LineColors!=NULL);
+    TextObj->m_LineBgColors = (_LineBgColors!=NULL && _BgWidth>0);
+    TextObj->m_Lines.resize(_NbLines);
+    TextObj->m_Glyphs.resize(0);
+
+    size_t NbChars = 0;
+    for( int Line=0; Line<_NbLines; ++Line )
+        NbChars += _TextLines[Line].length();
+    TextObj->m_Glyphs.reserve(NbChars);
+
+    for( int Line=0; Line<_NbLines; ++Line )
+    {
+        CTextLine& TextLine = TextObj->m_Lines[Line];
+        int y = Line * (_Font->m_CharHeight+_Sep);
+        TextLine.m_FirstGlyph = (int)TextObj->m_Glyphs.size();
+        TextLine.m_Y0 = (GLfloat)y;
+        TextLine.m_Y1 = (GLfloat)(y+_Font->m_CharHeight);
+        TextLine.m_Color = (_LineColors!=NULL) ? ToGLColor(_LineColors[Line]) : 0;
+        TextLine.m_BgColor = TextObj->m_LineBgColors ? ToGLColor(_LineBgColors[Line]) : 0;
+        AppendTextLine(TextObj->m_Glyphs, _TextLines[Line], y, _Font);
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::AppendTextLine(std::vector<CGlyph>& _Glyphs, const std::string& _TextLine, int _Y, const CTexFont *_Font)
+{
+    int Len = (int)_TextLine.length();
+    if( Len==0 )
+        return;
+    size_t First = _Glyphs.size();
+    _Glyphs.resize(First+Len);
+    TwBuildGlyphQuads(&(_Glyphs[First]), (const unsigned char *)(_TextLine.c_str()), Len, _Y, _Font);
+}
+
+//  ---------------------------------------------------------------------------
+
+bool CTwGraphOpenGLCore::UpdateTextLine(void *_TextObj, int _Line, const std::string& _TextLine, color32 _LineColor, color32 _LineBgColor, const CTexFont *_Font, int _Sep)
+{
+    assert(m_Drawing==true);
+    assert(_TextObj!=NULL);
+    assert(_Font!=NULL);
+    CTextObj *TextObj = static_cast<CTextObj *>(_TextObj);
+    if( _Font!=TextObj->m_Font || _Line<0 || _Line>=(int)TextObj->m_Lines.size() )
+        return false;   // BuildText is required
+
+    // Build the new glyphs of the line, then replace the previous ones
+    std::vector<CGlyph>& NewGlyphs = m_TextLineGlyphs;
+    NewGlyphs.resize(0);
+    AppendTextLine(NewGlyphs, _TextLine, _Line*(_Font->m_CharHeight+_Sep), _Font);
+
+    size_t First = TextObj->m_Lines[_Line].m_FirstGlyph;
+    size_t Count = TextObj->LineEnd(_Line) - First;
+    ReplaceRange(TextObj->m_Glyphs, First, Count, NewGlyphs);
+    int Delta = (int)NewGlyphs.size() - (int)Count;
+    if( Delta!=0 )
+        for( size_t l=_Line+1; l<TextObj->m_Lines.size(); ++l )
+            TextObj->m_Lines[l].m_FirstGlyph += Delta;
+
+    if( TextObj->m_LineColors )
+        TextObj->m_Lines[_Line].m_Color = ToGLColor(_LineColor);
+    if( TextObj->m_LineBgColors )
+        TextObj->m_Lines[_Line].m_BgColor = ToGLColor(_LineBgColor);
+
+    return true;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::DrawText(void *_TextObj, int _X, int _Y, color32 _Color, color32 _BgColor)
+{
+    assert(m_Drawing==true);
+    assert(_TextObj!=NULL);
+    CTextObj *TextObj = static_cast<CTextObj *>(_TextObj);
+
+    int NbLines = (int)TextObj->m_Lines.size();
+    bool DrawBg = ( NbLines>0 && TextObj->m_BgWidth>0 && (_BgColor!=0 || TextObj->m_LineBgColors) );
+    if( TextObj->m_Glyphs.size()==0 && !DrawBg )
+        return; // nothing to draw
+    if( TextObj->m_Font!=NULL )
+        SetFontTex(TextObj->m_Font);
+
+    // Quads are expanded to triangles (translated by _X,_Y) into the frame batch
+    GLfloat x = (GLfloat)_X;
+    GLfloat y = (GLfloat)_Y;
+    int Line;
+    CBatchVertex *v;
+    if( DrawBg )
+    {
+        v = AddBatchVerts(GL_TRIANGLES, false, 6*NbLines);
+        bool PerLineColors = ( TextObj->m_LineBgColors && _BgColor==0 );
+        color32 c = ToGLColor(_BgColor);
+        GLfloat x0 = x - 1;
+        GLfloat x1 = x + (GLfloat)(TextObj->m_BgWidth+1);
+        for( Line=0; Line<NbLines; ++Line, v+=6 )
+        {
+            const CTextLine& TextLine = TextObj->m_Lines[Line];
+            GLfloat y0 = TextLine.m_Y0 + y;
+            GLfloat y1 = TextLine.m_Y1 + y;
+            v[0].x = x0; v[0].y = y0;
+            v[1].x = x1; v[1].y = y0;
+            v[2].x = x0; v[2].y = y1;
+            v[3].x = x1; v[3].y = y0;
+            v[4].x = x1; v[4].y = y1;
+            v[5].x = x0; v[5].y = y1;
+            color32 LineColor = PerLineColors ? TextLine.m_BgColor : c;
+            for( int i=0; i<6; ++i )
+            {
+                v[i].u = m_WhiteU;
+                v[i].v = m_WhiteV;
+                v[i].c = LineColor;
+            }
+        }
+    }
+    if( TextObj->m_Glyphs.size()>0 )
+    {
+        v = AddBatchVerts(GL_TRIANGLES, false, 6*(int)TextObj->m_Glyphs.size());
+        bool PerLineColors = ( TextObj->m_LineColors && _Color==0 );
+        color32 c = ToGLColor(_Color);
+        for( Line=0; Line<NbLines; ++Line )
+        {
+            color32 LineColor = PerLineColors ? TextObj->m_Lines[Line].m_Color : c;
+            const CGlyph *g = &(TextObj->m_Glyphs[0]) + TextObj->m_Lines[Line].m_FirstGlyph;
+            const CGlyph *gEnd = &(TextObj->m_Glyphs[0]) + TextObj->LineEnd(Line);
+            for( ; g<gEnd; ++g, v+=6 )
+            {
+                GLfloat x0 = g->x0 + x, x1 = g->x1 + x;
+                GLfloat y0 = g->y0 + y, y1 = g->y1 + y;
+                v[0].x = x0; v[0].y = y0; v[0].u = g->u0; v[0].v = g->v0;
+                v[1].x = x1; v[1].y = y0; v[1].u = g->u1; v[1].v = g->v0;
+                v[2].x = x0; v[2].y = y1; v[2].u = g->u0; v[2].v = g->v1;
+                v[3].x = x1; v[3].y = y0; v[3].u = g->u1; v[3].v = g->v0;
+                v[4].x = x1; v[4].y = y1; v[4].u = g->u1; v[4].v = g->v1;
+                v[5].x = x0; v[5].y = y1; v[5].u = g->u0; v[5].v = g->v1;
+                v[0].c = v[1].c = v[2].c = v[3].c = v[4].c = v[5].c = LineColor;
+            }
+        }
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::ChangeViewport(int _X0, int _Y0, int _Width, int _Height, int _OffsetX, int _OffsetY)
+{
+    if( _Width>0 && _Height>0 )
+    {
+        // the viewport is applied by FlushBatches
+        CBatchViewport Vp;
+        Vp.m_Viewport[0] = _X0;
+        Vp.m_Viewport[1] = m_WndHeight-_Y0-(_Height-1);
+        Vp.m_Viewport[2] = _Width-1;
+        Vp.m_Viewport[3] = _Height-1;
+        OrthoTransform(Vp.m_Transform, (GLfloat)_OffsetX, (GLfloat)(_OffsetX+Vp.m_Viewport[2]), (GLfloat)(Vp.m_Viewport[3]-_OffsetY), (GLfloat)(-_OffsetY));
+        m_CurBatchViewport = (int)m_BatchViewports.size();
+        m_BatchViewports.push_back(Vp);
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::RestoreViewport()
+{
+    m_CurBatchViewport = -1;
+}
+
+//  ---------------------------------------------------------------------------
+
+static inline bool IsTriangleVisible(const int *_Vertices, ITwGraph::Cull _CullMode)
+{
+    // twice the signed area in window coordinates (y down): >0 for clockwise triangles
+    int Area2 = (_Vertices[2]-_Vertices[0])*(_Vertices[5]-_Vertices[1]) - (_Vertices[4]-_Vertices[0])*(_Vertices[3]-_Vertices[1]);
+    if( _CullMode==ITwGraph::CULL_CW )
+        return Area2<0;
+    else if( _CullMode==ITwGraph::CULL_CCW )
+        return Area2>0;
+    else
+        return Area2!=0;
+}
+
+void CTwGraphOpenGLCore::DrawTriangles(int _NumTriangles, int *_Vertices, color32 *_Colors, Cull _CullMode)
+{
+    assert(m_Drawing==true);
+
+    if( _NumTriangles<=0 )
+        return;
+
+    // vertices are added for all the triangles in one pass, and those of the culled triangles are removed
+    CBatchVertex *v0 = AddBatchVerts(GL_TRIANGLES, false, 3*_NumTriangles);
+    CBatchVertex *v = v0;
+    for( int i=0; i<_NumTriangles; ++i )
+        if( IsTriangleVisible(_Vertices+6*i, _CullMode) )
+            for( int j=3*i; j<3*i+3; ++j, ++v )
+            {
+                v->x = (GLfloat)_Vertices[2*j+0];
+                v->y = (GLfloat)_Vertices[2*j+1];
+                v->u = m_WhiteU;
+                v->v = m_WhiteV;
+                v->c = ToGLColor(_Colors[j]);
+            }
+    int NbCulled = 3*_NumTriangles - (int)(v-v0);
+    if( NbCulled>0 )
+    {
+        m_BatchVerts.resize(m_BatchVerts.size()-NbCulled);
+        if( (m_Batches.back().m_Count-=NbCulled)==0 )
+            m_Batches.pop_back();
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void *CTwGraphOpenGLCore::NewCacheObj()
+{
+    CCacheObj *Cache = new CCacheObj;
+    Cache->m_FontGeneration = -1;
+    Cache->m_Valid = false;
+    return Cache;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::DeleteCacheObj(void *_CacheObj)
+{
+    assert(_CacheObj!=NULL);
+    if( m_RecordCache==_CacheObj )
+        m_RecordCache = NULL;
+    delete static_cast<CCacheObj *>(_CacheObj);
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphOpenGLCore::BeginCache(void *_CacheObj)
+{
+    assert(m_Drawing==true && _CacheObj!=NULL && m_RecordCache==NULL);
+    m_RecordCache = static_cast<CCacheObj *>(_CacheObj);
+    m_RecordFirstVert = m_BatchVerts.size();
+    m_RecordFirstBatch = m_Batches.size();
+    m_RecordFirstViewport = m_BatchViewports.size();
+    m_RecordBroken = (m_CurBatchViewport>=0);
+    m_BatchBase = m_Batches.size();
+}
+
+//  ---------------------------------------------------------------------------
+
+bool CTwGraphOpenGLCore::EndCache(void *_CacheObj)
+{
+    assert(m_Drawing==true && _CacheObj==m_RecordCache);
+    CCacheObj *Cache = static_cast<CCacheObj *>(_CacheObj);
+    m_RecordCache = NULL;
+    m_BatchBase = m_Batches.size();
+    Cache->m_Valid = false;
+    if( m_RecordBroken || m_CurBatchViewport>=0 )
+        return false;
+
+    Cache->m_Verts.assign(m_BatchVerts.begin()+m_RecordFirstVert, m_BatchVerts.end());
+    Cache->m_Batches.assign(m_Batches.begin()+m_RecordFirstBatch, m_Batches.end());
+    Cache->m_Viewports.assign(m_BatchViewports.begin()+m_RecordFirstViewport, m_BatchViewports.end());
+    for( size_t i=0; i<Cache->m_Batches.size(); ++i )
+    {
+        Cache->m_Batches[i].m_First -= (int)m_RecordFirstVert;
+        if( Cache->m_Batches[i].m_Viewport>=0 )
+            Cache->m_Batches[i].m_Viewport -= (int)m_RecordFirstViewport;
+    }
+    Cache->m_FontGeneration = m_FontGeneration;
+    Cache->m_Valid = true;
+    return true;
+}
+
+//  ---------------------------------------------------------------------------
+
+bool CTwGraphOpenGLCore::DrawCache(void *_CacheObj)
+{
+    assert(m_Drawing==true && _CacheObj!=NULL);
+    const CCacheObj *Cache = static_cast<const CCacheObj *>(_CacheObj);
+    if( !Cache->m_Valid || Cache->m_FontGeneration!=m_FontGeneration || m_RecordCache!=NULL || m_CurBatchViewport>=0 )
+        return false;
+
+    int FirstVert = (int)m_BatchVerts.size();
+    int FirstViewport = (int)m_BatchViewports.size();
+    m_BatchVerts.insert(m_BatchVerts.end(), Cache->m_Verts.begin(), Cache->m_Verts.end());
+    m_BatchViewports.insert(m_BatchViewports.end(), Cache->m_Viewports.begin(), Cache->m_Viewports.end());
+    for( size_t i=0; i<Cache->m_Batches.size(); ++i )
+    {
+        CBatch Batch = Cache->m_Batches[i];
+        Batch.m_First += FirstVert;
+        if( Batch.m_Viewport>=0 )
+            Batch.m_Viewport += FirstViewport;
+        m_Batches.push_back(Batch);
+    }
+    m_BatchBase = m_Batches.size();
+    return true;
+}
+
+//  ---------------------------------------------------------------------------
@@ -0,0 +1,153 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwOpenGLCore.h
+//  @brief      OpenGL Core Profile graph functions
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  notes:      Private header
+//              TAB=4
+//
+//  ---------------------------------------------------------------------------
+
+
+#if !defined ANT_TW_OPENGL_CORE_INCLUDED
+#define ANT_TW_OPENGL_CORE_INCLUDED
+
+#include "TwGraph.h"
+#include "TwGlyphs.h"
+
+//  ---------------------------------------------------------------------------
+
+class CTwGraphOpenGLCore : public ITwGraph
+{
+public:
+    virtual int         Init();
+    virtual int         Shut();
+    virtual void        BeginDraw(int _WndWidth, int _WndHeight);
+    virtual void        EndDraw();
+    virtual bool        IsDrawing();
+    virtual void        Restore();
+    virtual void        DrawLine(int _X0, int _Y0, int _X1, int _Y1, color32 _Color0, color32 _Color1, bool _AntiAliased=false);
+    virtual void        DrawLine(int _X0, int _Y0, int _X1, int _Y1, color32 _Color, bool _AntiAliased=false) { DrawLine(_X0, _Y0, _X1, _Y1, _Color, _Color, _AntiAliased); }
+    virtual void        DrawRect(int _X0, int _Y0, int _X1, int _Y1, color32 _Color00, color32 _Color10, color32 _Color01, color32 _Color11);
+    virtual void        DrawRect(int _X0, int _Y0, int _X1, int _Y1, color32 _Color) { DrawRect(_X0, _Y0, _X1, _Y1, _Color, _Color, _Color, _Color); }
+    virtual void        DrawTriangles(int _NumTriangles, int *_Vertices, color32 *_Colors, Cull _CullMode);
+
+    virtual void *      NewTextObj();
+    virtual void        DeleteTextObj(void *_TextObj);
+    virtual void        BuildText(void *_TextObj, const std::string *_TextLines, color32 *_LineColors, color32 *_LineBgColors, int _NbLines, const CTexFont *_Font, int _Sep, int _BgWidth);
+    virtual void        DrawText(void *_TextObj, int _X, int _Y, color32 _Color, color32 _BgColor);
+    virtual bool        UpdateTextLine(void *_TextObj, int _Line, const std::string& _TextLine, color32 _LineColor, color32 _LineBgColor, const CTexFont *_Font, int _Sep);
+
+    virtual void        ChangeViewport(int _X0, int _Y0, int _Width, int _Height, int _OffsetX, int _OffsetY);
+    virtual void        RestoreViewport();
+
+    virtual int         GetDrawCallCount() { return m_NbDrawCalls; }
+
+    virtual void *      NewCacheObj();
+    virtual void        DeleteCacheObj(void *_CacheObj);
+    virtual void        BeginCache(void *_CacheObj);
+    virtual bool        EndCache(void *_CacheObj);
+    virtual bool        DrawCache(void *_CacheObj);
+
+protected:
+    bool                m_Drawing;
+    GLuint              m_FontTexID;    // texture of m_FontTex, used by the primitives added to the batches
+    const CTexFont *    m_FontTex;
+    struct CFontTex     { const CTexFont *m_Font; GLuint m_TexID; };
+    std::vector<CFontTex> m_FontTexs;   // textures of the fonts used so far, kept until Restore or Shut
+    void                SetFontTex(const CTexFont *_Font);
+    void                DeleteFontTexs();
+    GLuint              m_WhiteTexID;   // used while no font texture is bound
+    GLfloat             m_WhiteU, m_WhiteV; // uv of the opaque texel of the font texture
+    int                 m_WndWidth;
+    int                 m_WndHeight;
+    GLint               m_ViewportInit[4];
+    GLfloat             m_TransformInit[4]; // pixel to clip space: scale.xy, offset.xy
+
+    GLuint              m_VertShader;
+    GLuint              m_FragShader;
+    GLuint              m_Program;
+    GLint               m_TransformLoc;
+    GLint               m_TexLoc;
+    GLuint              m_VAO;
+    GLuint              m_VBO;
+
+    // state modified by BeginDraw, restored by EndDraw
+    GLint               m_PrevProgram;
+    GLint               m_PrevVAO;
+    GLint               m_PrevArrayBuffer;
+    GLint               m_PrevActiveTexture;
+    GLint               m_PrevTexture;
+    GLint               m_PrevSampler;
+    GLint               m_PrevViewport[4];
+    GLint               m_PrevPolygonMode[2];
+    GLboolean           m_PrevBlend;
+    GLboolean           m_PrevCullFace;
+    GLboolean           m_PrevDepthTest;
+    GLboolean           m_PrevScissorTest;
+    GLboolean           m_PrevStencilTest;
+    GLboolean           m_PrevLineSmooth;
+    GLint               m_PrevBlendEquationRGB;
+    GLint               m_PrevBlendEquationAlpha;
+    GLint               m_PrevBlendSrcRGB;
+    GLint               m_PrevBlendDstRGB;
+    GLint               m_PrevBlendSrcAlpha;
+    GLint               m_PrevBlendDstAlpha;
+
+    // Text is stored as one textured quad per glyph (expanded to two triangles
+    // by DrawText) and one color and background rectangle per line.
+    typedef CGlyphQuad  CGlyph;
+    struct CTextLine    { int m_FirstGlyph; GLfloat m_Y0, m_Y1; color32 m_Color, m_BgColor; }; // colors in GL byte order
+    struct CTextObj
+    {
+        std::vector<CGlyph> m_Glyphs;
+        std::vector<CTextLine> m_Lines;
+        int                 m_BgWidth;
+        bool                m_LineColors;
+        bool                m_LineBgColors;
+        const CTexFont *    m_Font;         // font used by BuildText
+                            CTextObj() : m_BgWidth(0), m_LineColors(false), m_LineBgColors(false), m_Font(NULL) {}
+        size_t              LineEnd(int _Line) const { return (_Line+1<(int)m_Lines.size()) ? m_Lines[_Line+1].m_FirstGlyph : m_Glyphs.size(); }
+    };
+    std::vector<CGlyph> m_TextLineGlyphs;   // scratch buffer used by UpdateTextLine
+    static void         AppendTextLine(std::vector<CGlyph>& _Glyphs, const std::string& _TextLine, int _Y, const CTexFont *_Font);
+
+    // Frame batching (see CTwGraphOpenGL)
+    struct CBatchVertex { GLfloat x, y, u, v; color32 c; };
+    struct CBatch       { GLenum m_Mode; GLuint m_TexID; bool m_AntiAliased; int m_Viewport; int m_First; int m_Count; };
+    struct CBatchViewport { GLint m_Viewport[4]; GLfloat m_Transform[4]; }; // set by ChangeViewport
+    std::vector<CBatchVertex> m_BatchVerts;
+    std::vector<CBatch> m_Batches;
+    std::vector<CBatchViewport> m_BatchViewports;
+    int                 m_CurBatchViewport; // index in m_BatchViewports, -1 for the initial viewport
+    size_t              m_BatchBase;    // batches before this index are not extended (cache boundaries)
+    int                 m_NbDrawCalls;
+    CBatchVertex *      AddBatchVerts(GLenum _Mode, bool _AntiAliased, int _NbVerts);
+    void                AddBatchQuad(GLfloat _X0, GLfloat _Y0, GLfloat _X1, GLfloat _Y1, color32 _Color00, color32 _Color10, color32 _Color01, color32 _Color11);
+    void                FlushBatches();
+    void                ApplyBatchViewport(int _Viewport);
+
+    // Retained draw cache (see CTwGraphOpenGL)
+    struct CCacheObj
+    {
+        std::vector<CBatchVertex> m_Verts;
+        std::vector<CBatch> m_Batches;
+        std::vector<CBatchViewport> m_Viewports;
+        int             m_FontGeneration;
+        bool            m_Valid;
+    };
+    CCacheObj *         m_RecordCache;
+    size_t              m_RecordFirstVert;
+    size_t              m_RecordFirstBatch;
+    size_t              m_RecordFirstViewport;
+    bool                m_RecordBroken;
+    int                 m_FontGeneration;   // incremented each time the font textures are deleted
+};
+
+//  ---------------------------------------------------------------------------
+
+
+#endif // !defined ANT_TW_OPENGL_CORE_INCLUDED
@@ -31,6 +31,8 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 #include <float.h>
@@ -44,6 +46,7 @@
 #include <map>
 #include <list>
 #include <set>
+#include <algorithm>
 #if defined(_MSC_VER) && _MSC_VER<=1200
 #   pragma warning(pop)
 #endif
@@ -55,6 +58,8 @@
 #   include <GL/glx.h>
 #   include <X11/Xatom.h>
 #   include <unistd.h>
+#   include <strings.h>
+#   include <pthread.h>
 #   undef _WIN32
 #   undef WIN32
 #   undef _WIN64
@@ -65,6 +70,7 @@
 #elif defined(_MACOSX)
 #   define ANT_OSX
 #   include <unistd.h>
+#   include <pthread.h>
 #   include <Foundation/Foundation.h>
 #   include <NSImage.h>
 #   include <NSCursor.h>
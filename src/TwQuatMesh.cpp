@@ -0,0 +1,203 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwQuatMesh.cpp
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  ---------------------------------------------------------------------------
+
+
+#include "TwPrecomp.h"
+#include "TwMgr.h"
+#include "TwQuatMesh.h"
+#include "TwCpu.h"
+
+using namespace std;
+
+typedef void (*QuatMeshKernel)(int *_Proj, float *_Z, color32 *_Colors, const CQuatMesh& _Mesh, const CQuatMeshTransform& _Transform, const color32 *_MeshColors, color32 _MeshColor, color32 _Mask);
+
+//  ---------------------------------------------------------------------------
+
+void CQuatMesh::Clear()
+{
+    m_X.clear(); m_Y.clear(); m_Z.clear();
+    m_NX.clear(); m_NY.clear(); m_NZ.clear();
+}
+
+void CQuatMesh::AddVertex(float _X, float _Y, float _Z)
+{
+    m_X.push_back(_X); m_Y.push_back(_Y); m_Z.push_back(_Z);
+}
+
+void CQuatMesh::AddVertex(float _X, float _Y, float _Z, float _NX, float _NY, float _NZ)
+{
+    m_X.push_back(_X); m_Y.push_back(_Y); m_Z.push_back(_Z);
+    m_NX.push_back(_NX); m_NY.push_back(_NY); m_NZ.push_back(_NZ);
+}
+
+//  ---------------------------------------------------------------------------
+
+// Same operations as CQuaternionExt::Permute followed by CQuaternionExt::ApplyQuat
+static inline void PermuteRotate(float *_X, float *_Y, float *_Z, const CQuatMeshTransform& _Transform)
+{
+    const float (*P)[3] = _Transform.m_Permute;
+    float x = P[0][0]*(*_X) + P[1][0]*(*_Y) + P[2][0]*(*_Z);
+    float y = P[0][1]*(*_X) + P[1][1]*(*_Y) + P[2][1]*(*_Z);
+    float z = P[0][2]*(*_X) + P[1][2]*(*_Y) + P[2][2]*(*_Z);
+    for( int q=0; q<_Transform.m_NbQuats; ++q )
+    {
+        float qx = _Transform.m_Quats[q][0], qy = _Transform.m_Quats[q][1], qz = _Transform.m_Quats[q][2], qs = _Transform.m_Quats[q][3];
+        float ps = - qx * x - qy * y - qz * z;
+        float px =   qs * x + qy * z - qz * y;
+        float py =   qs * y + qz * x - qx * z;
+        float pz =   qs * z + qx * y - qy * x;
+        x = - ps * qx + px * qs - py * qz + pz * qy;
+        y = - ps * qy + py * qs - pz * qx + px * qz;
+        z = - ps * qz + pz * qs - px * qy + py * qx;
+    }
+    *_X = x; *_Y = y; *_Z = z;
+}
+
+// Transforms the vertices of _Mesh from _First to the end
+static inline void TransformQuatMeshFrom(int _First, int *_Proj, float *_Z, color32 *_Colors, const CQuatMesh& _Mesh, const CQuatMeshTransform& _Transform, const color32 *_MeshColors, color32 _MeshColor, color32 _Mask)
+{
+    const bool HasNormals = !_Mesh.m_NX.empty();
+    const float D = (float)min(abs(_Transform.m_Width), abs(_Transform.m_Height)) - 4;
+    const float HalfW = (float)_Transform.m_Width*0.5f;
+    const float HalfH = (float)_Transform.m_Height*0.5f;
+    const int NbVerts = _Mesh.NbVerts();
+    for( int i=_First; i<NbVerts; ++i )
+    {
+        float x = _Mesh.m_X[i], y = _Mesh.m_Y[i], z = _Mesh.m_Z[i];
+        PermuteRotate(&x, &y, &z, _Transform);
+        float lz = z;
+        if( HasNormals )
+        {
+            float nx = _Mesh.m_NX[i], ny = _Mesh.m_NY[i];
+            lz = _Mesh.m_NZ[i];
+            PermuteRotate(&nx, &ny, &lz, _Transform);
+        }
+        _Proj[2*i+0] = (int)(x*0.5f*D + HalfW + 0.5f);
+        _Proj[2*i+1] = (int)(-y*0.5f*D + HalfH - 0.5f);
+        _Z[i] = z;
+        color32 Col = (_MeshColors!=NULL) ? _MeshColors[i] : _MeshColor;
+        _Colors[i] = ColorBlend(0xff000000, Col, fabsf(TClamp(lz/_Transform.m_LightScale, -1.0f, 1.0f))) & _Mask;
+    }
+}
+
+static void TransformQuatMeshScalar(int *_Proj, float *_Z, color32 *_Colors, const CQuatMesh& _Mesh, const CQuatMeshTransform& _Transform, const color32 *_MeshColors, color32 _MeshColor, color32 _Mask)
+{
+    TransformQuatMeshFrom(0, _Proj, _Z, _Colors, _Mesh, _Transform, _MeshColors, _MeshColor, _Mask);
+}
+
+//  ---------------------------------------------------------------------------
+
+// The vector kernel does the same float operations in the same order as the
+// scalar one (negations are exact, min/max clamp as TClamp, and conversions
+// to int truncate), so it writes the same values.
+
+#ifdef ANT_TW_SSE2_KERNELS
+
+ANT_TARGET_SSE2 static inline void PermuteRotate4(__m128 *_X, __m128 *_Y, __m128 *_Z, const CQuatMeshTransform& _Transform)
+{
+    const float (*P)[3] = _Transform.m_Permute;
+    __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(P[0][0]), *_X), _mm_mul_ps(_mm_set1_ps(P[1][0]), *_Y)), _mm_mul_ps(_mm_set1_ps(P[2][0]), *_Z));
+    __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(P[0][1]), *_X), _mm_mul_ps(_mm_set1_ps(P[1][1]), *_Y)), _mm_mul_ps(_mm_set1_ps(P[2][1]), *_Z));
+    __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(P[0][2]), *_X), _mm_mul_ps(_mm_set1_ps(P[1][2]), *_Y)), _mm_mul_ps(_mm_set1_ps(P[2][2]), *_Z));
+    for( int q=0; q<_Transform.m_NbQuats; ++q )
+    {
+        const float *Q = _Transform.m_Quats[q];
+        __m128 qx = _mm_set1_ps(Q[0]), qy = _mm_set1_ps(Q[1]), qz = _mm_set1_ps(Q[2]), qs = _mm_set1_ps(Q[3]);
+        __m128 nqx = _mm_set1_ps(-Q[0]), nqy = _mm_set1_ps(-Q[1]), nqz = _mm_set1_ps(-Q[2]);
+        __m128 ps = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(nqx, x), _mm_mul_ps(qy, y)), _mm_mul_ps(qz, z));
+        __m128 px = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(qs, x), _mm_mul_ps(qy, z)), _mm_mul_ps(qz, y));
+        __m128 py = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(qs, y), _mm_mul_ps(qz, x)), _mm_mul_ps(qx, z));
+        __m128 pz = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(qs, z), _mm_mul_ps(qx, y)), _mm_mul_ps(qy, x));
+        x = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(ps, nqx), _mm_mul_ps(px, qs)), _mm_mul_ps(py, qz)), _mm_mul_ps(pz, qy));
+        y = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(ps, nqy), _mm_mul_ps(py, qs)), _mm_mul_ps(pz, qx)), _mm_mul_ps(px, qz));
+        z = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(ps, nqz), _mm_mul_ps(pz, qs)), _mm_mul_ps(px, qy)), _mm_mul_ps(py, qx));
+    }
+    *_X = x; *_Y = y; *_Z = z;
+}
+
+// One channel of ColorBlend(0xff000000, _Color, _S): _Black is the channel of black (0 or 1)
+ANT_TARGET_SSE2 static inline __m128i BlendChannel4(__m128i _Color, int _Shift, __m128 _Black, __m128 _S, __m128 _T)
+{
+    __m128 c = _mm_mul_ps(_mm_set1_ps(1.0f/255.0f), _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(_Color, _Shift), _mm_set1_epi32(0xff))));
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_T, _Black), _mm_mul_ps(_S, c)), _mm_set1_ps(256.0f));
+    v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+    return _mm_slli_epi32(_mm_cvttps_epi32(v), _Shift);
+}
+
+ANT_TARGET_SSE2 static void TransformQuatMeshSSE2(int *_Proj, float *_Z, color32 *_Colors, const CQuatMesh& _Mesh, const CQuatMeshTransform& _Transform, const color32 *_MeshColors, color32 _MeshColor, color32 _Mask)
+{
+    const bool HasNormals = !_Mesh.m_NX.empty();
+    const __m128 D = _mm_set1_ps((float)min(abs(_Transform.m_Width), abs(_Transform.m_Height)) - 4);
+    const __m128 HalfW = _mm_set1_ps((float)_Transform.m_Width*0.5f);
+    const __m128 HalfH = _mm_set1_ps((float)_Transform.m_Height*0.5f);
+    const __m128 Half = _mm_set1_ps(0.5f);
+    const __m128 One = _mm_set1_ps(1.0f);
+    const __m128 MinusOne = _mm_set1_ps(-1.0f);
+    const __m128 SignMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+    const __m128 LightScale = _mm_set1_ps(_Transform.m_LightScale);
+    const __m128i Mask = _mm_set1_epi32((int)_Mask);
+    const __m128i MeshColor = _mm_set1_epi32((int)_MeshColor);
+    const int NbVerts = _Mesh.NbVerts();
+    int i = 0;
+    for( ; i+4<=NbVerts; i+=4 )
+    {
+        __m128 x = _mm_loadu_ps(&_Mesh.m_X[i]), y = _mm_loadu_ps(&_Mesh.m_Y[i]), z = _mm_loadu_ps(&_Mesh.m_Z[i]);
+        PermuteRotate4(&x, &y, &z, _Transform);
+        __m128 lz = z;
+        if( HasNormals )
+        {
+            __m128 nx = _mm_loadu_ps(&_Mesh.m_NX[i]), ny = _mm_loadu_ps(&_Mesh.m_NY[i]);
+            lz = _mm_loadu_ps(&_Mesh.m_NZ[i]);
+            PermuteRotate4(&nx, &ny, &lz, _Transform);
+        }
+
+        __m128i px = _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(x, Half), D), HalfW), Half));
+        __m128i py = _mm_cvttps_epi32(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_xor_ps(y, SignMask), Half), D), HalfH), Half));
+        _mm_storeu_si128((__m128i *)(_Proj+2*i), _mm_unpacklo_epi32(px, py));
+        _mm_storeu_si128((__m128i *)(_Proj+2*i+4), _mm_unpackhi_epi32(px, py));
+        _mm_storeu_ps(_Z+i, z);
+
+        __m128 S = _mm_andnot_ps(SignMask, _mm_min_ps(_mm_max_ps(_mm_div_ps(lz, LightScale), MinusOne), One));
+        __m128 T = _mm_sub_ps(One, S);
+        __m128i Col = (_MeshColors!=NULL) ? _mm_loadu_si128((const __m128i *)(_MeshColors+i)) : MeshColor;
+        __m128i Lit = BlendChannel4(Col, 24, One, S, T);
+        Lit = _mm_or_si128(Lit, BlendChannel4(Col, 16, _mm_setzero_ps(), S, T));
+        Lit = _mm_or_si128(Lit, BlendChannel4(Col, 8, _mm_setzero_ps(), S, T));
+        Lit = _mm_or_si128(Lit, BlendChannel4(Col, 0, _mm_setzero_ps(), S, T));
+        _mm_storeu_si128((__m128i *)(_Colors+i), _mm_and_si128(Lit, Mask));
+    }
+    TransformQuatMeshFrom(i, _Proj, _Z, _Colors, _Mesh, _Transform, _MeshColors, _MeshColor, _Mask);
+}
+
+#endif // ANT_TW_SSE2_KERNELS
+
+//  ---------------------------------------------------------------------------
+
+static QuatMeshKernel SelectQuatMeshKernel()
+{
+#ifdef ANT_TW_SSE2_KERNELS
+    if( TwCpuHasSSE2() )
+        return TransformQuatMeshSSE2;
+#endif
+    return TransformQuatMeshScalar;
+}
+
+//  ---------------------------------------------------------------------------
+
+static QuatMeshKernel g_QuatMeshKernel = NULL;  // selected at the first call
+
+void TwTransformQuatMesh(int *_Proj, float *_Z, color32 *_Colors, const CQuatMesh& _Mesh, const CQuatMeshTransform& _Transform, const color32 *_MeshColors, color32 _MeshColor, color32 _Mask)
+{
+    assert(_Transform.m_NbQuats>=0 && _Transform.m_NbQuats<=2);
+    if( g_QuatMeshKernel==NULL )
+        g_QuatMeshKernel = SelectQuatMeshKernel();
+    g_QuatMeshKernel(_Proj, _Z, _Colors, _Mesh, _Transform, _MeshColors, _MeshColor, _Mask);
+}
+
+//  ---------------------------------------------------------------------------
@@ -0,0 +1,57 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwQuatMesh.h
+//  @brief      Transform, lighting and projection of the quaternion widget meshes
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  notes:      Private header
+//              TAB=4
+//
+//  ---------------------------------------------------------------------------
+
+
+#if !defined ANT_TW_QUAT_MESH_INCLUDED
+#define ANT_TW_QUAT_MESH_INCLUDED
+
+#include "TwColors.h"
+
+//  ---------------------------------------------------------------------------
+//  A quat mesh stores the triangle vertices of a sphere or arrow part drawn by
+//  the quaternion and direction widgets, one array per coordinate (normals are
+//  empty for the sphere). TwTransformQuatMesh permutes each vertex and rotates
+//  it by the m_NbQuats quaternions (applied in order), then writes its pixel
+//  coordinates in the m_Width x m_Height widget rectangle, its rotated z and
+//  its color (_MeshColors[i], or _MeshColor if _MeshColors is NULL) blended
+//  with black by the rotated normal z (or by the rotated position z divided by
+//  m_LightScale if the mesh has no normals), masked by _Mask.
+//  Vertices are processed 4 at a time with SSE2 when the CPU supports it;
+//  both versions write the same values.
+//  ---------------------------------------------------------------------------
+
+struct CQuatMesh
+{
+    std::vector<float>  m_X, m_Y, m_Z;
+    std::vector<float>  m_NX, m_NY, m_NZ;
+    int                 NbVerts() const { return (int)m_X.size(); }
+    void                Clear();
+    void                AddVertex(float _X, float _Y, float _Z);
+    void                AddVertex(float _X, float _Y, float _Z, float _NX, float _NY, float _NZ);
+};
+
+struct CQuatMeshTransform
+{
+    float               m_Permute[3][3];
+    float               m_Quats[2][4];      // x, y, z, s
+    int                 m_NbQuats;
+    int                 m_Width, m_Height;
+    float               m_LightScale;
+};
+
+void    TwTransformQuatMesh(int *_Proj, float *_Z, color32 *_Colors, const CQuatMesh& _Mesh, const CQuatMeshTransform& _Transform, const color32 *_MeshColors, color32 _MeshColor, color32 _Mask);
+
+//  ---------------------------------------------------------------------------
+
+
+#endif // !defined ANT_TW_QUAT_MESH_INCLUDED
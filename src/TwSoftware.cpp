@@ -0,0 +1,736 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwSoftware.cpp
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  note:       TAB=4
+//
+//  ---------------------------------------------------------------------------
+
+
+#include "TwPrecomp.h"
+#include "TwSoftware.h"
+#include "TwMgr.h"
+#include "TwCpu.h"
+
+using namespace std;
+
+//  ---------------------------------------------------------------------------
+//  Pixel conventions are those of CTwGraphDirect3D9: pixel centers are at
+//  integer coordinates, rectangles include both corners and lines exclude
+//  their last pixel.
+//  Colors are blended "over" the buffer: rgb = src*a + dst*(1-a) and
+//  alpha = a + dst*(1-a), so the buffer can be composited afterwards.
+//  ---------------------------------------------------------------------------
+
+static inline void ToRGB1(color32 _Color, unsigned char *_RGB1)
+{
+    _RGB1[0] = (unsigned char)(_Color>>16);
+    _RGB1[1] = (unsigned char)(_Color>>8);
+    _RGB1[2] = (unsigned char)(_Color);
+    _RGB1[3] = 255;
+}
+
+static inline void ToRGBAf(color32 _Color, float *_RGBA)
+{
+    _RGBA[0] = (float)((_Color>>16)&0xff);
+    _RGBA[1] = (float)((_Color>>8)&0xff);
+    _RGBA[2] = (float)(_Color&0xff);
+    _RGBA[3] = (float)(_Color>>24);
+}
+
+//  ---------------------------------------------------------------------------
+
+// _Src is rgb + 255, _Alpha in [0,255]
+static inline void BlendPixel8(unsigned char *_Dst, const unsigned char *_Src, int _Alpha)
+{
+    for( int k=0; k<4; ++k )
+    {
+        int t = _Src[k]*_Alpha + _Dst[k]*(255-_Alpha) + 128;
+        _Dst[k] = (unsigned char)((t + (t>>8))>>8);
+    }
+}
+
+// _Color is rgba in [0,255]
+static inline void BlendPixelf(unsigned char *_Dst, const float *_Color, float _Coverage)
+{
+    float a = _Color[3]*_Coverage*(1.0f/255.0f);
+    for( int k=0; k<3; ++k )
+        _Dst[k] = (unsigned char)(_Dst[k] + (_Color[k]-_Dst[k])*a + 0.5f);
+    _Dst[3] = (unsigned char)(_Dst[3] + (255.0f-_Dst[3])*a + 0.5f);
+}
+
+//  ---------------------------------------------------------------------------
+
+// The SSE2 span kernels process the pixels by groups of 4 and return the
+// number of pixels processed; the scalar loops finish the span. Both write
+// the same values.
+
+#ifdef ANT_TW_SSE2_KERNELS
+
+ANT_TARGET_SSE2 static int BlendSpanSolidSSE2(unsigned char *_Dst, int _Len, const unsigned char *_Src, int _Alpha)
+{
+    int i = 0;
+    int SrcPx;
+    memcpy(&SrcPx, _Src, 4);
+    const __m128i s = _mm_set1_epi32(SrcPx);
+    if( _Alpha==255 )
+        for( ; i+4<=_Len; i+=4 )
+            _mm_storeu_si128((__m128i *)(_Dst+4*i), s);
+    else
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i sa = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), _mm_set1_epi16((short)_Alpha)), _mm_set1_epi16(128));
+        const __m128i ia = _mm_set1_epi16((short)(255-_Alpha));
+        for( ; i+4<=_Len; i+=4 )
+        {
+            __m128i d = _mm_loadu_si128((const __m128i *)(_Dst+4*i));
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), ia), sa);
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), ia), sa);
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+            _mm_storeu_si128((__m128i *)(_Dst+4*i), _mm_packus_epi16(lo, hi));
+        }
+    }
+    return i;
+}
+
+ANT_TARGET_SSE2 static int BlendSpanMaskSSE2(unsigned char *_Dst, int _Len, const unsigned char *_Src, int _Alpha, const unsigned char *_Mask)
+{
+    int i = 0;
+    int SrcPx;
+    memcpy(&SrcPx, _Src, 4);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i s = _mm_unpacklo_epi8(_mm_set1_epi32(SrcPx), zero);
+    const __m128i a = _mm_set1_epi16((short)_Alpha);
+    const __m128i c128 = _mm_set1_epi16(128);
+    const __m128i c255 = _mm_set1_epi16(255);
+    for( ; i+4<=_Len; i+=4 )
+    {
+        int m4;
+        memcpy(&m4, _Mask+i, 4);
+        if( m4==0 )
+            continue;
+        __m128i m = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(m4), zero), a), c128);
+        m = _mm_srli_epi16(_mm_add_epi16(m, _mm_srli_epi16(m, 8)), 8);
+        m = _mm_unpacklo_epi16(m, m);
+        __m128i alo = _mm_unpacklo_epi32(m, m); // alpha of pixels 0,1 replicated on their 4 channels
+        __m128i ahi = _mm_unpackhi_epi32(m, m); // alpha of pixels 2,3
+        __m128i d = _mm_loadu_si128((const __m128i *)(_Dst+4*i));
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s, alo), _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(c255, alo))), c128);
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s, ahi), _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(c255, ahi))), c128);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        _mm_storeu_si128((__m128i *)(_Dst+4*i), _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+// Same float operations as BlendPixelf, one pixel at a time
+ANT_TARGET_SSE2 static int BlendSpanGradientSSE2(unsigned char *_Dst, int _Len, float *_Color, const float *_DColor)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 AlphaLane = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    const __m128 c255 = _mm_set1_ps(255.0f);
+    const __m128 Inv255 = _mm_set1_ps(1.0f/255.0f);
+    const __m128 Half = _mm_set1_ps(0.5f);
+    const __m128 dc = _mm_loadu_ps(_DColor);
+    __m128 c = _mm_loadu_ps(_Color);
+    for( int i=0; i<_Len; ++i, c=_mm_add_ps(c, dc) )
+    {
+        __m128 a = _mm_mul_ps(_mm_shuffle_ps(c, c, _MM_SHUFFLE(3,3,3,3)), Inv255);
+        __m128 s = _mm_or_ps(_mm_andnot_ps(AlphaLane, c), _mm_and_ps(AlphaLane, c255));
+        int px;
+        memcpy(&px, _Dst+4*i, 4);
+        __m128 d = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(px), zero), zero));
+        __m128i o = _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(d, _mm_mul_ps(_mm_sub_ps(s, d), a)), Half));
+        o = _mm_packs_epi32(o, o);
+        px = _mm_cvtsi128_si32(_mm_packus_epi16(o, o));
+        memcpy(_Dst+4*i, &px, 4);
+    }
+    _mm_storeu_ps(_Color, c);
+    return _Len;
+}
+
+#endif // ANT_TW_SSE2_KERNELS
+
+static bool g_UseSSE2 = false;  // set by CTwGraphSoftware::Init
+
+//  ---------------------------------------------------------------------------
+
+// Blend a constant color over _Len pixels
+static void BlendSpanSolid(unsigned char *_Dst, int _Len, color32 _Color)
+{
+    int Alpha = (int)(_Color>>24);
+    if( Alpha==0 || _Len<=0 )
+        return;
+    unsigned char Src[4];
+    ToRGB1(_Color, Src);
+    int i = 0;
+#ifdef ANT_TW_SSE2_KERNELS
+    if( g_UseSSE2 )
+        i = BlendSpanSolidSSE2(_Dst, _Len, Src, Alpha);
+#endif
+    for( ; i<_Len; ++i )
+        BlendPixel8(_Dst+4*i, Src, Alpha);
+}
+
+//  ---------------------------------------------------------------------------
+
+// Blend a constant color modulated by an 8-bit coverage mask over _Len pixels
+static void BlendSpanMask(unsigned char *_Dst, int _Len, color32 _Color, const unsigned char *_Mask)
+{
+    int Alpha = (int)(_Color>>24);
+    if( Alpha==0 || _Len<=0 )
+        return;
+    unsigned char Src[4];
+    ToRGB1(_Color, Src);
+    int i = 0;
+#ifdef ANT_TW_SSE2_KERNELS
+    if( g_UseSSE2 )
+        i = BlendSpanMaskSSE2(_Dst, _Len, Src, Alpha, _Mask);
+#endif
+    for( ; i<_Len; ++i )
+        if( _Mask[i]!=0 )
+        {
+            int t = Alpha*_Mask[i] + 128;
+            BlendPixel8(_Dst+4*i, Src, (t + (t>>8))>>8);
+        }
+}
+
+//  ---------------------------------------------------------------------------
+
+// Blend a linearly interpolated color over _Len pixels (_Color and _DColor are rgba in [0,255])
+static void BlendSpanGradient(unsigned char *_Dst, int _Len, const float *_Color, const float *_DColor)
+{
+    if( _Len<=0 )
+        return;
+    float c[4] = { _Color[0], _Color[1], _Color[2], _Color[3] };
+    int i = 0;
+#ifdef ANT_TW_SSE2_KERNELS
+    if( g_UseSSE2 )
+        i = BlendSpanGradientSSE2(_Dst, _Len, c, _DColor);
+#endif
+    for( ; i<_Len; ++i )
+    {
+        BlendPixelf(_Dst+4*i, c, 1.0f);
+        for( int k=0; k<4; ++k )
+            c[k] += _DColor[k];
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+int CTwGraphSoftware::Init()
+{
+    assert(g_TwMgr->m_Device!=NULL);
+
+    m_Drawing = false;
+    m_Pixels = NULL;
+    m_Pitch = 0;
+    m_Width = m_Height = 0;
+    m_ClipX0 = m_ClipY0 = m_ClipX1 = m_ClipY1 = 0;
+    m_OffsetX = m_OffsetY = 0;
+    m_NbDrawCalls = 0;
+#ifdef ANT_TW_SSE2_KERNELS
+    g_UseSSE2 = TwCpuHasSSE2();
+#endif
+    return 1;
+}
+
+//  ---------------------------------------------------------------------------
+
+int CTwGraphSoftware::Shut()
+{
+    assert(m_Drawing==false);
+    m_Pixels = NULL;
+    return 1;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::BeginDraw(int _WndWidth, int _WndHeight)
+{
+    assert(m_Drawing==false && _WndWidth>0 && _WndHeight>0);
+    m_Drawing = true;
+    m_NbDrawCalls = 0;
+
+    // the buffer description is read at each frame: the application may resize or move it
+    const TwSoftwareBuffer *Buffer = static_cast<const TwSoftwareBuffer *>(g_TwMgr->m_Device);
+    m_Pixels = static_cast<unsigned char *>(Buffer->Pixels);
+    m_Pitch = (Buffer->Pitch!=0) ? Buffer->Pitch : 4*Buffer->Width;
+    if( m_Pixels!=NULL )
+    {
+        m_Width = min(_WndWidth, Buffer->Width);
+        m_Height = min(_WndHeight, Buffer->Height);
+    }
+    else
+        m_Width = m_Height = 0;
+
+    RestoreViewport();
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::EndDraw()
+{
+    assert(m_Drawing==true);
+    m_Drawing = false;
+}
+
+//  ---------------------------------------------------------------------------
+
+bool CTwGraphSoftware::IsDrawing()
+{
+    return m_Drawing;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::Restore()
+{
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::FillRect(int _X0, int _Y0, int _X1, int _Y1, color32 _Color)
+{
+    // _X1 and _Y1 excluded, screen coordinates
+    int x0 = max(_X0, m_ClipX0);
+    int x1 = min(_X1, m_ClipX1);
+    int y0 = max(_Y0, m_ClipY0);
+    int y1 = min(_Y1, m_ClipY1);
+    for( int y=y0; y<y1; ++y )
+        BlendSpanSolid(m_Pixels + y*m_Pitch + 4*x0, x1-x0, _Color);
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::BlendPixel(int _X, int _Y, const float *_Color, float _Coverage)
+{
+    if( _X>=m_ClipX0 && _X<m_ClipX1 && _Y>=m_ClipY0 && _Y<m_ClipY1 )
+        BlendPixelf(m_Pixels + _Y*m_Pitch + 4*_X, _Color, _Coverage);
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::DrawLine(int _X0, int _Y0, int _X1, int _Y1, color32 _Color0, color32 _Color1, bool _AntiAliased)
+{
+    assert(m_Drawing==true);
+
+    int x0 = _X0 + m_OffsetX;
+    int y0 = _Y0 + m_OffsetY;
+    int dx = _X1 - _X0;
+    int dy = _Y1 - _Y0;
+    int n = max(abs(dx), abs(dy));
+    if( n==0 )
+        return;
+    ++m_NbDrawCalls;
+
+    float c[4], dc[4];
+    ToRGBAf(_Color0, c);
+    ToRGBAf(_Color1, dc);
+    int k;
+    for( k=0; k<4; ++k )
+        dc[k] = (dc[k]-c[k])/(float)n;
+
+    if( dy==0 )
+    {
+        // horizontal span, from x0 included to x1 excluded
+        if( y0<m_ClipY0 || y0>=m_ClipY1 )
+            return;
+        int xs = (dx>0) ? x0 : x0+dx+1;
+        int xe = (dx>0) ? x0+dx : x0+1;
+        if( dx<0 )
+            for( k=0; k<4; ++k )
+            {
+                c[k] += dc[k]*(float)(n-1);
+                dc[k] = -dc[k];
+            }
+        int cxs = max(xs, m_ClipX0);
+        int cxe = min(xe, m_ClipX1);
+        if( cxs<cxe )
+        {
+            for( k=0; k<4; ++k )
+                c[k] += dc[k]*(float)(cxs-xs);
+            if( _Color0==_Color1 )
+                BlendSpanSolid(m_Pixels + y0*m_Pitch + 4*cxs, cxe-cxs, _Color0);
+            else
+                BlendSpanGradient(m_Pixels + y0*m_Pitch + 4*cxs, cxe-cxs, c, dc);
+        }
+        return;
+    }
+
+    float sx = (float)dx/(float)n;
+    float sy = (float)dy/(float)n;
+    bool XMajor = abs(dx)>=abs(dy);
+    for( int i=0; i<n; ++i )
+    {
+        float x = (float)x0 + sx*(float)i;
+        float y = (float)y0 + sy*(float)i;
+        if( !_AntiAliased )
+            BlendPixel((int)floorf(x+0.5f), (int)floorf(y+0.5f), c, 1.0f);
+        else if( XMajor )
+        {
+            // Wu's algorithm: coverage split between the two pixels closest to the line
+            float fy = floorf(y);
+            BlendPixel((int)x, (int)fy, c, 1.0f-(y-fy));
+            BlendPixel((int)x, (int)fy+1, c, y-fy);
+        }
+        else
+        {
+            float fx = floorf(x);
+            BlendPixel((int)fx, (int)y, c, 1.0f-(x-fx));
+            BlendPixel((int)fx+1, (int)y, c, x-fx);
+        }
+        for( k=0; k<4; ++k )
+            c[k] += dc[k];
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::DrawRect(int _X0, int _Y0, int _X1, int _Y1, color32 _Color00, color32 _Color10, color32 _Color01, color32 _Color11)
+{
+    assert(m_Drawing==true);
+
+    if( _X0==_X1 || _Y0==_Y1 )
+        return; // empty (same as Direct3D9)
+    if( _X0>_X1 )
+    {
+        swap(_X0, _X1);
+        swap(_Color00, _Color10);
+        swap(_Color01, _Color11);
+    }
+    if( _Y0>_Y1 )
+    {
+        swap(_Y0, _Y1);
+        swap(_Color00, _Color01);
+        swap(_Color10, _Color11);
+    }
+    ++m_NbDrawCalls;
+
+    // border adjustment: both corners are included
+    int x0 = _X0 + m_OffsetX;
+    int y0 = _Y0 + m_OffsetY;
+    int x1 = _X1 + 1 + m_OffsetX;
+    int y1 = _Y1 + 1 + m_OffsetY;
+    if( _Color00==_Color10 && _Color00==_Color01 && _Color00==_Color11 )
+    {
+        FillRect(x0, y0, x1, y1, _Color00);
+        return;
+    }
+
+    int cx0 = max(x0, m_ClipX0);
+    int cx1 = min(x1, m_ClipX1);
+    int cy0 = max(y0, m_ClipY0);
+    int cy1 = min(y1, m_ClipY1);
+    if( cx0>=cx1 )
+        return;
+    float c00[4], c10[4], c01[4], c11[4], l[4], dc[4];
+    ToRGBAf(_Color00, c00);
+    ToRGBAf(_Color10, c10);
+    ToRGBAf(_Color01, c01);
+    ToRGBAf(_Color11, c11);
+    float InvW = 1.0f/(float)(x1-x0);
+    float InvH = 1.0f/(float)(y1-y0);
+    bool HorizGradient = (_Color00!=_Color10 || _Color01!=_Color11);
+    for( int y=cy0; y<cy1; ++y )
+    {
+        float ty = ((float)(y-y0)+0.5f)*InvH;
+        for( int k=0; k<4; ++k )
+        {
+            l[k] = c00[k] + (c01[k]-c00[k])*ty;
+            dc[k] = (c10[k] + (c11[k]-c10[k])*ty - l[k])*InvW;
+            l[k] += dc[k]*((float)(cx0-x0)+0.5f);
+        }
+        unsigned char *Row = m_Pixels + y*m_Pitch + 4*cx0;
+        if( HorizGradient )
+            BlendSpanGradient(Row, cx1-cx0, l, dc);
+        else
+        {
+            color32 Color = ((color32)(l[3]+0.5f)<<24) | ((color32)(l[0]+0.5f)<<16) | ((color32)(l[1]+0.5f)<<8) | (color32)(l[2]+0.5f);
+            BlendSpanSolid(Row, cx1-cx0, Color);
+        }
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void *CTwGraphSoftware::NewTextObj()
+{
+    CTextObj *TextObj = new CTextObj;
+    TextObj->m_Font = NULL;
+    TextObj->m_LineColors = false;
+    TextObj->m_LineBgColors = false;
+    return TextObj;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::DeleteTextObj(void *_TextObj)
+{
+    assert(_TextObj!=NULL);
+    delete static_cast<CTextObj *>(_TextObj);
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::BuildText(void *_TextObj, const std::string *_TextLines, color32 *_LineColors, color32 *_LineBgColors, int _NbLines, const CTexFont *_Font, int _Sep, int _BgWidth)
+{
+    assert(m_Drawing==true);
+    assert(_TextObj!=NULL);
+    assert(_Font!=NULL);
+
+    CTextObj *TextObj = static_cast<CTextObj *>(_TextObj);
+    TextObj->m_Glyphs.resize(0);
+    TextObj->m_BgRects.resize(0);
+    TextObj->m_LineFirst.resize(0);
+    TextObj->m_Font = _Font;
+    TextObj->m_LineColors = (_LineColors!=NULL);
+    TextObj->m_LineBgColors = (_LineBgColors!=NULL);
+
+    int y, y1;
+    CBgRect BgRect;
+    for( int Line=0; Line<_NbLines; ++Line )
+    {
+        y = Line * (_Font->m_CharHeight+_Sep);
+        y1 = y+_Font->m_CharHeight;
+        TextObj->m_LineFirst.push_back((int)TextObj->m_Glyphs.size());
+        AppendTextLine(TextObj->m_Glyphs, _TextLines[Line], (_LineColors!=NULL) ? _LineColors[Line] : COLOR32_RED, y, _Font);
+
+        if( _BgWidth>0 )
+        {
+            BgRect.m_X0 = -1;
+            BgRect.m_Y0 = y;
+            BgRect.m_X1 = _BgWidth+1;
+            BgRect.m_Y1 = y1;
+            BgRect.m_Color = (_LineBgColors!=NULL) ? _LineBgColors[Line] : COLOR32_BLACK;
+            TextObj->m_BgRects.push_back(BgRect);
+        }
+    }
+    TextObj->m_LineFirst.push_back((int)TextObj->m_Glyphs.size());
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::AppendTextLine(std::vector<CGlyph>& _Glyphs, const std::string& _TextLine, color32 _LineColor, int _Y, const CTexFont *_Font)
+{
+    int Len = (int)_TextLine.length();
+    if( Len==0 )
+        return;
+    m_LineQuads.resize(Len);
+    TwBuildGlyphQuads(&(m_LineQuads[0]), (const unsigned char *)(_TextLine.c_str()), Len, _Y, _Font);
+    CGlyph Glyph;
+    Glyph.m_Color = _LineColor;
+    Glyph.m_Y0 = _Y;
+    Glyph.m_Y1 = _Y+_Font->m_CharHeight;
+    for( int i=0; i<Len; ++i )
+    {
+        const CGlyphQuad& q = m_LineQuads[i];
+        if( q.x1>q.x0 )
+        {
+            // glyphs are drawn unscaled: only the texel origin is needed
+            Glyph.m_X0 = (int)q.x0;
+            Glyph.m_X1 = (int)q.x1;
+            Glyph.m_TexX = (int)(q.u0*(float)_Font->m_TexWidth);
+            Glyph.m_TexY = (int)(q.v0*(float)_Font->m_TexHeight);
+            assert( Glyph.m_TexX+Glyph.m_X1-Glyph.m_X0<=_Font->m_TexWidth && Glyph.m_TexY+Glyph.m_Y1-_Y<=_Font->m_TexHeight );
+            _Glyphs.push_back(Glyph);
+        }
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+bool CTwGraphSoftware::UpdateTextLine(void *_TextObj, int _Line, const std::string& _TextLine, color32 _LineColor, color32 _LineBgColor, const CTexFont *_Font, int _Sep)
+{
+    assert(m_Drawing==true);
+    assert(_TextObj!=NULL);
+    assert(_Font!=NULL);
+    CTextObj *TextObj = static_cast<CTextObj *>(_TextObj);
+    if( _Font!=TextObj->m_Font || _Line<0 || _Line+1>=(int)TextObj->m_LineFirst.size() )
+        return false;   // BuildText is required
+
+    m_TextLineGlyphs.resize(0);
+    AppendTextLine(m_TextLineGlyphs, _TextLine, TextObj->m_LineColors ? _LineColor : COLOR32_RED, _Line*(_Font->m_CharHeight+_Sep), _Font);
+    size_t First = TextObj->m_LineFirst[_Line];
+    size_t Count = TextObj->m_LineFirst[_Line+1] - TextObj->m_LineFirst[_Line];
+    ReplaceRange(TextObj->m_Glyphs, First, Count, m_TextLineGlyphs);
+    int Delta = (int)m_TextLineGlyphs.size() - (int)Count;
+    if( Delta!=0 )
+        for( size_t l=_Line+1; l<TextObj->m_LineFirst.size(); ++l )
+            TextObj->m_LineFirst[l] += Delta;
+
+    if( TextObj->m_LineBgColors && _Line<(int)TextObj->m_BgRects.size() )
+        TextObj->m_BgRects[_Line].m_Color = _LineBgColor;
+
+    return true;
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::DrawText(void *_TextObj, int _X, int _Y, color32 _Color, color32 _BgColor)
+{
+    assert(m_Drawing==true);
+    assert(_TextObj!=NULL);
+    CTextObj *TextObj = static_cast<CTextObj *>(_TextObj);
+    int x = _X + m_OffsetX;
+    int y = _Y + m_OffsetY;
+    size_t i;
+
+    if( TextObj->m_BgRects.size()>0 )
+    {
+        bool UseBgColor = ( _BgColor!=0 || !TextObj->m_LineBgColors );
+        for( i=0; i<TextObj->m_BgRects.size(); ++i )
+        {
+            const CBgRect& r = TextObj->m_BgRects[i];
+            FillRect(r.m_X0+x, r.m_Y0+y, r.m_X1+x, r.m_Y1+y, UseBgColor ? _BgColor : r.m_Color);
+        }
+        ++m_NbDrawCalls;
+    }
+
+    if( TextObj->m_Glyphs.size()>0 )
+    {
+        const CTexFont *Font = TextObj->m_Font;
+        assert(Font!=NULL);
+        bool UseColor = ( _Color!=0 || !TextObj->m_LineColors );
+        for( i=0; i<TextObj->m_Glyphs.size(); ++i )
+        {
+            const CGlyph& g = TextObj->m_Glyphs[i];
+            int x0 = max(g.m_X0+x, m_ClipX0);
+            int x1 = min(g.m_X1+x, m_ClipX1);
+            int y0 = max(g.m_Y0+y, m_ClipY0);
+            int y1 = min(g.m_Y1+y, m_ClipY1);
+            if( x0>=x1 )
+                continue;
+            color32 Color = UseColor ? _Color : g.m_Color;
+            const unsigned char *Mask = Font->m_TexBytes + (g.m_TexY+y0-(g.m_Y0+y))*Font->m_TexWidth + g.m_TexX+x0-(g.m_X0+x);
+            for( int yy=y0; yy<y1; ++yy, Mask+=Font->m_TexWidth )
+                BlendSpanMask(m_Pixels + yy*m_Pitch + 4*x0, x1-x0, Color, Mask);
+        }
+        ++m_NbDrawCalls;
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::ChangeViewport(int _X0, int _Y0, int _Width, int _Height, int _OffsetX, int _OffsetY)
+{
+    if( _Width>0 && _Height>0 )
+    {
+        m_ClipX0 = max(_X0, 0);
+        m_ClipY0 = max(_Y0, 0);
+        m_ClipX1 = min(_X0+_Width, m_Width);
+        m_ClipY1 = min(_Y0+_Height, m_Height);
+        m_OffsetX = _X0 + _OffsetX;
+        m_OffsetY = _Y0 + _OffsetY - 1;
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+void CTwGraphSoftware::RestoreViewport()
+{
+    m_ClipX0 = m_ClipY0 = 0;
+    m_ClipX1 = m_Width;
+    m_ClipY1 = m_Height;
+    m_OffsetX = m_OffsetY = 0;
+}
+
+//  ---------------------------------------------------------------------------
+
+// Twice the signed area of triangle (a,b,p); positive when clockwise on screen (y down)
+static inline int Orient2D(int _Ax, int _Ay, int _Bx, int _By, int _Px, int _Py)
+{
+    return (_Bx-_Ax)*(_Py-_Ay) - (_By-_Ay)*(_Px-_Ax);
+}
+
+// Top-left fill rule for a clockwise triangle edge (a,b)
+static inline int TopLeftBias(int _Ax, int _Ay, int _Bx, int _By)
+{
+    return ( (_Ay==_By && _Bx>_Ax) || _By<_Ay ) ? 1 : 0;
+}
+
+void CTwGraphSoftware::DrawTriangles(int _NumTriangles, int *_Vertices, color32 *_Colors, Cull _CullMode)
+{
+    assert(m_Drawing==true);
+
+    if( _NumTriangles<=0 )
+        return;
+    ++m_NbDrawCalls;
+
+    int v[3][2], j, k;
+    float c[3][4];
+    for( int i=0; i<_NumTriangles; ++i )
+    {
+        for( j=0; j<3; ++j )
+        {
+            v[j][0] = _Vertices[6*i+2*j+0] + m_OffsetX;
+            v[j][1] = _Vertices[6*i+2*j+1] + m_OffsetY;
+        }
+        int Area2 = Orient2D(v[0][0], v[0][1], v[1][0], v[1][1], v[2][0], v[2][1]);
+        if( Area2==0 || (_CullMode==CULL_CW && Area2>0) || (_CullMode==CULL_CCW && Area2<0) )
+            continue;
+        for( j=0; j<3; ++j )
+            ToRGBAf(_Colors[3*i+j], c[j]);
+        if( Area2<0 )
+        {
+            // make it clockwise
+            swap(v[1][0], v[2][0]);
+            swap(v[1][1], v[2][1]);
+            for( k=0; k<4; ++k )
+                swap(c[1][k], c[2][k]);
+            Area2 = -Area2;
+        }
+
+        int bx0 = max(min(v[0][0], min(v[1][0], v[2][0])), m_ClipX0);
+        int bx1 = min(max(v[0][0], max(v[1][0], v[2][0]))+1, m_ClipX1);
+        int by0 = max(min(v[0][1], min(v[1][1], v[2][1])), m_ClipY0);
+        int by1 = min(max(v[0][1], max(v[1][1], v[2][1]))+1, m_ClipY1);
+        if( bx0>=bx1 || by0>=by1 )
+            continue;
+
+        // edge functions w0, w1, w2 (weights of v0, v1, v2) and their x steps
+        int b0 = TopLeftBias(v[1][0], v[1][1], v[2][0], v[2][1]);
+        int b1 = TopLeftBias(v[2][0], v[2][1], v[0][0], v[0][1]);
+        int b2 = TopLeftBias(v[0][0], v[0][1], v[1][0], v[1][1]);
+        int dw0 = v[1][1] - v[2][1];
+        int dw1 = v[2][1] - v[0][1];
+        int dw2 = v[0][1] - v[1][1];
+        float InvArea = 1.0f/(float)Area2;
+        float dc[4];
+        for( k=0; k<4; ++k )
+            dc[k] = ((float)dw0*c[0][k] + (float)dw1*c[1][k] + (float)dw2*c[2][k])*InvArea;
+
+        for( int y=by0; y<by1; ++y )
+        {
+            int w0 = Orient2D(v[1][0], v[1][1], v[2][0], v[2][1], bx0, y);
+            int w1 = Orient2D(v[2][0], v[2][1], v[0][0], v[0][1], bx0, y);
+            int w2 = Orient2D(v[0][0], v[0][1], v[1][0], v[1][1], bx0, y);
+            int x = bx0;
+            while( x<bx1 && (w0+b0<=0 || w1+b1<=0 || w2+b2<=0) )
+            {
+                ++x;
+                w0 += dw0; w1 += dw1; w2 += dw2;
+            }
+            if( x>=bx1 )
+                continue;
+            int xs = x;
+            float cs[4];
+            for( k=0; k<4; ++k )
+                cs[k] = ((float)w0*c[0][k] + (float)w1*c[1][k] + (float)w2*c[2][k])*InvArea;
+            // the triangle is convex: covered pixels of a row are contiguous
+            while( x<bx1 && w0+b0>0 && w1+b1>0 && w2+b2>0 )
+            {
+                ++x;
+                w0 += dw0; w1 += dw1; w2 += dw2;
+            }
+            BlendSpanGradient(m_Pixels + y*m_Pitch + 4*xs, x-xs, cs, dc);
+        }
+    }
+}
+
+//  ---------------------------------------------------------------------------
@@ -0,0 +1,82 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwSoftware.h
+//  @brief      Software (CPU rasterizer) graph functions
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  notes:      Private header
+//              TAB=4
+//
+//  ---------------------------------------------------------------------------
+
+
+#if !defined ANT_TW_SOFTWARE_INCLUDED
+#define ANT_TW_SOFTWARE_INCLUDED
+
+#include "TwGraph.h"
+#include "TwGlyphs.h"
+
+//  ---------------------------------------------------------------------------
+
+class CTwGraphSoftware : public ITwGraph
+{
+public:
+    virtual int         Init();
+    virtual int         Shut();
+    virtual void        BeginDraw(int _WndWidth, int _WndHeight);
+    virtual void        EndDraw();
+    virtual bool        IsDrawing();
+    virtual void        Restore();
+    virtual void        DrawLine(int _X0, int _Y0, int _X1, int _Y1, color32 _Color0, color32 _Color1, bool _AntiAliased=false);
+    virtual void        DrawLine(int _X0, int _Y0, int _X1, int _Y1, color32 _Color, bool _AntiAliased=false) { DrawLine(_X0, _Y0, _X1, _Y1, _Color, _Color, _AntiAliased); }
+    virtual void        DrawRect(int _X0, int _Y0, int _X1, int _Y1, color32 _Color00, color32 _Color10, color32 _Color01, color32 _Color11);
+    virtual void        DrawRect(int _X0, int _Y0, int _X1, int _Y1, color32 _Color) { DrawRect(_X0, _Y0, _X1, _Y1, _Color, _Color, _Color, _Color); }
+    virtual void        DrawTriangles(int _NumTriangles, int *_Vertices, color32 *_Colors, Cull _CullMode);
+
+    virtual void *      NewTextObj();
+    virtual void        DeleteTextObj(void *_TextObj);
+    virtual void        BuildText(void *_TextObj, const std::string *_TextLines, color32 *_LineColors, color32 *_LineBgColors, int _NbLines, const CTexFont *_Font, int _Sep, int _BgWidth);
+    virtual void        DrawText(void *_TextObj, int _X, int _Y, color32 _Color, color32 _BgColor);
+    virtual bool        UpdateTextLine(void *_TextObj, int _Line, const std::string& _TextLine, color32 _LineColor, color32 _LineBgColor, const CTexFont *_Font, int _Sep);
+
+    virtual void        ChangeViewport(int _X0, int _Y0, int _Width, int _Height, int _OffsetX, int _OffsetY);
+    virtual void        RestoreViewport();
+
+    virtual int         GetDrawCallCount() { return m_NbDrawCalls; }
+
+protected:
+    bool                m_Drawing;
+    unsigned char *     m_Pixels;       // target buffer given by TwSoftwareBuffer (RGBA, top row first)
+    int                 m_Pitch;
+    int                 m_Width;        // drawable size: intersection of the window and the buffer
+    int                 m_Height;
+    int                 m_ClipX0, m_ClipY0, m_ClipX1, m_ClipY1; // current viewport, max excluded
+    int                 m_OffsetX;
+    int                 m_OffsetY;
+    int                 m_NbDrawCalls;  // number of primitives rasterized
+
+    struct CGlyph       { int m_X0, m_Y0, m_X1, m_Y1; int m_TexX, m_TexY; color32 m_Color; };
+    struct CBgRect      { int m_X0, m_Y0, m_X1, m_Y1; color32 m_Color; };
+    struct CTextObj
+    {
+        std::vector<CGlyph> m_Glyphs;
+        std::vector<CBgRect> m_BgRects;
+        std::vector<int> m_LineFirst;   // first glyph of each line, followed by the total count
+        const CTexFont *m_Font;
+        bool            m_LineColors;
+        bool            m_LineBgColors;
+    };
+    std::vector<CGlyph> m_TextLineGlyphs;   // scratch glyphs used by UpdateTextLine
+    std::vector<CGlyphQuad> m_LineQuads;    // scratch quads used by AppendTextLine
+    void                AppendTextLine(std::vector<CGlyph>& _Glyphs, const std::string& _TextLine, color32 _LineColor, int _Y, const CTexFont *_Font);
+
+    void                FillRect(int _X0, int _Y0, int _X1, int _Y1, color32 _Color);
+    void                BlendPixel(int _X, int _Y, const float *_Color, float _Coverage);
+};
+
+//  ---------------------------------------------------------------------------
+
+
+#endif // !defined ANT_TW_SOFTWARE_INCLUDED
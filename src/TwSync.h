@@ -0,0 +1,182 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwSync.h
+//  @brief      Lock-free event queue and var value mailboxes used to pass
+//              input and values from other threads to the render thread
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  notes:      Private header
+//              TAB=4
+//
+//  ---------------------------------------------------------------------------
+
+
+#if !defined ANT_TW_SYNC_INCLUDED
+#define ANT_TW_SYNC_INCLUDED
+
+//  ---------------------------------------------------------------------------
+//  Atomic operations and thread identification
+//  ---------------------------------------------------------------------------
+
+#if defined(ANT_WINDOWS)
+
+typedef DWORD CTwThreadID;
+
+inline CTwThreadID TwCurrentThread()                        { return GetCurrentThreadId(); }
+inline bool TwSameThread(CTwThreadID _A, CTwThreadID _B)    { return _A==_B; }
+
+inline bool TwAtomicCAS(void * volatile *_Dest, void *_Comp, void *_Value)
+{
+    return InterlockedCompareExchangePointer((PVOID volatile *)_Dest, _Value, _Comp)==_Comp;
+}
+
+inline void *TwAtomicExchange(void * volatile *_Dest, void *_Value)
+{
+    return InterlockedExchangePointer((PVOID volatile *)_Dest, _Value);
+}
+
+inline long TwAtomicExchange(volatile long *_Dest, long _Value)
+{
+    return InterlockedExchange(_Dest, _Value);
+}
+
+#else // ANT_UNIX || ANT_OSX
+
+typedef pthread_t CTwThreadID;
+
+inline CTwThreadID TwCurrentThread()                        { return pthread_self(); }
+inline bool TwSameThread(CTwThreadID _A, CTwThreadID _B)    { return pthread_equal(_A, _B)!=0; }
+
+// __sync builtins are full memory barriers (except __sync_lock_test_and_set
+// which is only an acquire barrier, so exchanges are written with CAS)
+inline bool TwAtomicCAS(void * volatile *_Dest, void *_Comp, void *_Value)
+{
+    return __sync_bool_compare_and_swap(_Dest, _Comp, _Value);
+}
+
+inline void *TwAtomicExchange(void * volatile *_Dest, void *_Value)
+{
+    void *Prev;
+    do
+        Prev = *_Dest;
+    while( !__sync_bool_compare_and_swap(_Dest, Prev, _Value) );
+    return Prev;
+}
+
+inline long TwAtomicExchange(volatile long *_Dest, long _Value)
+{
+    long Prev;
+    do
+        Prev = *_Dest;
+    while( !__sync_bool_compare_and_swap(_Dest, Prev, _Value) );
+    return Prev;
+}
+
+#endif
+
+//  ---------------------------------------------------------------------------
+//  Multiple producers / single consumer event queue.
+//  Push can be called from any thread and never blocks; PopAll is called by
+//  the render thread and returns the pending events in push order.
+//  ---------------------------------------------------------------------------
+
+struct CTwQueuedEvent
+{
+    enum EType          { MOUSE, KEY, WINDOW_SIZE, NOTIFY_VAR };
+    EType               m_Type;
+    int                 m_Args[5];
+    TwBar *             m_Bar;          // NOTIFY_VAR only
+    std::string         m_VarName;      // NOTIFY_VAR only
+    bool                m_AllVars;      // NOTIFY_VAR only: varName was NULL
+    bool                m_Skip;         // superseded by a later event
+    CTwQueuedEvent *    m_Next;
+                        CTwQueuedEvent(EType _Type) : m_Type(_Type), m_Bar(NULL), m_AllVars(false), m_Skip(false), m_Next(NULL) { for(int i=0; i<5; ++i) m_Args[i] = 0; }
+};
+
+class CTwEventQueue
+{
+public:
+                        CTwEventQueue() : m_Head(NULL) {}
+                        ~CTwEventQueue() { Clear(); }
+    bool                IsEmpty() const { return m_Head==NULL; }
+    void                Push(CTwQueuedEvent *_Event)
+    {
+        void *Head;
+        do
+        {
+            Head = m_Head;
+            _Event->m_Next = static_cast<CTwQueuedEvent *>(Head);
+        }
+        while( !TwAtomicCAS(&m_Head, Head, _Event) );
+    }
+    CTwQueuedEvent *    PopAll()        // the caller deletes the returned events
+    {
+        if( m_Head==NULL )
+            return NULL;
+        CTwQueuedEvent *Ev = static_cast<CTwQueuedEvent *>(TwAtomicExchange(&m_Head, NULL));
+        CTwQueuedEvent *First = NULL;
+        while( Ev!=NULL )   // the stack is in reverse push order
+        {
+            CTwQueuedEvent *Next = Ev->m_Next;
+            Ev->m_Next = First;
+            First = Ev;
+            Ev = Next;
+        }
+        return First;
+    }
+    void                Clear()
+    {
+        CTwQueuedEvent *Ev = PopAll();
+        while( Ev!=NULL )
+        {
+            CTwQueuedEvent *Next = Ev->m_Next;
+            delete Ev;
+            Ev = Next;
+        }
+    }
+private:
+    void * volatile     m_Head;
+                        CTwEventQueue(const CTwEventQueue&);
+    CTwEventQueue&      operator=(const CTwEventQueue&);
+};
+
+//  ---------------------------------------------------------------------------
+//  Var value mailbox.
+//  One writer thread publishes values without waiting, the render thread
+//  fetches the latest published value. The front buffer is read while the
+//  back buffer is written; a spare third buffer lets both sides swap with a
+//  single atomic exchange, so neither side ever waits for the other.
+//  ---------------------------------------------------------------------------
+
+struct CTwMailbox
+{
+    TwBar *             m_Bar;          // NULL once the bar is deleted
+    std::string         m_VarName;
+    size_t              m_Size;
+    std::vector<unsigned char> m_Buffers; // 3 buffers of m_Size bytes
+    volatile long       m_Ready;        // index of the last published buffer | MAILBOX_FRESH
+    int                 m_Back;         // buffer owned by the writer
+    int                 m_Front;        // buffer owned by the reader
+    enum                { MAILBOX_FRESH = 4 };
+
+                        CTwMailbox(TwBar *_Bar, const char *_VarName, size_t _Size) : m_Bar(_Bar), m_VarName(_VarName), m_Size(_Size), m_Buffers(3*_Size), m_Ready(1), m_Back(0), m_Front(2) {}
+    void                Publish(const void *_Value)
+    {
+        memcpy(&m_Buffers[m_Back*m_Size], _Value, m_Size);
+        m_Back = (int)(TwAtomicExchange(&m_Ready, m_Back|MAILBOX_FRESH) & 3);
+    }
+    const void *        Fetch()         // returns NULL if no value has been published since the last call
+    {
+        if( (m_Ready & MAILBOX_FRESH)==0 )
+            return NULL;
+        m_Front = (int)(TwAtomicExchange(&m_Ready, m_Front) & 3);
+        return &m_Buffers[m_Front*m_Size];
+    }
+};
+
+//  ---------------------------------------------------------------------------
+
+
+#endif // !defined ANT_TW_SYNC_INCLUDED
@@ -0,0 +1,428 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwBench.cpp
+//  @brief      Benchmarks of the AntTweakBar library. They use the public
+//              API and draw with the software graph backend, so no window is
+//              needed. The number formatting functions of TwFormat.h are
+//              compared to snprintf directly. Times are printed in ms.
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  ---------------------------------------------------------------------------
+
+
+#include <AntTweakBar.h>
+#include "../src/TwFormat.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <string>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   include <sys/time.h>
+#endif
+
+static const int WND_WIDTH  = 1024;
+static const int WND_HEIGHT = 1024;
+static unsigned char g_Pixels[WND_WIDTH*WND_HEIGHT*4];
+
+// Current time in ms
+static double GetTimeMs()
+{
+#if defined(_WIN32)
+    LARGE_INTEGER Freq, Count;
+    QueryPerformanceFrequency(&Freq);
+    QueryPerformanceCounter(&Count);
+    return 1000.0*(double)Count.QuadPart/(double)Freq.QuadPart;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return 1000.0*(double)tv.tv_sec + 0.001*(double)tv.tv_usec;
+#endif
+}
+
+//  ---------------------------------------------------------------------------
+
+// Registration of n vars in one bar: the time per var should not grow with n
+static void BenchAddVar()
+{
+    static const int NbVars[] = { 2000, 4000, 8000, 16000 };
+    std::vector<float> Vals(16000);
+    char Name[32];
+    printf("  TwAddVarRW: us per var, by number of vars\n   ");
+    for( int n=0; n<(int)(sizeof(NbVars)/sizeof(NbVars[0])); ++n )
+    {
+        TwBar *Bar = TwNewBar("AddVar");
+        double T0 = GetTimeMs();
+        for( int i=0; i<NbVars[n]; ++i )
+        {
+            sprintf(Name, "var%d", i);
+            TwAddVarRW(Bar, Name, TW_TYPE_FLOAT, &Vals[i], "");
+        }
+        double DT = GetTimeMs()-T0;
+        printf(" %d=%.3f", NbVars[n], 1000.0*DT/NbVars[n]);
+        TwDeleteBar(Bar);
+    }
+    printf("\n");
+}
+
+//  ---------------------------------------------------------------------------
+
+// Registration of grouped vars one by one and with TwAddVarsBatch. Adding a
+// var does not rebuild the bar, so both are expected to take the same time:
+// a batch is validated as a whole, it is not a faster path.
+static void BenchAddVarsBatch()
+{
+    const int NbVars = 8000;
+    std::vector<float> Vals(NbVars);
+    std::vector<std::string> Names(NbVars), Defs(NbVars);
+    std::vector<TwVarDesc> Descs(NbVars);
+    char Str[32];
+    for( int i=0; i<NbVars; ++i )
+    {
+        sprintf(Str, "var%d", i);
+        Names[i] = Str;
+        sprintf(Str, "group=G%d min=0", i%64);
+        Defs[i] = Str;
+        TwVarDesc d = { Names[i].c_str(), TW_TYPE_FLOAT, &Vals[i], 0, NULL, NULL, NULL, Defs[i].c_str() };
+        Descs[i] = d;
+    }
+    printf("  %d grouped vars: ms\n   ", NbVars);
+    double DT[2] = { 1.0e9, 1.0e9 };
+    for( int r=0; r<10; ++r )   // best of 10 runs, alternated
+        for( int b=0; b<2; ++b )
+        {
+            TwBar *Bar = TwNewBar("AddVarsBatch");
+            double T0 = GetTimeMs();
+            if( b==0 )
+                for( int i=0; i<NbVars; ++i )
+                    TwAddVarRW(Bar, Descs[i].Name, Descs[i].Type, Descs[i].Var, Descs[i].DefString);
+            else
+                TwAddVarsBatch(Bar, &Descs[0], NbVars);
+            double T1 = GetTimeMs();
+            if( T1-T0<DT[b] )
+                DT[b] = T1-T0;
+            TwDeleteBar(Bar);
+        }
+    printf(" TwAddVarRW=%.2f TwAddVarsBatch=%.2f", DT[0], DT[1]);
+    printf("\n");
+}
+
+//  ---------------------------------------------------------------------------
+
+// Draws _NbFrames frames, calling _Update (if not NULL) before each frame.
+// Returns the time per frame.
+static double DrawFrames(int _NbFrames, void (*_Update)(int _Frame))
+{
+    double T0 = GetTimeMs();
+    for( int f=0; f<_NbFrames; ++f )
+    {
+        if( _Update!=NULL )
+            _Update(f);
+        TwDraw();
+    }
+    return (GetTimeMs()-T0)/_NbFrames;
+}
+
+//  ---------------------------------------------------------------------------
+
+// Formatting of the value of a var of each numeric type, by TwFormat and by
+// snprintf with the format string used before TwFormat
+enum EFormat { FMT_INT, FMT_UINT, FMT_HEX, FMT_FIXED, FMT_GENERAL };
+enum EValues { VAL_INT8, VAL_UINT8, VAL_INT32, VAL_FLOAT, VAL_DOUBLE };
+struct CFormatBench
+{
+    const char *    m_Name;
+    EValues         m_Values;
+    EFormat         m_Format;
+    int             m_Digits;   // hexa digits or precision
+    const char *    m_Printf;
+};
+
+static const int NB_FORMAT_VALUES = 4096;
+static int g_FormatInts[NB_FORMAT_VALUES];
+static double g_FormatReals[NB_FORMAT_VALUES];
+static char g_FormatBuf[TW_FORMAT_BUFFER_SIZE];
+
+// Returns the time per value in ns, and the sum of the text lengths in _Sum
+static double FormatValues(const CFormatBench& _Bench, bool _Printf, int *_Sum)
+{
+    const int NbLoops = 64;
+    char *Buf = g_FormatBuf;
+    int Sum = 0;
+    double T0 = GetTimeMs();
+    for( int l=0; l<NbLoops; ++l )
+        for( int i=0; i<NB_FORMAT_VALUES; ++i )
+        {
+            int Val = g_FormatInts[i];
+            double RealVal = g_FormatReals[i];
+            if( _Printf )
+                switch( _Bench.m_Format )
+                {
+                case FMT_INT:       Sum += sprintf(Buf, _Bench.m_Printf, Val); break;
+                case FMT_UINT:
+                case FMT_HEX:       Sum += sprintf(Buf, _Bench.m_Printf, (unsigned int)Val); break;
+                default:            Sum += sprintf(Buf, _Bench.m_Printf, RealVal); break;
+                }
+            else
+                switch( _Bench.m_Format )
+                {
+                case FMT_INT:       Sum += TwFormatInt(Buf, Val); break;
+                case FMT_UINT:      Sum += TwFormatUInt(Buf, (unsigned int)Val); break;
+                case FMT_HEX:       Sum += TwFormatHex(Buf, (unsigned int)Val, _Bench.m_Digits); break;
+                case FMT_FIXED:     Sum += TwFormatFixed(Buf, RealVal, _Bench.m_Digits); break;
+                default:            Sum += TwFormatGeneral(Buf, RealVal); break;
+                }
+        }
+    *_Sum = Sum;
+    return 1.0e6*(GetTimeMs()-T0)/(NbLoops*NB_FORMAT_VALUES);
+}
+
+static void BenchFormat()
+{
+    static const CFormatBench Benches[] =
+    {
+        { "int8",           VAL_INT8,   FMT_INT,        0,  "%d"        },
+        { "int32",          VAL_INT32,  FMT_INT,        0,  "%d"        },
+        { "uint32",         VAL_INT32,  FMT_UINT,       0,  "%u"        },
+        { "int32 hexa",     VAL_INT32,  FMT_HEX,        8,  "0x%.8X"    },
+        { "uint8 hexa",     VAL_UINT8,  FMT_HEX,        2,  "0x%.2X"    },
+        { "float",          VAL_FLOAT,  FMT_GENERAL,    0,  "%g"        },
+        { "float prec=2",   VAL_FLOAT,  FMT_FIXED,      2,  "%.2f"      },
+        { "double",         VAL_DOUBLE, FMT_GENERAL,    0,  "%g"        },
+        { "double prec=6",  VAL_DOUBLE, FMT_FIXED,      6,  "%.6f"      }
+    };
+    const int NbBenches = (int)(sizeof(Benches)/sizeof(Benches[0]));
+
+    printf("  ns per value: sprintf / TwFormat\n");
+    unsigned int Seed = 1;
+    for( int b=0; b<NbBenches; ++b )
+    {
+        // values of the type, at several magnitudes
+        static const double Pow10[] = { 1e-3, 1e-2, 0.1, 1, 10, 100, 1e3, 1e4, 1e5 };
+        for( int i=0; i<NB_FORMAT_VALUES; ++i )
+        {
+            Seed = Seed*1103515245 + 12345;
+            double Val = ((double)(Seed>>8)/(double)(1<<24) - 0.5) * Pow10[i%9];
+            switch( Benches[b].m_Values )
+            {
+            case VAL_INT8:      g_FormatInts[i] = (signed char)(Seed>>16); break;
+            case VAL_UINT8:     g_FormatInts[i] = (Seed>>16)&0xff; break;
+            case VAL_INT32:     g_FormatInts[i] = (int)(Seed^(Seed<<16))>>(i%24); break;
+            case VAL_FLOAT:     g_FormatReals[i] = (float)Val; break;
+            default:            g_FormatReals[i] = Val; break;
+            }
+        }
+        int SumPrintf, SumFormat;
+        double DTPrintf = FormatValues(Benches[b], true, &SumPrintf);
+        double DTFormat = FormatValues(Benches[b], false, &SumFormat);
+        printf("    %-14s %6.1f / %5.1f%s\n", Benches[b].m_Name, DTPrintf, DTFormat, (SumPrintf!=SumFormat) ? "  (different texts)" : "");
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+const int NB_VALUE_BARS = 4;
+const int NB_VALUES = 64;   // per bar, all visible
+static TwBar *g_ValueBars[NB_VALUE_BARS];
+static double g_Doubles[NB_VALUE_BARS][NB_VALUES];
+static float g_Floats[NB_VALUE_BARS][NB_VALUES];
+static int g_Ints[NB_VALUE_BARS][NB_VALUES];
+
+static void RefreshValues(int)
+{
+    for( int b=0; b<NB_VALUE_BARS; ++b )
+        TwRefreshBar(g_ValueBars[b]);
+}
+
+static void ChangeValues(int _Frame)
+{
+    for( int b=0; b<NB_VALUE_BARS; ++b )
+    {
+        for( int i=0; i<NB_VALUES; ++i )
+        {
+            g_Doubles[b][i] += 0.001*(i+1);
+            g_Floats[b][i] -= 0.37f;
+            g_Ints[b][i] += _Frame*(i+1);
+        }
+        TwRefreshBar(g_ValueBars[b]);
+    }
+}
+
+// Bars of numeric vars of several types and formats, refreshed every frame
+// while their values are constant or changing: values are formatted again
+// only when they change
+static void BenchValues()
+{
+    const int NbFrames = 200;
+    static const char *Defs[] = { "", "precision=2", "", "precision=6" };
+    char Name[32], Def[64];
+    for( int b=0; b<NB_VALUE_BARS; ++b )
+    {
+        sprintf(Name, "Values%d", b);
+        g_ValueBars[b] = TwNewBar(Name);
+        sprintf(Def, " Values%d position='%d 16' size='240 992' ", b, 16+250*b);
+        TwDefine(Def);
+        for( int i=0; i<NB_VALUES; ++i )
+        {
+            g_Doubles[b][i] = 1.0e-3*(i+1)*(b+1);
+            g_Floats[b][i] = 12.5f*(i-b);
+            g_Ints[b][i] = 1000*i;
+            sprintf(Name, "v%d", i);
+            switch( i%4 )
+            {
+            case 0:     TwAddVarRW(g_ValueBars[b], Name, TW_TYPE_DOUBLE, &g_Doubles[b][i], Defs[b]); break;
+            case 1:     TwAddVarRW(g_ValueBars[b], Name, TW_TYPE_FLOAT, &g_Floats[b][i], Defs[b]); break;
+            case 2:     TwAddVarRW(g_ValueBars[b], Name, TW_TYPE_INT32, &g_Ints[b][i], (b==2) ? "hexa=true" : ""); break;
+            default:    TwAddVarRW(g_ValueBars[b], Name, TW_TYPE_UINT8, &g_Ints[b][i], (b==2) ? "hexa=true" : ""); break;
+            }
+        }
+    }
+    TwDraw();
+    printf("  %d values: ms per frame\n   ", NB_VALUE_BARS*NB_VALUES);
+    printf(" constant=%.3f", DrawFrames(NbFrames, RefreshValues));
+    printf(" changing=%.3f", DrawFrames(NbFrames, ChangeValues));
+    printf("\n");
+    for( int b=0; b<NB_VALUE_BARS; ++b )
+        TwDeleteBar(g_ValueBars[b]);
+}
+
+//  ---------------------------------------------------------------------------
+
+const int NB_TEXT_BARS = 3;
+const int NB_TEXTS = 64;    // per bar, all visible
+static TwBar *g_TextBars[NB_TEXT_BARS];
+static char g_Texts[NB_TEXT_BARS][NB_TEXTS][64];
+
+static void ChangeTexts(int _Frame)
+{
+    for( int b=0; b<NB_TEXT_BARS; ++b )
+    {
+        for( int i=0; i<NB_TEXTS; ++i )
+            sprintf(g_Texts[b][i], "Frame %d, text %d of bar %d", _Frame, i, b);
+        TwRefreshBar(g_TextBars[b]);
+    }
+}
+
+// Bars of long labels and string values, the values change every frame: the
+// text of the labels is built once, the text of the values every frame
+static void BenchText()
+{
+    const int NbFrames = 200;
+    char Name[32], Def[128];
+    for( int b=0; b<NB_TEXT_BARS; ++b )
+    {
+        sprintf(Name, "Text%d", b);
+        g_TextBars[b] = TwNewBar(Name);
+        sprintf(Def, " Text%d position='%d 16' size='330 992' valueswidth=180 ", b, 16+336*b);
+        TwDefine(Def);
+        for( int i=0; i<NB_TEXTS; ++i )
+        {
+            sprintf(Name, "t%d", i);
+            sprintf(Def, " label='Label of the text var number %d' ", i);
+            TwAddVarRW(g_TextBars[b], Name, TW_TYPE_CSSTRING(sizeof(g_Texts[b][i])), g_Texts[b][i], Def);
+        }
+    }
+    ChangeTexts(0);
+    TwDraw();
+    printf("  %d labels and string values: ms per frame\n   ", NB_TEXT_BARS*NB_TEXTS);
+    printf(" changing=%.3f", DrawFrames(NbFrames, ChangeTexts));
+    printf("\n");
+    for( int b=0; b<NB_TEXT_BARS; ++b )
+        TwDeleteBar(g_TextBars[b]);
+}
+
+//  ---------------------------------------------------------------------------
+
+const int NB_BENCH_QUATS = 6;
+const int NB_BENCH_DIRS = 2;
+static float g_Quats[NB_BENCH_QUATS][4];
+static float g_Dirs[NB_BENCH_DIRS][3];
+static TwBar *g_RotationBar;
+
+// Quaternion of angle 2*_HalfAngle around (1, 2, 3)
+static void SetQuat(float *_Quat, float _HalfAngle)
+{
+    float s = (float)sin(_HalfAngle)/(float)sqrt(14.0);
+    _Quat[0] = s; _Quat[1] = 2*s; _Quat[2] = 3*s; _Quat[3] = (float)cos(_HalfAngle);
+}
+
+static void RefreshRotations(int)
+{
+    TwRefreshBar(g_RotationBar);
+}
+
+static void RotateQuats(int _Frame)
+{
+    for( int i=0; i<NB_BENCH_QUATS; ++i )
+        SetQuat(g_Quats[i], 0.5f*(float)(i+1) + 0.01f*(float)(_Frame+1));
+    TwRefreshBar(g_RotationBar);
+}
+
+// A bar of opened rotation widgets refreshed every frame, with static and
+// rotating orientations
+static void BenchRotationWidgets()
+{
+    const int NbFrames = 200;
+    TwBar *Bar = TwNewBar("Rotations");
+    g_RotationBar = Bar;
+    TwDefine(" Rotations position='16 16' size='240 1000' ");
+    char Name[32];
+    for( int i=0; i<NB_BENCH_QUATS; ++i )
+    {
+        SetQuat(g_Quats[i], 0.5f*(float)(i+1));
+        sprintf(Name, "quat%d", i);
+        TwAddVarRW(Bar, Name, TW_TYPE_QUAT4F, g_Quats[i], "opened=true");
+    }
+    for( int i=0; i<NB_BENCH_DIRS; ++i )
+    {
+        g_Dirs[i][0] = 1; g_Dirs[i][1] = (float)i; g_Dirs[i][2] = -0.5f;
+        sprintf(Name, "dir%d", i);
+        TwAddVarRW(Bar, Name, TW_TYPE_DIR3F, g_Dirs[i], "opened=true");
+    }
+    TwDraw();
+    double DrawCalls = 0;
+    printf("  %d rotation widgets: ms per frame\n   ", NB_BENCH_QUATS+NB_BENCH_DIRS);
+    printf(" static=%.3f", DrawFrames(NbFrames, RefreshRotations));
+    printf(" rotating=%.3f", DrawFrames(NbFrames, RotateQuats));
+    TwGetParam(NULL, NULL, "drawcalls", TW_PARAM_DOUBLE, 1, &DrawCalls);
+    printf(" drawcalls=%d\n", (int)DrawCalls);
+    TwDeleteBar(Bar);
+}
+
+//  ---------------------------------------------------------------------------
+
+int main()
+{
+    struct CBench { const char *m_Name; void (*m_Func)(); };
+    static const CBench Benches[] =
+    {
+        { "var registration",   BenchAddVar },
+        { "var batch",          BenchAddVarsBatch },
+        { "format",             BenchFormat },
+        { "values",             BenchValues },
+        { "text",               BenchText },
+        { "rotation widgets",   BenchRotationWidgets }
+    };
+    const int NbBenches = (int)(sizeof(Benches)/sizeof(Benches[0]));
+
+    for( int b=0; b<NbBenches; ++b )
+    {
+        printf("%s\n", Benches[b].m_Name);
+        TwSoftwareBuffer Buffer = { g_Pixels, WND_WIDTH, WND_HEIGHT, 0 };
+        if( !TwInit(TW_SOFTWARE, &Buffer) )
+        {
+            printf("  TwInit failed: %s\n", TwGetLastError());
+            return 1;
+        }
+        TwWindowSize(WND_WIDTH, WND_HEIGHT);
+        Benches[b].m_Func();
+        TwTerminate();
+    }
+    return 0;
+}
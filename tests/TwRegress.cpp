@@ -0,0 +1,1286 @@
+//  ---------------------------------------------------------------------------
+//
+//  @file       TwRegress.cpp
+//  @brief      Regression checks of the AntTweakBar library. They use the
+//              public API and draw with the software graph backend, so no
+//              window is needed. The number formatting functions of
+//              TwFormat.h, exported by the library but not part of the API,
+//              are checked directly. The program returns 1 if a check fails.
+//  @author     Philippe Decaudin - http://www.antisphere.com
+//  @license    This file is part of the AntTweakBar library.
+//              For conditions of distribution and use, see License.txt
+//
+//  ---------------------------------------------------------------------------
+
+
+#include <AntTweakBar.h>
+#include "../src/TwFormat.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   include <pthread.h>
+#endif
+
+static const int WND_WIDTH  = 640;
+static const int WND_HEIGHT = 480;
+static unsigned char g_Pixels[WND_WIDTH*WND_HEIGHT*4];
+
+static int g_NbChecks = 0;
+static int g_NbFailed = 0;
+
+#define CHECK(_Cond)    Check((_Cond)!=0, #_Cond, __LINE__)
+
+static void Check(bool _Ok, const char *_Expr, int _Line)
+{
+    ++g_NbChecks;
+    if( !_Ok )
+    {
+        ++g_NbFailed;
+        printf("  FAILED line %d: %s\n", _Line, _Expr);
+    }
+}
+
+// Errors are expected by some checks: they are tested through return values
+static void TW_CALL IgnoreError(const char *_ErrorMessage)
+{
+    (void)_ErrorMessage;
+}
+
+// Returns true if a var named _Name exists in _Bar
+static bool VarExists(TwBar *_Bar, const char *_Name)
+{
+    char Label[256];
+    return TwGetParam(_Bar, _Name, "label", TW_PARAM_CSTRING, sizeof(Label), Label)!=0;
+}
+
+// FNV-1a hash of the software buffer
+static unsigned int PixelsChecksum()
+{
+    unsigned int h = 2166136261u;
+    for( int i=0; i<(int)sizeof(g_Pixels); ++i )
+        h = (h ^ g_Pixels[i]) * 16777619u;
+    return h;
+}
+
+// Pseudo-random sequence, the same on all platforms
+static unsigned int g_Seed = 1;
+static unsigned int Random()
+{
+    g_Seed = g_Seed*1103515245 + 12345;
+    return g_Seed>>8;
+}
+
+//  ---------------------------------------------------------------------------
+
+// Vars are found by name after being added, moved into groups and removed
+static void CheckVarNames()
+{
+    static float Vals[64];
+    TwBar *Bar = TwNewBar("Names");
+    char Name[32], Def[64];
+    for( int i=0; i<64; ++i )
+    {
+        sprintf(Name, "v%d", i);
+        CHECK( TwAddVarRW(Bar, Name, TW_TYPE_FLOAT, &Vals[i], "")!=0 );
+    }
+    CHECK( TwAddVarRW(Bar, "v10", TW_TYPE_FLOAT, &Vals[0], "")==0 );  // duplicate name
+    for( int i=0; i<64; i+=2 )
+    {
+        sprintf(Def, " Names/v%d group=G%d ", i, i%3);
+        CHECK( TwDefine(Def)!=0 );
+    }
+    CHECK( TwDefine(" Names/G1 group=G0 ")!=0 );  // nested group
+    for( int i=0; i<64; ++i )
+    {
+        sprintf(Name, "v%d", i);
+        CHECK( VarExists(Bar, Name) );
+    }
+    CHECK( VarExists(Bar, "G0") && VarExists(Bar, "G1") && VarExists(Bar, "G2") );
+    CHECK( TwRemoveVar(Bar, "v4")!=0 );
+    CHECK( !VarExists(Bar, "v4") );
+    CHECK( TwRemoveVar(Bar, "G2")!=0 );         // removes its vars too
+    CHECK( !VarExists(Bar, "v2") && VarExists(Bar, "v3") );
+    CHECK( TwAddVarRW(Bar, "v4", TW_TYPE_FLOAT, &Vals[4], "")!=0 );
+    CHECK( VarExists(Bar, "v4") );
+    CHECK( TwRemoveAllVars(Bar)!=0 );
+    CHECK( !VarExists(Bar, "v5") );
+    CHECK( TwAddVarRW(Bar, "v5", TW_TYPE_FLOAT, &Vals[5], "")!=0 );
+    CHECK( VarExists(Bar, "v5") );
+    CHECK( TwDraw()!=0 );
+}
+
+//  ---------------------------------------------------------------------------
+
+struct CPoint { float x, y; };
+static float g_CBVal = 0;
+static void TW_CALL SetCBVal(const void *_Value, void *) { g_CBVal = *(const float *)_Value; }
+static void TW_CALL GetCBVal(void *_Value, void *) { *(float *)_Value = g_CBVal; }
+static CPoint g_CBPt = { 3, 4 };
+static void TW_CALL SetCBPt(const void *_Value, void *) { g_CBPt = *(const CPoint *)_Value; }
+static void TW_CALL GetCBPt(void *_Value, void *) { *(CPoint *)_Value = g_CBPt; }
+static int g_NbBatchClicks = 0;
+static void TW_CALL BatchClick(void *) { ++g_NbBatchClicks; }
+
+// Fill _Bar with the vars of _Descs, one by one or with TwAddVarsBatch
+static int AddVars(TwBar *_Bar, const TwVarDesc *_Descs, int _NbDescs, bool _Batch)
+{
+    if( _Batch )
+        return TwAddVarsBatch(_Bar, _Descs, _NbDescs);
+    int Res = 1;
+    for( int i=0; i<_NbDescs; ++i )
+    {
+        const TwVarDesc& d = _Descs[i];
+        if( d.ButtonCallback!=NULL )
+            Res &= TwAddButton(_Bar, d.Name, d.ButtonCallback, d.ClientData, d.DefString);
+        else if( d.Var!=NULL && d.ReadOnly )
+            Res &= TwAddVarRO(_Bar, d.Name, d.Type, d.Var, d.DefString);
+        else if( d.Var!=NULL )
+            Res &= TwAddVarRW(_Bar, d.Name, d.Type, d.Var, d.DefString);
+        else
+            Res &= TwAddVarCB(_Bar, d.Name, d.Type, d.SetCallback, d.GetCallback, d.ClientData, d.DefString);
+    }
+    return Res;
+}
+
+// A batch is validated before anything is added, and gives the same bar as
+// the equivalent TwAddVar* calls
+static void CheckAddVarsBatch()
+{
+    static float F[4];
+    static CPoint Pt = { 1, 2 };
+    static float Col[3] = { 1, 0.5f, 0 };
+    static float Quat[4] = { 0, 0, 0, 1 };
+    TwStructMember PointMembers[] = { { "x", TW_TYPE_FLOAT, offsetof(CPoint, x), "step=0.1" }, { "y", TW_TYPE_FLOAT, offsetof(CPoint, y), "" } };
+    TwType PointType = TwDefineStruct("Point", PointMembers, 2, sizeof(CPoint), NULL, NULL);
+    CHECK( PointType!=TW_TYPE_UNDEF );
+
+    const TwVarDesc Descs[] =
+    {
+        { "f0",     TW_TYPE_FLOAT,      &F[0],  0, NULL,     NULL,     NULL, "group=G min=0" },
+        { "f1",     TW_TYPE_FLOAT,      &F[1],  1, NULL,     NULL,     NULL, "group=G label='F 1'" },
+        { "pt",     PointType,          &Pt,    0, NULL,     NULL,     NULL, "group=H opened=true" },
+        { "col",    TW_TYPE_COLOR3F,    Col,    0, NULL,     NULL,     NULL, "opened=true" },
+        { "cb",     TW_TYPE_FLOAT,      NULL,   0, SetCBVal, GetCBVal, NULL, "" },
+        { "quat",   TW_TYPE_QUAT4F,     Quat,   0, NULL,     NULL,     NULL, "opened=true" },
+        { "f2",     TW_TYPE_FLOAT,      &F[2],  0, NULL,     NULL,     NULL, "group=H" },
+        { "btn",    TW_TYPE_UNDEF,      NULL,   0, NULL,     NULL,     NULL, "group=G key=z", BatchClick }
+    };
+    const int NbDescs = (int)(sizeof(Descs)/sizeof(Descs[0]));
+
+    // draw the bar filled one var at a time, then with a batch
+    static unsigned char Ref[WND_WIDTH*WND_HEIGHT*4];
+    for( int b=0; b<2; ++b )
+    {
+        TwBar *Bar = TwNewBar("Batch");
+        TwDefine(" Batch position='16 16' size='300 400' color='64 96 128' ");
+        CHECK( AddVars(Bar, Descs, NbDescs, b==1)!=0 );
+        CHECK( VarExists(Bar, "pt.x") && VarExists(Bar, "col.Red") && VarExists(Bar, "G") );
+        memset(g_Pixels, 0, sizeof(g_Pixels));
+        CHECK( TwDraw()!=0 );
+        if( b==0 )
+            memcpy(Ref, g_Pixels, sizeof(Ref));
+        else
+            CHECK( memcmp(Ref, g_Pixels, sizeof(Ref))==0 );
+        CHECK( TwKeyPressed('z', TW_KMOD_NONE)!=0 && g_NbBatchClicks==b+1 );
+        TwDeleteBar(Bar);
+    }
+
+    // invalid batches leave the bar unchanged
+    TwBar *Bar = TwNewBar("Batch");
+    CHECK( TwAddVarRW(Bar, "pt.y", TW_TYPE_FLOAT, &F[3], "")!=0 );
+    const TwVarDesc MemberClash[] =
+    {
+        { "a",      TW_TYPE_FLOAT,      &F[0],  0, NULL,     NULL,     NULL, "" },
+        { "pt",     PointType,          &Pt,    0, NULL,     NULL,     NULL, "" }
+    };
+    CHECK( TwAddVarsBatch(Bar, MemberClash, 2)==0 );
+    CHECK( !VarExists(Bar, "a") && !VarExists(Bar, "pt.x") );
+    const TwVarDesc Duplicate[] =
+    {
+        { "a",      TW_TYPE_FLOAT,      &F[0],  0, NULL,     NULL,     NULL, "" },
+        { "b",      TW_TYPE_COLOR3F,    Col,    0, NULL,     NULL,     NULL, "" },
+        { "b.Red",  TW_TYPE_FLOAT,      &F[1],  0, NULL,     NULL,     NULL, "" }
+    };
+    CHECK( TwAddVarsBatch(Bar, Duplicate, 3)==0 );
+    CHECK( !VarExists(Bar, "a") && !VarExists(Bar, "b") );
+    const TwVarDesc SameName[] =
+    {
+        { "b",      TW_TYPE_FLOAT,      &F[0],  0, NULL,     NULL,     NULL, "" },
+        { "a",      TW_TYPE_FLOAT,      &F[1],  0, NULL,     NULL,     NULL, "" },
+        { "b",      TW_TYPE_FLOAT,      &F[2],  0, NULL,     NULL,     NULL, "" }
+    };
+    CHECK( TwAddVarsBatch(Bar, SameName, 3)==0 );
+    CHECK( !VarExists(Bar, "a") && !VarExists(Bar, "b") );
+    const TwVarDesc BadType[] =
+    {
+        { "a",      TW_TYPE_FLOAT,      &F[0],  0, NULL,     NULL,     NULL, "" },
+        { "c",      (TwType)0x2000ffff, &F[1],  0, NULL,     NULL,     NULL, "" }
+    };
+    CHECK( TwAddVarsBatch(Bar, BadType, 2)==0 );
+    CHECK( !VarExists(Bar, "a") );
+
+    // a member name is only checked when the member is added: what has been
+    // added before, struct members and groups included, is removed
+    TwStructMember BadMembers[] = { { "x", TW_TYPE_FLOAT, offsetof(CPoint, x), "" }, { "y`", TW_TYPE_FLOAT, offsetof(CPoint, y), "" } };
+    TwType BadPointType = TwDefineStruct("BadPoint", BadMembers, 2, sizeof(CPoint), NULL, NULL);
+    const TwVarDesc Rollback[] =
+    {
+        { "r0",     TW_TYPE_FLOAT,      &F[0],  0, NULL,     NULL,     NULL, "group=R" },
+        { "r1",     PointType,          NULL,   0, SetCBPt,  GetCBPt,  NULL, "group=R" },
+        { "r2",     BadPointType,       &Pt,    0, NULL,     NULL,     NULL, "" }
+    };
+    CHECK( BadPointType!=TW_TYPE_UNDEF );
+    CHECK( TwAddVarsBatch(Bar, Rollback, 3)==0 );
+    CHECK( !VarExists(Bar, "r0") && !VarExists(Bar, "R") && !VarExists(Bar, "r1") && !VarExists(Bar, "r1.x") && !VarExists(Bar, "r2.x") );
+    CHECK( VarExists(Bar, "pt.y") );
+    CHECK( TwAddVarsBatch(Bar, Rollback, 2)!=0 );
+    CHECK( VarExists(Bar, "R") && VarExists(Bar, "r1.y") );
+    CHECK( TwDraw()!=0 );
+    CHECK( TwRemoveVar(Bar, "R")!=0 );
+
+    // a def error does not remove the vars
+    const TwVarDesc BadDef[] =
+    {
+        { "a",      TW_TYPE_FLOAT,      &F[0],  0, NULL,     NULL,     NULL, "nosuchattrib=1" },
+        { "b",      TW_TYPE_FLOAT,      &F[1],  0, NULL,     NULL,     NULL, "group=G" }
+    };
+    CHECK( TwAddVarsBatch(Bar, BadDef, 2)==0 );
+    CHECK( VarExists(Bar, "a") && VarExists(Bar, "b") && VarExists(Bar, "G") );
+    CHECK( TwDraw()!=0 );
+}
+
+//  ---------------------------------------------------------------------------
+
+static int g_NbClicks = 0;
+static void TW_CALL Click(void *) { ++g_NbClicks; }
+
+// Draw until TwNeedsRedraw returns 0, for at most _MaxMs. Returns the number
+// of draws, or -1 if a redraw is still needed.
+static int DrawUntilStable(double _MaxMs)
+{
+    clock_t T0 = clock();
+    int NbDraws = 0;
+    while( TwNeedsRedraw() )
+    {
+        if( 1000.0*(clock()-T0)/CLOCKS_PER_SEC>_MaxMs )
+            return -1;
+        TwDraw();
+        ++NbDraws;
+    }
+    return NbDraws;
+}
+
+// With the default configuration (help bar iconified), nothing needs to be
+// redrawn once the bars have been drawn
+static void CheckNeedsRedraw()
+{
+    static float F = 0;
+    TwBar *Bar = TwNewBar("Redraw");
+    CHECK( TwAddVarRW(Bar, "f", TW_TYPE_FLOAT, &F, "key=f")!=0 );
+    CHECK( TwAddButton(Bar, "b", Click, NULL, "key=b")!=0 );
+    CHECK( TwNeedsRedraw()!=0 );
+    CHECK( TwDraw()!=0 );
+    CHECK( TwNeedsRedraw()==0 );
+    CHECK( TwDraw()!=0 );
+    CHECK( TwNeedsRedraw()==0 );
+
+    CHECK( TwKeyPressed('f', TW_KMOD_NONE)!=0 );    // shortcut of a var
+    CHECK( F==1 && TwNeedsRedraw()!=0 );
+    CHECK( DrawUntilStable(1000)>0 );
+
+    // the button is drawn highlighted for a while after its shortcut
+    CHECK( TwKeyPressed('b', TW_KMOD_NONE)!=0 );
+    CHECK( g_NbClicks==1 && TwNeedsRedraw()!=0 );
+    CHECK( DrawUntilStable(1000)>0 );
+    CHECK( TwNeedsRedraw()==0 );
+
+    // same with the help bar opened, once its content has been updated (at
+    // most every 2 seconds) and the key pressed text has been shown (1 second)
+    CHECK( TwDefine(" TW_HELP iconified=false ")!=0 );
+    CHECK( DrawUntilStable(3000)>0 );
+    CHECK( TwDefine(" TW_HELP iconified=true ")!=0 );
+    CHECK( DrawUntilStable(1000)>0 );
+}
+
+//  ---------------------------------------------------------------------------
+
+// Click on the enum var "e" of _Bar (first line) to open its popup list.
+// Returns true if the popup has been opened.
+static bool OpenPopup(int _PosX, int _PosY, int _Width)
+{
+    int NbBars = TwGetBarCount();
+    for( int y=_PosY; y<_PosY+64; y+=2 )
+    {
+        TwMouseMotion(_PosX+_Width-32, y);
+        TwMouseButton(TW_MOUSE_PRESSED, TW_MOUSE_LEFT);
+        TwMouseButton(TW_MOUSE_RELEASED, TW_MOUSE_LEFT);
+        TwDraw();
+        if( TwGetBarCount()>NbBars )
+            return true;
+    }
+    return false;
+}
+
+// Typing in an enum popup list filters its entries, but var shortcuts still
+// work until the filter is typed
+static void CheckPopupKeys()
+{
+    static int E = 0;
+    static int K = 0;
+    TwEnumVal Fruits[] = { {0, "Apple"}, {1, "Pear"}, {2, "Plum"}, {3, "Kiwi"} };
+    TwType FruitType = TwDefineEnum("Fruit", Fruits, 4);
+    TwBar *Bar = TwNewBar("Popup");
+    CHECK( TwAddVarRW(Bar, "e", FruitType, &E, "")!=0 );
+    CHECK( TwAddVarRW(Bar, "k", TW_TYPE_INT32, &K, "key=k")!=0 );
+    TwDefine(" Popup position='320 16' size='300 200' ");
+    CHECK( TwDraw()!=0 );
+    int NbBars = TwGetBarCount();
+
+    // a shortcut closes the popup
+    CHECK( OpenPopup(320, 16, 300) );
+    CHECK( TwKeyPressed('k', TW_KMOD_NONE)!=0 );
+    CHECK( K==1 && TwGetBarCount()==NbBars );
+
+    // other keys filter the popup, shortcuts included once a filter is typed
+    CHECK( OpenPopup(320, 16, 300) );
+    CHECK( TwKeyPressed('p', TW_KMOD_NONE)!=0 );
+    CHECK( TwKeyPressed('k', TW_KMOD_NONE)!=0 );
+    CHECK( K==1 && TwGetBarCount()==NbBars+1 );
+    CHECK( TwKeyPressed(TW_KEY_BACKSPACE, TW_KMOD_NONE)!=0 );
+    CHECK( TwKeyPressed(TW_KEY_ESCAPE, TW_KMOD_NONE)!=0 );
+    CHECK( K==1 && TwGetBarCount()==NbBars+1 );
+    CHECK( TwKeyPressed('k', TW_KMOD_NONE)!=0 );
+    CHECK( K==2 && TwGetBarCount()==NbBars );
+    CHECK( E==0 );
+
+    TwDeleteBar(Bar);
+}
+
+//  ---------------------------------------------------------------------------
+
+struct CBigStruct { float m[16]; };
+static CBigStruct g_Big;
+static int g_NbBigGets = 0, g_NbBigSets = 0;
+static void TW_CALL SetBig(const void *_Value, void *) { g_Big = *(const CBigStruct *)_Value; ++g_NbBigSets; }
+static void TW_CALL GetBig(void *_Value, void *) { *(CBigStruct *)_Value = g_Big; ++g_NbBigGets; }
+static float g_CBCol[3] = { 1, 0.5f, 0.25f };
+static int g_NbColGets = 0;
+static void TW_CALL SetCol(const void *_Value, void *) { memcpy(g_CBCol, _Value, sizeof(g_CBCol)); }
+static void TW_CALL GetCol(void *_Value, void *) { memcpy(_Value, g_CBCol, sizeof(g_CBCol)); ++g_NbColGets; }
+
+// The get callback of a struct var is called once per bar refresh, however
+// many members are displayed, and a member edit calls the set callback
+static void CheckStructGets()
+{
+    TwStructMember Members[16];
+    char Names[16][8];
+    for( int i=0; i<16; ++i )
+    {
+        sprintf(Names[i], "m%d", i);
+        Members[i].Name = Names[i];
+        Members[i].Type = TW_TYPE_FLOAT;
+        Members[i].Offset = i*sizeof(float);
+        Members[i].DefString = "";
+        g_Big.m[i] = (float)i;
+    }
+    TwType BigType = TwDefineStruct("Big", Members, 16, sizeof(CBigStruct), NULL, NULL);
+    CHECK( BigType!=TW_TYPE_UNDEF );
+    TwBar *Bar = TwNewBar("Structs");
+    TwDefine(" Structs position='16 16' size='240 460' refresh=1000 ");
+    CHECK( TwAddVarCB(Bar, "big", BigType, SetBig, GetBig, NULL, "opened=true")!=0 );
+    CHECK( TwAddVarCB(Bar, "col", TW_TYPE_COLOR3F, SetCol, GetCol, NULL, "opened=true")!=0 );
+    CHECK( TwDefine(" Structs/big.m3 keyincr=a ")!=0 );
+    CHECK( TwDraw()!=0 );
+    for( int i=0; i<4; ++i )
+    {
+        g_NbBigGets = g_NbColGets = 0;
+        CHECK( TwRefreshBar(Bar)!=0 );
+        CHECK( TwDraw()!=0 );
+        CHECK( g_NbBigGets==1 && g_NbColGets==1 );
+    }
+
+    // outside a refresh, the struct is read again before a member is changed
+    g_Big.m[3] = 10;
+    g_NbBigSets = 0;
+    CHECK( TwKeyPressed('a', TW_KMOD_NONE)!=0 );
+    CHECK( g_NbBigSets==1 && g_Big.m[3]==11 && g_Big.m[15]==15 );
+    TwDeleteBar(Bar);
+}
+
+//  ---------------------------------------------------------------------------
+
+static float g_FmtFloat = 0;
+static int g_NbFmtGets = 0;
+static void TW_CALL SetFmtFloat(const void *_Value, void *) { g_FmtFloat = *(const float *)_Value; }
+static void TW_CALL GetFmtFloat(void *_Value, void *) { *(float *)_Value = g_FmtFloat; ++g_NbFmtGets; }
+static int g_FmtInt = 0;
+
+// Refreshes and draws the bar "Format", then draws a new bar with the same
+// layout and values, and returns true if both give the same pixels
+static bool IsDrawnAsNewBar(const char *_FloatDef, const char *_IntDef)
+{
+    static unsigned char Ref[WND_WIDTH*WND_HEIGHT*4];
+    TwBar *Bar = TwGetBarByName("Format");
+    TwRefreshBar(Bar);
+    memset(g_Pixels, 0, sizeof(g_Pixels));
+    TwDraw();
+    memcpy(Ref, g_Pixels, sizeof(Ref));
+    TwDefine(" Format visible=false ");
+    TwBar *NewBar = TwNewBar("FormatRef");
+    TwDefine(" FormatRef label=Format position='16 16' size='240 100' color='64 96 128' ");
+    TwAddVarCB(NewBar, "f", TW_TYPE_FLOAT, SetFmtFloat, GetFmtFloat, NULL, _FloatDef);
+    TwAddVarRW(NewBar, "i", TW_TYPE_INT32, &g_FmtInt, _IntDef);
+    memset(g_Pixels, 0, sizeof(g_Pixels));
+    TwDraw();
+    TwDeleteBar(NewBar);
+    TwDefine(" Format visible=true ");
+    return memcmp(Ref, g_Pixels, sizeof(Ref))==0;
+}
+
+// Values are formatted again only if they or their format changed
+static void CheckFormatCache()
+{
+    g_FmtFloat = 0.125f;
+    g_FmtInt = 255;
+    TwBar *Bar = TwNewBar("Format");
+    TwDefine(" Format position='16 16' size='240 100' color='64 96 128' refresh=1000 ");
+    CHECK( TwAddVarCB(Bar, "f", TW_TYPE_FLOAT, SetFmtFloat, GetFmtFloat, NULL, "precision=2")!=0 );
+    CHECK( TwAddVarRW(Bar, "i", TW_TYPE_INT32, &g_FmtInt, "")!=0 );
+    CHECK( IsDrawnAsNewBar("precision=2", "") );
+
+    // an unchanged value is read once per refresh
+    for( int i=0; i<3; ++i )
+    {
+        g_NbFmtGets = 0;
+        CHECK( TwRefreshBar(Bar)!=0 );
+        CHECK( TwDraw()!=0 );
+        CHECK( g_NbFmtGets==1 );
+    }
+
+    // a format change invalidates the cached strings
+    CHECK( TwDefine(" Format/f precision=4 ")!=0 );
+    CHECK( IsDrawnAsNewBar("precision=4", "") );
+    CHECK( !IsDrawnAsNewBar("precision=2", "") );
+    CHECK( TwDefine(" Format/i hexa=true ")!=0 );
+    CHECK( IsDrawnAsNewBar("precision=4", "hexa=true") );
+    CHECK( TwDefine(" Format/i hexa=false ")!=0 );
+    CHECK( IsDrawnAsNewBar("precision=4", "") );
+
+    // so does a value change, even between equal values
+    g_FmtInt = 254;
+    CHECK( IsDrawnAsNewBar("precision=4", "") );
+    g_FmtFloat = 0;
+    CHECK( IsDrawnAsNewBar("precision=4", "") );
+    g_FmtFloat = -g_FmtFloat;
+    CHECK( IsDrawnAsNewBar("precision=4", "") );
+    TwDeleteBar(Bar);
+}
+
+//  ---------------------------------------------------------------------------
+
+// Entries of the enum type of the var _Var of _Bar, as listed by its "enum" attribute
+static bool HasEnum(TwBar *_Bar, const char *_Var, const char *_Entries)
+{
+    char Entries[512];
+    return TwGetParam(_Bar, _Var, "enum", TW_PARAM_CSTRING, sizeof(Entries), Entries)!=0 && strcmp(Entries, _Entries)==0;
+}
+
+// Draws the read-only enum var "e" of the bar "Enum", then the string _Label
+// at the same place, and returns true if both give the same pixels
+static bool IsDrawnAs(TwType _Type, unsigned int _Value, const char *_Label)
+{
+    static unsigned char Ref[WND_WIDTH*WND_HEIGHT*4];
+    static unsigned int E;
+    static char Str[64];
+    E = _Value;
+    strncpy(Str, _Label, sizeof(Str)-1);
+    for( int s=0; s<2; ++s )
+    {
+        TwBar *Bar = TwNewBar("Enum");
+        TwDefine(" Enum position='16 16' size='240 100' color='64 96 128' ");
+        if( s==0 )
+            TwAddVarRO(Bar, "e", _Type, &E, "");
+        else
+            TwAddVarRO(Bar, "e", TW_TYPE_CSSTRING(sizeof(Str)), Str, "");
+        memset(g_Pixels, 0, sizeof(g_Pixels));
+        TwDraw();
+        if( s==0 )
+            memcpy(Ref, g_Pixels, sizeof(Ref));
+        TwDeleteBar(Bar);
+    }
+    return memcmp(Ref, g_Pixels, sizeof(Ref))==0;
+}
+
+// Enum values are found, sorted and relabeled whether they are dense or not,
+// and incrementing an enum var goes through its values in order and wraps
+static void CheckEnums()
+{
+    TwEnumVal Vals[] = { {7, "seven"}, {1000, "thousand"}, {42, "x"}, {-1, "max"}, {42, "forty-two"} };
+    TwType Sparse = TwDefineEnum("Sparse", Vals, 5);
+    CHECK( IsDrawnAs(Sparse, 42, "forty-two") );    // the last duplicate wins
+    CHECK( IsDrawnAs(Sparse, 7, "seven") );
+    CHECK( IsDrawnAs(Sparse, 0xffffffff, "max") );
+    CHECK( IsDrawnAs(Sparse, 43, "43") );           // not in the enum
+    CHECK( !IsDrawnAs(Sparse, 43, "seven") );
+    TwEnumVal DenseVals[] = { {3, "three"}, {1, "one"}, {2, "two"}, {5, "five"}, {4, "four"}, {2, "deux"} };
+    TwType Dense = TwDefineEnum("Dense", DenseVals, 6);
+    CHECK( IsDrawnAs(Dense, 1, "one") && IsDrawnAs(Dense, 2, "deux") && IsDrawnAs(Dense, 5, "five") );
+    CHECK( IsDrawnAs(Dense, 0, "0") && IsDrawnAs(Dense, 6, "6") );
+
+    static unsigned int S = 7, D = 1;
+    TwBar *Bar = TwNewBar("Enums");
+    CHECK( TwAddVarRW(Bar, "s", Sparse, &S, "keyincr=a keydecr=b")!=0 );
+    CHECK( TwAddVarRW(Bar, "d", Dense, &D, "keyincr=c keydecr=d")!=0 );
+    CHECK( HasEnum(Bar, "s", "7 {seven},42 {forty-two},1000 {thousand},4294967295 {max}") );
+    CHECK( HasEnum(Bar, "d", "1 {one},2 {deux},3 {three},4 {four},5 {five}") );
+
+    // increment and decrement wrap around
+    const unsigned int SparseOrder[] = { 7, 42, 1000, 0xffffffff, 7, 42 };
+    for( int i=1; i<6; ++i )
+    {
+        CHECK( TwKeyPressed('a', TW_KMOD_NONE)!=0 );
+        CHECK( S==SparseOrder[i] );
+    }
+    for( int i=4; i>=0; --i )
+    {
+        CHECK( TwKeyPressed('b', TW_KMOD_NONE)!=0 );
+        CHECK( S==SparseOrder[i] );
+    }
+    CHECK( TwKeyPressed('b', TW_KMOD_NONE)!=0 && S==0xffffffff );
+    S = 1000;   // changed by the application
+    CHECK( TwKeyPressed('a', TW_KMOD_NONE)!=0 && S==0xffffffff );
+    S = 8;      // not in the enum: goes to the first value
+    CHECK( TwKeyPressed('b', TW_KMOD_NONE)!=0 && S==7 );
+    for( int i=0; i<5; ++i )
+        CHECK( TwKeyPressed('c', TW_KMOD_NONE)!=0 && D==(unsigned int)(i+1)%5+1 );
+    CHECK( TwKeyPressed('d', TW_KMOD_NONE)!=0 && D==5 );
+
+    // entries added by the "enum" attribute are merged, a dense enum becomes sparse and back
+    CHECK( TwDefine(" Enums/d enum='8 {eight}, 0 {zero}, 2 {two}' ")!=0 );
+    CHECK( HasEnum(Bar, "d", "0 {zero},1 {one},2 {two},3 {three},4 {four},5 {five},8 {eight}") );
+    D = 5;
+    CHECK( TwKeyPressed('c', TW_KMOD_NONE)!=0 && D==8 );
+    CHECK( TwKeyPressed('c', TW_KMOD_NONE)!=0 && D==0 );
+    CHECK( TwKeyPressed('d', TW_KMOD_NONE)!=0 && D==8 );
+    CHECK( TwDefine(" Enums/d enum='7 {seven}, 6 <six>' ")!=0 );
+    CHECK( HasEnum(Bar, "d", "0 {zero},1 {one},2 {two},3 {three},4 {four},5 {five},6 {six},7 {seven},8 {eight}") );
+    CHECK( TwKeyPressed('d', TW_KMOD_NONE)!=0 && D==7 );
+    CHECK( IsDrawnAs(Dense, 6, "six") && IsDrawnAs(Dense, 2, "two") && IsDrawnAs(Dense, 9, "9") );
+
+    // entries parsed before a syntax error are kept
+    CHECK( TwDefine(" Enums/s enum='3 {three}, 4' ")==0 );
+    CHECK( HasEnum(Bar, "s", "3 {three},7 {seven},42 {forty-two},1000 {thousand},4294967295 {max}") );
+    CHECK( IsDrawnAs(Sparse, 3, "three") );
+    TwDeleteBar(Bar);
+}
+
+//  ---------------------------------------------------------------------------
+
+// Hierarchy of the bar "Hier" built by CheckHierarchy: node i is the button
+// "b<i>" or the group "g<i>", listed in display order
+struct CHierNode { int m_Parent; bool m_Group; bool m_Opened; };
+static std::vector<CHierNode> g_Hier;
+static int g_LastClicked = -1;
+static void TW_CALL HierClick(void *_ClientData) { g_LastClicked = (int)(size_t)_ClientData; }
+
+// Nodes displayed by the bar, the way the lines were listed by a full walk of the hierarchy
+static void ListHierLines(std::vector<int>& _Lines)
+{
+    _Lines.clear();
+    std::vector<bool> Shown(g_Hier.size());
+    for( int i=0; i<(int)g_Hier.size(); ++i )
+    {
+        int p = g_Hier[i].m_Parent;
+        Shown[i] = (p<0 || (Shown[p] && g_Hier[p].m_Opened));
+        if( Shown[i] )
+            _Lines.push_back(i);
+    }
+}
+
+// Clicks at the ordinate _Y of the bar and returns the button pressed, or -1
+static int ClickAt(int _Y)
+{
+    g_LastClicked = -1;
+    TwMouseMotion(80, _Y);
+    TwMouseButton(TW_MOUSE_PRESSED, TW_MOUSE_LEFT);
+    TwMouseButton(TW_MOUSE_RELEASED, TW_MOUSE_LEFT);
+    return g_LastClicked;
+}
+
+// The lines displayed by a bar with a large, partly folded hierarchy are the
+// ones listed by a full walk of the hierarchy, while it is scrolled with the
+// wheel and its groups are folded and unfolded
+static void CheckHierarchy()
+{
+    g_Seed = 1;
+    g_Hier.clear();
+    TwBar *Bar = TwNewBar("Hier");
+    TwDefine(" Hier position='16 16' size='240 300' ");
+    char Name[32], Def[64];
+    std::vector<bool> Created;
+    std::vector<int> Path;  // groups containing the next node
+    int Res = 1;
+    while( g_Hier.size()<3000 || g_Hier.back().m_Group )    // no empty group
+    {
+        int i = (int)g_Hier.size();
+        CHierNode Node;
+        Node.m_Parent = Path.empty() ? -1 : Path.back();
+        Node.m_Group = (i>=40 && Random()%6==0);    // the first lines are buttons
+        Node.m_Opened = true;
+        g_Hier.push_back(Node);
+        Created.push_back(false);
+        if( Node.m_Group )
+        {
+            Path.push_back(i);  // the next node is its first child
+            continue;
+        }
+        sprintf(Name, "b%d", i);
+        Def[0] = '\0';
+        if( Node.m_Parent>=0 )
+            sprintf(Def, "group=g%d", Node.m_Parent);
+        Res &= TwAddButton(Bar, Name, HierClick, (void *)(size_t)i, Def);
+        // new groups are created at the end of the bar, then moved into their parent
+        for( int g=Node.m_Parent; g>=0 && !Created[g]; g=g_Hier[g].m_Parent )
+        {
+            Created[g] = true;
+            if( g_Hier[g].m_Parent>=0 )
+            {
+                sprintf(Def, " Hier/g%d group=g%d ", g, g_Hier[g].m_Parent);
+                Res &= TwDefine(Def);
+            }
+        }
+        if( !Path.empty() && Random()%4==0 )
+            Path.pop_back();
+    }
+    for( int i=0; i<(int)g_Hier.size(); ++i )
+        if( g_Hier[i].m_Group && Random()%3==0 )
+        {
+            g_Hier[i].m_Opened = false;
+            sprintf(Def, " Hier/g%d opened=false ", i);
+            Res &= TwDefine(Def);
+        }
+    CHECK( Res!=0 );
+    CHECK( TwDraw()!=0 );
+
+    // position of the lines, and number of lines displayed
+    int Y0 = -1, LineHeight = 0, NbLines = 0;
+    for( int y=16; y<100 && LineHeight==0; ++y )
+    {
+        int Clicked = ClickAt(y);
+        if( Clicked==0 && Y0<0 )
+            Y0 = y;
+        else if( Clicked==1 )
+            LineHeight = y-Y0;
+    }
+    CHECK( Y0>0 && LineHeight>0 );
+    while( NbLines<40 && ClickAt(Y0+LineHeight*NbLines+LineHeight/2)==NbLines )
+        ++NbLines;
+    CHECK( NbLines>=10 && NbLines<40 );
+
+    std::vector<int> Lines;
+    int FirstLine = 0, WheelPos = 0, NbWrongLines = 0;
+    for( int Step=0; Step<400 && NbWrongLines==0; ++Step )
+    {
+        ListHierLines(Lines);
+        int NbHierLines = (int)Lines.size();
+        if( Random()%2==0 )
+        {
+            // each wheel step scrolls one line
+            int NbSteps = (int)(Random()%61)-30;
+            if( Step%50==0 )
+                NbSteps = -NbHierLines; // to the end
+            TwMouseMotion(80, 100);
+            for( int i=0; i<abs(NbSteps); ++i )
+            {
+                int NbDisplayed = std::max(0, std::min(NbLines, NbHierLines-FirstLine));
+                if( NbSteps>0 && FirstLine>0 )
+                    --FirstLine;
+                else if( NbSteps<0 && FirstLine<NbHierLines-NbDisplayed )
+                    ++FirstLine;
+                WheelPos += (NbSteps>0) ? 1 : -1;
+                TwMouseWheel(WheelPos);
+            }
+        }
+        else
+        {
+            // fold or unfold a group of the displayed lines or close to them
+            int Line = std::min(FirstLine+(int)(Random()%(2*NbLines)), NbHierLines-1) - NbLines/2;
+            int g = Lines[std::max(Line, 0)];
+            while( g>=0 && !g_Hier[g].m_Group )
+                g = g_Hier[g].m_Parent;
+            if( g<0 )
+                continue;
+            g_Hier[g].m_Opened = !g_Hier[g].m_Opened;
+            sprintf(Def, " Hier/g%d opened=%s ", g, g_Hier[g].m_Opened ? "true" : "false");
+            Res &= TwDefine(Def);
+        }
+        Res &= TwDraw();
+
+        ListHierLines(Lines);
+        NbHierLines = (int)Lines.size();
+        int NbDisplayed = std::max(0, std::min(NbLines, NbHierLines-FirstLine));
+        for( int l=0; l<NbLines; ++l )
+        {
+            int Node = (l<NbDisplayed) ? Lines[FirstLine+l] : -1;
+            if( Node>=0 && g_Hier[Node].m_Group )
+                continue;   // a click would fold or unfold the group
+            if( ClickAt(Y0+LineHeight*l+LineHeight/2)!=Node )
+                ++NbWrongLines;
+        }
+        if( NbWrongLines>0 )
+            printf("  step %d: wrong lines\n", Step);
+    }
+    CHECK( Res!=0 && NbWrongLines==0 );
+    TwDeleteBar(Bar);
+}
+
+//  ---------------------------------------------------------------------------
+
+struct CHitBar { TwBar *m_Bar; int m_X, m_Y, m_W, m_H; bool m_Iconified; };
+
+// Moves, resizes, iconifies and reorders bars at random, and checks that a
+// click goes to the topmost bar under the mouse
+static void CheckBarHits()
+{
+    g_Seed = 1;
+    const int NbBars = 5;
+    CHitBar Bars[NbBars];
+    std::vector<int> Order;     // from bottom to top
+    char Name[32], Def[128];
+    int Res = 1;
+    for( int b=0; b<NbBars; ++b )
+    {
+        sprintf(Name, "Hit%d", b);
+        Bars[b].m_Bar = TwNewBar(Name);
+        Bars[b].m_X = 20+90*b;
+        Bars[b].m_Y = 10+40*b;
+        Bars[b].m_W = 200;
+        Bars[b].m_H = 160;
+        Bars[b].m_Iconified = false;
+        sprintf(Def, " Hit%d position='%d %d' size='%d %d' ", b, Bars[b].m_X, Bars[b].m_Y, Bars[b].m_W, Bars[b].m_H);
+        Res &= TwDefine(Def);
+        for( int i=0; i<20; ++i )   // the bar is filled with lines of its button
+        {
+            sprintf(Name, "b%d", i);
+            Res &= TwAddButton(Bars[b].m_Bar, Name, HierClick, (void *)(size_t)b, "");
+        }
+        Order.push_back(b);
+    }
+    CHECK( Res!=0 );
+
+    int NbWrongHits = 0, NbHits = 0, NbMisses = 0;
+    for( int Step=0; Step<300 && NbWrongHits==0; ++Step )
+    {
+        int b = (int)(Random()%NbBars);
+        CHitBar& Bar = Bars[b];
+        switch( Random()%5 )
+        {
+        case 0:
+            Bar.m_X = (int)(Random()%(640-Bar.m_W));
+            Bar.m_Y = (int)(Random()%(420-Bar.m_H));
+            sprintf(Def, " Hit%d position='%d %d' ", b, Bar.m_X, Bar.m_Y);
+            break;
+        case 1:
+            Bar.m_W = 200+(int)(Random()%100);
+            Bar.m_H = 120+(int)(Random()%100);
+            Bar.m_X = std::min(Bar.m_X, 640-Bar.m_W);
+            Bar.m_Y = std::min(Bar.m_Y, 420-Bar.m_H);
+            sprintf(Def, " Hit%d size='%d %d' position='%d %d' ", b, Bar.m_W, Bar.m_H, Bar.m_X, Bar.m_Y);
+            break;
+        case 2:
+            Bar.m_Iconified = !Bar.m_Iconified;
+            sprintf(Def, " Hit%d iconified=%s ", b, Bar.m_Iconified ? "true" : "false");
+            break;
+        default:
+            Def[0] = '\0';
+            Order.erase(std::find(Order.begin(), Order.end(), b));
+            if( Random()%2==0 )
+            {
+                Res &= TwSetTopBar(Bar.m_Bar);
+                Order.push_back(b);
+            }
+            else
+            {
+                Res &= TwSetBottomBar(Bar.m_Bar);
+                Order.insert(Order.begin(), b);
+            }
+        }
+        if( Def[0]!='\0' )
+            Res &= TwDefine(Def);
+        if( Random()%2==0 )
+            Res &= TwDraw();
+
+        // click where the expected bar is known
+        for( int i=0; i<8; ++i )
+        {
+            int x = (int)(Random()%640);
+            int y = (int)(Random()%420);
+            if( i%2==0 )
+            {
+                // on the lines of a bar, maybe covered by another one
+                const CHitBar& B = Bars[Random()%NbBars];
+                x = B.m_X+30+(int)(Random()%50);
+                y = B.m_Y+40+(int)(Random()%(B.m_H-70));
+            }
+            int Top = -1;
+            for( int o=NbBars-1; o>=0 && Top<0; --o )
+            {
+                const CHitBar& B = Bars[Order[o]];
+                if( !B.m_Iconified && x>=B.m_X && x<B.m_X+B.m_W && y>=B.m_Y && y<B.m_Y+B.m_H )
+                    Top = Order[o];
+            }
+            if( Top>=0 )
+            {
+                const CHitBar& B = Bars[Top];
+                if( x<B.m_X+30 || x>=B.m_X+80 || y<B.m_Y+40 || y>=B.m_Y+B.m_H-30 )
+                    continue;   // the click may be handled by the title, the scroll bar or a margin
+            }
+            g_LastClicked = -1;
+            Res &= TwDraw();    // so that only the bars under the mouse have a mouse state
+            TwMouseMotion(x, y);
+            TwMouseButton(TW_MOUSE_PRESSED, TW_MOUSE_LEFT);
+            TwMouseButton(TW_MOUSE_RELEASED, TW_MOUSE_LEFT);
+            if( g_LastClicked!=Top )
+                ++NbWrongHits;
+            if( Top>=0 )
+            {
+                // the clicked bar is moved on top
+                Order.erase(std::find(Order.begin(), Order.end(), Top));
+                Order.push_back(Top);
+                if( TwGetTopBar()!=Bars[Top].m_Bar )
+                    ++NbWrongHits;
+                ++NbHits;
+            }
+            else
+                ++NbMisses;
+        }
+        if( NbWrongHits>0 )
+            printf("  step %d: wrong bar\n", Step);
+    }
+    CHECK( Res!=0 && NbWrongHits==0 );
+    CHECK( NbHits>300 && NbMisses>300 );
+    for( int b=0; b<NbBars; ++b )
+        TwDeleteBar(Bars[b].m_Bar);
+}
+
+//  ---------------------------------------------------------------------------
+
+static std::vector<int> g_MergeClicks;
+static void TW_CALL MergeClick(void *_ClientData) { g_MergeClicks.push_back((int)(size_t)_ClientData); }
+
+// Sends the same pseudo-random mouse and key events to two bars, merged by
+// TwBeginEvents/TwEndEvents if _Merge is true. Returns the checksum of the
+// final drawing.
+static unsigned int SendEvents(bool _Merge, float *_Val, int *_NbRejected)
+{
+    static int WheelPos = 0;
+    g_Seed = 1;
+    g_MergeClicks.clear();
+    *_Val = 0;
+    *_NbRejected = 0;
+    TwBar *Bars[2];
+    Bars[0] = TwNewBar("Merge0");
+    Bars[1] = TwNewBar("Merge1");
+    TwDefine(" Merge0 position='16 16' size='240 300' color='64 96 128' ");
+    TwDefine(" Merge1 position='200 100' size='240 300' color='128 96 64' ");
+    char Name[32];
+    for( int b=0; b<2; ++b )
+        for( int i=0; i<40; ++i )
+        {
+            sprintf(Name, "b%d", i);
+            TwAddButton(Bars[b], Name, MergeClick, (void *)(size_t)(100*b+i), "");
+        }
+    TwAddVarRW(Bars[1], "v", TW_TYPE_FLOAT, _Val, "keyincr=k keydecr=K");
+    TwDraw();
+
+    for( int Batch=0; Batch<200; ++Batch )
+    {
+        if( _Merge )
+            TwBeginEvents();
+        int NbEvents = 1+(int)(Random()%12);
+        for( int e=0; e<NbEvents; ++e )
+        {
+            int r = (int)(Random()%100);
+            if( r<60 )
+            {
+                // mostly on the lines of the bars, where they are highlighted
+                int x = 40+(int)(Random()%380);
+                int y = 50+(int)(Random()%330);
+                if( TwMouseMotion(x, y)!=0 && _Merge )
+                    ++*_NbRejected;
+            }
+            else if( r<85 )
+            {
+                WheelPos += (Random()%3==0) ? 1 : -1;
+                if( TwMouseWheel(WheelPos)!=0 && _Merge )
+                    ++*_NbRejected;
+            }
+            else if( r<95 )
+            {
+                // buttons are pressed where the last motion went
+                TwMouseButton(TW_MOUSE_PRESSED, TW_MOUSE_LEFT);
+                TwMouseButton(TW_MOUSE_RELEASED, TW_MOUSE_LEFT);
+            }
+            else
+                TwKeyPressed((Random()%2==0) ? 'k' : 'K', TW_KMOD_NONE);
+        }
+        if( _Merge )
+            TwEndEvents();
+        if( Random()%4==0 )
+            TwDraw();
+    }
+    memset(g_Pixels, 0, sizeof(g_Pixels));
+    TwDraw();
+    unsigned int Sum = PixelsChecksum();
+    TwDeleteBar(Bars[0]);
+    TwDeleteBar(Bars[1]);
+    return Sum;
+}
+
+// Merged mouse motions and wheel steps give the same result as the events
+// sent one by one, buttons and keys being processed after the motions
+// that precede them
+static void CheckMergedEvents()
+{
+    float Val, MergedVal;
+    int NbRejected;
+    unsigned int Sum = SendEvents(false, &Val, &NbRejected);
+    std::vector<int> Clicks = g_MergeClicks;
+    unsigned int MergedSum = SendEvents(true, &MergedVal, &NbRejected);
+    CHECK( Clicks.size()>20 && Val!=0 );
+    CHECK( g_MergeClicks==Clicks );
+    CHECK( MergedVal==Val );
+    CHECK( MergedSum==Sum );
+    CHECK( NbRejected==0 );
+
+    // a batch returns if one of its events has been handled
+    CHECK( TwBeginEvents()!=0 );
+    CHECK( TwMouseMotion(600, 470)==0 );
+    CHECK( TwEndEvents()==0 );
+    TwBar *Bar = TwNewBar("Merge");
+    TwDefine(" Merge position='16 16' size='240 300' ");
+    CHECK( TwBeginEvents()!=0 && TwBeginEvents()!=0 );  // nested
+    CHECK( TwMouseMotion(100, 100)==0 );
+    CHECK( TwEndEvents()==0 );
+    CHECK( TwEndEvents()!=0 );
+    CHECK( TwEndEvents()==0 );  // not in a batch
+    TwDeleteBar(Bar);
+}
+
+//  ---------------------------------------------------------------------------
+
+static bool HasLabel(TwBar *_Bar, const char *_Var, const char *_Label)
+{
+    char Label[256];
+    return TwGetParam(_Bar, _Var, "label", TW_PARAM_CSTRING, sizeof(Label), Label)!=0 && strcmp(Label, _Label)==0;
+}
+
+// Runs _Def with TwDefine, or compiled if _Compiled is true
+static int Define(const char *_Def, bool _Compiled)
+{
+    if( !_Compiled )
+        return TwDefine(_Def);
+    TwCompiledDefine *Def = TwCompileDefine(_Def);
+    if( Def==NULL )
+        return 0;
+    int Res = TwApplyCompiledDefine(Def);
+    TwDeleteCompiledDefine(Def);
+    return Res;
+}
+
+// Quoted names and values, case and optional values are parsed the same way
+// by TwDefine and compiled defines, and errors report the faulty token
+static void CheckDefineParsing()
+{
+    static int V = 0;
+    TwBar *Bar = TwNewBar("Def Bar");
+    CHECK( TwAddVarRW(Bar, "v", TW_TYPE_INT32, &V, "")!=0 );
+    for( int c=0; c<2; ++c )
+    {
+        bool Compiled = (c==1);
+        CHECK( Define(" 'Def Bar'/v label='a b' READONLY hexa ", Compiled)!=0 );
+        CHECK( HasLabel(Bar, "v", "a b") );
+        CHECK( Define(" 'Def Bar'/v readonly=false 'label'=x\n`Def Bar`/v Label = \"y z\" ", Compiled)!=0 );
+        CHECK( HasLabel(Bar, "v", "y z") );
+        CHECK( Define(" 'Def Bar'/v 'lab'el=q ", Compiled)!=0 );
+        CHECK( HasLabel(Bar, "v", "q") );
+
+        CHECK( Define(" 'Def Bar'/v labelx=3 min=0 ", Compiled)==0 );
+        CHECK( strstr(TwGetLastError(), "Unknown attribute [labelx          ...]")!=NULL );
+        CHECK( Define(" 'Def Bar'/w label=3 ", Compiled)==0 );
+        CHECK( strstr(TwGetLastError(), "Variable not found ['Def Bar'/w     ...]")!=NULL );
+        CHECK( Define(" 'Def Bar'/v label ", Compiled)==0 );
+        CHECK( strstr(TwGetLastError(), "[label           ...]")!=NULL );
+        CHECK( Define(" 'Def Bar'/v 'label=3 ", Compiled)==0 );
+    }
+    TwDeleteBar(Bar);
+}
+
+//  ---------------------------------------------------------------------------
+
+#if defined(_WIN32)
+static DWORD WINAPI ThreadProc(LPVOID _Func) { ((void (*)())_Func)(); return 0; }
+#else
+static void *ThreadProc(void *_Func) { ((void (*)())_Func)(); return NULL; }
+#endif
+
+// Run _Func in a new thread and wait for its end
+static void RunInThread(void (*_Func)())
+{
+#if defined(_WIN32)
+    HANDLE Thread = CreateThread(NULL, 0, ThreadProc, (LPVOID)_Func, 0, NULL);
+    WaitForSingleObject(Thread, INFINITE);
+    CloseHandle(Thread);
+#else
+    pthread_t Thread;
+    pthread_create(&Thread, NULL, ThreadProc, (void *)_Func);
+    pthread_join(Thread, NULL);
+#endif
+}
+
+static TwBar *g_ThreadBar = NULL;
+static TwMailbox *g_Mailbox = NULL;
+static float g_ThreadVal = 0;
+static int g_WorkerRes[8];
+
+static void Worker()
+{
+    static float F = 0;
+    g_WorkerRes[0] = TwAddVarRW(g_ThreadBar, "w", TW_TYPE_FLOAT, &F, "");
+    g_WorkerRes[1] = TwDefine(" Thread/v label=W ");
+    g_WorkerRes[2] = (TwNewMailbox(g_ThreadBar, "v")!=NULL);
+    g_WorkerRes[3] = TwKeyPressed('v', TW_KMOD_NONE);
+    g_WorkerRes[4] = TwMouseMotion(1, 1);
+    g_WorkerRes[6] = TwEventsQueued();
+    g_WorkerRes[7] = TwDraw();
+    for( int i=1; i<=1000; ++i )
+    {
+        float Val = (float)(100*i);
+        g_WorkerRes[5] = TwPublishVarValue(g_Mailbox, &Val);
+    }
+}
+
+// Functions that modify bars fail when called from another thread than the
+// render thread, input is queued, and mailboxes pass values to TwDraw
+static void CheckThreads()
+{
+    g_ThreadBar = TwNewBar("Thread");
+    CHECK( TwAddVarRW(g_ThreadBar, "v", TW_TYPE_FLOAT, &g_ThreadVal, "key=v")!=0 );
+    g_Mailbox = TwNewMailbox(g_ThreadBar, "v");
+    CHECK( g_Mailbox!=NULL );
+    CHECK( TwDraw()!=0 );
+
+    RunInThread(Worker);
+    CHECK( g_WorkerRes[0]==0 && g_WorkerRes[1]==0 && g_WorkerRes[2]==0 );
+    CHECK( g_WorkerRes[3]==0 && g_WorkerRes[4]==0 && g_WorkerRes[6]==1 );
+    CHECK( g_WorkerRes[5]==1 && g_WorkerRes[7]==0 );
+    CHECK( !VarExists(g_ThreadBar, "w") );
+    CHECK( g_ThreadVal==0 );
+
+    // the key is processed first, then the last value published is applied
+    CHECK( TwDraw()!=0 );
+    CHECK( TwEventsQueued()==0 );
+    CHECK( g_ThreadVal==100000 );
+    CHECK( TwKeyPressed('v', TW_KMOD_NONE)==1 );
+    CHECK( g_ThreadVal==100001 );
+    CHECK( TwDeleteMailbox(g_Mailbox)!=0 );
+    CHECK( TwDeleteMailbox(g_Mailbox)==0 );
+}
+
+//  ---------------------------------------------------------------------------
+
+static int g_NbFormatDiffs = 0;
+
+// Compare the text written by a TwFormat function with snprintf. Only the
+// first differences are printed.
+static void CompareFormat(const char *_Text, int _Len, const char *_Format, ...)
+{
+    char Ref[TW_FORMAT_BUFFER_SIZE];
+    va_list Args;
+    va_start(Args, _Format);
+    int RefLen = vsnprintf(Ref, sizeof(Ref), _Format, Args);
+    va_end(Args);
+    if( RefLen!=_Len || strcmp(Ref, _Text)!=0 )
+    {
+        if( g_NbFormatDiffs<10 )
+            printf("  format \"%s\": \"%s\" instead of \"%s\"\n", _Format, _Text, Ref);
+        ++g_NbFormatDiffs;
+    }
+}
+
+// Random double from random bits: all exponents, denormals, infinities and NaNs
+static double RandomBits()
+{
+    unsigned long long Bits = 0;
+    for( int i=0; i<3; ++i )
+        Bits = (Bits<<24) ^ Random();
+    double Val;
+    memcpy(&Val, &Bits, sizeof(Val));
+    return Val;
+}
+
+// Random decimal value k/10^p of magnitude around 10^e, or one ulp away:
+// rounding ties of printf are at these values
+static double RandomDecimal()
+{
+    static const double Pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8 };
+    double Val = (double)(Random()%1000000) / Pow10[Random()%9];
+    if( Random()%2 )
+        Val *= Pow10[Random()%9];
+    switch( Random()%4 )
+    {
+    case 0:     Val = nextafter(Val, 0.0); break;
+    case 1:     Val = nextafter(Val, 1.0e300); break;
+    default:    break;
+    }
+    return (Random()%2) ? -Val : Val;
+}
+
+// TwFormatInt, UInt, Hex, Fixed and General write the same text as snprintf
+static void CheckFormat()
+{
+    char Buf[TW_FORMAT_BUFFER_SIZE];
+    static const int Ints[] = { 0, 1, -1, 9, 10, -10, 99, 100, 12345, -99999, 100000, 999999999, 1000000000, INT_MAX, INT_MIN, INT_MIN+1 };
+    static const double Reals[] = { 0.0, -0.0, 1.0, -1.0, 0.5, 1.5, 2.5, -0.5, 0.05, 0.15, 0.125, 1.005, 0.1, 0.2, 0.3, 123.456, 1.0e-5, 9.99999e-5, 1.0e-4, 0.000999999,
+                                    999999.0, 999999.5, 9999995.0, 1.0e6, 1.0e15, 4.5e15, 1.0e16, 1.0e21, 1.0e300, 1.0e-300, FLT_MAX, FLT_MIN, DBL_MAX, DBL_MIN, DBL_MIN/2, 4.9406564584124654e-324 };
+    const int NbInts = (int)(sizeof(Ints)/sizeof(Ints[0]));
+    const int NbReals = (int)(sizeof(Reals)/sizeof(Reals[0]));
+    const int NbRandom = 10000;
+    const int MaxPrecision = 16;
+
+    g_NbFormatDiffs = 0;
+    for( int i=0; i<NbInts+NbRandom; ++i )
+    {
+        int Val = (i<NbInts) ? Ints[i] : (int)(Random()<<8 ^ Random());
+        if( i>=NbInts && i%2 )
+            Val >>= Random()%32;
+        CompareFormat(Buf, TwFormatInt(Buf, Val), "%d", Val);
+        CompareFormat(Buf, TwFormatUInt(Buf, (unsigned int)Val), "%u", (unsigned int)Val);
+        for( int d=0; d<=10; ++d )
+            CompareFormat(Buf, TwFormatHex(Buf, (unsigned int)Val, d), "0x%.*X", d, (unsigned int)Val);
+    }
+    CHECK( g_NbFormatDiffs==0 );
+
+    g_NbFormatDiffs = 0;
+    double Inf = HUGE_VAL;
+    double Specials[] = { Inf, -Inf, Inf-Inf, -(Inf-Inf) };
+    for( int i=0; i<NbReals+4+3*NbRandom; ++i )
+    {
+        double Val;
+        if( i<NbReals )
+            Val = Reals[i];
+        else if( i<NbReals+4 )
+            Val = Specials[i-NbReals];
+        else if( i%3==0 )
+            Val = RandomBits();
+        else if( i%3==1 )
+            Val = RandomDecimal();
+        else
+            Val = (float)RandomDecimal();   // values of float vars
+        CompareFormat(Buf, TwFormatGeneral(Buf, Val), "%g", Val);
+        for( int p=0; p<=MaxPrecision; ++p )
+            CompareFormat(Buf, TwFormatFixed(Buf, Val, p), "%.*f", p, Val);
+    }
+    CHECK( g_NbFormatDiffs==0 );
+}
+
+//  ---------------------------------------------------------------------------
+
+// Known bar layouts are drawn with the same pixels, with or without the SSE2
+// span kernels of the software rasterizer
+static void CheckGoldenBars()
+{
+    static float F = 0.25f;
+    static int I = -12;
+    static bool B = true;
+    static float Col[4] = { 1, 0.5f, 0.25f, 0.5f };
+    static float Quat[4] = { 0.2f, 0.3f, 0.1f, 0.927f };
+    static char Str[32] = "golden";
+    struct CLayout { const char *m_Def; unsigned int m_Checksum; };
+    const CLayout Layouts[] =
+    {
+        { " Golden position='16 16' size='240 320' color='64 96 128' alpha=255 ",           0xEA10D931 },
+        { " Golden position='37 23' size='251 333' color='200 40 90' alpha=100 ",           0x5B792912 },
+        { " Golden position='5 9' size='301 400' color='10 200 30' alpha=0 text=dark ",     0x9B1B986F }
+    };
+    const int NbLayouts = (int)(sizeof(Layouts)/sizeof(Layouts[0]));
+
+    TwBar *Bar = TwNewBar("Golden");
+    CHECK( TwAddVarRW(Bar, "f", TW_TYPE_FLOAT, &F, "step=0.01 group=G")!=0 );
+    CHECK( TwAddVarRW(Bar, "i", TW_TYPE_INT32, &I, "group=G")!=0 );
+    CHECK( TwAddVarRW(Bar, "b", TW_TYPE_BOOLCPP, &B, "")!=0 );
+    CHECK( TwAddVarRW(Bar, "col", TW_TYPE_COLOR4F, Col, "opened=true")!=0 );
+    CHECK( TwAddVarRW(Bar, "quat", TW_TYPE_QUAT4F, Quat, "opened=true")!=0 );
+    CHECK( TwAddVarRW(Bar, "str", TW_TYPE_CSSTRING(sizeof(Str)), Str, "")!=0 );
+    CHECK( TwAddSeparator(Bar, NULL, "")!=0 );
+    CHECK( TwAddButton(Bar, "Run", NULL, NULL, "label='Golden label'")!=0 );
+    for( int l=0; l<NbLayouts; ++l )
+    {
+        CHECK( TwDefine(Layouts[l].m_Def)!=0 );
+        memset(g_Pixels, 0x40, sizeof(g_Pixels));
+        CHECK( TwDraw()!=0 );
+        unsigned int Sum = PixelsChecksum();
+        if( Sum!=Layouts[l].m_Checksum )
+            printf("  layout %d: checksum 0x%08X\n", l, Sum);
+        CHECK( Sum==Layouts[l].m_Checksum );
+    }
+}
+
+//  ---------------------------------------------------------------------------
+
+int main()
+{
+    struct CTest { const char *m_Name; void (*m_Func)(); };
+    static const CTest Tests[] =
+    {
+        { "var names",  CheckVarNames },
+        { "var batch",  CheckAddVarsBatch },
+        { "redraw",     CheckNeedsRedraw },
+        { "popup keys", CheckPopupKeys },
+        { "enums",      CheckEnums },
+        { "struct gets", CheckStructGets },
+        { "format cache", CheckFormatCache },
+        { "hierarchy",  CheckHierarchy },
+        { "bar hits",   CheckBarHits },
+        { "merged events", CheckMergedEvents },
+        { "define",     CheckDefineParsing },
+        { "threads",    CheckThreads },
+        { "format",     CheckFormat },
+        { "golden bars", CheckGoldenBars }
+    };
+    const int NbTests = (int)(sizeof(Tests)/sizeof(Tests[0]));
+    TwHandleErrors(IgnoreError);
+
+    for( int t=0; t<NbTests; ++t )
+    {
+        int NbFailed = g_NbFailed;
+        printf("%s\n", Tests[t].m_Name);
+        TwSoftwareBuffer Buffer = { g_Pixels, WND_WIDTH, WND_HEIGHT, 0 };
+        if( !TwInit(TW_SOFTWARE, &Buffer) )
+        {
+            printf("  FAILED: TwInit: %s\n", TwGetLastError());
+            ++g_NbFailed;
+            continue;
+        }
+        TwWindowSize(WND_WIDTH, WND_HEIGHT);
+        Tests[t].m_Func();
+        TwTerminate();
+        if( g_NbFailed>NbFailed )
+            printf("  %d check(s) failed\n", g_NbFailed-NbFailed);
+    }
+    printf("%d checks, %d failed\n", g_NbChecks, g_NbFailed);
+    return (g_NbFailed>0) ? 1 : 0;
+}